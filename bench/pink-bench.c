@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pink-bench: measure the cost of the core primitives reading tracee memory
+ * and registers
+ *
+ * The tracee is a forked copy of the benchmark stopped with SIGSTOP, so the
+ * buffers set up before the fork are found at the same addresses in it.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#include <pinktrace/pink.h>
+
+/* Room around the buffers for the alignment sweep */
+#define BENCH_SLACK		64
+#define BENCH_PAGE		4096
+
+static const size_t sizes[] = { 8, 64, 512, 4096, 65536 };
+static const unsigned aligns[] = { 0, 1, 4, 7 };
+#define NSIZES			(sizeof(sizes) / sizeof(sizes[0]))
+#define NALIGNS			(sizeof(aligns) / sizeof(aligns[0]))
+/* Strings are at most this long */
+#define BENCH_STRING_MAX	4096
+#define BENCH_STRING_STRIDE	(BENCH_STRING_MAX + BENCH_PAGE)
+
+enum format {
+	FORMAT_CSV,
+	FORMAT_JSON,
+};
+
+struct bench {
+	const char *primitive;
+	const char *backend;
+	/* Runs the primitive once, returns the system calls it made outside
+	 * of libpinktrace, -1 on failure */
+	int (*run)(const struct bench *b, size_t size, unsigned align);
+	/* Whether the size sweep only goes up to BENCH_STRING_MAX */
+	bool strings;
+	/* Whether there's no size and alignment to sweep */
+	bool single;
+};
+
+static pid_t tracee;
+static int mem_fd = -1;
+static char *arena;
+static char *strings;
+static long *string_table;
+static char *dest;
+
+static enum format format = FORMAT_CSV;
+static unsigned repeats = 5;
+static uint64_t repeat_ns = 20000000ULL;
+static const char *only;
+static bool first = true;
+static struct utsname uts;
+
+static void usage(FILE *f)
+{
+	fprintf(f, "Usage: pink-bench [-h] [-f csv|json] [-r repeats] [-t ms] [-p primitive]\n"
+			"Measure the cost of the core primitives reading tracee memory\n"
+			"  -f format     Output format, defaults to csv\n"
+			"  -r repeats    Number of repeats per case, the median is reported, defaults to 5\n"
+			"  -t ms         Duration of a repeat in milliseconds, defaults to 20\n"
+			"  -p primitive  Only measure this primitive\n");
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static char *string_at(size_t size, unsigned align)
+{
+	unsigned i, j;
+
+	for (i = 0; sizes[i] != size; i++)
+		;
+	for (j = 0; aligns[j] != align; j++)
+		;
+	return strings + (i * NALIGNS + j) * BENCH_STRING_STRIDE + align;
+}
+
+static unsigned string_index(size_t size, unsigned align)
+{
+	return (string_at(size, align) - strings) / BENCH_STRING_STRIDE;
+}
+
+static int run_moven(const struct bench *b, size_t size, unsigned align)
+{
+	return pink_util_moven(tracee, (long)(arena + align), dest, size) ? 0 : -1;
+}
+
+static int run_process_vm_readv(const struct bench *b, size_t size, unsigned align)
+{
+#ifdef __NR_process_vm_readv
+	struct iovec local, remote;
+
+	local.iov_base = dest;
+	remote.iov_base = arena + align;
+	local.iov_len = remote.iov_len = size;
+	return syscall(__NR_process_vm_readv, (long)tracee, &local, 1UL, &remote, 1UL, 0UL)
+		== (long)size ? 1 : -1;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static int run_proc_mem(const struct bench *b, size_t size, unsigned align)
+{
+	return pread(mem_fd, dest, size, (off_t)(uintptr_t)(arena + align))
+		== (ssize_t)size ? 1 : -1;
+}
+
+static int run_movestr(const struct bench *b, size_t size, unsigned align)
+{
+	return pink_util_movestr(tracee, (long)string_at(size, align), dest, size + 1) ? 0 : -1;
+}
+
+static int run_get_arg(const struct bench *b, size_t size, unsigned align)
+{
+	long arg;
+
+	return pink_util_get_arg(tracee, PINKTRACE_BITNESS_DEFAULT, 0, &arg) ? 0 : -1;
+}
+
+static int run_string_array_member(const struct bench *b, size_t size, unsigned align)
+{
+	bool nil;
+
+	return pink_decode_string_array_member(tracee, PINKTRACE_BITNESS_DEFAULT,
+			(long)string_table, string_index(size, align),
+			dest, size + 1, &nil) && !nil ? 0 : -1;
+}
+
+static const struct bench benches[] = {
+	{ "moven", "peekdata", run_moven, false, false },
+	{ "moven", "process_vm_readv", run_process_vm_readv, false, false },
+	{ "moven", "proc_mem", run_proc_mem, false, false },
+	{ "movestr", "peekdata", run_movestr, true, false },
+	{ "get_arg", "ptrace", run_get_arg, false, true },
+	{ "decode_string_array_member", "peekdata", run_string_array_member, true, false },
+};
+
+/* Whatever the backend, the data read must be the data of the tracee */
+static bool verify(const struct bench *b, size_t size, unsigned align)
+{
+	if (b->single)
+		return true;
+	if (b->strings)
+		return !memcmp(dest, string_at(size, align), size + 1);
+	return !memcmp(dest, arena + align, size);
+}
+
+static int compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const struct bench *b, size_t size, unsigned align,
+		unsigned long ops, double median, double min, double syscalls)
+{
+	if (format == FORMAT_CSV) {
+		if (first)
+			printf("kernel,primitive,backend,size,align,ops,ns_per_op,ns_per_op_min,syscalls_per_op\n");
+		printf("%s,%s,%s,%zu,%u,%lu,%.1f,%.1f,%.2f\n", uts.release,
+				b->primitive, b->backend, size, align, ops,
+				median, min, syscalls);
+	} else {
+		printf("%s\n    {\"primitive\": \"%s\", \"backend\": \"%s\", \"size\": %zu, "
+				"\"align\": %u, \"ops\": %lu, \"ns_per_op\": %.1f, "
+				"\"ns_per_op_min\": %.1f, \"syscalls_per_op\": %.2f}",
+				first ? "" : ",", b->primitive, b->backend, size, align, ops,
+				median, min, syscalls);
+	}
+	first = false;
+}
+
+static bool measure(const struct bench *b, size_t size, unsigned align)
+{
+	int r;
+	unsigned long ops, total_ops, calls;
+	uint64_t start, elapsed;
+	double ns[repeats];
+	pink_trace_account_t account;
+
+	/* Count the system calls in an untimed pass, the accounting itself
+	 * reads the clock around every request */
+	memset(dest, 0, size + 1);
+	memset(&account, 0, sizeof(account));
+	pink_trace_set_account(&account);
+	r = b->run(b, size, align);
+	pink_trace_set_account(NULL);
+	if (r < 0) {
+		fprintf(stderr, "pink-bench: %s (%s) size:%zu align:%u: %s\n",
+				b->primitive, b->backend, size, align, strerror(errno));
+		return false;
+	}
+	if (!verify(b, size, align)) {
+		fprintf(stderr, "pink-bench: %s (%s) size:%zu align:%u: wrong data\n",
+				b->primitive, b->backend, size, align);
+		exit(EXIT_FAILURE);
+	}
+	calls = r + account.regs_calls + account.mem_calls + account.ctl_calls;
+
+	total_ops = 0;
+	for (unsigned i = 0; i < repeats; i++) {
+		ops = 0;
+		start = now();
+		do {
+			if (b->run(b, size, align) < 0) {
+				fprintf(stderr, "pink-bench: %s (%s): %s\n",
+						b->primitive, b->backend, strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			ops++;
+		} while ((elapsed = now() - start) < repeat_ns);
+		ns[i] = (double)elapsed / ops;
+		total_ops += ops;
+	}
+
+	qsort(ns, repeats, sizeof(ns[0]), compare);
+	report(b, size, align, total_ops, ns[repeats / 2], ns[0], (double)calls);
+	return true;
+}
+
+/* Copy of the benchmark which waits to be read */
+static pid_t spawn_tracee(void)
+{
+	int status;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (!pid) {
+		if (!pink_trace_me())
+			_exit(127);
+		kill(getpid(), SIGSTOP);
+		for (;;)
+			pause();
+	}
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+		kill(pid, SIGKILL);
+		errno = ECHILD;
+		return -1;
+	}
+	return pid;
+}
+
+static bool setup(void)
+{
+	size_t len;
+
+	len = sizes[NSIZES - 1] + BENCH_SLACK;
+	if (posix_memalign((void **)&arena, BENCH_PAGE, len)
+			|| posix_memalign((void **)&strings, BENCH_PAGE,
+				NSIZES * NALIGNS * BENCH_STRING_STRIDE)
+			|| !(string_table = calloc(NSIZES * NALIGNS + 1, sizeof(long)))
+			|| !(dest = malloc(len)))
+		return false;
+
+	for (size_t i = 0; i < len; i++)
+		arena[i] = (char)(i * 131 + 7);
+	for (unsigned i = 0; i < NSIZES; i++) {
+		if (sizes[i] > BENCH_STRING_MAX)
+			break;
+		for (unsigned j = 0; j < NALIGNS; j++) {
+			char *s = string_at(sizes[i], aligns[j]);
+			for (size_t k = 0; k < sizes[i]; k++)
+				s[k] = 'a' + k % 26;
+			s[sizes[i]] = '\0';
+			string_table[i * NALIGNS + j] = (long)s;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	bool ok = true;
+	char *end, path[32];
+	unsigned long val;
+
+	while ((opt = getopt(argc, argv, "hf:r:t:p:")) != -1) {
+		switch (opt) {
+		case 'h':
+			usage(stdout);
+			return EXIT_SUCCESS;
+		case 'f':
+			if (!strcmp(optarg, "csv"))
+				format = FORMAT_CSV;
+			else if (!strcmp(optarg, "json"))
+				format = FORMAT_JSON;
+			else {
+				fprintf(stderr, "pink-bench: invalid format `%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+		case 't':
+			val = strtoul(optarg, &end, 10);
+			if (*end || !val || val > 100000) {
+				fprintf(stderr, "pink-bench: invalid number `%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			if (opt == 'r')
+				repeats = val;
+			else
+				repeat_ns = val * 1000000ULL;
+			break;
+		case 'p':
+			only = optarg;
+			break;
+		default:
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	uname(&uts);
+	if (!setup()) {
+		perror("pink-bench: setup");
+		return EXIT_FAILURE;
+	}
+	tracee = spawn_tracee();
+	if (tracee < 0) {
+		perror("pink-bench: spawn");
+		return EXIT_FAILURE;
+	}
+	snprintf(path, sizeof(path), "/proc/%ld/mem", (long)tracee);
+	mem_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (format == FORMAT_JSON)
+		printf("{\n  \"kernel\": \"%s\",\n  \"machine\": \"%s\",\n  \"results\": [",
+				uts.release, uts.machine);
+	for (unsigned i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		const struct bench *b = &benches[i];
+
+		if (only && strcmp(only, b->primitive))
+			continue;
+		if (b->run == run_proc_mem && mem_fd < 0) {
+			fprintf(stderr, "pink-bench: %s: %s, skipping\n", path, strerror(errno));
+			continue;
+		}
+		if (b->single) {
+			ok = measure(b, 0, 0) && ok;
+			continue;
+		}
+		for (unsigned s = 0; s < NSIZES; s++) {
+			if (b->strings && sizes[s] > BENCH_STRING_MAX)
+				break;
+			for (unsigned a = 0; a < NALIGNS; a++) {
+				if (!measure(b, sizes[s], aligns[a])) {
+					ok = false;
+					/* The backend isn't available */
+					s = NSIZES;
+					break;
+				}
+			}
+		}
+	}
+	if (format == FORMAT_JSON)
+		printf("\n  ]\n}\n");
+
+	if (mem_fd >= 0)
+		close(mem_fd);
+	pink_trace_kill(tracee);
+	waitpid(tracee, NULL, 0);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_ARCHIVE_H
+#define _PINK_EASY_ARCHIVE_H
+
+/**
+ * @file pinktrace/easy/archive.h
+ * @brief Pink's easy columnar trace archives
+ * @defgroup pink_easy_archive Pink's easy columnar trace archives
+ * @ingroup pinktrace-easy
+ *
+ * Archives keep events for long term storage. Events are grouped into
+ * blocks; each block stores its times, process IDs, system call numbers,
+ * return values and strings as separate columns, delta and variable length
+ * encoded, with a dictionary of the distinct strings of the block. An index
+ * at the end of the file records the time range and the process IDs and
+ * system calls of each block, so queries skip the blocks which can't match
+ * without decoding them.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/recorder.h>
+
+PINK_BEGIN_DECL
+
+/** Magic at the start of archives **/
+#define PINK_EASY_ARCHIVE_MAGIC		"PINKARC"
+
+/** Version of the archive format **/
+#define PINK_EASY_ARCHIVE_VERSION	1
+
+/**
+ * @brief An archived event
+ **/
+typedef struct {
+	/** Time of the event, in nanoseconds **/
+	uint64_t time;
+	/** Process ID **/
+	pid_t pid;
+	/** System call number **/
+	long scno;
+	/** Return value **/
+	long retval;
+	/** String, e.g. a path, NULL if there is none **/
+	const char *string;
+} pink_easy_archive_event_t;
+
+/**
+ * @brief Filter of archive queries
+ **/
+typedef struct {
+	/** Process ID, 0 for any **/
+	pid_t pid;
+	/** System call number, -1 for any **/
+	long scno;
+	/** Lower and upper bound of the time, inclusive **/
+	uint64_t time_min, time_max;
+} pink_easy_archive_filter_t;
+
+/**
+ * @struct pink_easy_archive_writer_t
+ * @brief Opaque structure which represents an archive being written
+ **/
+typedef struct pink_easy_archive_writer pink_easy_archive_writer_t;
+
+/**
+ * @struct pink_easy_archive_t
+ * @brief Opaque structure which represents an archive opened for queries
+ **/
+typedef struct pink_easy_archive pink_easy_archive_t;
+
+/**
+ * Query callback
+ *
+ * @param event Matching event, the string is valid until the callback
+ *        returns
+ * @param data User data
+ * @return true to continue the query, false to stop it
+ **/
+typedef bool (*pink_easy_archive_func_t) (const pink_easy_archive_event_t *event, void *data);
+
+/**
+ * Create an archive
+ *
+ * @param path Path of the archive, truncated if it exists
+ * @param block_events Number of events per block, 0 for the default of 4096
+ * @return Archive writer on success, NULL on failure and sets errno
+ *         accordingly
+ *
+ * @since 0.2.0
+ **/
+pink_easy_archive_writer_t *pink_easy_archive_writer_new(const char *path,
+		unsigned block_events)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add an event to an archive. Events are written out a block at a time;
+ * once writing a block fails the writer is stopped and this function, as
+ * well as pink_easy_archive_writer_close(), fails with the same errno.
+ *
+ * @param writer Archive writer
+ * @param event Event, the string is copied
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_archive_writer_add(pink_easy_archive_writer_t *writer,
+		const pink_easy_archive_event_t *event)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Add the record of a system call exit, read with
+ * pink_easy_record_reader_next(), to an archive. The payload of the record
+ * becomes the string of the event, up to the first zero byte. Records of
+ * system call entries are skipped.
+ *
+ * @param writer Archive writer
+ * @param record Record
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_archive_writer_add_record(pink_easy_archive_writer_t *writer,
+		const pink_easy_record_t *record)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Write the last block and the index, close the archive and free the
+ * writer
+ *
+ * @param writer Archive writer
+ * @return true on success, false on failure and sets errno accordingly, the
+ *         writer is freed either way
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_archive_writer_close(pink_easy_archive_writer_t *writer)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Open an archive for queries
+ *
+ * @param path Path of the archive
+ * @return Archive on success, NULL on failure and sets errno accordingly,
+ *         @e EINVAL if the file isn't an archive of a known version and
+ *         byte order, or it is incomplete
+ *
+ * @since 0.2.0
+ **/
+pink_easy_archive_t *pink_easy_archive_open(const char *path)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Call a function for each event matching a filter, in the order the events
+ * were added
+ *
+ * @param archive Archive
+ * @param filter Filter, NULL to match every event
+ * @param func Function to call
+ * @param data User data to pass to the function
+ * @return true on success, also if the function stopped the query, false if
+ *         a block is corrupt and sets errno to @e EINVAL
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_archive_query(pink_easy_archive_t *archive,
+		const pink_easy_archive_filter_t *filter,
+		pink_easy_archive_func_t func, void *data)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Returns the number of blocks of an archive
+ *
+ * @param archive Archive
+ * @return Number of blocks
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_archive_get_blocks(const pink_easy_archive_t *archive)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the number of blocks the last query decoded, the index ruled out
+ * the others
+ *
+ * @param archive Archive
+ * @return Number of blocks
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_archive_get_blocks_decoded(const pink_easy_archive_t *archive)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Close an archive
+ *
+ * @param archive Archive
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_archive_close(pink_easy_archive_t *archive)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
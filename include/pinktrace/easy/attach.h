@@ -48,6 +48,10 @@ PINK_BEGIN_DECL
  * Call this multiple times before pink_easy_loop() to attach to multiple
  * processes.
  *
+ * @note If pink_easy_context_set_seize() is enabled, the process is attached
+ *       with @e PTRACE_SEIZE and stopped with @e PTRACE_INTERRUPT rather than
+ *       @e SIGSTOP.
+ *
  * @param ctx Tracing context
  * @param pid Process ID
  * @param ppid Parent process ID. Use this to specify the parent of the process
@@ -59,6 +63,57 @@ PINK_BEGIN_DECL
 bool pink_easy_attach(pink_easy_context_t *ctx, pid_t pid, pid_t ppid)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Makes pink_easy_attach_tree() attach to the descendants of the process
+ * and their threads as well.
+ *
+ * @since 0.2.0
+ **/
+#define PINK_EASY_ATTACH_DESCENDANTS	(1 << 0)
+
+/**
+ * Makes pink_easy_attach_tree() switch the context to @e PTRACE_SEIZE, see
+ * pink_easy_context_set_seize(), unless the kernel doesn't support it or the
+ * context traces processes already.
+ *
+ * @since 0.2.0
+ **/
+#define PINK_EASY_ATTACH_SEIZE		(1 << 1)
+
+/**
+ * @brief Statistics of pink_easy_attach_tree()
+ * @since 0.2.0
+ **/
+typedef struct pink_easy_attach_stats {
+	/** Number of tasks attached **/
+	unsigned tasks;
+	/** Number of passes over the task lists **/
+	unsigned passes;
+	/** Time the attach took, in microseconds **/
+	unsigned long usec;
+} pink_easy_attach_stats_t;
+
+/**
+ * Attach to all threads of a process, and optionally to its descendants,
+ * in one go. The task lists under @e /proc are read over and over until a
+ * pass finds no new task, so threads and processes created during the
+ * attach are not missed. Tasks which exit meanwhile are skipped, tasks
+ * which are traced by the context already, e.g. because they were attached
+ * automatically, are skipped as well.
+ *
+ * @note The tasks which were attached before a failure stay attached.
+ * @since 0.2.0
+ *
+ * @param ctx Tracing context
+ * @param pid Process ID
+ * @param flags Bitwise OR'ed PINK_EASY_ATTACH_* flags
+ * @param stats Statistics are stored here, may be NULL
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_attach_tree(pink_easy_context_t *ctx, pid_t pid, int flags,
+		pink_easy_attach_stats_t *stats)
+	PINK_GCC_ATTR((nonnull(1)));
+
 PINK_END_DECL
 /** @} */
 #endif
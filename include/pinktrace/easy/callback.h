@@ -58,6 +58,35 @@
  **/
 #define PINK_EASY_CFLAG_SIGIGN		(1 << 2)
 
+/**
+ * Implies that the decision about the current process is made elsewhere,
+ * e.g. by a worker thread, and the process is to be kept stopped until
+ * pink_easy_process_complete() is called for it. The event loop keeps
+ * serving the other processes in the meantime, woken up by the @e SIGCHLD
+ * handler described at pink_easy_loop_get_fd().
+ * Only makes sense for "syscall" callback and dispatch table handlers.
+ *
+ * @since 0.2.0
+ **/
+#define PINK_EASY_CFLAG_PENDING		(1 << 3)
+
+/**
+ * Implies that the current process and its subtree are to be detached,
+ * see pink_easy_process_tree_release() with #PINK_EASY_RELEASE_DETACH.
+ *
+ * @since 0.2.0
+ **/
+#define PINK_EASY_CFLAG_DETACH		(1 << 4)
+
+/**
+ * Implies that the system calls of the current process and its subtree
+ * are no longer to be traced, see pink_easy_process_tree_release() with
+ * #PINK_EASY_RELEASE_QUIET.
+ *
+ * @since 0.2.0
+ **/
+#define PINK_EASY_CFLAG_QUIET		(1 << 5)
+
 struct pink_easy_context;
 
 /**
@@ -167,6 +196,20 @@ typedef int (*pink_easy_callback_cleanup_t) (const struct pink_easy_context *ctx
 typedef int (*pink_easy_callback_syscall_t) (const struct pink_easy_context *ctx,
 		pink_easy_process_t *current, bool entering);
 
+/**
+ * Handler for a single system call, registered with pink_easy_dispatch_set()
+ *
+ * @note The system call number is read once on entry and remembered until
+ *       exit, so handlers need not call pink_util_get_syscall().
+ *
+ * @param ctx Tracing context
+ * @param current Current child
+ * @param scno System call number
+ * @return See PINK_EASY_CFLAG_* for flags to set in the return value.
+ **/
+typedef int (*pink_easy_callback_syscall_handler_t) (const struct pink_easy_context *ctx,
+		pink_easy_process_t *current, long scno);
+
 /**
  * Callback for successful @e execve(2)
  *
@@ -102,6 +102,27 @@ pink_easy_error_t pink_easy_context_get_error(const pink_easy_context_t *ctx)
 void pink_easy_context_clear_error(pink_easy_context_t *ctx)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Use @e PTRACE_SEIZE to attach to processes. pink_easy_attach(),
+ * pink_easy_call() and the pink_easy_exec family set the tracing options
+ * atomically while attaching, and spawned children aren't stopped with
+ * @e SIGSTOP. Children which are traced automatically start with the options
+ * in place, and group-stops keep the tracees stopped until @e SIGCONT by
+ * using @e PTRACE_LISTEN so job control works as without a tracer.
+ *
+ * @note Availability: Linux-3.4 or newer
+ * @since 0.2.0
+ *
+ * @param ctx Tracing context
+ * @param seize true to use @e PTRACE_SEIZE, false to use @e PTRACE_ATTACH
+ *              and @e PTRACE_TRACEME
+ * @return true on success, false on failure and sets errno accordingly:
+ *         @e ENOTSUP if the kernel is too old, @e EBUSY if the context
+ *         traces processes already
+ **/
+bool pink_easy_context_set_seize(pink_easy_context_t *ctx, bool seize)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Set user data and destruction function of the tracing context
  *
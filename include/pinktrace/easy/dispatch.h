@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_DISPATCH_H
+#define _PINK_EASY_DISPATCH_H
+
+/**
+ * @file pinktrace/easy/dispatch.h
+ * @brief Pink's easy per-system call dispatch table
+ * @defgroup pink_easy_dispatch Pink's easy per-system call dispatch table
+ * @ingroup pinktrace-easy
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/callback.h>
+#include <pinktrace/easy/context.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * This type definition represents the dispatch table walk function.
+ * It takes the bitness and the number of a system call together with the
+ * interest flags of the entry. If this function returns false,
+ * pink_easy_dispatch_walk() stops iterating and returns immediately.
+ *
+ * @see pink_easy_dispatch_walk
+ **/
+typedef bool (*pink_easy_dispatch_walk_func_t) (pink_bitness_t bitness,
+		long scno, bool entry, bool exit, void *userdata);
+
+/**
+ * Register handlers for a system call.
+ *
+ * The event loop checks the entry and exit interest masks of the context
+ * before doing anything else on a system call stop. System calls without a
+ * handler cost a single register read on entry and nothing on exit; the
+ * generic "syscall" callback is still called for every system call if it is
+ * set.
+ *
+ * @note Passing NULL for both handlers unregisters the system call.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param entry Handler to call on system call entry or NULL
+ * @param exit Handler to call on system call exit or NULL
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_dispatch_set(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, pink_easy_callback_syscall_handler_t entry,
+		pink_easy_callback_syscall_handler_t exit)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Like pink_easy_dispatch_set() but looks up the system call by name
+ *
+ * @see pink_name_lookup()
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param name Name of the system call
+ * @param entry Handler to call on system call entry or NULL
+ * @param exit Handler to call on system call exit or NULL
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_dispatch_set_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, pink_easy_callback_syscall_handler_t entry,
+		pink_easy_callback_syscall_handler_t exit)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Unregister all handlers of the given bitness
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness
+ **/
+void pink_easy_dispatch_clear(pink_easy_context_t *ctx, pink_bitness_t bitness)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Check whether a system call stop is of interest to the dispatch table
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param entering true for system call entry, false for exit
+ * @return true if a handler is registered, false otherwise
+ **/
+bool pink_easy_dispatch_interested(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, long scno, bool entering)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Walk the interest set of the dispatch table. This is the set of system
+ * calls the tracer needs to stop for, e.g. to build a seccomp filter which
+ * returns @e SECCOMP_RET_TRACE for these system calls.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness
+ * @param func Walk function
+ * @param userdata User data to pass to the walk function
+ * @return Total number of visited entries
+ **/
+unsigned pink_easy_dispatch_walk(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, pink_easy_dispatch_walk_func_t func,
+		void *userdata)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+PINK_END_DECL
+/** @} */
+#endif
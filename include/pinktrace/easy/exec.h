@@ -33,6 +33,25 @@
  * @brief Pink's easy execve() wrappers
  * @defgroup pink_easy_exec Pink's easy execve() wrappers
  * @ingroup pinktrace-easy
+ *
+ * These functions spawn children with vfork(), which costs the same however
+ * large the memory of the tracer is. The child is traced with
+ * @e PTRACE_TRACEME, even if pink_easy_context_set_seize() is enabled, since
+ * the tracer is suspended until the child calls execve(). So the first stop
+ * of the child is after the execve(), which is reported to the "exec"
+ * callback if #PINK_TRACE_OPTION_EXEC is set.
+ *
+ * The child errback runs in the vfork()'ed child too, so it must only call
+ * async-signal-safe functions. The default errback,
+ * pink_easy_errback_child_stderr(), is replaced with an equivalent which
+ * writes with @e write(2). Signals are blocked in the child until the exec
+ * hook has run, then the signals with a handler are reset to their default
+ * action, like posix_spawn() does, and the signal mask is restored.
+ *
+ * If a seccomp filter is to be loaded, see pink_easy_context_set_policy(),
+ * the children are spawned with fork() instead, like pink_easy_call() does.
+ * The child stops before it loads the filter, so that the tracer sets its
+ * options first, and the execve() is traced like any other system call.
  * @{
  **/
 
@@ -42,7 +61,7 @@
 PINK_BEGIN_DECL
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
+ * This function calls vfork() to spawn a new child, does the necessary
  * preparation for tracing and then calls execve().
  *
  * @param ctx Tracing context
@@ -56,7 +75,7 @@ bool pink_easy_execve(pink_easy_context_t *ctx, const char *filename,
 	PINK_GCC_ATTR((nonnull(1)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
+ * This function calls vfork() to spawn a new child, does the necessary
  * preparation for tracing, handles the arguments and calls execl().
  *
  * @param ctx Tracing context
@@ -70,7 +89,7 @@ bool pink_easy_execl(pink_easy_context_t *ctx, const char *file,
 	PINK_GCC_ATTR((nonnull(1), sentinel(0)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
+ * This function calls vfork() to spawn a new child, does the necessary
  * preparation for tracing, handles the arguments and calls execlp().
  *
  * @param ctx Tracing context
@@ -84,7 +103,7 @@ bool pink_easy_execlp(pink_easy_context_t *ctx, const char *file,
 	PINK_GCC_ATTR((nonnull(1), sentinel(0)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
+ * This function calls vfork() to spawn a new child, does the necessary
  * preparation for tracing and then calls execv().
  *
  * @param ctx Tracing context
@@ -97,7 +116,7 @@ bool pink_easy_execv(pink_easy_context_t *ctx, const char *path,
 	PINK_GCC_ATTR((nonnull(1)));
 
 /**
- * This function calls fork() to spawn a new child, does the necessary
+ * This function calls vfork() to spawn a new child, does the necessary
  * preparation for tracing and then calls execvp().
  *
  * @param ctx Tracing context
@@ -109,6 +128,25 @@ bool pink_easy_execvp(pink_easy_context_t *ctx, const char *file,
 		char *const argv[])
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Set a hook which the pink_easy_exec family calls in the child before the
+ * seccomp filter is loaded and the program is executed, e.g. to set up file
+ * descriptors. If the hook returns non-zero, the child exits through the
+ * child errback with #PINK_EASY_CHILD_ERROR_SETUP.
+ *
+ * @attention The hook runs in a vfork()'ed child unless a seccomp filter is
+ *            to be loaded: it shares the memory of the tracer and must only
+ *            call async-signal-safe functions.
+ * @since 0.2.0
+ *
+ * @param ctx Tracing context
+ * @param hook Hook function, NULL to unset
+ * @param userdata User data passed to the hook
+ **/
+void pink_easy_context_set_exec_hook(pink_easy_context_t *ctx,
+		pink_easy_child_func_t hook, void *userdata)
+	PINK_GCC_ATTR((nonnull(1)));
+
 PINK_END_DECL
 /** @} */
 #endif
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_GROUP_H
+#define _PINK_EASY_GROUP_H
+
+/**
+ * @file pinktrace/easy/group.h
+ * @brief Pink's easy shared process state
+ * @defgroup pink_easy_group Pink's easy shared process state
+ * @ingroup pinktrace-easy
+ *
+ * Threads and processes created with @e clone(2) share parts of their
+ * state: the thread group, the address space, the file descriptor table
+ * and the filesystem information like the working directory. For each of
+ * these the library keeps a reference counted group which is shared by the
+ * process entries as the clone flags dictate, so state which belongs to
+ * e.g. an address space can be kept once in the user data of the group
+ * rather than once per thread.
+ *
+ * A process gets new groups on @e fork(2) and a new address space group
+ * on @e execve(2), which also gives it a file descriptor table group of
+ * its own if the table was shared. The entries hold a reference to their
+ * groups, the group and its user data are freed when the last reference is
+ * dropped.
+ *
+ * @{
+ **/
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/func.h>
+#include <pinktrace/easy/process.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_group_t
+ * @brief Opaque structure which represents state shared by processes
+ **/
+typedef struct pink_easy_group pink_easy_group_t;
+
+/** Kinds of shared state **/
+typedef enum {
+	/** Thread group, shared with @e CLONE_THREAD **/
+	PINK_EASY_GROUP_THREAD = 0,
+	/** Address space, shared with @e CLONE_VM **/
+	PINK_EASY_GROUP_VM,
+	/** File descriptor table, shared with @e CLONE_FILES **/
+	PINK_EASY_GROUP_FILES,
+	/** Working directory, root and umask, shared with @e CLONE_FS **/
+	PINK_EASY_GROUP_FS,
+	/** Number of kinds **/
+	PINK_EASY_GROUP_MAX,
+} pink_easy_group_type_t;
+
+/**
+ * Returns the group of the given kind the process belongs to
+ *
+ * @param proc Process entry
+ * @param type Kind of the group
+ * @return The group, NULL if the group couldn't be allocated or the
+ *         process isn't fully set up yet
+ *
+ * @since 0.2.0
+ **/
+pink_easy_group_t *pink_easy_process_get_group(const pink_easy_process_t *proc,
+		pink_easy_group_type_t type)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the kind of the group
+ *
+ * @param group Group
+ * @return Kind of the group
+ *
+ * @since 0.2.0
+ **/
+pink_easy_group_type_t pink_easy_group_get_type(const pink_easy_group_t *group)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the number of references to the group, i.e. the number of
+ * process entries sharing it unless the user holds references
+ *
+ * @param group Group
+ * @return Reference count
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_group_get_refcount(const pink_easy_group_t *group)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Take a reference to the group
+ *
+ * @param group Group
+ * @return The group
+ *
+ * @since 0.2.0
+ **/
+pink_easy_group_t *pink_easy_group_ref(pink_easy_group_t *group)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Drop a reference to the group, the group is freed with its user data
+ * when the last one is dropped
+ *
+ * @param group Group
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_group_unref(pink_easy_group_t *group)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Set the user data of the group
+ *
+ * @param group Group
+ * @param userdata User data
+ * @param userdata_destroy The destructor function of the user data
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_group_set_userdata(pink_easy_group_t *group, void *userdata,
+		pink_easy_free_func_t userdata_destroy)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the user data of the group
+ *
+ * @param group Group
+ * @return User data
+ *
+ * @since 0.2.0
+ **/
+void *pink_easy_group_get_userdata(const pink_easy_group_t *group)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
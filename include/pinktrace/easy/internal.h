@@ -38,13 +38,41 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/queue.h>
+#include <sys/wait.h>
 
 #include <pinktrace/pink.h>
+#include <pinktrace/easy/archive.h>
 #include <pinktrace/easy/callback.h>
 #include <pinktrace/easy/error.h>
+#include <pinktrace/easy/group.h>
+#include <pinktrace/easy/memo.h>
+#include <pinktrace/easy/monitor.h>
+#include <pinktrace/easy/policy.h>
+#include <pinktrace/easy/netmatch.h>
+#include <pinktrace/easy/overhead.h>
+#include <pinktrace/easy/recorder.h>
+#include <pinktrace/easy/shadow.h>
+#include <pinktrace/easy/stats.h>
+#include <pinktrace/easy/trie.h>
+
+#ifdef PINKTRACE_USDT
+#include <sys/sdt.h>
+#endif /* PINKTRACE_USDT */
+
+#if defined(HAVE_LINUX_SECCOMP_H) && defined(HAVE_LINUX_FILTER_H) \
+	&& defined(HAVE_LINUX_AUDIT_H) && defined(HAVE_SYS_PRCTL_H)
+#define PINK_EASY_HAVE_SECCOMP 1
+#else
+#define PINK_EASY_HAVE_SECCOMP 0
+#endif
 
 #undef KERNEL_VERSION
 #define KERNEL_VERSION(a,b,c) (((a) << 16) + ((b) << 8) + (c))
@@ -63,6 +91,37 @@
 #define PINK_EASY_PROCESS_FOLLOWFORK		00040
 /** Process is a clone **/
 #define PINK_EASY_PROCESS_CLONE_THREAD		00100
+/** Process runs under the seccomp filter of the context **/
+#define PINK_EASY_PROCESS_SECCOMP		00200
+/** Next system call entry stop repeats a seccomp stop (Linux<4.8) **/
+#define PINK_EASY_PROCESS_SECCOMP_ENTRY		00400
+/** System call was resolved by the library, callbacks are skipped **/
+#define PINK_EASY_PROCESS_RESOLVED		01000
+/** Return value is to be fixed up on system call exit **/
+#define PINK_EASY_PROCESS_DENY			02000
+/** Process is kept stopped until its pending decision is completed **/
+#define PINK_EASY_PROCESS_PARKED		04000
+/** Process is gone, the entry is freed once its decision is completed **/
+#define PINK_EASY_PROCESS_GONE			010000
+/** Process was attached with PTRACE_SEIZE, directly or automatically **/
+#define PINK_EASY_PROCESS_SEIZED		020000
+/** Next SIGTRAP, the one after execve() of a vfork()'ed child, is to be ignored **/
+#define PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP	040000
+/** Process is to be detached at its next stop **/
+#define PINK_EASY_PROCESS_DETACH		0100000
+/** System calls of the process are no longer traced **/
+#define PINK_EASY_PROCESS_QUIET			0200000
+/** Process is a launcher helper, traced for its forks only **/
+#define PINK_EASY_PROCESS_HELPER		0400000
+
+/** Upper limit for system call numbers in the dispatch table **/
+#define PINK_EASY_SYSCALL_MAX			4096
+/** Bits in a word of a system call mask **/
+#define PINK_EASY_MASK_BITS			(8 * sizeof(unsigned long))
+/** Number of system calls updating the shadow tables **/
+#define PINK_EASY_SHADOW_NSYSCALLS		19
+/** Upper limit for file descriptors in the shadow tables **/
+#define PINK_EASY_SHADOW_FD_MAX			65536
 
 PINK_BEGIN_DECL
 
@@ -72,10 +131,42 @@ typedef enum {
 	PINK_EASY_TRIBOOL_NONE,
 } pink_easy_tribool_t;
 
+/** Shadow state of a file descriptor **/
+struct pink_easy_shadow_fd {
+	pink_easy_fd_type_t type;
+	/** Access mode and status flags, O_CLOEXEC if closed on exec **/
+	int flags;
+	/** Path, NULL if it is to be looked up in /proc **/
+	char *path;
+	/** Address a socket is connected to, NULL if unknown **/
+	pink_socket_address_t *addr;
+};
+
+/** State shared by processes **/
+struct pink_easy_group {
+	unsigned refs;
+	pink_easy_group_type_t type;
+
+	/** Number of quiet members, whose changes go unseen: the shadow
+	 * tables are empty and unused as long as there is one **/
+	unsigned quiet;
+
+	/** Shadow file descriptor table of PINK_EASY_GROUP_FILES groups,
+	 * NULL entries are to be looked up in /proc **/
+	struct pink_easy_shadow_fd **fds;
+	unsigned nfds;
+
+	/** Shadow working directory of PINK_EASY_GROUP_FS groups **/
+	char *cwd;
+
+	void *userdata;
+	pink_easy_free_func_t userdata_destroy;
+};
+
 /** Process entry **/
 struct pink_easy_process {
 	/** PINK_EASY_PROCESS_* flags **/
-	short flags;
+	unsigned flags;
 
 	/** Process Id of this entry **/
 	pid_t pid;
@@ -83,9 +174,76 @@ struct pink_easy_process {
 	/** Parent of this process **/
 	pid_t ppid;
 
+	/** Thread group ID of this process **/
+	pid_t tgid;
+
+	/** Parent entry, NULL if the parent isn't traced, and the children **/
+	struct pink_easy_process *parent;
+	LIST_HEAD(pink_easy_process_children, pink_easy_process) children;
+	LIST_ENTRY(pink_easy_process) siblings;
+
+	/** Leader entry of the thread group, NULL for leaders and if the
+	 * leader isn't traced, and the other threads for leaders **/
+	struct pink_easy_process *leader;
+	LIST_HEAD(pink_easy_process_threads, pink_easy_process) threads;
+	LIST_ENTRY(pink_easy_process) group;
+
+	/** Shared state, indexed by pink_easy_group_type_t **/
+	struct pink_easy_group *groups[PINK_EASY_GROUP_MAX];
+
 	/** Bitness (e.g. 32bit, 64bit) of this process **/
 	pink_bitness_t bitness;
 
+	/** System call number, saved on entry, -1 if unknown **/
+	long scno;
+
+	/** Return value for PINK_EASY_PROCESS_DENY **/
+	long retval;
+
+	/** System call being timed for the statistics, -1 if none, its
+	 * bitness and the time of the entry **/
+	long stats_scno;
+	pink_bitness_t stats_bitness;
+	uint64_t stats_start;
+
+	/** Overhead accounting, indexed by pink_easy_stop_t, NULL until the
+	 * first stop is accounted **/
+	pink_easy_overhead_t *overhead;
+
+	/** Stop time of a parked stop, accounted once the decision is picked
+	 * up: the time until the process was parked, when it was parked, the
+	 * kind of stop and the system call, -1 if none **/
+	bool overhead_parked;
+	uint64_t overhead_park_elapsed, overhead_park_start;
+	pink_easy_stop_t overhead_park_stop;
+	long overhead_park_scno;
+	pink_bitness_t overhead_park_bitness;
+
+	/** Cached system call results, most recent first **/
+	struct pink_easy_memo_entry *memo;
+	unsigned nmemo;
+
+	/** Cache entry to fill in on system call exit **/
+	struct pink_easy_memo_entry *memo_pending;
+
+	/** Tracing context, for completions from other threads **/
+	struct pink_easy_context *ctx;
+
+	/** Whether a decision is pending, the completed decision and the
+	 * next entry in the completion queue, protected by the lock of the
+	 * context **/
+	bool pending;
+	unsigned char verdict;
+	int verdict_err;
+	struct pink_easy_process *completed;
+
+	/** Entry in the list of removed processes still waiting for their
+	 * pending decision **/
+	LIST_ENTRY(pink_easy_process) gone;
+
+	/** Launcher helper this process is, NULL for other processes **/
+	struct pink_easy_launcher_proc *launcher;
+
 	/** Per-process user data **/
 	void *userdata;
 
@@ -96,6 +254,394 @@ struct pink_easy_process {
 };
 SLIST_HEAD(pink_easy_process_list, pink_easy_process);
 
+/** Dispatch table entry **/
+struct pink_easy_dispatch_entry {
+	pink_easy_callback_syscall_handler_t entry;
+	pink_easy_callback_syscall_handler_t exit;
+};
+
+/** Per-bitness dispatch table **/
+struct pink_easy_dispatch {
+	/** Number of entries in the table **/
+	long nr;
+
+	/** Number of registered system calls **/
+	unsigned count;
+
+	/** Handlers, indexed by system call number **/
+	struct pink_easy_dispatch_entry *table;
+
+	/** Interest masks, 0 for entry and 1 for exit **/
+	unsigned long *mask[2];
+};
+
+/** Cached system call result **/
+struct pink_easy_memo_entry {
+	pink_bitness_t bitness;
+	long scno;
+	long key;
+	long retval;
+	/** Output argument, its size and contents **/
+	long addr;
+	size_t size;
+	struct pink_easy_memo_entry *next;
+	unsigned char out[];
+};
+
+/** Cached system call specification **/
+struct pink_easy_memo_spec {
+	signed char keyarg;
+	signed char outarg;
+	size_t outsize;
+};
+
+/** Per-bitness cached system call table **/
+struct pink_easy_memo {
+	/** Number of entries in the table **/
+	long nr;
+
+	/** Number of cached system calls **/
+	unsigned count;
+
+	/** Specifications, indexed by system call number **/
+	struct pink_easy_memo_spec *table;
+
+	/** Masks of cached system calls and system calls flushing the cache **/
+	unsigned long *mask;
+	unsigned long *flush;
+};
+
+/** Trace recorder **/
+struct pink_easy_recorder {
+	int fd;
+
+	/** Ring buffer, its size, a power of two, and the bytes reserved and
+	 * consumed so far. Unused bytes of the ring are zero, a record is
+	 * committed once its size is stored. **/
+	char *ring;
+	size_t size;
+	uint64_t head;
+	uint64_t tail;
+
+	/** Creation time, for the timestamps of records **/
+	struct timespec start;
+
+	/** Writer thread, the lock waits happen under, the condition waking
+	 * the writer up and the condition signalling its progress **/
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t progress;
+	bool stop;
+	/** Bytes written to the file, and the first write error **/
+	uint64_t written;
+	int error;
+
+	/** Output batch of the writer thread **/
+	char *batch;
+	size_t batch_size;
+
+	/** Number of appends which waited for room **/
+	unsigned long stalls;
+};
+
+/** Reader of recorder files **/
+struct pink_easy_record_reader {
+	const char *map;
+	size_t len;
+	size_t off;
+};
+
+/** Statistics of a system call **/
+struct pink_easy_stats_counter {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t time;
+	uint64_t stop_time;
+	uint64_t buckets[PINK_EASY_STATS_BUCKETS];
+};
+
+/** Statistics of one tracer thread, counters are allocated on first use and
+ * only ever written by the thread **/
+struct pink_easy_stats_shard {
+	struct pink_easy_stats_counter *counters[2][PINK_EASY_SYSCALL_MAX];
+	struct pink_easy_stats_shard *next;
+};
+
+/** Statistics collector **/
+struct pink_easy_stats {
+	/** Shard of the calling thread **/
+	pthread_key_t key;
+
+	/** Shards of all threads and the totals at the last reset, protected
+	 * by the lock **/
+	pthread_mutex_t lock;
+	struct pink_easy_stats_shard *shards;
+	struct pink_easy_stats_shard base;
+};
+
+/** Segment opened by a monitor **/
+struct pink_easy_monitor {
+	const pink_easy_monitor_segment_t *segment;
+};
+
+/** Index entry of an archive block, as stored in the file **/
+struct pink_easy_archive_index {
+	uint64_t offset;
+	uint32_t length;
+	uint32_t nevents;
+	uint64_t time_min;
+	uint64_t time_max;
+	/** Bitmaps of the process IDs modulo 256 and the system call numbers
+	 * modulo 512 of the events of the block **/
+	uint32_t pids[8];
+	uint32_t scnos[16];
+};
+
+/** Archive writer **/
+struct pink_easy_archive_writer {
+	FILE *file;
+	uint64_t offset;
+	int error;
+
+	/** Columns of the current block **/
+	unsigned block_events;
+	unsigned nevents;
+	uint64_t *times;
+	int64_t *pids;
+	int64_t *scnos;
+	int64_t *retvals;
+	uint32_t *sids;
+
+	/** Strings of the current block and the hash table interning them,
+	 * which holds string indexes plus one **/
+	char **strings;
+	unsigned nstrings;
+	uint32_t *slots;
+	unsigned nslots;
+
+	/** Index of the blocks written so far **/
+	struct pink_easy_archive_index *index;
+	unsigned nblocks;
+	unsigned index_alloc;
+
+	/** Encoding buffers **/
+	unsigned char *out, *col;
+	size_t out_len, out_alloc;
+	size_t col_len, col_alloc;
+};
+
+/** Archive opened for queries **/
+struct pink_easy_archive {
+	const unsigned char *map;
+	size_t len;
+	const struct pink_easy_archive_index *index;
+	unsigned nblocks;
+	unsigned decoded;
+
+	/** Strings of the block being decoded **/
+	const char **dict;
+	unsigned dict_alloc;
+};
+
+/** Trie pattern tokens, besides literal bytes **/
+#define PINK_EASY_TRIE_ANY1	256
+#define PINK_EASY_TRIE_STAR	257
+#define PINK_EASY_TRIE_DSTAR	258
+
+/** Trie pattern **/
+struct pink_easy_trie_pattern {
+	/** Tokens, literal bytes or PINK_EASY_TRIE_* **/
+	unsigned short *tok;
+	unsigned len;
+	int value;
+	/** Matches without waiting for a slash or the end **/
+	bool immediate;
+};
+
+/** Trie automaton state can still reach a match **/
+#define PINK_EASY_TRIE_LIVE	01
+
+/** Trie automaton state **/
+struct pink_easy_trie_state {
+	/** Outgoing edges, sorted by byte **/
+	unsigned first;
+	unsigned nedges;
+	/** Target for bytes other than slash without an edge, -1 if none **/
+	int other;
+	/** Value if the input so far matches **/
+	int value_now;
+	/** Value if the input so far matches and a slash or the end follows **/
+	int value_boundary;
+	/** PINK_EASY_TRIE_* flags **/
+	unsigned flags;
+};
+
+/** Path prefix matcher **/
+struct pink_easy_trie {
+	/** Patterns as they were added **/
+	struct pink_easy_trie_pattern *patterns;
+	unsigned npatterns, patterns_alloc;
+
+	/** Compiled automaton, state zero is the start state **/
+	bool compiled;
+	struct pink_easy_trie_state *states;
+	unsigned nstates;
+	unsigned char *edge_byte;
+	unsigned *edge_target;
+	unsigned nedges;
+};
+
+/** Socket address matcher rule, rules of a node are chained in the order
+ * they were added **/
+struct pink_easy_netmatch_rule {
+	unsigned port_lo, port_hi;
+	int value;
+	int next;
+};
+
+/** Radix tree node **/
+struct pink_easy_netmatch_node {
+	/** Prefix, bits past the prefix length are zero **/
+	unsigned char addr[16];
+	unsigned bits;
+	/** Children, by the bit after the prefix, -1 if none **/
+	int child[2];
+	/** First and last rule, -1 if none **/
+	int first, last;
+};
+
+/** Path compressed radix tree, node zero is the root **/
+struct pink_easy_netmatch_tree {
+	struct pink_easy_netmatch_node *nodes;
+	unsigned nnodes, nodes_alloc;
+	/** Address length in bits **/
+	unsigned maxbits;
+};
+
+/** Socket address matcher **/
+struct pink_easy_netmatch {
+	/** Radix trees for AF_INET and AF_INET6 **/
+	struct pink_easy_netmatch_tree inet[2];
+	struct pink_easy_netmatch_rule *rules;
+	unsigned nrules, rules_alloc;
+
+	/** UNIX socket paths and abstract names **/
+	pink_easy_trie_t *unix_path;
+	pink_easy_trie_t *unix_abstract;
+};
+
+/** Policy rule kinds **/
+enum {
+	PINK_EASY_POLICY_RULE_SYSCALL = 0,
+	PINK_EASY_POLICY_RULE_INT,
+	PINK_EASY_POLICY_RULE_PATH,
+	PINK_EASY_POLICY_RULE_INET,
+	PINK_EASY_POLICY_RULE_UNIX,
+};
+
+/** Policy rule, also used as a compiled argument predicate **/
+struct pink_easy_policy_rule {
+	/** PINK_EASY_POLICY_RULE_* **/
+	unsigned char kind;
+	/** Action and errno if the rule matches **/
+	unsigned char action;
+	int err;
+
+	pink_bitness_t bitness;
+	long scno;
+
+	/** Argument index **/
+	unsigned ind;
+
+	/** Integer rules **/
+	pink_easy_policy_op_t op;
+	long value;
+	long mask;
+
+	/** Path and UNIX socket rules **/
+	char *path;
+	size_t pathlen;
+	bool abstract;
+
+	/** Compiled run of path rules or socket address rules on the same
+	 * argument, set on the first rule of the run **/
+	pink_easy_trie_t *trie;
+	pink_easy_netmatch_t *net;
+	unsigned run;
+
+	/** Internet socket rules **/
+	int family;
+	unsigned char addr[16];
+	unsigned prefixlen;
+	unsigned port_lo, port_hi;
+};
+
+/** Compiled policy slot, one per system call **/
+struct pink_easy_policy_slot {
+	/** Is this system call listed? **/
+	unsigned char listed;
+	/** Action and errno if no predicate matches **/
+	unsigned char action;
+	int err;
+	/** Predicates, in the order they were added **/
+	unsigned first;
+	unsigned npred;
+};
+
+/** Upper limit for the size of the decoded arguments of a cached decision **/
+#define PINK_EASY_DECISION_KEY_MAX	(2 * PATH_MAX + 256)
+
+/** Cached policy decision **/
+struct pink_easy_decision {
+	unsigned hash;
+	pink_bitness_t bitness;
+	long scno;
+	unsigned char action;
+	int err;
+	/** Decoded arguments **/
+	unsigned char *key;
+	size_t keylen;
+	/** Hash chain and recency list, -1 terminated **/
+	int chain;
+	int prev, next;
+};
+
+/** Least recently used cache of policy decisions **/
+struct pink_easy_decision_cache {
+	unsigned size, count;
+	struct pink_easy_decision *entries;
+	/** Hash buckets, a power of two **/
+	int *buckets;
+	unsigned nbuckets;
+	/** Most and least recently used entries **/
+	int head, tail;
+	/** Policy and its generation the cached decisions were made with **/
+	const pink_easy_policy_t *policy;
+	unsigned long generation;
+};
+
+/** System call policy **/
+struct pink_easy_policy {
+	/** Action and errno for system calls which aren't listed **/
+	pink_easy_policy_action_t default_action;
+	int default_errno;
+
+	/** Rules as they were added **/
+	struct pink_easy_policy_rule *rules;
+	unsigned nrules, rules_alloc;
+
+	/** Compiled tables, indexed by bitness **/
+	bool compiled;
+	long nr[2];
+	struct pink_easy_policy_slot *slots[2];
+	/** Compiled predicates, slots point into this array **/
+	struct pink_easy_policy_rule *preds;
+	unsigned npreds;
+	/** Bumped on every compilation **/
+	unsigned long generation;
+};
+
 /** Tracing context **/
 struct pink_easy_context {
 	/** Number of processes */
@@ -116,6 +662,73 @@ struct pink_easy_context {
 	/** Callback table **/
 	pink_easy_callback_table_t callback_table;
 
+	/** Per-system call dispatch tables, indexed by bitness **/
+	struct pink_easy_dispatch dispatch[2];
+
+	/** Cached system call tables, indexed by bitness **/
+	struct pink_easy_memo memo[2];
+
+	/** Keep shadow file descriptor tables, the system calls updating
+	 * them and their mask, indexed by bitness **/
+	bool shadow;
+	long shadow_scno[2][PINK_EASY_SHADOW_NSYSCALLS];
+	unsigned long shadow_mask[2][PINK_EASY_SYSCALL_MAX / PINK_EASY_MASK_BITS];
+
+	/** System call policy, not owned by the context **/
+	const pink_easy_policy_t *policy;
+
+	/** Statistics collector, not owned by the context **/
+	pink_easy_stats_t *stats;
+
+	/** Overhead accounting, the totals of the processes and the figures
+	 * of the stop being handled: the waitpid() time, the callback time,
+	 * the process, NULL if it is gone, the kind of stop and the system
+	 * call, -1 if none **/
+	bool overhead;
+	pink_easy_overhead_t overhead_total[PINK_EASY_STOP_MAX];
+	uint64_t overhead_wait;
+	uint64_t overhead_callback;
+	struct pink_easy_process *overhead_current;
+	pink_easy_stop_t overhead_stop;
+	long overhead_scno;
+	pink_bitness_t overhead_bitness;
+
+	/** Shared memory segment for monitors, NULL if not published, and
+	 * the number of updates made to it **/
+	pink_easy_monitor_segment_t *monitor;
+	uint64_t monitor_updates;
+
+	/** Install a seccomp filter in spawned children **/
+	bool seccomp;
+
+	/** Attach with PTRACE_SEIZE rather than PTRACE_ATTACH/TRACEME **/
+	bool seize;
+
+	/** Called in the child before execve() **/
+	pink_easy_child_func_t exec_hook;
+	void *exec_hook_data;
+
+	/** Policy decision cache **/
+	struct pink_easy_decision_cache decisions;
+
+	/** Number of processes waiting for a pending decision, and those of
+	 * them which were removed from the process list **/
+	unsigned nparked;
+	LIST_HEAD(pink_easy_process_gone, pink_easy_process) gone;
+
+	/** Queue of completed decisions, protected by the lock, and the pipe
+	 * waking the event loop up **/
+	pthread_mutex_t lock;
+	struct pink_easy_process *completed_head, *completed_tail;
+	int wakeup[2];
+	/** Slot of the pipe in the SIGCHLD handler, -1 if not registered **/
+	int wakeup_slot;
+	/** Where completions are signalled, the pipe of the session if any **/
+	int wakeup_fd;
+
+	/** Session the context belongs to, NULL if none **/
+	struct pink_easy_session *session;
+
 	/** User data **/
 	void *userdata;
 
@@ -123,24 +736,200 @@ struct pink_easy_context {
 	pink_easy_free_func_t userdata_destroy;
 };
 #define PINK_EASY_FOREACH_PROCESS(node, ctx)	SLIST_FOREACH((node), &(ctx)->process_list, entries)
-#define PINK_EASY_INSERT_PROCESS(ctx, current)							\
+/* Static probes of the provider pinktrace, see --enable-usdt.
+ * The probes and their arguments are listed in doc/index.markdown. */
+#ifdef PINKTRACE_USDT
+#define PINK_EASY_PROBE(...)	STAP_PROBEV(pinktrace, __VA_ARGS__)
+#else
+#define PINK_EASY_PROBE(...)	do { } while (0)
+#endif /* PINKTRACE_USDT */
+
+/* Backends of the memory probes */
+#define PINK_EASY_PROBE_VM_PROCESS_VM	0
+#define PINK_EASY_PROBE_VM_PTRACE	1
+
+#define PINK_EASY_INSERT_PROCESS(ctx, current, process_pid)					\
 	do {											\
 		(current) = calloc(1, sizeof(*(current)));					\
 		if ((current) == NULL) {							\
 			(ctx)->callback_table.error((ctx), PINK_EASY_ERROR_ALLOC, "calloc");	\
+			break;									\
 		}										\
+		(current)->pid = (process_pid);							\
+		(current)->scno = -1;								\
+		(current)->stats_scno = -1;							\
+		(current)->ctx = (ctx);								\
 		SLIST_INSERT_HEAD(&(ctx)->process_list, (current), entries);			\
 		(ctx)->nprocs++;								\
+		PINK_EASY_PROBE(process_insert, (current)->pid, (ctx)->nprocs);			\
 	} while (0)
 #define PINK_EASY_REMOVE_PROCESS(ctx, current)							\
 	do {											\
+		PINK_EASY_PROBE(process_remove, (current)->pid, (ctx)->nprocs - 1);		\
+		if ((ctx)->overhead_current == (current))					\
+			(ctx)->overhead_current = NULL;						\
+		pink_easy_process_unlink(current);						\
 		SLIST_REMOVE(&(ctx)->process_list, (current), pink_easy_process, entries);	\
 		if ((current)->userdata_destroy && (current)->userdata) {			\
 			(current)->userdata_destroy((current)->userdata);			\
 		}										\
-		free(current);									\
+		if ((current)->flags & PINK_EASY_PROCESS_PARKED) {				\
+			(current)->flags |= PINK_EASY_PROCESS_GONE;				\
+			LIST_INSERT_HEAD(&(ctx)->gone, (current), gone);			\
+		} else {									\
+			pink_easy_process_memo_flush(current);					\
+			free((current)->overhead);						\
+			free(current);								\
+		}										\
 		(ctx)->nprocs--;								\
 	} while (0)
 
+static inline uint64_t pink_easy_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* waitpid() for any child, timed if elapsed isn't NULL */
+static inline pid_t pink_easy_waitpid(int *status, int options, uint64_t *elapsed)
+{
+	pid_t pid;
+	uint64_t start;
+
+	if (!elapsed) {
+		pid = waitpid(-1, status, __WALL | options);
+		PINK_EASY_PROBE(wait, pid, pid > 0 ? *status : 0);
+		return pid;
+	}
+	start = pink_easy_clock();
+	pid = waitpid(-1, status, __WALL | options);
+	*elapsed = pink_easy_clock() - start;
+	PINK_EASY_PROBE(wait, pid, pid > 0 ? *status : 0);
+	return pid;
+}
+
+static inline bool pink_easy_mask_test(const unsigned long *mask, long nr, long bit)
+{
+	return bit >= 0 && bit < nr
+		&& (mask[bit / PINK_EASY_MASK_BITS] & (1UL << (bit % PINK_EASY_MASK_BITS)));
+}
+
+/* pink-easy-attach.c */
+bool pink_easy_spawn_prepare(struct pink_easy_context *ctx, int fd[2]);
+bool pink_easy_spawn_child(const struct pink_easy_context *ctx, int fd[2]);
+bool pink_easy_spawn_parent(struct pink_easy_context *ctx, pid_t pid, int fd[2]);
+
+/* pink-easy-process.c */
+void pink_easy_process_link(struct pink_easy_process *current,
+		struct pink_easy_process *parent, pid_t tgid, unsigned long flags);
+void pink_easy_process_unlink(struct pink_easy_process *current);
+void pink_easy_process_replace(struct pink_easy_process *old,
+		struct pink_easy_process *current);
+
+/* pink-easy-group.c */
+void pink_easy_group_inherit(struct pink_easy_process *current,
+		const struct pink_easy_process *parent, unsigned long flags);
+void pink_easy_group_exec(struct pink_easy_process *current);
+void pink_easy_group_unshare(struct pink_easy_process *current, unsigned long flags);
+void pink_easy_group_drop(struct pink_easy_process *current);
+void pink_easy_group_quiet(struct pink_easy_process *current);
+
+/* pink-easy-monitor.c */
+void pink_easy_monitor_update(struct pink_easy_context *ctx, bool stopped,
+		uint64_t elapsed);
+
+/* pink-easy-overhead.c */
+void pink_easy_overhead_account(struct pink_easy_context *ctx, uint64_t elapsed,
+		const pink_trace_account_t *account);
+void pink_easy_overhead_unpark(struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+
+/* pink-easy-stats.c */
+unsigned pink_easy_stats_bucket(uint64_t ns);
+void pink_easy_stats_stop(struct pink_easy_context *ctx, pink_bitness_t bitness,
+		long scno, uint64_t elapsed);
+void pink_easy_stats_enter(struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+void pink_easy_stats_leave(struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+
+/* pink-easy-shadow.c */
+bool pink_easy_shadow_interested(const struct pink_easy_context *ctx,
+		pink_bitness_t bitness, long scno);
+void pink_easy_shadow_leave(const struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+void pink_easy_shadow_copy(struct pink_easy_group *group,
+		const struct pink_easy_group *from);
+void pink_easy_shadow_exec(struct pink_easy_group *group);
+void pink_easy_shadow_free(struct pink_easy_group *group);
+
+/* pink-easy-loop.c */
+int pink_easy_loop_handle_event(struct pink_easy_context *ctx, pid_t pid, int status);
+void pink_easy_loop_handle_completions(struct pink_easy_context *ctx);
+
+/* pink-easy-session.c */
+bool pink_easy_session_claim(struct pink_easy_session *session, pid_t pid);
+void pink_easy_session_unlink(struct pink_easy_context *ctx);
+
+/* pink-easy-launcher.c */
+void pink_easy_launcher_flush(struct pink_easy_launcher_proc *lp);
+void *pink_easy_launcher_take(struct pink_easy_launcher_proc *lp);
+
+/* pink-easy-async.c */
+bool pink_easy_async_pipe(int fd[2]);
+bool pink_easy_async_drain(int fd);
+bool pink_easy_async_register(int fd, int *slot);
+void pink_easy_async_unregister(int slot);
+bool pink_easy_async_poll(int fd, int slot, int timeout);
+bool pink_easy_async_init(struct pink_easy_context *ctx);
+void pink_easy_async_free(struct pink_easy_context *ctx);
+void pink_easy_async_park(struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+struct pink_easy_process *pink_easy_async_take(struct pink_easy_context *ctx);
+bool pink_easy_async_wait(struct pink_easy_context *ctx, int timeout);
+
+/* pink-easy-decision.c */
+void pink_easy_decision_init(struct pink_easy_decision_cache *cache);
+bool pink_easy_decision_resize(struct pink_easy_decision_cache *cache, unsigned size);
+bool pink_easy_decision_lookup(struct pink_easy_decision_cache *cache,
+		const pink_easy_policy_t *policy, pink_bitness_t bitness, long scno,
+		const void *key, size_t keylen,
+		pink_easy_policy_action_t *action, int *err);
+void pink_easy_decision_store(struct pink_easy_decision_cache *cache,
+		pink_bitness_t bitness, long scno, const void *key, size_t keylen,
+		pink_easy_policy_action_t action, int err);
+void pink_easy_decision_flush(struct pink_easy_decision_cache *cache);
+
+/* pink-easy-dispatch.c */
+bool pink_easy_dispatch_any(const struct pink_easy_context *ctx);
+int pink_easy_dispatch_call(const struct pink_easy_context *ctx,
+		struct pink_easy_process *current, bool entering);
+void pink_easy_dispatch_free(struct pink_easy_context *ctx);
+
+/* pink-easy-memo.c */
+bool pink_easy_memo_any(const struct pink_easy_context *ctx);
+bool pink_easy_memo_interested(const struct pink_easy_context *ctx,
+		pink_bitness_t bitness, long scno);
+int pink_easy_memo_enter(const struct pink_easy_context *ctx,
+		struct pink_easy_process *current);
+void pink_easy_memo_leave(struct pink_easy_process *current);
+void pink_easy_memo_drop(struct pink_easy_process *current);
+void pink_easy_memo_free(struct pink_easy_context *ctx);
+
+/* pink-easy-policy.c */
+bool pink_easy_policy_eval(const pink_easy_policy_t *policy,
+		struct pink_easy_decision_cache *cache, pid_t pid,
+		pink_bitness_t bitness, long scno,
+		pink_easy_policy_action_t *action, int *err, bool *listed);
+const struct pink_easy_policy_slot *pink_easy_policy_slot(const pink_easy_policy_t *policy,
+		pink_bitness_t bitness, long scno);
+
+/* pink-easy-seccomp.c */
+void *pink_easy_seccomp_build(const struct pink_easy_context *ctx);
+bool pink_easy_seccomp_load(const void *prog);
+void pink_easy_seccomp_free(void *prog);
+
 PINK_END_DECL
 #endif
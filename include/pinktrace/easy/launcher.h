@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_LAUNCHER_H
+#define _PINK_EASY_LAUNCHER_H
+
+/**
+ * @file pinktrace/easy/launcher.h
+ * @brief Pink's easy pre-forked launchers
+ * @defgroup pink_easy_launcher Pink's easy pre-forked launchers
+ * @ingroup pinktrace-easy
+ *
+ * A launcher is a set of small helper processes, forked from the tracer with
+ * pink_easy_call() while its address space is still small, which spawn
+ * children on request. Requests are sent over a socket, so any thread may
+ * spawn children without waiting for the tracing thread. Each helper forks
+ * the children itself and executes the program, the children are traced from
+ * their birth with the tracing options already in place since the helpers
+ * are traced with fork following, and they inherit the seccomp filter
+ * installed in the helper so no filter is built or loaded per child. With
+ * more than one helper, children are forked in parallel.
+ *
+ * The helpers are traced for their forks only: they are resumed without
+ * system call stops, so system call callbacks and the policy of the context
+ * apply to them through the seccomp filter only. Children are reported
+ * with the startup callback, with the helper as parent, and with the user
+ * data of the request already set as their process user data. A helper
+ * which fails to fork a child tells the tracer so and goes on with the next
+ * request; the user data of such requests, and of the requests still pending
+ * when the launcher is destroyed, is passed to the destructor set with
+ * pink_easy_launcher_set_userdata_destroy().
+ *
+ * The helpers exit once the launcher is destroyed and they have served the
+ * pending requests, pink_easy_loop() keeps running until then.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_launcher_t
+ * @brief Opaque structure which represents a launcher
+ *
+ * Use pink_easy_launcher_new() to create one and
+ * pink_easy_launcher_destroy() to free all allocated resources.
+ **/
+typedef struct pink_easy_launcher pink_easy_launcher_t;
+
+/**
+ * Start a launcher with the given number of helper processes
+ *
+ * @note This function must be called from the thread which runs
+ *       pink_easy_loop(), preferably early since every helper is a copy of
+ *       the tracer at this point.
+ * @note The tracing options of the context must include
+ *       #PINK_TRACE_OPTION_FORK.
+ *
+ * @param ctx Tracing context
+ * @param nprocs Number of helper processes
+ * @return The launcher on success, NULL on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+pink_easy_launcher_t *pink_easy_launcher_new(pink_easy_context_t *ctx, unsigned nprocs)
+	PINK_GCC_ATTR((malloc, nonnull(1)));
+
+/**
+ * Set the destructor for the user data of requests which yield no child:
+ * requests a helper failed to fork a child for, and requests still pending
+ * when the launcher is destroyed. The former are noticed when the helper
+ * forks the next child or when the launcher is destroyed.
+ *
+ * @note The destructor is called from the thread which runs pink_easy_loop().
+ *
+ * @param launcher Launcher
+ * @param userdata_destroy Destructor, NULL to drop the user data
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_launcher_set_userdata_destroy(pink_easy_launcher_t *launcher,
+		pink_easy_free_func_t userdata_destroy)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Destroy a launcher. Its helpers exit after serving the pending requests,
+ * the children forked for them get no user data. Requests which haven't
+ * been sent to a helper yet, see pink_easy_launcher_spawn(), are dropped.
+ *
+ * @note This function must be called from the thread which runs
+ *       pink_easy_loop(), e.g. from a callback, and no other thread may be
+ *       calling pink_easy_launcher_spawn() concurrently.
+ *
+ * @param launcher Launcher
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_launcher_destroy(pink_easy_launcher_t *launcher)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Request a new traced child which executes the given program. The request
+ * is served asynchronously by one of the helpers, the child is reported
+ * with the startup callback once it is traced. The request is sent without
+ * blocking; if the socket of the helper is full, the rest is sent by
+ * pink_easy_loop() the next time the helper stops.
+ *
+ * @note This function may be called from any thread, callbacks included.
+ *
+ * @param launcher Launcher
+ * @param filename Path of the program, searched in PATH like execvp() does
+ *                 if it does not contain a slash
+ * @param argv Arguments
+ * @param envp Environment, NULL to inherit the environment of the helper
+ * @param userdata Process user data of the child, see
+ *                 pink_easy_process_get_userdata()
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_launcher_spawn(pink_easy_launcher_t *launcher, const char *filename,
+		char *const argv[], char *const envp[], void *userdata)
+	PINK_GCC_ATTR((nonnull(1,2,3)));
+
+/**
+ * Return the process ID of a helper
+ *
+ * @param launcher Launcher
+ * @param i Index of the helper, less than the number given to
+ *          pink_easy_launcher_new()
+ * @return Process ID
+ *
+ * @since 0.2.0
+ **/
+pid_t pink_easy_launcher_get_pid(const pink_easy_launcher_t *launcher, unsigned i)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -36,6 +36,7 @@
  * @{
  **/
 
+#include <stdbool.h>
 #include <pinktrace/pink.h>
 #include <pinktrace/easy/context.h>
 
@@ -54,6 +55,69 @@ PINK_BEGIN_DECL
 int pink_easy_loop(pink_easy_context_t *ctx)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Returns a file descriptor which becomes readable when there is work for
+ * pink_easy_loop_dispatch_ready(), i.e. a traced process changed state or
+ * a pending decision was completed. This lets the event loop be driven
+ * from @e poll(2), @e epoll(7) or the like together with other file
+ * descriptors, instead of dedicating a thread to pink_easy_loop().
+ *
+ * The first call installs a @e SIGCHLD handler which chains to the
+ * previous one and writes to a pipe of the context. The descriptor is the
+ * reading end of that pipe; it is owned by the context and is readable
+ * initially, so that stops which happened before are not missed.
+ *
+ * The handler is process-wide and stays installed for the lifetime of the
+ * process. It is shared with pink_easy_loop() and sessions, which install it
+ * as well once a decision is pending (see #PINK_EASY_CFLAG_PENDING). At most
+ * 64 contexts and sessions are registered with it at a time; beyond that this
+ * function fails with @e ENOSPC, and pink_easy_loop() and sessions fall back
+ * to checking for events every 10 milliseconds while decisions are pending.
+ *
+ * @note @e SIGCHLD must not be blocked in every thread of the process.
+ * @note @e SIGCHLD must not be replaced with @e sigaction(2) or
+ *       @e signal(2) after this function is called, or the descriptor never
+ *       becomes readable again. Install the handler of the application
+ *       before, it is chained to.
+ * @note The handler interrupts @e poll(2) and friends with @e EINTR, which
+ *       the caller should treat like a wakeup.
+ *
+ * @param ctx Tracing context
+ * @return File descriptor on success, -1 on failure and sets errno
+ *         accordingly: @e ENOSPC if too many contexts are registered,
+ *         @e ENOTSUP if the handler could not be installed
+ **/
+int pink_easy_loop_get_fd(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Handle all events which are ready without blocking
+ *
+ * When the last process is gone or an error occurs, the "cleanup" callback
+ * is called, its return value is ignored, and this function returns false.
+ * Use pink_easy_context_get_error() to tell success from failure then.
+ * The context must not be stepped any more afterwards.
+ *
+ * @see pink_easy_loop_get_fd()
+ *
+ * @param ctx Tracing context
+ * @return true if tracing goes on, false if the loop is over
+ **/
+bool pink_easy_loop_dispatch_ready(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Wait at most @e timeout milliseconds for events, then handle all events
+ * which are ready with pink_easy_loop_dispatch_ready()
+ *
+ * @param ctx Tracing context
+ * @param timeout Timeout in milliseconds, zero to return immediately and
+ *        negative to wait without a timeout
+ * @return true if tracing goes on, false if the loop is over
+ **/
+bool pink_easy_loop_step(pink_easy_context_t *ctx, int timeout)
+	PINK_GCC_ATTR((nonnull(1)));
+
 PINK_END_DECL
 /** @} */
 #endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_MEMO_H
+#define _PINK_EASY_MEMO_H
+
+/**
+ * @file pinktrace/easy/memo.h
+ * @brief Pink's easy result cache for idempotent system calls
+ * @defgroup pink_easy_memo Pink's easy result cache for idempotent system calls
+ * @ingroup pinktrace-easy
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+#include <pinktrace/easy/process.h>
+
+PINK_BEGIN_DECL
+
+/** Upper limit for the size of the output argument of a cached system call **/
+#define PINK_EASY_MEMO_OUT_MAX		1024
+
+/** Upper limit for the number of results cached per process **/
+#define PINK_EASY_MEMO_PROCESS_MAX	32
+
+/**
+ * Declare a system call idempotent and cache its results
+ *
+ * The first successful call of a process runs as usual and its result is
+ * remembered. Later calls of the same process are answered from the cache
+ * on system call entry using pink_easy_process_emulate() and reach neither
+ * the dispatch table nor the "syscall" callback.
+ *
+ * A system call may have a key argument, e.g. the clock of
+ * @e clock_getres(2), in which case results are cached per key, and an
+ * output argument pointing to @e outsize bytes the system call fills in,
+ * e.g. the buffer of @e uname(2), which is written back on cache hits.
+ *
+ * The cache of a process is flushed on @e execve(2) and on the set*id(2),
+ * @e setgroups(2) and @e capset(2) family of system calls. New processes
+ * start with an empty cache, so a child never sees e.g. the @e getpid(2)
+ * result of its parent.
+ *
+ * @note When the context has a seccomp filter, cached system calls and the
+ *       system calls flushing the cache are traced.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param keyarg Index of the key argument or -1 if none
+ * @param outarg Index of the output argument or -1 if none
+ * @param outsize Size of the output argument, at most
+ *        #PINK_EASY_MEMO_OUT_MAX, ignored if @e outarg is -1
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_memo_set(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, int keyarg, int outarg, size_t outsize)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Like pink_easy_memo_set() but looks up the system call by name
+ *
+ * @see pink_name_lookup()
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness of the system call
+ * @param name Name of the system call
+ * @param keyarg Index of the key argument or -1 if none
+ * @param outarg Index of the output argument or -1 if none
+ * @param outsize Size of the output argument
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_memo_set_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, int keyarg, int outarg, size_t outsize)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Stop caching the results of any system call of the given bitness
+ *
+ * @note Results which are already cached by processes are kept until the
+ *       cache of the process is flushed.
+ *
+ * @param ctx Tracing context
+ * @param bitness Bitness
+ **/
+void pink_easy_memo_clear(pink_easy_context_t *ctx, pink_bitness_t bitness)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Flush the cached results of a process, e.g. after changing its state
+ * behind the back of the library
+ *
+ * @param proc Process entry
+ **/
+void pink_easy_process_memo_flush(pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
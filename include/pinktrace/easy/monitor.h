@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_MONITOR_H
+#define _PINK_EASY_MONITOR_H
+
+/**
+ * @file pinktrace/easy/monitor.h
+ * @brief Pink's easy live statistics for external monitors
+ * @defgroup pink_easy_monitor Pink's easy live statistics for external monitors
+ * @ingroup pinktrace-easy
+ *
+ * A context can publish live counters in a shared memory segment, a file
+ * mapped by the tracer and by any number of monitors, e.g. the pink-top
+ * tool. The event loop updates the segment with plain memory writes, so
+ * monitors never make the tracer do system calls or take locks on their
+ * behalf. Updates are protected by a sequence lock: the sequence number is
+ * odd while an update is in progress, and readers retry until they copied
+ * the segment without the number changing, see pink_easy_monitor_read().
+ *
+ * Counters only ever grow; monitors compute rates from the difference of
+ * two snapshots and their times.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+#include <pinktrace/easy/overhead.h>
+#include <pinktrace/easy/stats.h>
+
+PINK_BEGIN_DECL
+
+/** Magic at the start of segments **/
+#define PINK_EASY_MONITOR_MAGIC		"PINKMON"
+
+/** Version of the segment layout **/
+#define PINK_EASY_MONITOR_VERSION	1
+
+/** Number of system calls counted per bitness, larger numbers aren't **/
+#define PINK_EASY_MONITOR_SYSCALLS	1024
+
+/**
+ * @brief Layout of the shared memory segment
+ **/
+typedef struct {
+	/** #PINK_EASY_MONITOR_MAGIC **/
+	char magic[8];
+	/** #PINK_EASY_MONITOR_VERSION **/
+	uint32_t version;
+	/** Size of the segment **/
+	uint32_t size;
+	/** Sequence number, odd while an update is in progress **/
+	uint64_t seq;
+
+	/** Process ID of the tracer **/
+	int32_t tracer;
+	/** Number of traced processes **/
+	uint32_t tracees;
+	/** Monotonic clock time of the last update, in nanoseconds **/
+	uint64_t time;
+	/** Monotonic clock time the segment was created, in nanoseconds **/
+	uint64_t start;
+	/** Heap memory in use by the tracer in bytes, updated every now and
+	 * then, zero where unknown **/
+	uint64_t memory;
+
+	/** Number of stops, indexed by pink_easy_stop_t **/
+	uint64_t stops[PINK_EASY_STOP_MAX];
+	/** Histogram of the time from the return of @e waitpid(2) to the
+	 * resumption of the stops, see pink_easy_stats_bucket_min() **/
+	uint64_t stop_buckets[PINK_EASY_STATS_BUCKETS];
+	/** Number of system calls, indexed by bitness and system call number **/
+	uint64_t syscalls[2][PINK_EASY_MONITOR_SYSCALLS];
+} pink_easy_monitor_segment_t;
+
+/**
+ * @struct pink_easy_monitor_t
+ * @brief Opaque structure which represents a segment opened by a monitor
+ **/
+typedef struct pink_easy_monitor pink_easy_monitor_t;
+
+/**
+ * Publish the counters of the context in a shared memory segment
+ *
+ * The file is created, or truncated if it exists, with permissions for the
+ * owner only. It is left in place when publishing stops, remove it with
+ * @e unlink(2) once it's no longer needed.
+ *
+ * @param ctx Tracing context
+ * @param path Path of the segment, e.g. in @c /dev/shm, NULL to stop
+ *        publishing
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_context_set_monitor(pink_easy_context_t *ctx, const char *path)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Open a segment for reading
+ *
+ * @param path Path of the segment
+ * @return Monitor on success, NULL on failure and sets errno accordingly,
+ *         @e EINVAL if the file isn't a segment of a known version
+ *
+ * @since 0.2.0
+ **/
+pink_easy_monitor_t *pink_easy_monitor_open(const char *path)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Take a consistent snapshot of a segment
+ *
+ * @param monitor Monitor
+ * @param segment Where to copy the segment
+ * @return true on success, false if the tracer kept updating the segment
+ *         and sets errno to @e EAGAIN
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_monitor_read(const pink_easy_monitor_t *monitor,
+		pink_easy_monitor_segment_t *segment)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Close a segment
+ *
+ * @param monitor Monitor
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_monitor_close(pink_easy_monitor_t *monitor)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
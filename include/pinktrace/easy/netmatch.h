@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_NETMATCH_H
+#define _PINK_EASY_NETMATCH_H
+
+/**
+ * @file pinktrace/easy/netmatch.h
+ * @brief Pink's easy socket address matcher
+ * @defgroup pink_easy_netmatch Pink's easy socket address matcher
+ * @ingroup pinktrace-easy
+ *
+ * A socket address matcher holds internet address prefixes with port ranges
+ * and UNIX socket path patterns, each with an integer value, and looks up
+ * decoded socket addresses as returned by pink_decode_socket_address().
+ *
+ * Internet prefixes are kept in path compressed radix trees, one for each
+ * address family, so a lookup visits at most one node per distinct prefix
+ * length on the path to the address. The longest prefix whose port range
+ * contains the port wins. Among rules with the same prefix, the one added
+ * first wins. IPv4-mapped IPv6 addresses are looked up as IPv4 addresses.
+ *
+ * UNIX socket paths are matched with a pink_easy_trie_t, so the same
+ * pattern syntax applies. Names in the abstract namespace are matched
+ * separately, up to their first zero byte.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <pinktrace/pink.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_netmatch_t
+ * @brief Opaque structure which represents a socket address matcher
+ *
+ * Use pink_easy_netmatch_new() to create one and pink_easy_netmatch_destroy()
+ * to free all allocated resources.
+ **/
+typedef struct pink_easy_netmatch pink_easy_netmatch_t;
+
+/**
+ * Allocate a socket address matcher
+ *
+ * @return The matcher on success, NULL on failure and sets errno accordingly
+ **/
+pink_easy_netmatch_t *pink_easy_netmatch_new(void)
+	PINK_GCC_ATTR((malloc));
+
+/**
+ * Destroy a socket address matcher
+ *
+ * @param nm Matcher
+ **/
+void pink_easy_netmatch_destroy(pink_easy_netmatch_t *nm)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add an internet address prefix. It takes effect immediately.
+ *
+ * @param nm Matcher
+ * @param family @e AF_INET or @e AF_INET6
+ * @param addr Address in network byte order, either a struct in_addr or a
+ *             struct in6_addr depending on the family
+ * @param prefixlen Number of leading bits of the address to compare
+ * @param port_lo Lowest port in host byte order
+ * @param port_hi Highest port in host byte order
+ * @param value Value to return when the rule matches, must not be negative
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_netmatch_add_inet(pink_easy_netmatch_t *nm, int family,
+		const void *addr, unsigned prefixlen,
+		unsigned port_lo, unsigned port_hi, int value)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Add a UNIX socket path pattern. It takes effect after the next call to
+ * pink_easy_netmatch_compile().
+ *
+ * @param nm Matcher
+ * @param pattern Path pattern, see pink_easy_trie_t
+ * @param abstract true to match sockets in the abstract namespace, the
+ *                 pattern doesn't include the leading zero byte then
+ * @param value Value to return when the rule matches, must not be negative
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_netmatch_add_unix(pink_easy_netmatch_t *nm, const char *pattern,
+		bool abstract, int value)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Compile the UNIX socket path patterns
+ *
+ * @param nm Matcher
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_netmatch_compile(pink_easy_netmatch_t *nm)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Look a socket address up
+ *
+ * @param nm Matcher
+ * @param addr Decoded socket address
+ * @return Value of the matching rule, -1 if none matches
+ **/
+int pink_easy_netmatch_lookup(const pink_easy_netmatch_t *nm,
+		const pink_socket_address_t *addr)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_OVERHEAD_H
+#define _PINK_EASY_OVERHEAD_H
+
+/**
+ * @file pinktrace/easy/overhead.h
+ * @brief Pink's easy tracer overhead accounting
+ * @defgroup pink_easy_overhead Pink's easy tracer overhead accounting
+ * @ingroup pinktrace-easy
+ *
+ * A traced process is stopped from the moment the kernel reports a stop
+ * until the event loop resumes it. With overhead accounting on, the event
+ * loop measures this time for each stop, from the return of @e waitpid(2)
+ * to the resumption, and breaks it down into the @e ptrace(2) requests
+ * made (see pink_trace_set_account()) and the time spent in callbacks. The
+ * time the @e waitpid(2) call took is kept apart, it also includes the time
+ * the loop was idle. Totals and histograms are kept per kind of stop, for
+ * each process and for the context. Per system call, only the total stop
+ * time of the entries and exits together is kept, and only in the statistics
+ * collector of the context; without a collector it is not recorded, see
+ * pink_easy_context_set_stats().
+ *
+ * The requests made by callbacks are part of both the @e ptrace(2) and the
+ * callback figures. A stop whose decision is made elsewhere, see
+ * #PINK_EASY_CFLAG_PENDING, lasts until the event loop picks the decision
+ * up, the time the process was parked is part of its stop time. Its stop
+ * time is accounted then, the other figures when the process is parked.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+#include <pinktrace/easy/process.h>
+#include <pinktrace/easy/stats.h>
+
+PINK_BEGIN_DECL
+
+/** Kinds of stops **/
+typedef enum {
+	/** System call entry, including seccomp stops **/
+	PINK_EASY_STOP_SYSCALL_ENTRY = 0,
+	/** System call exit **/
+	PINK_EASY_STOP_SYSCALL_EXIT,
+	/** Signal delivery **/
+	PINK_EASY_STOP_SIGNAL,
+	/** Other ptrace events, e.g. fork, exec and exit **/
+	PINK_EASY_STOP_EVENT,
+	/** Number of kinds of stops **/
+	PINK_EASY_STOP_MAX,
+} pink_easy_stop_t;
+
+/**
+ * @brief Overhead of a kind of stops
+ **/
+typedef struct {
+	/** Number of stops **/
+	uint64_t stops;
+	/** Total time of the @e waitpid(2) calls which reported the stops, in
+	 * nanoseconds **/
+	uint64_t wait_time;
+	/** Total time from the return of @e waitpid(2) to the resumption, in
+	 * nanoseconds **/
+	uint64_t stop_time;
+	/** Total time spent in callbacks, in nanoseconds **/
+	uint64_t callback_time;
+	/** @e ptrace(2) requests made during the stops **/
+	pink_trace_account_t ptrace;
+	/** Histogram of the time from the return of @e waitpid(2) to the
+	 * resumption, see pink_easy_stats_bucket_min() **/
+	uint64_t buckets[PINK_EASY_STATS_BUCKETS];
+} pink_easy_overhead_t;
+
+/**
+ * Turn overhead accounting on or off for the processes of the context
+ *
+ * @param ctx Tracing context
+ * @param on true to turn accounting on
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_context_set_overhead(pink_easy_context_t *ctx, bool on)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the overhead of a kind of stops of all processes of the context,
+ * including those which are gone
+ *
+ * @param ctx Tracing context
+ * @param stop Kind of stops
+ * @param overhead Where to store the overhead
+ * @return true on success, false on failure and sets errno to @e EINVAL if
+ *         the kind of stops is invalid
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_context_get_overhead(const pink_easy_context_t *ctx,
+		pink_easy_stop_t stop, pink_easy_overhead_t *overhead)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Returns the overhead of a kind of stops of a process
+ *
+ * @param proc Process entry
+ * @param stop Kind of stops
+ * @param overhead Where to store the overhead, zero if the process had no
+ *        stops accounted
+ * @return true on success, false on failure and sets errno to @e EINVAL if
+ *         the kind of stops is invalid
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_get_overhead(const pink_easy_process_t *proc,
+		pink_easy_stop_t stop, pink_easy_overhead_t *overhead)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -37,15 +37,29 @@
 #include <pinktrace/pink.h>
 
 #include <pinktrace/easy/init.h>
+#include <pinktrace/easy/archive.h>
 #include <pinktrace/easy/attach.h>
 #include <pinktrace/easy/call.h>
 #include <pinktrace/easy/callback.h>
 #include <pinktrace/easy/context.h>
+#include <pinktrace/easy/dispatch.h>
 #include <pinktrace/easy/error.h>
 #include <pinktrace/easy/exec.h>
 #include <pinktrace/easy/func.h>
+#include <pinktrace/easy/group.h>
+#include <pinktrace/easy/launcher.h>
 #include <pinktrace/easy/loop.h>
+#include <pinktrace/easy/memo.h>
+#include <pinktrace/easy/monitor.h>
+#include <pinktrace/easy/netmatch.h>
+#include <pinktrace/easy/overhead.h>
+#include <pinktrace/easy/policy.h>
 #include <pinktrace/easy/process.h>
+#include <pinktrace/easy/recorder.h>
+#include <pinktrace/easy/session.h>
+#include <pinktrace/easy/shadow.h>
+#include <pinktrace/easy/stats.h>
+#include <pinktrace/easy/trie.h>
 #include <pinktrace/easy/vm.h>
 
 #endif
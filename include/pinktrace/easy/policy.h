@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_POLICY_H
+#define _PINK_EASY_POLICY_H
+
+/**
+ * @file pinktrace/easy/policy.h
+ * @brief Pink's easy declarative system call policy
+ * @defgroup pink_easy_policy Pink's easy declarative system call policy
+ * @ingroup pinktrace-easy
+ *
+ * A policy maps system calls to actions, optionally depending on the
+ * arguments of the system call. Rules are added to a policy object which is
+ * then compiled into flat lookup tables and loaded into a tracing context
+ * with pink_easy_context_set_policy(). The event loop evaluates the policy on
+ * system call entry before any callback is called, so system calls which the
+ * policy resolves never reach the callbacks.
+ *
+ * For a given system call, argument rules are checked in the order they were
+ * added and the first match wins, except that consecutive path rules and
+ * consecutive socket address rules on the same argument are matched
+ * together and the most specific one wins, see pink_easy_trie_t and
+ * pink_easy_netmatch_t. If no argument rule matches, the action of
+ * the system call set with pink_easy_policy_set() is used. System calls which
+ * are not listed at all get the default action of the policy unless a
+ * handler is registered for them in the dispatch table, in which case they
+ * are traced.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+#include <pinktrace/easy/trie.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_policy_t
+ * @brief Opaque structure which represents a system call policy
+ *
+ * Use pink_easy_policy_new() to create one and pink_easy_policy_destroy() to
+ * free all allocated resources.
+ **/
+typedef struct pink_easy_policy pink_easy_policy_t;
+
+/** Policy actions **/
+typedef enum {
+	/** Let the system call run without calling any callbacks **/
+	PINK_EASY_POLICY_ALLOW = 0,
+	/** Fail the system call with the given @e errno **/
+	PINK_EASY_POLICY_DENY,
+	/** Kill the process with @e SIGKILL **/
+	PINK_EASY_POLICY_KILL,
+	/** Hand the system call over to the dispatch table and callbacks **/
+	PINK_EASY_POLICY_TRACE,
+} pink_easy_policy_action_t;
+
+/** Comparison operators for integer argument rules **/
+typedef enum {
+	/** Argument is equal to the value **/
+	PINK_EASY_POLICY_OP_EQ = 0,
+	/** Argument is not equal to the value **/
+	PINK_EASY_POLICY_OP_NE,
+	/** Argument is less than the value **/
+	PINK_EASY_POLICY_OP_LT,
+	/** Argument is less than or equal to the value **/
+	PINK_EASY_POLICY_OP_LE,
+	/** Argument is greater than the value **/
+	PINK_EASY_POLICY_OP_GT,
+	/** Argument is greater than or equal to the value **/
+	PINK_EASY_POLICY_OP_GE,
+	/** Argument masked with the mask is equal to the value **/
+	PINK_EASY_POLICY_OP_MASKED_EQ,
+	/** Any of the bits in the mask are set in the argument **/
+	PINK_EASY_POLICY_OP_ANY_SET,
+} pink_easy_policy_op_t;
+
+/**
+ * Allocate a policy
+ *
+ * @param default_action Action for system calls which aren't listed
+ * @param default_errno @e errno for #PINK_EASY_POLICY_DENY
+ * @return The policy on success, NULL on failure and sets errno accordingly
+ **/
+pink_easy_policy_t *pink_easy_policy_new(pink_easy_policy_action_t default_action,
+		int default_errno)
+	PINK_GCC_ATTR((malloc));
+
+/**
+ * Destroy a policy
+ *
+ * @param policy Policy
+ **/
+void pink_easy_policy_destroy(pink_easy_policy_t *policy)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Set the action of a system call
+ *
+ * @param policy Policy
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param action Action
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_set(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, pink_easy_policy_action_t action, int err)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a rule on an integer or flags argument of a system call
+ *
+ * @param policy Policy
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param ind Index of the argument (0-5, see #PINK_MAX_ARGS)
+ * @param op Comparison operator
+ * @param value Value to compare the argument with
+ * @param mask Mask for #PINK_EASY_POLICY_OP_MASKED_EQ and
+ *             #PINK_EASY_POLICY_OP_ANY_SET, ignored otherwise
+ * @param action Action if the rule matches
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_add_int(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, pink_easy_policy_op_t op,
+		long value, long mask,
+		pink_easy_policy_action_t action, int err)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a rule on a path argument of a system call. The rule matches if the
+ * path equals to the prefix or lies under the prefix; a prefix with a
+ * trailing slash, like @e /usr/, matches only what lies under it and never
+ * @e /usr itself or @e /usrlocal. The prefix may contain wildcards, see
+ * pink_easy_trie_t for the syntax.
+ *
+ * @note Paths are matched as they are passed to the system call, relative
+ *       paths are not resolved.
+ *
+ * @param policy Policy
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param ind Index of the argument (0-5, see #PINK_MAX_ARGS)
+ * @param prefix Path prefix
+ * @param action Action if the rule matches
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_add_path(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, const char *prefix,
+		pink_easy_policy_action_t action, int err)
+	PINK_GCC_ATTR((nonnull(1,5)));
+
+/**
+ * Add a rule on an internet socket address argument of a system call
+ *
+ * @see pink_decode_socket_address()
+ *
+ * @param policy Policy
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param ind Index of the socket address argument, the same as the index
+ *            argument of pink_decode_socket_address()
+ * @param family @e AF_INET or @e AF_INET6
+ * @param addr Address in network byte order, either a struct in_addr or a
+ *             struct in6_addr depending on the family
+ * @param prefixlen Number of leading bits of the address to compare
+ * @param port_lo Lowest port in host byte order
+ * @param port_hi Highest port in host byte order
+ * @param action Action if the rule matches
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_add_inet(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, int family, const void *addr,
+		unsigned prefixlen, unsigned port_lo, unsigned port_hi,
+		pink_easy_policy_action_t action, int err)
+	PINK_GCC_ATTR((nonnull(1,6)));
+
+/**
+ * Add a rule on a UNIX socket address argument of a system call. The rule
+ * matches if the socket path equals to the prefix or lies under the prefix.
+ *
+ * @param policy Policy
+ * @param bitness Bitness of the system call
+ * @param scno System call number
+ * @param ind Index of the socket address argument, the same as the index
+ *            argument of pink_decode_socket_address()
+ * @param prefix Path prefix, without the leading zero byte for abstract
+ *               sockets
+ * @param abstract true to match sockets in the abstract namespace
+ * @param action Action if the rule matches
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_add_unix(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, const char *prefix, bool abstract,
+		pink_easy_policy_action_t action, int err)
+	PINK_GCC_ATTR((nonnull(1,5)));
+
+/**
+ * Compile the rules into lookup tables. Rules added after compilation take
+ * effect after the next call to this function.
+ *
+ * @param policy Policy
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_policy_compile(pink_easy_policy_t *policy)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Evaluate the policy for the system call the process is entering
+ *
+ * @note This is what pink_easy_loop() does on system call entry, it's
+ *       exported for callbacks which want to consult a policy themselves.
+ *
+ * @param policy Compiled policy
+ * @param pid Process ID
+ * @param bitness Bitness of the process
+ * @param scno System call number
+ * @param err Pointer to store the @e errno for #PINK_EASY_POLICY_DENY
+ * @return The action, or #PINK_EASY_POLICY_TRACE if the policy isn't compiled
+ *         or the process is gone
+ **/
+pink_easy_policy_action_t pink_easy_policy_check(const pink_easy_policy_t *policy,
+		pid_t pid, pink_bitness_t bitness, long scno, int *err)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Load a compiled policy into the tracing context
+ *
+ * If @e seccomp is true, the system call number part of the policy is
+ * lowered to a seccomp filter which is installed in children spawned with
+ * pink_easy_execve() and friends or pink_easy_call(). System calls allowed,
+ * denied or killed without looking at the arguments never stop the tracee in
+ * that case. The context adds #PINK_TRACE_OPTION_SECCOMP to its trace
+ * options.
+ *
+ * @attention Loading the filter sets @e PR_SET_NO_NEW_PRIVS in the children
+ *            before they execute the program, unprivileged processes can't
+ *            install seccomp filters otherwise. Set-user-ID and set-group-ID
+ *            bits and file capabilities are ignored by @e execve(2) from
+ *            then on, for the children and all their descendants, and this
+ *            can't be undone. Pass false for @e seccomp to spawn children
+ *            which may gain privileges.
+ *
+ * @note The context doesn't take the ownership of the policy, it must stay
+ *       alive until the context is destroyed or another policy is loaded.
+ *
+ * @param ctx Tracing context
+ * @param policy Compiled policy or NULL to unload the current policy
+ * @param seccomp true to install a seccomp filter in spawned children
+ * @return true on success, false on failure and sets errno accordingly,
+ *         errno is set to @e ENOTSUP if seccomp filters aren't supported
+ **/
+bool pink_easy_context_set_policy(pink_easy_context_t *ctx,
+		const pink_easy_policy_t *policy, bool seccomp)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Complete the pending decision about a process which was kept stopped
+ * because a callback returned #PINK_EASY_CFLAG_PENDING
+ *
+ * This function may be called from any thread. The event loop picks the
+ * verdict up and resumes the process:
+ * - #PINK_EASY_POLICY_ALLOW and #PINK_EASY_POLICY_TRACE resume it as if the
+ *   callbacks had returned zero.
+ * - #PINK_EASY_POLICY_DENY fails the system call with @e err on system call
+ *   entry and makes it return @e -err on system call exit.
+ * - #PINK_EASY_POLICY_KILL kills the process.
+ *
+ * @attention Complete each pending decision exactly once, even if the
+ *            process is killed in the meantime: pink_easy_loop() doesn't
+ *            return before all pending decisions are completed. Once this
+ *            function returns true, don't pass the entry to it again; the
+ *            entry of a process which went away is freed as soon as the
+ *            event loop picks the verdict up. Entries of processes which
+ *            went away and were never completed are freed by
+ *            pink_easy_context_destroy().
+ *
+ * @param proc Process entry
+ * @param verdict Action to take
+ * @param err @e errno for #PINK_EASY_POLICY_DENY
+ * @return true on success, false on failure and sets errno accordingly,
+ *         errno is set to @e EBUSY if no decision is pending for the
+ *         process, e.g. because it is already completed
+ **/
+bool pink_easy_process_complete(pink_easy_process_t *proc,
+		pink_easy_policy_action_t verdict, int err)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Cache the decisions of the policy of the tracing context
+ *
+ * When a system call has argument predicates, the event loop decodes the
+ * arguments the predicates look at, i.e. integers, path strings and socket
+ * addresses, and looks the system call number, the bitness and the decoded
+ * arguments up in a least recently used cache before evaluating the
+ * predicates. Repeated decisions, e.g. the same @e stat(2) on the same path,
+ * cost a single hash probe.
+ *
+ * Decisions only depend on the decoded arguments, so the cache is shared by
+ * all processes of the context and needs no flushing on @e execve(2). It is
+ * flushed when another policy is loaded or the policy is compiled again.
+ * Paths longer than @e PATH_MAX aren't cached.
+ *
+ * @param ctx Tracing context
+ * @param size Maximum number of cached decisions, 0 to disable the cache
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_context_set_decision_cache(pink_easy_context_t *ctx, unsigned size)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Flush the policy decision cache of the tracing context
+ *
+ * @see pink_easy_context_set_decision_cache()
+ *
+ * @param ctx Tracing context
+ **/
+void pink_easy_context_flush_decision_cache(pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
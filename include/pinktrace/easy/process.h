@@ -79,6 +79,45 @@ int pink_easy_process_kill(const pink_easy_process_t *proc, int sig);
  **/
 bool pink_easy_process_resume(const pink_easy_process_t *proc, int sig);
 
+/**
+ * Fail the system call the process is entering with the given @e errno
+ *
+ * @see pink_easy_process_emulate()
+ *
+ * @param proc Process entry
+ * @param err @e errno
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_process_deny(pink_easy_process_t *proc, int err)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Skip the system call the process is entering and make it return the given
+ * value instead.
+ *
+ * This may only be called on system call entry, i.e. from a "syscall"
+ * callback with entering set to true or from an entry handler of the
+ * dispatch table. The callbacks and handlers which would come after for
+ * this system call, including the ones on exit, are not called.
+ *
+ * Where pink_util_skip_syscall() is supported, the system call is resolved
+ * at entry and processes running under a seccomp filter don't stop at the
+ * exit at all. Elsewhere the return value is fixed up on exit by the event
+ * loop.
+ *
+ * @note @e PTRACE_SYSEMU is of no use here: it has to be requested when
+ *       resuming the tracee @e before the entry stop, whereas the decision
+ *       is made at the entry stop.
+ *
+ * @param proc Process entry
+ * @param retval Return value, a negated @e errno to fail the system call
+ * @return true on success, false on failure and sets errno accordingly,
+ *         errno is set to @e EINVAL if the process isn't at system call
+ *         entry
+ **/
+bool pink_easy_process_emulate(pink_easy_process_t *proc, long retval)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Returns the process ID of the entry
  *
@@ -97,6 +136,30 @@ pid_t pink_easy_process_get_pid(const pink_easy_process_t *proc)
 pid_t pink_easy_process_get_ppid(const pink_easy_process_t *proc)
 	PINK_GCC_ATTR((nonnull(1)));
 
+/**
+ * Returns the thread group ID of the entry
+ *
+ * @param proc Process entry
+ * @return Thread group ID
+ *
+ * @since 0.2.0
+ **/
+pid_t pink_easy_process_get_tgid(const pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the parent entry of the entry. A process whose parent is gone is
+ * adopted by its closest traced ancestor. Threads are children of the
+ * thread which created them.
+ *
+ * @param proc Process entry
+ * @return Parent entry or NULL if no ancestor is traced
+ *
+ * @since 0.2.0
+ **/
+pink_easy_process_t *pink_easy_process_get_parent(const pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
 /**
  * Returns the bitness of the entry
  *
@@ -189,6 +252,114 @@ unsigned pink_easy_process_list_walk(const pink_easy_process_list_t *list,
 		pink_easy_walk_func_t func, void *userdata)
 	PINK_GCC_ATTR((nonnull(1,2)));
 
+/**
+ * Walk the subtree of a process entry, the entry first, parents before
+ * their children. It takes time proportional to the size of the subtree.
+ *
+ * @note The walk function must not remove entries.
+ *
+ * @param proc Process entry
+ * @param func Walk function
+ * @param userdata User data to pass to the walk function
+ * @return Total number of visited entries
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_tree_walk(pink_easy_process_t *proc,
+		pink_easy_walk_func_t func, void *userdata)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Count the entries in the subtree of a process entry, including itself
+ *
+ * @param proc Process entry
+ * @return Number of entries
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_tree_count(const pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Send a signal to every entry in the subtree of a process entry with
+ * pink_easy_process_kill()
+ *
+ * @param proc Process entry
+ * @param sig Signal to deliver
+ * @return Number of entries the signal was sent to successfully
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_tree_kill(const pink_easy_process_t *proc, int sig)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Detach from every entry in the subtree of a process entry, they run
+ * untraced from then on. Processes attached with @e PTRACE_SEIZE are
+ * interrupted and detached right away, others are detached at their next
+ * stop. Children they create in the meantime are detached as well. The
+ * "teardown" callback is called for each of them before its entry is
+ * removed.
+ *
+ * @note Processes running under the seccomp filter of the context are
+ *       skipped, the filter would fail the system calls it traps once
+ *       they are detached.
+ *
+ * @param proc Process entry
+ * @return Number of entries which are to be detached
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_tree_detach(pink_easy_process_t *proc)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/** Ways to stop tracing a process **/
+typedef enum {
+	/** Detach, processes under the seccomp filter of the context are
+	 * quieted instead **/
+	PINK_EASY_RELEASE_DETACH = 0,
+	/** Stay attached, following forks, execs and exits, but stop tracing
+	 * system calls. Processes under the seccomp filter of the context are
+	 * left with the verdicts the filter makes on its own. **/
+	PINK_EASY_RELEASE_QUIET,
+} pink_easy_release_t;
+
+/**
+ * Stop tracing the subtree of a process entry as cheaply as possible,
+ * e.g. once it has executed a trusted program. Children created in the
+ * meantime are released the same way.
+ *
+ * Unlike pink_easy_process_tree_detach() this never leaves a process to
+ * the seccomp filter of the context alone: processes under the filter are
+ * kept attached and the system calls the filter traps are let through
+ * without stopping at their exits. A process whose denied system call is
+ * yet to return is released after the return value is fixed up.
+ *
+ * @param proc Process entry
+ * @param how How to release the processes
+ * @return Number of entries which are to be released
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_tree_release(pink_easy_process_t *proc,
+		pink_easy_release_t how)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Walk the thread group of a process entry, the leader first if it is
+ * traced.
+ *
+ * @param proc Process entry
+ * @param func Walk function
+ * @param userdata User data to pass to the walk function
+ * @return Total number of visited entries
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_process_thread_walk(pink_easy_process_t *proc,
+		pink_easy_walk_func_t func, void *userdata)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
 PINK_END_DECL
 /** @} */
 #endif
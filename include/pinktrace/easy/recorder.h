@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_RECORDER_H
+#define _PINK_EASY_RECORDER_H
+
+/**
+ * @file pinktrace/easy/recorder.h
+ * @brief Pink's easy binary trace recorder
+ * @defgroup pink_easy_recorder Pink's easy binary trace recorder
+ * @ingroup pinktrace-easy
+ *
+ * The recorder writes compact binary records of system calls to a file.
+ * Callbacks append records to a lock-free ring buffer, which may be shared
+ * by many threads, and a background thread writes the ring out in large
+ * batches, so neither formatting nor file I/O happens while tracees wait.
+ * The reader functions decode the file offline, see the pink-tracedump
+ * tool for an example.
+ *
+ * The file starts with a #pink_easy_record_header_t followed by the
+ * records, in the byte order of the machine which wrote them.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/process.h>
+
+PINK_BEGIN_DECL
+
+/** Magic at the start of recorder files **/
+#define PINK_EASY_RECORD_MAGIC		"PINKREC"
+
+/** Version of the file format **/
+#define PINK_EASY_RECORD_VERSION	1
+
+/** Upper limit for the number of arguments of a record **/
+#define PINK_EASY_RECORD_ARGS_MAX	6
+
+/** Upper limit for the length of the payload of a record **/
+#define PINK_EASY_RECORD_PAYLOAD_MAX	65535
+
+/** The record is of a system call exit and has a return value **/
+#define PINK_EASY_RECORD_EXIT		0x01
+
+/** The process was 64 bit, 32 bit otherwise **/
+#define PINK_EASY_RECORD_64		0x02
+
+/**
+ * @brief Header of recorder files
+ **/
+typedef struct {
+	/** #PINK_EASY_RECORD_MAGIC **/
+	char magic[8];
+	/** #PINK_EASY_RECORD_VERSION **/
+	uint32_t version;
+	/** 0x01020304 in the byte order of the writer **/
+	uint32_t byte_order;
+	/** Wall clock time the recorder was created, in nanoseconds since
+	 * the epoch **/
+	uint64_t epoch;
+} pink_easy_record_header_t;
+
+/**
+ * @brief Record of a system call
+ *
+ * Records are padded to a multiple of eight bytes.
+ **/
+typedef struct {
+	/** Size of the record with its padding **/
+	uint32_t size;
+	/** Length of the payload **/
+	uint16_t payload_len;
+	/** PINK_EASY_RECORD_* flags **/
+	uint8_t flags;
+	/** Number of arguments **/
+	uint8_t nargs;
+	/** Process ID **/
+	int32_t pid;
+	/** System call number **/
+	int32_t scno;
+	/** Time of the record, in nanoseconds since the recorder was created **/
+	uint64_t time;
+	/** Return value, 0 unless #PINK_EASY_RECORD_EXIT is set **/
+	int64_t retval;
+	/** Arguments, followed by the payload **/
+	uint64_t args[];
+} pink_easy_record_t;
+
+/**
+ * @struct pink_easy_recorder_t
+ * @brief Opaque structure which represents a trace recorder
+ **/
+typedef struct pink_easy_recorder pink_easy_recorder_t;
+
+/**
+ * @struct pink_easy_record_reader_t
+ * @brief Opaque structure which represents a reader of recorder files
+ **/
+typedef struct pink_easy_record_reader pink_easy_record_reader_t;
+
+/**
+ * Create a trace recorder writing to the given file and start its writer
+ * thread
+ *
+ * @param path Path of the file, truncated if it exists
+ * @param size Size of the ring buffer in bytes, rounded up to a power of
+ *        two, 0 for the default of 1MiB
+ * @return Recorder on success, NULL on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+pink_easy_recorder_t *pink_easy_recorder_new(const char *path, size_t size)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Append a record. Any thread may append records at any time.
+ *
+ * This never blocks unless the ring buffer is full, in which case it waits
+ * for the writer thread to make room; records are never dropped.
+ *
+ * @param recorder Recorder
+ * @param pid Process ID
+ * @param bitness Bitness of the process
+ * @param scno System call number
+ * @param flags PINK_EASY_RECORD_* flags, #PINK_EASY_RECORD_64 is set
+ *        according to @e bitness
+ * @param retval Return value
+ * @param args Arguments
+ * @param nargs Number of arguments, at most #PINK_EASY_RECORD_ARGS_MAX
+ * @param payload Payload, e.g. a decoded path, may be NULL
+ * @param len Length of the payload, at most #PINK_EASY_RECORD_PAYLOAD_MAX
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_recorder_append(pink_easy_recorder_t *recorder, pid_t pid,
+		pink_bitness_t bitness, long scno, unsigned flags, long retval,
+		const long *args, unsigned nargs, const void *payload, size_t len)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Append a record of the system call the process is stopped at. The
+ * system call number is the one the event loop has decoded, if any, the
+ * arguments are read at once with pink_util_get_args() and, on exit, the
+ * return value with pink_util_get_return().
+ *
+ * @param recorder Recorder
+ * @param proc Process entry
+ * @param entering true if the process is entering the system call
+ * @param payload Payload, may be NULL
+ * @param len Length of the payload
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_recorder_syscall(pink_easy_recorder_t *recorder,
+		const pink_easy_process_t *proc, bool entering,
+		const void *payload, size_t len)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Wait until the records appended so far are written to the file
+ *
+ * @param recorder Recorder
+ * @return true on success, false if writing failed and sets errno
+ *         accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_recorder_flush(pink_easy_recorder_t *recorder)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the number of times an append had to wait for the writer thread
+ * because the ring buffer was full
+ *
+ * @param recorder Recorder
+ * @return Number of stalls
+ *
+ * @since 0.2.0
+ **/
+unsigned long pink_easy_recorder_get_stalls(const pink_easy_recorder_t *recorder)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Write the remaining records, stop the writer thread, close the file and
+ * free the recorder
+ *
+ * @param recorder Recorder
+ * @return true on success, false if writing failed and sets errno
+ *         accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_recorder_destroy(pink_easy_recorder_t *recorder)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Open a recorder file for reading
+ *
+ * @param path Path of the file
+ * @return Reader on success, NULL on failure and sets errno accordingly,
+ *         @e EINVAL if the file isn't a recorder file of a known version
+ *         and byte order
+ *
+ * @since 0.2.0
+ **/
+pink_easy_record_reader_t *pink_easy_record_reader_open(const char *path)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the header of the file
+ *
+ * @param reader Reader
+ * @return File header
+ *
+ * @since 0.2.0
+ **/
+const pink_easy_record_header_t *pink_easy_record_reader_get_header(const pink_easy_record_reader_t *reader)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the next record of the file
+ *
+ * @param reader Reader
+ * @return Record, valid until the reader is closed, NULL at the end of the
+ *         file, in which case errno is zero, or if the record is corrupt or
+ *         truncated, in which case errno is set to @e EINVAL
+ *
+ * @since 0.2.0
+ **/
+const pink_easy_record_t *pink_easy_record_reader_next(pink_easy_record_reader_t *reader)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Close a reader
+ *
+ * @param reader Reader
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_record_reader_close(pink_easy_record_reader_t *reader)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the payload of a record
+ *
+ * @param record Record
+ * @return Payload, the length is in the payload_len member
+ *
+ * @since 0.2.0
+ **/
+const void *pink_easy_record_get_payload(const pink_easy_record_t *record)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the bitness of the process a record is of
+ *
+ * @param record Record
+ * @return Bitness
+ *
+ * @since 0.2.0
+ **/
+pink_bitness_t pink_easy_record_get_bitness(const pink_easy_record_t *record)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_SESSION_H
+#define _PINK_EASY_SESSION_H
+
+/**
+ * @file pinktrace/easy/session.h
+ * @brief Pink's easy tracing sessions
+ * @defgroup pink_easy_session Pink's easy tracing sessions
+ * @ingroup pinktrace-easy
+ *
+ * pink_easy_loop() waits for any child, so only one context can be traced
+ * by it in a process. A session runs a single event loop for many contexts
+ * instead: every event is handed to the context which traces the process,
+ * with its own callbacks, policy and process list, so unrelated jobs can be
+ * traced by one thread.
+ *
+ * Contexts are added to the session once their initial processes are
+ * started, also while the loop is running, e.g. from a callback. A
+ * context leaves the session when its last process is gone: it is removed
+ * from the session, then its "cleanup" callback is called, whose return
+ * value is ignored. If a callback of a context aborts, the remaining
+ * processes of that context are killed and it leaves the session the same
+ * way, the other contexts are not affected.
+ *
+ * Contexts with processes can't be removed from the session while the loop
+ * runs, the loop may be dispatching events to them. To make such a context
+ * leave early, kill its processes, e.g. with pink_easy_process_kill(); it
+ * leaves once their exits are reported. Destroying a context which is still
+ * in the session from a callback is not supported, destroy it from its
+ * "cleanup" callback or once pink_easy_session_loop() has returned.
+ *
+ * New processes whose parent is never reported, e.g. because the parent was
+ * killed at the fork, are killed when a context leaves the session and no
+ * other context traces the parent.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_session_t
+ * @brief Opaque structure which represents a tracing session
+ *
+ * Use pink_easy_session_new() to create one and pink_easy_session_destroy()
+ * to free all allocated resources.
+ **/
+typedef struct pink_easy_session pink_easy_session_t;
+
+/**
+ * Allocate a tracing session
+ *
+ * @return The session on success, NULL on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+pink_easy_session_t *pink_easy_session_new(void)
+	PINK_GCC_ATTR((malloc));
+
+/**
+ * Destroy a tracing session. The contexts which are still in the session
+ * are removed from it, they are not destroyed.
+ *
+ * @param session Session
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_session_destroy(pink_easy_session_t *session)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a context to the session
+ *
+ * @note Destroying the context removes it from the session, but see the
+ *       restrictions above while pink_easy_session_loop() runs.
+ *
+ * @param session Session
+ * @param ctx Tracing context, with at least one process
+ * @return true on success, false on failure and sets errno accordingly:
+ *         @e EINVAL if the context has no processes, @e EBUSY if it is in a
+ *         session already
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_session_add(pink_easy_session_t *session, pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Remove a context without processes from the session. Contexts with
+ * processes leave the session by themselves once the processes are gone.
+ *
+ * @param session Session
+ * @param ctx Tracing context
+ * @return true on success, false on failure and sets errno accordingly:
+ *         @e ENOENT if the context is not in the session, @e EBUSY if it
+ *         still has processes
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_session_remove(pink_easy_session_t *session, pink_easy_context_t *ctx)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Return the number of contexts in the session
+ *
+ * @param session Session
+ * @return Number of contexts
+ *
+ * @since 0.2.0
+ **/
+unsigned pink_easy_session_count(const pink_easy_session_t *session)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * The event loop of the session. It returns when no contexts are left in
+ * the session.
+ *
+ * @param session Session
+ * @return true on success, false if waiting for events failed and sets errno
+ *         accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_session_loop(pink_easy_session_t *session)
+	PINK_GCC_ATTR((nonnull(1)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_SHADOW_H
+#define _PINK_EASY_SHADOW_H
+
+/**
+ * @file pinktrace/easy/shadow.h
+ * @brief Pink's easy shadow file descriptor tables
+ * @defgroup pink_easy_shadow Pink's easy shadow file descriptor tables
+ * @ingroup pinktrace-easy
+ *
+ * Policies often need to know what a file descriptor refers to, or where
+ * a relative path of @e openat(2) leads. Reading @c /proc/pid/fd/N and
+ * @c /proc/pid/cwd on every system call is slow, so the library can keep a
+ * shadow of the file descriptor table and the working directory of the
+ * traced processes, updated from the exits of the system calls changing
+ * them. The shadow tables live in the groups of the processes (see
+ * pink_easy_process_get_group()) and are copied on @e fork(2) as the clone
+ * flags dictate.
+ *
+ * File descriptors the library hasn't seen created, e.g. those inherited
+ * from the tracer or opened before attaching, are looked up in @c /proc
+ * once. Paths are recorded as the process named them, joined with the
+ * directory they are relative to but neither canonicalised nor resolved
+ * through symbolic links.
+ *
+ * A quieted process (see #PINK_EASY_RELEASE_QUIET) changes its tables
+ * unseen. As long as a group has a quiet member, its table isn't kept and
+ * every lookup goes to @c /proc, also for the traced members sharing it.
+ *
+ * @note The lookup functions may be called from the event loop thread
+ *       only, e.g. from callbacks.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+#include <pinktrace/easy/process.h>
+
+PINK_BEGIN_DECL
+
+/** Kinds of file descriptors **/
+typedef enum {
+	/** File, directory or anything else with a path **/
+	PINK_EASY_FD_FILE = 0,
+	/** Socket **/
+	PINK_EASY_FD_SOCKET,
+	/** Pipe, event descriptor and the like **/
+	PINK_EASY_FD_OTHER,
+} pink_easy_fd_type_t;
+
+/**
+ * Keep shadow file descriptor tables and working directories for the
+ * processes of the context
+ *
+ * @note When the context has a seccomp filter, the system calls updating
+ *       the shadow tables are traced.
+ *
+ * @param ctx Tracing context
+ * @param shadow true to keep shadow tables, false to look everything up
+ *        in @c /proc
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e EBUSY if the context has processes
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_context_set_shadow(pink_easy_context_t *ctx, bool shadow)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Get the working directory of the process
+ *
+ * @param proc Process entry
+ * @param buf Buffer to store the path
+ * @param len Size of the buffer
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e ERANGE if the buffer is too small
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_get_cwd(const pink_easy_process_t *proc, char *buf, size_t len)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Get the path a file descriptor of the process refers to
+ *
+ * @note For sockets, pipes and the like this is what @c /proc reports,
+ *       e.g. @c socket:[1234]
+ *
+ * @param proc Process entry
+ * @param fd File descriptor
+ * @param buf Buffer to store the path
+ * @param len Size of the buffer
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e EBADF if the file descriptor isn't open and @e ERANGE if the
+ *         buffer is too small
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_get_fd_path(const pink_easy_process_t *proc, long fd,
+		char *buf, size_t len)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Get the kind of a file descriptor of the process
+ *
+ * @param proc Process entry
+ * @param fd File descriptor
+ * @param type Pointer to store the kind
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e EBADF if the file descriptor isn't open
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_get_fd_type(const pink_easy_process_t *proc, long fd,
+		pink_easy_fd_type_t *type)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Get the flags a file descriptor of the process was opened with
+ *
+ * @param proc Process entry
+ * @param fd File descriptor
+ * @return The access mode and status flags of the file descriptor with
+ *         @e O_CLOEXEC if it is closed on @e execve(2), -1 on failure and
+ *         sets errno accordingly, @e EBADF if the file descriptor isn't open
+ *
+ * @since 0.2.0
+ **/
+int pink_easy_process_get_fd_flags(const pink_easy_process_t *proc, long fd)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Get the address a socket of the process is connected to
+ *
+ * @param proc Process entry
+ * @param fd File descriptor
+ * @param addr Pointer to store the socket address
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e EBADF if the file descriptor isn't open, @e ENOTSOCK if it
+ *         isn't a socket and @e ENOTCONN if the library hasn't seen the
+ *         socket connect
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_get_fd_address(const pink_easy_process_t *proc, long fd,
+		pink_socket_address_t *addr)
+	PINK_GCC_ATTR((nonnull(1,3)));
+
+/**
+ * Resolve a path relative to a directory file descriptor of the process,
+ * as the path arguments of the *at(2) family of system calls are
+ *
+ * @param proc Process entry
+ * @param dirfd Directory file descriptor or @e AT_FDCWD
+ * @param path Path, absolute paths are copied as they are
+ * @param buf Buffer to store the resolved path
+ * @param len Size of the buffer
+ * @return true on success, false on failure and sets errno accordingly,
+ *         @e EBADF if @e dirfd isn't open, @e ENOTDIR if it isn't a file
+ *         and @e ERANGE if the buffer is too small
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_process_resolve_at(const pink_easy_process_t *proc, long dirfd,
+		const char *path, char *buf, size_t len)
+	PINK_GCC_ATTR((nonnull(1,3,4)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_STATS_H
+#define _PINK_EASY_STATS_H
+
+/**
+ * @file pinktrace/easy/stats.h
+ * @brief Pink's easy system call statistics
+ * @defgroup pink_easy_stats Pink's easy system call statistics
+ * @ingroup pinktrace-easy
+ *
+ * A statistics collector counts the system calls of the processes of the
+ * contexts it is attached to, like @e strace -c, per system call number and
+ * bitness: the number of calls, the number of failed calls and a histogram
+ * of the time from entry to exit. Each tracer thread updates counters of
+ * its own without locking, they are merged when a snapshot is taken.
+ *
+ * Only system call stops are counted, so when a context has a seccomp
+ * filter the system calls the filter lets through aren't. The time is
+ * measured by the tracer, from the entry stop to the exit stop, and
+ * includes the time the tracer takes to handle both.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/context.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * Number of buckets of the time histograms. Buckets are log-linear, four to
+ * each power of two of nanoseconds, the last one holds anything longer than
+ * about four seconds, see pink_easy_stats_bucket_min().
+ **/
+#define PINK_EASY_STATS_BUCKETS		128
+
+/**
+ * @brief Statistics of a system call
+ **/
+typedef struct {
+	/** Bitness **/
+	pink_bitness_t bitness;
+	/** System call number **/
+	long scno;
+	/** Number of calls **/
+	uint64_t calls;
+	/** Number of calls which returned an error **/
+	uint64_t errors;
+	/** Total time of the calls in nanoseconds **/
+	uint64_t time;
+	/** Total time the tracer kept the processes stopped at the entries and
+	 * exits of the calls in nanoseconds, including the time they waited
+	 * for pending decisions. Only counted with overhead accounting on, see
+	 * pink_easy_context_set_overhead() **/
+	uint64_t stop_time;
+	/** Histogram of the time of the calls which returned **/
+	uint64_t buckets[PINK_EASY_STATS_BUCKETS];
+} pink_easy_stats_entry_t;
+
+/**
+ * @struct pink_easy_stats_t
+ * @brief Opaque structure which represents a statistics collector
+ **/
+typedef struct pink_easy_stats pink_easy_stats_t;
+
+/**
+ * Allocate a statistics collector
+ *
+ * @return Collector on success, NULL on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+pink_easy_stats_t *pink_easy_stats_new(void);
+
+/**
+ * Free a statistics collector, it must not be attached to a context
+ *
+ * @param stats Collector
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_stats_free(pink_easy_stats_t *stats)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Attach a statistics collector to a context. A collector may be shared by
+ * contexts, also ones served by different threads.
+ *
+ * @param ctx Tracing context
+ * @param stats Collector, not owned by the context, NULL to stop collecting
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_context_set_stats(pink_easy_context_t *ctx, pink_easy_stats_t *stats)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Take a snapshot of the statistics collected since the collector was
+ * allocated or last reset. May be called from any thread at any time.
+ *
+ * @param stats Collector
+ * @param entries Where to store the entries of the system calls which were
+ *        called, ordered by bitness and system call number; free() it
+ * @param count Where to store the number of entries
+ * @return true on success, false on failure and sets errno accordingly
+ *
+ * @since 0.2.0
+ **/
+bool pink_easy_stats_snapshot(pink_easy_stats_t *stats,
+		pink_easy_stats_entry_t **entries, size_t *count)
+	PINK_GCC_ATTR((nonnull(1,2,3)));
+
+/**
+ * Reset the statistics. May be called from any thread at any time.
+ *
+ * @param stats Collector
+ *
+ * @since 0.2.0
+ **/
+void pink_easy_stats_reset(pink_easy_stats_t *stats)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Returns the shortest time which falls into a histogram bucket
+ *
+ * @param bucket Bucket, less than #PINK_EASY_STATS_BUCKETS
+ * @return Time in nanoseconds
+ *
+ * @since 0.2.0
+ **/
+uint64_t pink_easy_stats_bucket_min(unsigned bucket);
+
+PINK_END_DECL
+/** @} */
+#endif
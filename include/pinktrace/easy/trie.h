@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PINK_EASY_TRIE_H
+#define _PINK_EASY_TRIE_H
+
+/**
+ * @file pinktrace/easy/trie.h
+ * @brief Pink's easy path prefix matcher
+ * @defgroup pink_easy_trie Pink's easy path prefix matcher
+ * @ingroup pinktrace-easy
+ *
+ * A trie holds path patterns, each with an integer value, and is compiled
+ * into a deterministic automaton with sorted, sparse transitions. Matching
+ * a path takes one transition per byte, no matter how many patterns there
+ * are, and stops as soon as no pattern can match any more.
+ *
+ * A pattern matches a path if it matches the whole path or a leading part
+ * of it which ends at a slash, so @e /usr matches @e /usr and @e /usr/bin but
+ * not @e /usrfoo. A pattern with a trailing slash, like @e /usr/, matches
+ * only what lies beneath. Patterns may contain the following wildcards,
+ * a backslash escapes the next character:
+ * - @e ? matches one character except slash
+ * - @e * matches any number of characters except slash
+ * - @e ** matches any number of characters including slash
+ *
+ * If more than one pattern matches, the one matching the longest leading
+ * part of the path wins, i.e. the most specific one. Among patterns which
+ * match the same part, the one added first wins.
+ *
+ * @{
+ **/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <pinktrace/pink.h>
+
+PINK_BEGIN_DECL
+
+/**
+ * @struct pink_easy_trie_t
+ * @brief Opaque structure which represents a path prefix matcher
+ *
+ * Use pink_easy_trie_new() to create one and pink_easy_trie_destroy() to free
+ * all allocated resources.
+ **/
+typedef struct pink_easy_trie pink_easy_trie_t;
+
+/**
+ * @brief Structure which represents the state of a streaming match
+ *
+ * @see pink_easy_trie_feed
+ **/
+typedef struct pink_easy_trie_cursor {
+	/** Compiled trie, for internal use only **/
+	const pink_easy_trie_t *trie;
+	/** Current state, for internal use only **/
+	unsigned state;
+	/** Value of the best match so far, -1 if none **/
+	int value;
+	/** true if the decision is final **/
+	bool done;
+} pink_easy_trie_cursor_t;
+
+/**
+ * Allocate a trie
+ *
+ * @return The trie on success, NULL on failure and sets errno accordingly
+ **/
+pink_easy_trie_t *pink_easy_trie_new(void)
+	PINK_GCC_ATTR((malloc));
+
+/**
+ * Destroy a trie
+ *
+ * @param trie Trie
+ **/
+void pink_easy_trie_destroy(pink_easy_trie_t *trie)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Add a pattern
+ *
+ * @param trie Trie
+ * @param pattern Pattern, must not be empty
+ * @param value Value to return when the pattern matches, must not be
+ *              negative
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_trie_add(pink_easy_trie_t *trie, const char *pattern, int value)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Compile the patterns. Patterns added after compilation take effect after
+ * the next call to this function.
+ *
+ * @param trie Trie
+ * @return true on success, false on failure and sets errno accordingly,
+ *         errno is set to @e E2BIG if the automaton grows too large
+ **/
+bool pink_easy_trie_compile(pink_easy_trie_t *trie)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Match a path
+ *
+ * @param trie Compiled trie
+ * @param path Path
+ * @return Value of the matching pattern, -1 if none matches or the trie
+ *         isn't compiled
+ **/
+int pink_easy_trie_match(const pink_easy_trie_t *trie, const char *path)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Start a streaming match
+ *
+ * @param trie Compiled trie
+ * @param cursor Cursor to initialize
+ **/
+void pink_easy_trie_cursor_init(const pink_easy_trie_t *trie,
+		pink_easy_trie_cursor_t *cursor)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * Feed the next chunk of the path. A zero byte in the chunk ends the path.
+ *
+ * @param cursor Cursor
+ * @param buf Chunk
+ * @param len Length of the chunk
+ * @return true if the decision is final, in which case the rest of the path
+ *         need not be read, false otherwise
+ **/
+bool pink_easy_trie_feed(pink_easy_trie_cursor_t *cursor, const char *buf, size_t len)
+	PINK_GCC_ATTR((nonnull(1,2)));
+
+/**
+ * End the path
+ *
+ * @param cursor Cursor
+ * @return Value of the matching pattern, -1 if none matches
+ **/
+int pink_easy_trie_finish(pink_easy_trie_cursor_t *cursor)
+	PINK_GCC_ATTR((nonnull(1)));
+
+/**
+ * Match the string argument of a system call, reading it from the tracee in
+ * chunks and stopping as soon as the decision is final
+ *
+ * @note Strings longer than @e PATH_MAX are matched by their first
+ *       @e PATH_MAX bytes.
+ *
+ * @param trie Compiled trie
+ * @param pid Process ID
+ * @param bitness Bitness
+ * @param ind The index of the argument (0-5, see #PINK_MAX_ARGS)
+ * @param value Pointer to store the value of the matching pattern, -1 if
+ *              none matches
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_easy_trie_match_string(const pink_easy_trie_t *trie, pid_t pid,
+		pink_bitness_t bitness, unsigned ind, int *value)
+	PINK_GCC_ATTR((nonnull(1,5)));
+
+PINK_END_DECL
+/** @} */
+#endif
@@ -72,14 +72,37 @@
 
 #define ADDR_MUL	((64 == __WORDSIZE) ? 8 : 4)
 
+#ifdef PINKTRACE_USDT
+#include <sys/sdt.h>
+#endif /* PINKTRACE_USDT */
+
 #include <pinktrace/macros.h>
 #include <pinktrace/bitness.h>
 #include <pinktrace/socket.h>
+#include <pinktrace/trace.h>
 
 PINK_BEGIN_DECL
 
+/* Static probes of the provider pinktrace, see --enable-usdt.
+ * The probes and their arguments are listed in doc/index.markdown. */
+#ifdef PINKTRACE_USDT
+#define PINK_PROBE(...)	STAP_PROBEV(pinktrace, __VA_ARGS__)
+#else
+#define PINK_PROBE(...)	do { } while (0)
+#endif /* PINKTRACE_USDT */
+
 bool _pink_decode_socket_address(pid_t pid, long addr, long addrlen,
 		pink_socket_address_t *paddr);
 
+#if PINK_OS_LINUX
+/* ptrace(2), counted and timed if the thread has an account */
+extern __thread pink_trace_account_t *_pink_trace_account;
+long _pink_ptrace_account(int request, pid_t pid, void *addr, void *data);
+#define pink_ptrace(request, pid, addr, data)							\
+	(PINK_GCC_LIKELY(_pink_trace_account == NULL)						\
+		? ptrace((request), (pid), (addr), (data))					\
+		: _pink_ptrace_account((request), (pid), (void *)(long)(addr), (void *)(long)(data)))
+#endif /* PINK_OS_LINUX */
+
 PINK_END_DECL
 #endif
@@ -116,6 +116,18 @@
  * @note Availability: Linux
  **/
 #define PINK_TRACE_OPTION_EXIT      (1 << 6)
+/**
+ * This define represents the trace option SECCOMP.
+ * If this flag is set in the options argument of pink_trace_setup(), stop the
+ * child with (SIGTRAP | PTRACE_EVENT_SECCOMP << 8) when a seccomp filter
+ * returns @e SECCOMP_RET_TRACE. The data part of the filter's return value
+ * can be retrieved with pink_trace_geteventmsg().
+ *
+ * @note Availability: Linux-3.5 or newer
+ * @note This option is not part of #PINK_TRACE_OPTION_ALL because older
+ *       kernels refuse it.
+ **/
+#define PINK_TRACE_OPTION_SECCOMP   (1 << 7)
 
 /**
  * All trace options OR'ed together.
@@ -307,6 +319,50 @@ bool pink_trace_sysemu(pid_t pid, int sig);
  **/
 bool pink_trace_sysemu_singlestep(pid_t pid, int sig);
 
+/**
+ * Attaches to the process specified in pid like pink_trace_attach(), but
+ * doesn't stop the process and sets the tracing options atomically. Children
+ * which are traced automatically due to the options start with a
+ * @e PTRACE_EVENT_STOP rather than a @e SIGSTOP, and group-stops are reported
+ * as @e PTRACE_EVENT_STOP as well which lets the tracer keep the tracee
+ * stopped with pink_trace_listen().
+ *
+ * @note Availability: Linux (3.4 or newer)
+ * @since 0.2.0
+ *
+ * @param pid Process ID
+ * @param options Bitwise OR'ed PINK_TRACE_OPTION_* flags
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_seize(pid_t pid, int options);
+
+/**
+ * Stops a running tracee which was attached with pink_trace_seize(). The
+ * tracee reports a @e PTRACE_EVENT_STOP with @e SIGTRAP, unless it stops for
+ * another reason first.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ * @since 0.2.0
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_interrupt(pid_t pid);
+
+/**
+ * Restarts a tracee which was attached with pink_trace_seize() and is in a
+ * group-stop, but keeps it stopped. Unlike the other restarting functions
+ * this lets job control work: the tracee resumes when it receives
+ * @e SIGCONT, and the tracer is notified about that.
+ *
+ * @note Availability: Linux (3.4 or newer)
+ * @since 0.2.0
+ *
+ * @param pid Process ID
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_trace_listen(pid_t pid);
+
 #endif /* PINK_OS_LINUX... */
 
 /**
@@ -331,6 +387,50 @@ bool pink_trace_attach(pid_t pid);
  **/
 bool pink_trace_detach(pid_t pid, int sig);
 
+#if PINK_OS_LINUX || defined(DOXYGEN)
+/**
+ * @brief Accounting of ptrace(2) requests, see pink_trace_set_account()
+ *
+ * @since 0.2.0
+ **/
+typedef struct {
+	/** Number and total time in nanoseconds of the requests reading or
+	 * writing registers **/
+	unsigned long regs_calls;
+	unsigned long long regs_time;
+	/** Number and total time in nanoseconds of the requests reading or
+	 * writing memory **/
+	unsigned long mem_calls;
+	unsigned long long mem_time;
+	/** Number and total time in nanoseconds of the other requests, e.g.
+	 * those resuming tracees **/
+	unsigned long ctl_calls;
+	unsigned long long ctl_time;
+} pink_trace_account_t;
+
+/**
+ * Count and time the ptrace(2) requests the functions of the library make
+ * in the calling thread. Accounting costs two clock reads per request, it
+ * is off unless an account is set.
+ *
+ * @note Availability: Linux
+ * @since 0.2.0
+ *
+ * @param account Account to add the requests to, NULL to stop accounting
+ **/
+void pink_trace_set_account(pink_trace_account_t *account);
+
+/**
+ * Returns the account of the calling thread
+ *
+ * @note Availability: Linux
+ * @since 0.2.0
+ *
+ * @return Account set with pink_trace_set_account(), NULL if none
+ **/
+pink_trace_account_t *pink_trace_get_account(void);
+#endif /* PINK_OS_LINUX... */
+
 PINK_END_DECL
 /** @} */
 #endif
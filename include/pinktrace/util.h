@@ -266,6 +266,28 @@ bool pink_util_get_return(pid_t pid, long *res)
  **/
 bool pink_util_set_return(pid_t pid, long ret);
 
+#if PINK_OS_LINUX || defined(DOXYGEN)
+/**
+ * Skip the system call the child is entering and make it return the given
+ * value, without waiting for the system call exit. The system call number
+ * and the return value registers are both rewritten while the child is
+ * stopped at system call entry.
+ *
+ * @note Availability: Linux
+ * @note Only x86 and x86_64 support this, on other architectures this
+ *       function fails with @e ENOTSUP. Use pink_util_set_syscall() with
+ *       #PINK_SYSCALL_INVALID on entry and pink_util_set_return() on exit
+ *       there.
+ * @since 0.2.0
+ *
+ * @param pid Process ID
+ * @param bitness Bitness
+ * @param ret Return value, a negated @e errno to fail the system call
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_skip_syscall(pid_t pid, pink_bitness_t bitness, long ret);
+#endif /* PINK_OS_LINUX... */
+
 /**
  * Get the given argument and place it in res.
  *
@@ -279,6 +301,20 @@ bool pink_util_get_arg(pid_t pid, pink_bitness_t bitness, unsigned ind,
 		long *res)
 	PINK_GCC_ATTR((nonnull(4)));
 
+/**
+ * Get all the arguments and place them in res. On architectures with
+ * @e PTRACE_GETREGS this is a single request instead of one per argument.
+ *
+ * @since 0.2.0
+ *
+ * @param pid Process ID
+ * @param bitness Bitness
+ * @param res Array of #PINK_MAX_ARGS elements to store the arguments
+ * @return true on success, false on failure and sets errno accordingly
+ **/
+bool pink_util_get_args(pid_t pid, pink_bitness_t bitness, long *res)
+	PINK_GCC_ATTR((nonnull(3)));
+
 /**
  * Set the given argument
  *
@@ -0,0 +1,636 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * File layout:
+ *
+ *   header | block... | index entry for each block | footer
+ *
+ * A block is the number of events and strings, the strings, each with a
+ * terminating zero byte, then the time, process ID, system call number,
+ * return value and string columns, each preceded by its length. Numbers are
+ * variable length encoded, seven bits per byte; signed numbers are zigzag
+ * encoded first. Times and process IDs are stored as the difference to the
+ * previous event, strings as their index plus one, zero for none.
+ */
+
+#define ARCHIVE_BLOCK_EVENTS	4096
+#define ARCHIVE_INDEX_MAGIC	"PINKIDX"
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t reserved;
+} archive_header_t;
+
+typedef struct {
+	uint64_t index;
+	uint64_t nblocks;
+	char magic[8];
+} archive_footer_t;
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static bool buf_reserve(unsigned char **buf, size_t *alloc, size_t len)
+{
+	size_t n;
+	unsigned char *p;
+
+	if (len <= *alloc)
+		return true;
+	n = *alloc ? *alloc : 4096;
+	while (n < len)
+		n *= 2;
+	p = realloc(*buf, n);
+	if (!p)
+		return false;
+	*buf = p;
+	*alloc = n;
+	return true;
+}
+
+static bool put_varint(unsigned char **buf, size_t *len, size_t *alloc, uint64_t v)
+{
+	if (!buf_reserve(buf, alloc, *len + 10))
+		return false;
+	while (v >= 0x80) {
+		(*buf)[(*len)++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	(*buf)[(*len)++] = v;
+	return true;
+}
+
+static bool put_bytes(unsigned char **buf, size_t *len, size_t *alloc,
+		const void *src, size_t n)
+{
+	if (!buf_reserve(buf, alloc, *len + n))
+		return false;
+	memcpy(*buf + *len, src, n);
+	*len += n;
+	return true;
+}
+
+#define OUT_VARINT(w, v)	put_varint(&(w)->out, &(w)->out_len, &(w)->out_alloc, (v))
+#define COL_VARINT(w, v)	put_varint(&(w)->col, &(w)->col_len, &(w)->col_alloc, (v))
+
+static bool get_varint(const unsigned char **p, const unsigned char *end, uint64_t *v)
+{
+	unsigned shift;
+
+	*v = 0;
+	for (shift = 0; shift < 64; shift += 7) {
+		if (*p == end)
+			return false;
+		*v |= (uint64_t)(**p & 0x7f) << shift;
+		if (!(*(*p)++ & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static uint32_t hash_string(const char *s)
+{
+	uint32_t h = 2166136261U;
+
+	for (; *s; s++)
+		h = (h ^ (unsigned char)*s) * 16777619U;
+	return h;
+}
+
+static bool write_out(pink_easy_archive_writer_t *writer, const void *buf, size_t len)
+{
+	if (writer->error)
+		return false;
+	if (fwrite(buf, 1, len, writer->file) != len) {
+		writer->error = errno ? errno : EIO;
+		return false;
+	}
+	writer->offset += len;
+	return true;
+}
+
+/* Returns the index of the string in the current block, adding it if new */
+static bool intern_string(pink_easy_archive_writer_t *writer, const char *s, uint32_t *sid)
+{
+	uint32_t h, slot;
+
+	h = hash_string(s);
+	for (slot = h & (writer->nslots - 1); writer->slots[slot];
+			slot = (slot + 1) & (writer->nslots - 1)) {
+		if (!strcmp(writer->strings[writer->slots[slot] - 1], s)) {
+			*sid = writer->slots[slot] - 1;
+			return true;
+		}
+	}
+
+	writer->strings[writer->nstrings] = strdup(s);
+	if (!writer->strings[writer->nstrings])
+		return false;
+	*sid = writer->nstrings++;
+	writer->slots[slot] = *sid + 1;
+	return true;
+}
+
+static bool put_column(pink_easy_archive_writer_t *writer)
+{
+	bool r;
+
+	r = OUT_VARINT(writer, writer->col_len)
+		&& put_bytes(&writer->out, &writer->out_len, &writer->out_alloc,
+				writer->col, writer->col_len);
+	writer->col_len = 0;
+	return r;
+}
+
+static bool encode_block(pink_easy_archive_writer_t *writer)
+{
+	unsigned i;
+	int64_t prev;
+	struct pink_easy_archive_index *entry;
+
+	if (!writer->nevents)
+		return true;
+
+	if (writer->nblocks == writer->index_alloc) {
+		unsigned n = writer->index_alloc ? writer->index_alloc * 2 : 64;
+		entry = realloc(writer->index, n * sizeof(struct pink_easy_archive_index));
+		if (!entry)
+			return false;
+		writer->index = entry;
+		writer->index_alloc = n;
+	}
+	entry = &writer->index[writer->nblocks];
+	memset(entry, 0, sizeof(struct pink_easy_archive_index));
+	entry->offset = writer->offset;
+	entry->nevents = writer->nevents;
+	entry->time_min = UINT64_MAX;
+
+	writer->out_len = 0;
+	if (!OUT_VARINT(writer, writer->nevents) || !OUT_VARINT(writer, writer->nstrings))
+		return false;
+	for (i = 0; i < writer->nstrings; i++)
+		if (!put_bytes(&writer->out, &writer->out_len, &writer->out_alloc,
+					writer->strings[i], strlen(writer->strings[i]) + 1))
+			return false;
+
+	for (i = 0, prev = 0; i < writer->nevents; i++) {
+		if (writer->times[i] < entry->time_min)
+			entry->time_min = writer->times[i];
+		if (writer->times[i] > entry->time_max)
+			entry->time_max = writer->times[i];
+		if (!COL_VARINT(writer, zigzag((int64_t)writer->times[i] - prev)))
+			return false;
+		prev = writer->times[i];
+	}
+	if (!put_column(writer))
+		return false;
+	for (i = 0, prev = 0; i < writer->nevents; i++) {
+		entry->pids[(writer->pids[i] & 255) / 32] |= 1U << (writer->pids[i] & 31);
+		if (!COL_VARINT(writer, zigzag(writer->pids[i] - prev)))
+			return false;
+		prev = writer->pids[i];
+	}
+	if (!put_column(writer))
+		return false;
+	for (i = 0; i < writer->nevents; i++) {
+		entry->scnos[(writer->scnos[i] & 511) / 32] |= 1U << (writer->scnos[i] & 31);
+		if (!COL_VARINT(writer, zigzag(writer->scnos[i])))
+			return false;
+	}
+	if (!put_column(writer))
+		return false;
+	for (i = 0; i < writer->nevents; i++)
+		if (!COL_VARINT(writer, zigzag(writer->retvals[i])))
+			return false;
+	if (!put_column(writer))
+		return false;
+	for (i = 0; i < writer->nevents; i++)
+		if (!COL_VARINT(writer, writer->sids[i]))
+			return false;
+	if (!put_column(writer))
+		return false;
+
+	entry->length = writer->out_len;
+	if (!write_out(writer, writer->out, writer->out_len))
+		return false;
+	writer->nblocks++;
+
+	for (i = 0; i < writer->nstrings; i++)
+		free(writer->strings[i]);
+	writer->nstrings = 0;
+	memset(writer->slots, 0, writer->nslots * sizeof(uint32_t));
+	writer->nevents = 0;
+	return true;
+}
+
+/* A failed block leaves the event columns full, so the writer is stopped
+ * for good: every later _add() and _close() reports the saved error */
+static bool write_block(pink_easy_archive_writer_t *writer)
+{
+	if (writer->error)
+		return false;
+	if (!encode_block(writer)) {
+		if (!writer->error)
+			writer->error = errno ? errno : ENOMEM;
+		return false;
+	}
+	return true;
+}
+
+static void writer_free(pink_easy_archive_writer_t *writer)
+{
+	for (unsigned i = 0; i < writer->nstrings; i++)
+		free(writer->strings[i]);
+	free(writer->strings);
+	free(writer->slots);
+	free(writer->times);
+	free(writer->pids);
+	free(writer->scnos);
+	free(writer->retvals);
+	free(writer->sids);
+	free(writer->index);
+	free(writer->out);
+	free(writer->col);
+	free(writer);
+}
+
+pink_easy_archive_writer_t *pink_easy_archive_writer_new(const char *path,
+		unsigned block_events)
+{
+	int save_errno;
+	archive_header_t header;
+	pink_easy_archive_writer_t *writer;
+
+	if (!block_events)
+		block_events = ARCHIVE_BLOCK_EVENTS;
+	if (block_events > (1U << 24)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	writer = calloc(1, sizeof(pink_easy_archive_writer_t));
+	if (!writer)
+		return NULL;
+	writer->block_events = block_events;
+	for (writer->nslots = 16; writer->nslots < 2 * block_events; writer->nslots *= 2)
+		;
+	writer->times = malloc(block_events * sizeof(uint64_t));
+	writer->pids = malloc(block_events * sizeof(int64_t));
+	writer->scnos = malloc(block_events * sizeof(int64_t));
+	writer->retvals = malloc(block_events * sizeof(int64_t));
+	writer->sids = malloc(block_events * sizeof(uint32_t));
+	writer->strings = malloc(block_events * sizeof(char *));
+	writer->slots = calloc(writer->nslots, sizeof(uint32_t));
+	if (!writer->times || !writer->pids || !writer->scnos || !writer->retvals
+			|| !writer->sids || !writer->strings || !writer->slots)
+		goto fail;
+
+	writer->file = fopen(path, "we");
+	if (!writer->file)
+		goto fail;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PINK_EASY_ARCHIVE_MAGIC, sizeof(PINK_EASY_ARCHIVE_MAGIC));
+	header.version = PINK_EASY_ARCHIVE_VERSION;
+	header.byte_order = 0x01020304;
+	if (!write_out(writer, &header, sizeof(header))) {
+		errno = writer->error;
+		fclose(writer->file);
+		goto fail;
+	}
+	return writer;
+
+fail:
+	save_errno = errno;
+	writer_free(writer);
+	errno = save_errno;
+	return NULL;
+}
+
+bool pink_easy_archive_writer_add(pink_easy_archive_writer_t *writer,
+		const pink_easy_archive_event_t *event)
+{
+	unsigned i;
+	uint32_t sid;
+
+	if (writer->error) {
+		errno = writer->error;
+		return false;
+	}
+
+	sid = 0;
+	if (event->string) {
+		if (!intern_string(writer, event->string, &sid))
+			return false;
+		sid++;
+	}
+	i = writer->nevents++;
+	writer->times[i] = event->time;
+	writer->pids[i] = event->pid;
+	writer->scnos[i] = event->scno;
+	writer->retvals[i] = event->retval;
+	writer->sids[i] = sid;
+
+	if (writer->nevents == writer->block_events && !write_block(writer)) {
+		errno = writer->error;
+		return false;
+	}
+	return true;
+}
+
+bool pink_easy_archive_writer_add_record(pink_easy_archive_writer_t *writer,
+		const pink_easy_record_t *record)
+{
+	bool r;
+	char *string;
+	pink_easy_archive_event_t event;
+
+	if (!(record->flags & PINK_EASY_RECORD_EXIT))
+		return true;
+
+	event.time = record->time;
+	event.pid = record->pid;
+	event.scno = record->scno;
+	event.retval = record->retval;
+	event.string = NULL;
+	if (!record->payload_len)
+		return pink_easy_archive_writer_add(writer, &event);
+
+	string = strndup(pink_easy_record_get_payload(record), record->payload_len);
+	if (!string)
+		return false;
+	event.string = string;
+	r = pink_easy_archive_writer_add(writer, &event);
+	free(string);
+	return r;
+}
+
+bool pink_easy_archive_writer_close(pink_easy_archive_writer_t *writer)
+{
+	int error;
+	archive_footer_t footer;
+
+	memset(&footer, 0, sizeof(footer));
+	if (write_block(writer)) {
+		/* Align the index, it is used in place by readers */
+		write_out(writer, &footer, -writer->offset & 7);
+		footer.index = writer->offset;
+		footer.nblocks = writer->nblocks;
+		memcpy(footer.magic, ARCHIVE_INDEX_MAGIC, sizeof(ARCHIVE_INDEX_MAGIC));
+		if (write_out(writer, writer->index,
+					writer->nblocks * sizeof(struct pink_easy_archive_index)))
+			write_out(writer, &footer, sizeof(footer));
+	}
+
+	error = writer->error;
+	if (fclose(writer->file) && !error)
+		error = errno;
+	writer_free(writer);
+
+	if (error) {
+		errno = error;
+		return false;
+	}
+	return true;
+}
+
+pink_easy_archive_t *pink_easy_archive_open(const char *path)
+{
+	int fd, save_errno;
+	void *map;
+	size_t len;
+	struct stat st;
+	const archive_header_t *header;
+	const archive_footer_t *footer;
+	pink_easy_archive_t *archive;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0) {
+		save_errno = errno;
+		close(fd);
+		errno = save_errno;
+		return NULL;
+	}
+	len = st.st_size;
+	if (len < sizeof(archive_header_t) + sizeof(archive_footer_t)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	save_errno = errno;
+	close(fd);
+	if (map == MAP_FAILED) {
+		errno = save_errno;
+		return NULL;
+	}
+
+	header = map;
+	footer = (const archive_footer_t *)((const char *)map + len - sizeof(archive_footer_t));
+	if (memcmp(header->magic, PINK_EASY_ARCHIVE_MAGIC, sizeof(PINK_EASY_ARCHIVE_MAGIC))
+			|| header->version != PINK_EASY_ARCHIVE_VERSION
+			|| header->byte_order != 0x01020304
+			|| memcmp(footer->magic, ARCHIVE_INDEX_MAGIC, sizeof(ARCHIVE_INDEX_MAGIC))
+			|| footer->index < sizeof(archive_header_t)
+			|| footer->index & 7
+			|| footer->nblocks > len / sizeof(struct pink_easy_archive_index)
+			|| footer->index + footer->nblocks * sizeof(struct pink_easy_archive_index)
+				!= len - sizeof(archive_footer_t)) {
+		munmap(map, len);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	archive = calloc(1, sizeof(pink_easy_archive_t));
+	if (!archive) {
+		save_errno = errno;
+		munmap(map, len);
+		errno = save_errno;
+		return NULL;
+	}
+	archive->map = map;
+	archive->len = len;
+	archive->index = (const struct pink_easy_archive_index *)(archive->map + footer->index);
+	archive->nblocks = footer->nblocks;
+	return archive;
+}
+
+static bool block_matches(const struct pink_easy_archive_index *entry,
+		const pink_easy_archive_filter_t *filter)
+{
+	if (entry->time_max < filter->time_min || entry->time_min > filter->time_max)
+		return false;
+	if (filter->pid && !(entry->pids[(filter->pid & 255) / 32] & (1U << (filter->pid & 31))))
+		return false;
+	if (filter->scno >= 0 && !(entry->scnos[(filter->scno & 511) / 32] & (1U << (filter->scno & 31))))
+		return false;
+	return true;
+}
+
+/* Decode a block, calling func for the matching events.
+ * Returns false if the block is corrupt, sets *stop if func stopped. */
+static bool query_block(pink_easy_archive_t *archive,
+		const struct pink_easy_archive_index *entry,
+		const pink_easy_archive_filter_t *filter,
+		pink_easy_archive_func_t func, void *data, bool *stop)
+{
+	unsigned c;
+	uint64_t n, nstrings, len, v[5];
+	int64_t time, pid;
+	const unsigned char *p, *end, *col[5], *col_end[5];
+	pink_easy_archive_event_t event;
+
+	if (entry->offset < sizeof(archive_header_t)
+			|| entry->offset + entry->length > archive->len)
+		return false;
+	p = archive->map + entry->offset;
+	end = p + entry->length;
+
+	if (!get_varint(&p, end, &n) || n != entry->nevents
+			|| !get_varint(&p, end, &nstrings) || nstrings > (uint64_t)(end - p))
+		return false;
+	if (nstrings > archive->dict_alloc) {
+		const char **dict = realloc(archive->dict, nstrings * sizeof(char *));
+		if (!dict)
+			return false;
+		archive->dict = dict;
+		archive->dict_alloc = nstrings;
+	}
+	for (unsigned i = 0; i < nstrings; i++) {
+		const unsigned char *z = memchr(p, 0, end - p);
+		if (!z)
+			return false;
+		archive->dict[i] = (const char *)p;
+		p = z + 1;
+	}
+	for (c = 0; c < 5; c++) {
+		if (!get_varint(&p, end, &len) || len > (uint64_t)(end - p))
+			return false;
+		col[c] = p;
+		col_end[c] = p + len;
+		p += len;
+	}
+
+	time = pid = 0;
+	for (uint64_t i = 0; i < n; i++) {
+		for (c = 0; c < 5; c++)
+			if (!get_varint(&col[c], col_end[c], &v[c]))
+				return false;
+		time += unzigzag(v[0]);
+		pid += unzigzag(v[1]);
+		if (v[4] > nstrings)
+			return false;
+
+		event.time = time;
+		event.pid = pid;
+		event.scno = unzigzag(v[2]);
+		event.retval = unzigzag(v[3]);
+		event.string = v[4] ? archive->dict[v[4] - 1] : NULL;
+		if (event.time < filter->time_min || event.time > filter->time_max
+				|| (filter->pid && event.pid != filter->pid)
+				|| (filter->scno >= 0 && event.scno != filter->scno))
+			continue;
+		if (!func(&event, data)) {
+			*stop = true;
+			return true;
+		}
+	}
+	return true;
+}
+
+bool pink_easy_archive_query(pink_easy_archive_t *archive,
+		const pink_easy_archive_filter_t *filter,
+		pink_easy_archive_func_t func, void *data)
+{
+	bool stop;
+	pink_easy_archive_filter_t any;
+
+	if (!filter) {
+		any.pid = 0;
+		any.scno = -1;
+		any.time_min = 0;
+		any.time_max = UINT64_MAX;
+		filter = &any;
+	}
+
+	stop = false;
+	archive->decoded = 0;
+	for (unsigned i = 0; i < archive->nblocks && !stop; i++) {
+		if (!block_matches(&archive->index[i], filter))
+			continue;
+		archive->decoded++;
+		if (!query_block(archive, &archive->index[i], filter, func, data, &stop)) {
+			errno = EINVAL;
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned pink_easy_archive_get_blocks(const pink_easy_archive_t *archive)
+{
+	return archive->nblocks;
+}
+
+unsigned pink_easy_archive_get_blocks_decoded(const pink_easy_archive_t *archive)
+{
+	return archive->decoded;
+}
+
+void pink_easy_archive_close(pink_easy_archive_t *archive)
+{
+	munmap((void *)archive->map, archive->len);
+	free(archive->dict);
+	free(archive);
+}
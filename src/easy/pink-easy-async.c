@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+
+/* SIGCHLD wakes the event loops up through the wakeup pipes of the
+ * registered contexts, waitpid() can't wait for a file descriptor. */
+#define SIGCHLD_SLOTS 64
+static volatile sig_atomic_t sigchld_fds[SIGCHLD_SLOTS];
+static bool sigchld_ok;
+static struct sigaction sigchld_old;
+static pthread_once_t sigchld_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t sigchld_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool pink_easy_async_pipe(int fd[2])
+{
+	if (pipe(fd) < 0)
+		return false;
+	for (unsigned i = 0; i < 2; i++) {
+		if (fcntl(fd[i], F_SETFL, O_NONBLOCK) < 0
+				|| fcntl(fd[i], F_SETFD, FD_CLOEXEC) < 0) {
+			int save_errno = errno;
+			close(fd[0]);
+			close(fd[1]);
+			fd[0] = fd[1] = -1;
+			errno = save_errno;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool pink_easy_async_drain(int fd)
+{
+	bool any = false;
+	char buf[64];
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		any = true;
+	return any;
+}
+
+static void sigchld_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	int save_errno = errno;
+	ssize_t n;
+
+	for (unsigned i = 0; i < SIGCHLD_SLOTS; i++) {
+		int fd = sigchld_fds[i];
+		if (fd >= 0) {
+			n = write(fd, "", 1);
+			(void)n;
+		}
+	}
+	errno = save_errno;
+
+	/* Chain to the handler of the application */
+	if (sigchld_old.sa_flags & SA_SIGINFO)
+		sigchld_old.sa_sigaction(sig, info, ucontext);
+	else if (sigchld_old.sa_handler != SIG_DFL && sigchld_old.sa_handler != SIG_IGN)
+		sigchld_old.sa_handler(sig);
+}
+
+static void sigchld_install(void)
+{
+	struct sigaction sa;
+
+	for (unsigned i = 0; i < SIGCHLD_SLOTS; i++)
+		sigchld_fds[i] = -1;
+
+	memset(&sa, 0, sizeof(struct sigaction));
+	sa.sa_sigaction = sigchld_handler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGCHLD, &sa, &sigchld_old) < 0)
+		return;
+	sigchld_ok = true;
+}
+
+bool pink_easy_async_register(int fd, int *slot)
+{
+	if (*slot >= 0)
+		return true;
+
+	pthread_once(&sigchld_once, sigchld_install);
+	if (!sigchld_ok) {
+		errno = ENOTSUP;
+		return false;
+	}
+
+	pthread_mutex_lock(&sigchld_lock);
+	for (unsigned i = 0; i < SIGCHLD_SLOTS; i++) {
+		if (sigchld_fds[i] < 0) {
+			sigchld_fds[i] = fd;
+			*slot = i;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sigchld_lock);
+
+	if (*slot < 0) {
+		errno = ENOSPC;
+		return false;
+	}
+	return true;
+}
+
+void pink_easy_async_unregister(int slot)
+{
+	if (slot < 0)
+		return;
+	pthread_mutex_lock(&sigchld_lock);
+	sigchld_fds[slot] = -1;
+	pthread_mutex_unlock(&sigchld_lock);
+}
+
+bool pink_easy_async_poll(int fd, int slot, int timeout)
+{
+	struct pollfd pfd;
+
+	/* Fall back to polling waitpid() if SIGCHLD can't wake us up */
+	if (slot < 0 && (timeout < 0 || timeout > 10))
+		timeout = 10;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, timeout) < 0 && errno != EINTR)
+		return false;
+	return true;
+}
+
+/* Make SIGCHLD wake the event loop of the context up */
+static bool sigchld_register(pink_easy_context_t *ctx)
+{
+	return pink_easy_async_register(ctx->wakeup[1], &ctx->wakeup_slot);
+}
+
+bool pink_easy_async_init(pink_easy_context_t *ctx)
+{
+	ctx->nparked = 0;
+	LIST_INIT(&ctx->gone);
+	ctx->wakeup_slot = -1;
+	ctx->completed_head = ctx->completed_tail = NULL;
+	if (!pink_easy_async_pipe(ctx->wakeup))
+		return false;
+	ctx->wakeup_fd = ctx->wakeup[1];
+	errno = pthread_mutex_init(&ctx->lock, NULL);
+	if (errno) {
+		close(ctx->wakeup[0]);
+		close(ctx->wakeup[1]);
+		return false;
+	}
+	return true;
+}
+
+void pink_easy_async_free(pink_easy_context_t *ctx)
+{
+	pink_easy_process_t *current;
+
+	/* Entries of live processes are freed with the process list, those of
+	 * removed processes are freed here whether completed or not */
+	while ((current = LIST_FIRST(&ctx->gone))) {
+		LIST_REMOVE(current, gone);
+		pink_easy_process_memo_flush(current);
+		free(current->overhead);
+		free(current);
+	}
+
+	pink_easy_async_unregister(ctx->wakeup_slot);
+	close(ctx->wakeup[0]);
+	close(ctx->wakeup[1]);
+	pthread_mutex_destroy(&ctx->lock);
+}
+
+void pink_easy_async_park(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	if (current->flags & PINK_EASY_PROCESS_PARKED)
+		return;
+	current->flags |= PINK_EASY_PROCESS_PARKED;
+	ctx->nparked++;
+	pthread_mutex_lock(&ctx->lock);
+	current->pending = true;
+	pthread_mutex_unlock(&ctx->lock);
+	/* Sessions wake up their loop themselves */
+	if (!ctx->session)
+		sigchld_register(ctx);
+}
+
+pink_easy_process_t *pink_easy_async_take(pink_easy_context_t *ctx)
+{
+	pink_easy_process_t *head;
+
+	pthread_mutex_lock(&ctx->lock);
+	head = ctx->completed_head;
+	ctx->completed_head = ctx->completed_tail = NULL;
+	pthread_mutex_unlock(&ctx->lock);
+
+	pink_easy_async_drain(ctx->wakeup[0]);
+	return head;
+}
+
+bool pink_easy_async_wait(pink_easy_context_t *ctx, int timeout)
+{
+	return pink_easy_async_poll(ctx->wakeup[0], ctx->wakeup_slot, timeout);
+}
+
+int pink_easy_loop_get_fd(pink_easy_context_t *ctx)
+{
+	ssize_t n;
+
+	if (ctx->wakeup_slot < 0) {
+		if (!sigchld_register(ctx))
+			return -1;
+		/* Processes may have stopped before the handler was set up */
+		n = write(ctx->wakeup[1], "", 1);
+		(void)n;
+	}
+	return ctx->wakeup[0];
+}
+
+bool pink_easy_process_complete(pink_easy_process_t *proc,
+		pink_easy_policy_action_t verdict, int err)
+{
+	ssize_t n;
+	pink_easy_context_t *ctx = proc->ctx;
+
+	if (verdict > PINK_EASY_POLICY_TRACE) {
+		errno = EINVAL;
+		return false;
+	}
+
+	/* Only the first completion of a pending decision counts, a late or
+	 * second one would resume the process at a later stop */
+	pthread_mutex_lock(&ctx->lock);
+	if (!proc->pending) {
+		pthread_mutex_unlock(&ctx->lock);
+		errno = EBUSY;
+		return false;
+	}
+	proc->pending = false;
+	proc->verdict = verdict;
+	proc->verdict_err = err;
+	proc->completed = NULL;
+	if (ctx->completed_tail)
+		ctx->completed_tail->completed = proc;
+	else
+		ctx->completed_head = proc;
+	ctx->completed_tail = proc;
+	pthread_mutex_unlock(&ctx->lock);
+
+	/* A full pipe wakes the loop up as well */
+	n = write(ctx->wakeup_fd, "", 1);
+	(void)n;
+	return true;
+}
@@ -30,32 +30,361 @@
 #include <pinktrace/easy/pink.h>
 
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
-bool pink_easy_attach(pink_easy_context_t *ctx, pid_t pid, pid_t ppid)
+/* Attach to a single task, the failure of ptrace() is left to the caller to
+ * report, errno is ENOMEM if the entry couldn't be allocated. */
+static bool attach_one(pink_easy_context_t *ctx, pid_t pid, pid_t ppid, bool thread)
 {
+	int save_errno, status;
+	pid_t r;
 	struct pink_easy_process *current;
 
-	if (!pink_trace_attach(pid)) {
-		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
-		goto fail;
+	if (ctx->seize) {
+		/* The options are set at once, the stop is for PTRACE_SYSCALL */
+		if (!pink_trace_seize(pid, ctx->ptrace_options))
+			return false;
+		if (!pink_trace_interrupt(pid)) {
+			save_errno = errno;
+			pink_trace_detach(pid, 0);
+			errno = save_errno;
+			return false;
+		}
+	} else if (!pink_trace_attach(pid)) {
+		save_errno = errno;
+		kill(pid, SIGCONT);
+		errno = save_errno;
+		return false;
 	}
 
-	PINK_EASY_INSERT_PROCESS(ctx, current);
-	if (current == NULL)
-		goto fail;
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
+	if (current == NULL) {
+		/* Nobody would resume the task, let it go. PTRACE_DETACH needs
+		 * it stopped, the stop for PTRACE_ATTACH or PTRACE_INTERRUPT
+		 * may be yet to come; its SIGSTOP is suppressed. */
+		if (!pink_trace_detach(pid, 0) && errno == ESRCH) {
+			while ((r = waitpid(pid, &status, __WALL)) < 0 && errno == EINTR)
+				;
+			if (r == pid && WIFSTOPPED(status))
+				pink_trace_detach(pid, 0);
+		}
+		errno = ENOMEM;
+		return false;
+	}
 
 	current->ppid = ppid;
-	current->flags |= PINK_EASY_PROCESS_ATTACHED | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
-	if (current->ppid > 0) /* clone */
-		current->flags |= PINK_EASY_PROCESS_CLONE_THREAD;
+	current->flags |= PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_ATTACHED;
+	current->flags |= ctx->seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	pink_easy_process_link(current,
+			ppid > 0 ? pink_easy_process_list_lookup(&ctx->process_list, ppid) : NULL,
+			thread ? ppid : pid,
+			thread ? CLONE_THREAD | CLONE_SIGHAND | CLONE_VM | CLONE_FS | CLONE_FILES : 0);
+	return true;
+}
+
+bool pink_easy_attach(pink_easy_context_t *ctx, pid_t pid, pid_t ppid)
+{
+	if (!attach_one(ctx, pid, ppid, ppid > 0 /* clone */)) {
+		if (errno != ENOMEM)
+			ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
+		return false;
+	}
 	return true;
-fail:
-	kill(pid, SIGCONT);
+}
+
+/* Processes whose threads pink_easy_attach_tree() attaches to */
+struct attach_proc {
+	pid_t pid;
+	pid_t ppid;
+};
+
+struct attach_tree {
+	struct attach_proc *procs;
+	unsigned nprocs, size;
+	unsigned tasks;
+};
+
+static bool tree_add(struct attach_tree *tree, pid_t pid, pid_t ppid)
+{
+	struct attach_proc *procs;
+
+	if (tree->nprocs == tree->size) {
+		procs = realloc(tree->procs, 2 * (tree->size + 4) * sizeof(struct attach_proc));
+		if (!procs)
+			return false;
+		tree->procs = procs;
+		tree->size = 2 * (tree->size + 4);
+	}
+	tree->procs[tree->nprocs].pid = pid;
+	tree->procs[tree->nprocs].ppid = ppid;
+	tree->nprocs++;
+	return true;
+}
+
+static bool tree_has(const struct attach_tree *tree, pid_t pid)
+{
+	for (unsigned i = 0; i < tree->nprocs; i++)
+		if (tree->procs[i].pid == pid)
+			return true;
 	return false;
 }
+
+/* Is the task traced by the calling thread already? */
+static bool traced_by_us(pid_t pid)
+{
+	long tracer = 0;
+	char path[32], line[128];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	f = fopen(path, "r");
+	if (!f)
+		return false;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "TracerPid: %ld", &tracer) == 1)
+			break;
+	fclose(f);
+	return tracer == syscall(SYS_gettid);
+}
+
+/* Attach to the threads of a process, returns false on failure.
+ * Threads which exit or are traced by the context already are skipped. */
+static bool tree_attach_threads(pink_easy_context_t *ctx, struct attach_tree *tree,
+		const struct attach_proc *proc)
+{
+	pid_t tid;
+	char path[32];
+	DIR *dir;
+	struct dirent *ent;
+
+	snprintf(path, sizeof(path), "/proc/%ld/task", (long)proc->pid);
+	dir = opendir(path);
+	if (!dir) {
+		if (errno == ENOENT)
+			errno = ESRCH;
+		return false;
+	}
+
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+			continue;
+		tid = atoi(ent->d_name);
+		if (pink_easy_process_list_lookup(&ctx->process_list, tid))
+			continue;
+
+		if (tid == proc->pid
+				? attach_one(ctx, tid, proc->ppid, false)
+				: attach_one(ctx, tid, proc->pid, true)) {
+			tree->tasks++;
+			continue;
+		}
+		if (errno == ESRCH || (errno == EPERM && traced_by_us(tid)))
+			continue;
+		if (errno != ENOMEM)
+			ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, tid);
+		closedir(dir);
+		return false;
+	}
+
+	closedir(dir);
+	return true;
+}
+
+/* Look for new children of the processes of the tree, returns the number
+ * of processes found or -1 on failure. */
+static int tree_find_children(struct attach_tree *tree)
+{
+	int n = 0;
+	long pid, ppid;
+	char path[32], buf[512], *p;
+	ssize_t len;
+	int fd;
+	DIR *dir;
+	struct dirent *ent;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return -1;
+
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+			continue;
+		pid = atol(ent->d_name);
+		if (tree_has(tree, pid))
+			continue;
+
+		/* pid (comm) state ppid ..., comm may contain anything */
+		snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		len = read(fd, buf, sizeof(buf) - 1);
+		close(fd);
+		if (len <= 0)
+			continue;
+		buf[len] = '\0';
+		p = strrchr(buf, ')');
+		if (!p || sscanf(p + 1, " %*c %ld", &ppid) != 1)
+			continue;
+
+		/* /proc lists processes in order of their IDs, grandchildren
+		 * are found in the same pass unless the IDs wrapped around. */
+		if (tree_has(tree, ppid)) {
+			if (!tree_add(tree, pid, ppid)) {
+				closedir(dir);
+				errno = ENOMEM;
+				return -1;
+			}
+			n++;
+		}
+	}
+
+	closedir(dir);
+	return n;
+}
+
+bool pink_easy_attach_tree(pink_easy_context_t *ctx, pid_t pid, int flags,
+		pink_easy_attach_stats_t *stats)
+{
+	int r, save_errno;
+	bool ok, more;
+	unsigned passes, tasks;
+	struct timespec start, end;
+	struct attach_tree tree;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* Falls back to PTRACE_ATTACH if the kernel is too old */
+	if (flags & PINK_EASY_ATTACH_SEIZE && !ctx->seize && ctx->nprocs == 0)
+		pink_easy_context_set_seize(ctx, true);
+
+	memset(&tree, 0, sizeof(struct attach_tree));
+	if (!tree_add(&tree, pid, -1)) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "realloc");
+		errno = ENOMEM;
+		return false;
+	}
+
+	ok = false;
+	passes = 0;
+	do {
+		more = false;
+		passes++;
+
+		tasks = tree.tasks;
+		for (unsigned i = 0; i < tree.nprocs; i++) {
+			if (tree_attach_threads(ctx, &tree, &tree.procs[i]))
+				continue;
+			/* Only the process itself must exist */
+			if (errno == ESRCH && (passes > 1 || i > 0))
+				continue;
+			if (errno == ESRCH)
+				ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
+			goto out;
+		}
+		if (tree.tasks > tasks)
+			more = true;
+
+		if (flags & PINK_EASY_ATTACH_DESCENDANTS) {
+			r = tree_find_children(&tree);
+			if (r < 0) {
+				if (errno == ENOMEM)
+					ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "realloc");
+				else
+					ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
+				goto out;
+			}
+			if (r > 0)
+				more = true;
+		}
+	} while (more);
+	ok = true;
+
+out:
+	save_errno = errno;
+	free(tree.procs);
+
+	if (stats) {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		stats->tasks = tree.tasks;
+		stats->passes = passes;
+		stats->usec = (end.tv_sec - start.tv_sec) * 1000000UL
+			+ end.tv_nsec / 1000 - start.tv_nsec / 1000;
+	}
+	errno = save_errno;
+	return ok;
+}
+
+bool pink_easy_spawn_prepare(pink_easy_context_t *ctx, int fd[2])
+{
+	fd[0] = fd[1] = -1;
+	if (ctx->seize && pipe(fd) < 0) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "pipe");
+		return false;
+	}
+	return true;
+}
+
+bool pink_easy_spawn_child(const pink_easy_context_t *ctx, int fd[2])
+{
+	char c = 0;
+
+	if (!ctx->seize) {
+		if (!pink_trace_me())
+			return false;
+		/* Induce a ptrace stop. Tracer (our parent) will resume us
+		 * with PTRACE_SYSCALL and may examine the immediately
+		 * following execve syscall.  Note: This can't be done on NOMMU
+		 * systems with vfork because the parent would be blocked and
+		 * stopping would deadlock.
+		 */
+		kill(getpid(), SIGSTOP);
+		return true;
+	}
+
+	/* Wait until the parent has seized us */
+	close(fd[1]);
+	while (read(fd[0], &c, 1) < 0 && errno == EINTR)
+		/* void */;
+	close(fd[0]);
+	return c == 1;
+}
+
+bool pink_easy_spawn_parent(pink_easy_context_t *ctx, pid_t pid, int fd[2])
+{
+	char c = 1;
+	ssize_t n;
+	bool ok;
+
+	if (!ctx->seize)
+		return true;
+
+	/* The interrupt makes the child stop before it goes on, unlike
+	 * SIGSTOP it needs neither a signal delivery nor PTRACE_SETOPTIONS. */
+	close(fd[0]);
+	ok = pink_trace_seize(pid, ctx->ptrace_options) && pink_trace_interrupt(pid);
+	if (ok) {
+		n = write(fd[1], &c, 1);
+		(void)n;
+	}
+	close(fd[1]);
+	if (!ok) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ATTACH, pid);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, __WALL);
+	}
+	return ok;
+}
@@ -38,25 +38,49 @@
 bool pink_easy_call(pink_easy_context_t *ctx, pink_easy_child_func_t func, void *userdata)
 {
 	pid_t pid;
+	int fd[2];
+	void *prog = NULL;
 	pink_easy_process_t *current;
 
+	/* Build the filter before forking, the child only loads it. */
+	if (ctx->seccomp && !(prog = pink_easy_seccomp_build(ctx))) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "seccomp");
+		return false;
+	}
+	if (!pink_easy_spawn_prepare(ctx, fd)) {
+		pink_easy_seccomp_free(prog);
+		return false;
+	}
+
 	pid = fork();
 	if (pid < 0) {
+		pink_easy_seccomp_free(prog);
+		if (ctx->seize) {
+			close(fd[0]);
+			close(fd[1]);
+		}
 		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "fork");
 		return false;
 	} else if (pid == 0) { /* child */
-		if (!pink_trace_me())
+		if (!pink_easy_spawn_child(ctx, fd))
+			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		if (prog && !pink_easy_seccomp_load(prog))
 			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
-		kill(getpid(), SIGSTOP);
 		_exit(func(userdata));
 	}
 	/* parent */
-	PINK_EASY_INSERT_PROCESS(ctx, current);
+	pink_easy_seccomp_free(prog);
+	if (!pink_easy_spawn_parent(ctx, pid, fd))
+		return false;
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
 	if (current == NULL) {
 		kill(pid, SIGKILL);
 		return false;
 	}
-	current->pid = pid;
-	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	pink_easy_process_link(current, NULL, pid, 0);
+	current->flags = PINK_EASY_PROCESS_STARTUP;
+	current->flags |= ctx->seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	if (ctx->seccomp)
+		current->flags |= PINK_EASY_PROCESS_SECCOMP;
 	return true;
 }
@@ -28,6 +28,7 @@
 #include <pinktrace/easy/internal.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +45,12 @@ pink_easy_context_t *pink_easy_context_new(int ptrace_options,
 	if (!ctx)
 		return NULL;
 
+	/* Pending decisions */
+	if (!pink_easy_async_init(ctx)) {
+		free(ctx);
+		return NULL;
+	}
+
 	/* Properties */
 	ctx->nprocs = 0;
 	ctx->ptrace_options = ptrace_options;
@@ -56,6 +63,34 @@ pink_easy_context_t *pink_easy_context_new(int ptrace_options,
 	if (ctx->callback_table.error == NULL)
 		ctx->callback_table.error = pink_easy_errback_stderr;
 
+	/* Dispatch table */
+	memset(ctx->dispatch, 0, sizeof(ctx->dispatch));
+
+	/* Result cache */
+	memset(ctx->memo, 0, sizeof(ctx->memo));
+
+	/* Shadow file descriptor tables */
+	ctx->shadow = false;
+	memset(ctx->shadow_mask, 0, sizeof(ctx->shadow_mask));
+
+	/* Policy */
+	ctx->policy = NULL;
+	ctx->seccomp = false;
+	ctx->seize = false;
+	ctx->exec_hook = NULL;
+	ctx->exec_hook_data = NULL;
+	ctx->session = NULL;
+	pink_easy_decision_init(&ctx->decisions);
+
+	/* Statistics, overhead accounting and live counters */
+	ctx->stats = NULL;
+	ctx->overhead = false;
+	memset(ctx->overhead_total, 0, sizeof(ctx->overhead_total));
+	ctx->overhead_wait = 0;
+	ctx->overhead_callback = 0;
+	ctx->overhead_current = NULL;
+	ctx->monitor = NULL;
+
 	/* Process list */
 	SLIST_INIT(&ctx->process_list);
 
@@ -83,18 +118,47 @@ pink_easy_context_destroy(pink_easy_context_t *ctx)
 {
 	pink_easy_process_t *current;
 
+	if (ctx->session)
+		pink_easy_session_unlink(ctx);
+
 	if (ctx->userdata_destroy && ctx->userdata)
 		ctx->userdata_destroy(ctx->userdata);
 
 	SLIST_FOREACH(current, &ctx->process_list, entries) {
 		if (current->userdata_destroy && current->userdata)
 			current->userdata_destroy(current->userdata);
+		pink_easy_group_drop(current);
+		pink_easy_process_memo_flush(current);
+		free(current->overhead);
 		free(current);
 	}
 
+	pink_easy_context_set_monitor(ctx, NULL);
+	pink_easy_dispatch_free(ctx);
+	pink_easy_memo_free(ctx);
+	pink_easy_decision_resize(&ctx->decisions, 0);
+	pink_easy_async_free(ctx);
 	free(ctx);
 }
 
+bool
+pink_easy_context_set_seize(pink_easy_context_t *ctx, bool seize)
+{
+	/* PTRACE_SEIZE, PTRACE_INTERRUPT and PTRACE_LISTEN need Linux-3.4 */
+	if (seize && pink_easy_os_release < KERNEL_VERSION(3,4,0)) {
+		errno = ENOTSUP;
+		return false;
+	}
+	/* Existing tracees are attached the other way */
+	if (ctx->nprocs > 0) {
+		errno = EBUSY;
+		return false;
+	}
+
+	ctx->seize = seize;
+	return true;
+}
+
 void
 pink_easy_context_set_userdata(pink_easy_context_t *ctx, void *userdata, pink_easy_free_func_t userdata_destroy)
 {
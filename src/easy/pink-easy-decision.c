@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* FNV-1a */
+static unsigned decision_hash(pink_bitness_t bitness, long scno,
+		const unsigned char *key, size_t keylen)
+{
+	unsigned h = 2166136261U;
+
+	h = (h ^ (unsigned)bitness) * 16777619U;
+	h = (h ^ (unsigned)scno) * 16777619U;
+	for (size_t i = 0; i < keylen; i++)
+		h = (h ^ key[i]) * 16777619U;
+	return h;
+}
+
+static void lru_unlink(struct pink_easy_decision_cache *cache, int i)
+{
+	struct pink_easy_decision *d = &cache->entries[i];
+
+	if (d->prev >= 0)
+		cache->entries[d->prev].next = d->next;
+	else
+		cache->head = d->next;
+	if (d->next >= 0)
+		cache->entries[d->next].prev = d->prev;
+	else
+		cache->tail = d->prev;
+}
+
+static void lru_push(struct pink_easy_decision_cache *cache, int i)
+{
+	struct pink_easy_decision *d = &cache->entries[i];
+
+	d->prev = -1;
+	d->next = cache->head;
+	if (cache->head >= 0)
+		cache->entries[cache->head].prev = i;
+	else
+		cache->tail = i;
+	cache->head = i;
+}
+
+static void chain_unlink(struct pink_easy_decision_cache *cache, int i)
+{
+	int *p = &cache->buckets[cache->entries[i].hash & (cache->nbuckets - 1)];
+
+	while (*p != i)
+		p = &cache->entries[*p].chain;
+	*p = cache->entries[i].chain;
+}
+
+void pink_easy_decision_init(struct pink_easy_decision_cache *cache)
+{
+	memset(cache, 0, sizeof(struct pink_easy_decision_cache));
+	cache->head = cache->tail = -1;
+}
+
+void pink_easy_decision_flush(struct pink_easy_decision_cache *cache)
+{
+	for (unsigned i = 0; i < cache->count; i++)
+		free(cache->entries[i].key);
+	for (unsigned i = 0; i < cache->nbuckets; i++)
+		cache->buckets[i] = -1;
+	cache->count = 0;
+	cache->head = cache->tail = -1;
+	cache->policy = NULL;
+}
+
+bool pink_easy_decision_resize(struct pink_easy_decision_cache *cache, unsigned size)
+{
+	unsigned nbuckets;
+	int *buckets;
+	struct pink_easy_decision *entries;
+
+	pink_easy_decision_flush(cache);
+	if (!size) {
+		free(cache->entries);
+		free(cache->buckets);
+		pink_easy_decision_init(cache);
+		return true;
+	}
+
+	for (nbuckets = 1; nbuckets < size; nbuckets <<= 1)
+		/* void */;
+	entries = malloc(size * sizeof(struct pink_easy_decision));
+	buckets = malloc(nbuckets * sizeof(int));
+	if (!entries || !buckets) {
+		free(entries);
+		free(buckets);
+		errno = ENOMEM;
+		return false;
+	}
+	for (unsigned i = 0; i < nbuckets; i++)
+		buckets[i] = -1;
+
+	free(cache->entries);
+	free(cache->buckets);
+	cache->entries = entries;
+	cache->buckets = buckets;
+	cache->nbuckets = nbuckets;
+	cache->size = size;
+	return true;
+}
+
+bool pink_easy_decision_lookup(struct pink_easy_decision_cache *cache,
+		const pink_easy_policy_t *policy, pink_bitness_t bitness, long scno,
+		const void *key, size_t keylen,
+		pink_easy_policy_action_t *action, int *err)
+{
+	unsigned hash;
+
+	if (cache->policy != policy || cache->generation != policy->generation) {
+		pink_easy_decision_flush(cache);
+		cache->policy = policy;
+		cache->generation = policy->generation;
+		return false;
+	}
+
+	hash = decision_hash(bitness, scno, key, keylen);
+	for (int i = cache->buckets[hash & (cache->nbuckets - 1)]; i >= 0; i = cache->entries[i].chain) {
+		struct pink_easy_decision *d = &cache->entries[i];
+		if (d->hash != hash || d->bitness != bitness || d->scno != scno
+				|| d->keylen != keylen || memcmp(d->key, key, keylen))
+			continue;
+		if (cache->head != i) {
+			lru_unlink(cache, i);
+			lru_push(cache, i);
+		}
+		*action = d->action;
+		*err = d->err;
+		return true;
+	}
+	return false;
+}
+
+void pink_easy_decision_store(struct pink_easy_decision_cache *cache,
+		pink_bitness_t bitness, long scno, const void *key, size_t keylen,
+		pink_easy_policy_action_t action, int err)
+{
+	int i;
+	unsigned char *copy;
+	struct pink_easy_decision *d;
+
+	copy = malloc(keylen ? keylen : 1);
+	if (!copy)
+		return;
+	memcpy(copy, key, keylen);
+
+	if (cache->count < cache->size) {
+		i = cache->count++;
+	} else {
+		/* Evict the least recently used decision */
+		i = cache->tail;
+		lru_unlink(cache, i);
+		chain_unlink(cache, i);
+		free(cache->entries[i].key);
+	}
+
+	d = &cache->entries[i];
+	d->hash = decision_hash(bitness, scno, key, keylen);
+	d->bitness = bitness;
+	d->scno = scno;
+	d->action = action;
+	d->err = err;
+	d->key = copy;
+	d->keylen = keylen;
+	d->chain = cache->buckets[d->hash & (cache->nbuckets - 1)];
+	cache->buckets[d->hash & (cache->nbuckets - 1)] = i;
+	lru_push(cache, i);
+}
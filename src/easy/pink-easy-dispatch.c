@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static bool dispatch_grow(struct pink_easy_dispatch *d, long scno)
+{
+	long nr, old_words, new_words;
+	struct pink_easy_dispatch_entry *table;
+	unsigned long *mask[2];
+
+	/* Round up to a full mask word so the masks and the table stay in sync */
+	nr = (scno / PINK_EASY_MASK_BITS + 1) * PINK_EASY_MASK_BITS;
+	old_words = d->nr / PINK_EASY_MASK_BITS;
+	new_words = nr / PINK_EASY_MASK_BITS;
+
+	table = realloc(d->table, nr * sizeof(struct pink_easy_dispatch_entry));
+	if (!table)
+		return false;
+	memset(table + d->nr, 0, (nr - d->nr) * sizeof(struct pink_easy_dispatch_entry));
+	d->table = table;
+
+	for (unsigned i = 0; i < 2; i++) {
+		mask[i] = realloc(d->mask[i], new_words * sizeof(unsigned long));
+		if (!mask[i])
+			return false;
+		memset(mask[i] + old_words, 0, (new_words - old_words) * sizeof(unsigned long));
+		d->mask[i] = mask[i];
+	}
+
+	d->nr = nr;
+	return true;
+}
+
+static inline void mask_assign(unsigned long *mask, long bit, bool on)
+{
+	if (on)
+		mask[bit / PINK_EASY_MASK_BITS] |= (1UL << (bit % PINK_EASY_MASK_BITS));
+	else
+		mask[bit / PINK_EASY_MASK_BITS] &= ~(1UL << (bit % PINK_EASY_MASK_BITS));
+}
+
+bool pink_easy_dispatch_set(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, pink_easy_callback_syscall_handler_t entry,
+		pink_easy_callback_syscall_handler_t exit)
+{
+	bool was_set;
+	struct pink_easy_dispatch *d;
+
+	if ((bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+			|| scno < 0 || scno >= PINK_EASY_SYSCALL_MAX) {
+		errno = EINVAL;
+		return false;
+	}
+
+	d = &ctx->dispatch[bitness];
+	if (scno >= d->nr) {
+		if (!entry && !exit)
+			return true;
+		if (!dispatch_grow(d, scno)) {
+			errno = ENOMEM;
+			return false;
+		}
+	}
+
+	was_set = d->table[scno].entry || d->table[scno].exit;
+	d->table[scno].entry = entry;
+	d->table[scno].exit = exit;
+	mask_assign(d->mask[0], scno, entry != NULL);
+	mask_assign(d->mask[1], scno, exit != NULL);
+
+	if (!was_set && (entry || exit))
+		d->count++;
+	else if (was_set && !entry && !exit)
+		d->count--;
+	return true;
+}
+
+bool pink_easy_dispatch_set_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, pink_easy_callback_syscall_handler_t entry,
+		pink_easy_callback_syscall_handler_t exit)
+{
+	long scno;
+
+	scno = pink_name_lookup(name, bitness);
+	if (scno < 0) {
+		errno = ENOENT;
+		return false;
+	}
+
+	return pink_easy_dispatch_set(ctx, bitness, scno, entry, exit);
+}
+
+void pink_easy_dispatch_clear(pink_easy_context_t *ctx, pink_bitness_t bitness)
+{
+	struct pink_easy_dispatch *d;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return;
+
+	d = &ctx->dispatch[bitness];
+	free(d->table);
+	free(d->mask[0]);
+	free(d->mask[1]);
+	memset(d, 0, sizeof(struct pink_easy_dispatch));
+}
+
+bool pink_easy_dispatch_interested(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, long scno, bool entering)
+{
+	const struct pink_easy_dispatch *d;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return false;
+
+	d = &ctx->dispatch[bitness];
+	return pink_easy_mask_test(d->mask[entering ? 0 : 1], d->nr, scno);
+}
+
+unsigned pink_easy_dispatch_walk(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, pink_easy_dispatch_walk_func_t func,
+		void *userdata)
+{
+	unsigned count;
+	const struct pink_easy_dispatch *d;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return 0;
+
+	count = 0;
+	d = &ctx->dispatch[bitness];
+	for (long scno = 0; scno < d->nr; scno++) {
+		bool entry = d->table[scno].entry != NULL;
+		bool exit = d->table[scno].exit != NULL;
+		if (!entry && !exit)
+			continue;
+		++count;
+		if (!func(bitness, scno, entry, exit, userdata))
+			break;
+	}
+
+	return count;
+}
+
+bool pink_easy_dispatch_any(const pink_easy_context_t *ctx)
+{
+	return ctx->dispatch[PINK_BITNESS_32].count || ctx->dispatch[PINK_BITNESS_64].count;
+}
+
+int pink_easy_dispatch_call(const pink_easy_context_t *ctx,
+		pink_easy_process_t *current, bool entering)
+{
+	const struct pink_easy_dispatch *d;
+	pink_easy_callback_syscall_handler_t handler;
+
+	if (current->bitness != PINK_BITNESS_32 && current->bitness != PINK_BITNESS_64)
+		return 0;
+
+	d = &ctx->dispatch[current->bitness];
+	if (!pink_easy_mask_test(d->mask[entering ? 0 : 1], d->nr, current->scno))
+		return 0;
+
+	handler = entering ? d->table[current->scno].entry : d->table[current->scno].exit;
+	return handler(ctx, current, current->scno);
+}
+
+void pink_easy_dispatch_free(pink_easy_context_t *ctx)
+{
+	pink_easy_dispatch_clear(ctx, PINK_BITNESS_32);
+	pink_easy_dispatch_clear(ctx, PINK_BITNESS_64);
+}
@@ -31,9 +31,12 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <alloca.h>
 #include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -43,53 +46,187 @@ enum {
 	PINK_INTERNAL_FUNC_EXECVP,
 };
 
-static bool pink_easy_exec_helper(pink_easy_context_t *ctx, int type,
+static void exec_child(int type, const char *filename, char *const argv[], char *const envp[])
+{
+	switch (type) {
+	case PINK_INTERNAL_FUNC_EXECVE:
+		execve(filename, argv, envp);
+		break;
+	case PINK_INTERNAL_FUNC_EXECV:
+		execv(filename, argv);
+		break;
+	case PINK_INTERNAL_FUNC_EXECVP:
+		execvp(filename, argv);
+		break;
+	default:
+		abort(); /* TODO assert_not_reached() */
+	}
+}
+
+/* The child of vfork() shares the memory and the stdio locks of the tracer,
+ * the default child errback is replaced with one writing with write(2). */
+static int vfork_child_error(const pink_easy_context_t *ctx, pink_easy_child_error_t e)
+{
+	int save_errno = errno;
+	char num[16], *p;
+	const char *msg;
+	ssize_t n;
+
+	if (ctx->callback_table.cerror != pink_easy_errback_child_stderr)
+		return ctx->callback_table.cerror(e);
+
+	p = num + sizeof(num);
+	*--p = '\0';
+	do {
+		*--p = '0' + save_errno % 10;
+		save_errno /= 10;
+	} while (save_errno > 0 && p > num);
+
+	msg = pink_easy_child_strerror(e);
+	n = write(STDERR_FILENO, "pinktrace child error: ", 23);
+	n = write(STDERR_FILENO, msg, strlen(msg));
+	n = write(STDERR_FILENO, " (errno:", 8);
+	n = write(STDERR_FILENO, p, strlen(p));
+	n = write(STDERR_FILENO, ")\n", 2);
+	(void)n;
+	return EXIT_FAILURE;
+}
+
+/* With a seccomp filter the child is spawned with fork() and stops before it
+ * loads the filter, so that the tracer sets PTRACE_O_TRACESECCOMP first.
+ * Otherwise the system calls the filter traps, execve() among them, would
+ * fail with ENOSYS until the tracer got to see the child. */
+static bool exec_fork(pink_easy_context_t *ctx, int type,
 		const char *filename, char *const argv[], char *const envp[])
 {
 	pid_t pid;
+	int fd[2];
+	void *prog;
 	pink_easy_process_t *current;
 
+	/* Build the filter before forking, the child only loads it. */
+	if (!(prog = pink_easy_seccomp_build(ctx))) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_ALLOC, "seccomp");
+		return false;
+	}
+	if (!pink_easy_spawn_prepare(ctx, fd)) {
+		pink_easy_seccomp_free(prog);
+		return false;
+	}
+
 	pid = fork();
 	if (pid < 0) {
+		pink_easy_seccomp_free(prog);
+		if (ctx->seize) {
+			close(fd[0]);
+			close(fd[1]);
+		}
 		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "fork");
 		return false;
 	} else if (pid == 0) { /* child */
-		if (!pink_trace_me())
+		if (ctx->exec_hook && ctx->exec_hook(ctx->exec_hook_data) != 0)
 			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
-		/* Induce a ptrace stop. Tracer (our parent) will resume us
-		 * with PTRACE_SYSCALL and may examine the immediately
-		 * following execve syscall.  Note: This can't be done on NOMMU
-		 * systems with vfork because the parent would be blocked and
-		 * stopping would deadlock.
-		 */
-		kill(getpid(), SIGSTOP);
-		switch (type) {
-		case PINK_INTERNAL_FUNC_EXECVE:
-			execve(filename, argv, envp);
-			break;
-		case PINK_INTERNAL_FUNC_EXECV:
-			execv(filename, argv);
-			break;
-		case PINK_INTERNAL_FUNC_EXECVP:
-			execvp(filename, argv);
-			break;
-		default:
-			abort(); /* TODO assert_not_reached() */
-		}
+		if (!pink_easy_spawn_child(ctx, fd))
+			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		if (!pink_easy_seccomp_load(prog))
+			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		exec_child(type, filename, argv, envp);
 		/* execve() failed */
 		_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_EXEC));
 	}
 	/* parent */
-	PINK_EASY_INSERT_PROCESS(ctx, current);
+	pink_easy_seccomp_free(prog);
+	if (!pink_easy_spawn_parent(ctx, pid, fd))
+		return false;
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
 	if (current == NULL) {
 		kill(pid, SIGKILL);
 		return false;
 	}
-	current->pid = pid;
-	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+	pink_easy_process_link(current, NULL, pid, 0);
+	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_SECCOMP;
+	current->flags |= ctx->seize ? PINK_EASY_PROCESS_SEIZED : PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
 	return true;
 }
 
+/* Reset the signals the tracer handles to their default action, as
+ * posix_spawn() does. The child of vfork() has its own signal handler table
+ * but shares our memory and stack, a handler of the tracer would run on
+ * them once the child unblocks signals. Ignored signals stay ignored. */
+static void vfork_child_signals(void)
+{
+	int sig;
+	struct sigaction sa;
+
+	for (sig = 1; sig < NSIG; sig++) {
+		if (sigaction(sig, NULL, &sa) < 0)
+			continue;
+		if (sa.sa_handler == SIG_DFL || sa.sa_handler == SIG_IGN)
+			continue;
+		sa.sa_handler = SIG_DFL;
+		sa.sa_flags = 0;
+		sigemptyset(&sa.sa_mask);
+		sigaction(sig, &sa, NULL);
+	}
+}
+
+static bool pink_easy_exec_helper(pink_easy_context_t *ctx, int type,
+		const char *filename, char *const argv[], char *const envp[])
+{
+	pid_t pid;
+	int save_errno;
+	sigset_t all, old;
+	pink_easy_process_t *current;
+
+	if (ctx->seccomp)
+		return exec_fork(ctx, type, filename, argv, envp);
+
+	/* vfork() doesn't copy the page tables, so spawning costs the same
+	 * however large the tracer is. The child runs in our memory while we
+	 * are suspended until it calls execve() or exits, signal handlers of
+	 * the tracer must not run in the child. */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	pid = vfork();
+	if (pid < 0) {
+		save_errno = errno;
+		pthread_sigmask(SIG_SETMASK, &old, NULL);
+		errno = save_errno;
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_FORK, "vfork");
+		return false;
+	} else if (pid == 0) { /* child */
+		/* The child can't stop itself with SIGSTOP, the parent would
+		 * never be resumed to resume it. The first stop is the SIGTRAP
+		 * after a successful execve() instead. */
+		if (!pink_trace_me())
+			_exit(vfork_child_error(ctx, PINK_EASY_CHILD_ERROR_SETUP));
+		if (ctx->exec_hook && ctx->exec_hook(ctx->exec_hook_data) != 0)
+			_exit(vfork_child_error(ctx, PINK_EASY_CHILD_ERROR_SETUP));
+		vfork_child_signals();
+		sigprocmask(SIG_SETMASK, &old, NULL);
+		exec_child(type, filename, argv, envp);
+		/* execve() failed */
+		_exit(vfork_child_error(ctx, PINK_EASY_CHILD_ERROR_EXEC));
+	}
+	/* parent */
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	PINK_EASY_INSERT_PROCESS(ctx, current, pid);
+	if (current == NULL) {
+		kill(pid, SIGKILL);
+		return false;
+	}
+	pink_easy_process_link(current, NULL, pid, 0);
+	current->flags = PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP;
+	return true;
+}
+
+void pink_easy_context_set_exec_hook(pink_easy_context_t *ctx,
+		pink_easy_child_func_t hook, void *userdata)
+{
+	ctx->exec_hook = hook;
+	ctx->exec_hook_data = userdata;
+}
+
 bool pink_easy_execve(pink_easy_context_t *ctx, const char *filename,
 		char *const argv[], char *const envp[])
 {
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdlib.h>
+#include <sched.h>
+
+static const unsigned long group_clone_flags[PINK_EASY_GROUP_MAX] = {
+	[PINK_EASY_GROUP_THREAD] = CLONE_THREAD,
+	[PINK_EASY_GROUP_VM] = CLONE_VM,
+	[PINK_EASY_GROUP_FILES] = CLONE_FILES,
+	[PINK_EASY_GROUP_FS] = CLONE_FS,
+};
+
+static pink_easy_group_t *group_new(pink_easy_group_type_t type)
+{
+	pink_easy_group_t *group;
+
+	group = calloc(1, sizeof(pink_easy_group_t));
+	if (group == NULL)
+		return NULL;
+	group->refs = 1;
+	group->type = type;
+	return group;
+}
+
+/* Quiet members are counted in the groups they are in */
+static void group_enter(pink_easy_process_t *current, pink_easy_group_type_t type,
+		pink_easy_group_t *group)
+{
+	current->groups[type] = group;
+	if (group && current->flags & PINK_EASY_PROCESS_QUIET && group->quiet++ == 0)
+		pink_easy_shadow_free(group);
+}
+
+static void group_leave(pink_easy_process_t *current, pink_easy_group_type_t type)
+{
+	pink_easy_group_t *group = current->groups[type];
+
+	if (!group)
+		return;
+	if (current->flags & PINK_EASY_PROCESS_QUIET)
+		group->quiet--;
+	current->groups[type] = NULL;
+	pink_easy_group_unref(group);
+}
+
+void pink_easy_group_inherit(pink_easy_process_t *current,
+		const pink_easy_process_t *parent, unsigned long flags)
+{
+	pink_easy_group_t *group;
+
+	for (unsigned i = 0; i < PINK_EASY_GROUP_MAX; i++) {
+		group_leave(current, i);
+		if (parent && parent->groups[i] && flags & group_clone_flags[i]) {
+			group_enter(current, i, pink_easy_group_ref(parent->groups[i]));
+			continue;
+		}
+		group = group_new(i);
+		if (parent && parent->groups[i] && group)
+			pink_easy_shadow_copy(group, parent->groups[i]);
+		group_enter(current, i, group);
+	}
+}
+
+static void group_unshare(pink_easy_process_t *current, pink_easy_group_type_t type)
+{
+	pink_easy_group_t *group, *old;
+
+	old = current->groups[type];
+	if (!old || old->refs == 1)
+		return;
+	group = group_new(type);
+	if (group)
+		pink_easy_shadow_copy(group, old);
+	group_leave(current, type);
+	group_enter(current, type, group);
+}
+
+void pink_easy_group_exec(pink_easy_process_t *current)
+{
+	pink_easy_group_t **group;
+
+	/* The address space is new, a shared table of files is unshared */
+	group_leave(current, PINK_EASY_GROUP_VM);
+	group_enter(current, PINK_EASY_GROUP_VM, group_new(PINK_EASY_GROUP_VM));
+
+	group_unshare(current, PINK_EASY_GROUP_FILES);
+	group = &current->groups[PINK_EASY_GROUP_FILES];
+	if (*group)
+		pink_easy_shadow_exec(*group);
+}
+
+void pink_easy_group_unshare(pink_easy_process_t *current, unsigned long flags)
+{
+	if (flags & CLONE_FILES)
+		group_unshare(current, PINK_EASY_GROUP_FILES);
+	if (flags & CLONE_FS)
+		group_unshare(current, PINK_EASY_GROUP_FS);
+}
+
+void pink_easy_group_drop(pink_easy_process_t *current)
+{
+	for (unsigned i = 0; i < PINK_EASY_GROUP_MAX; i++)
+		group_leave(current, i);
+}
+
+void pink_easy_group_quiet(pink_easy_process_t *current)
+{
+	pink_easy_group_t *group;
+
+	if (current->flags & PINK_EASY_PROCESS_QUIET)
+		return;
+	current->flags |= PINK_EASY_PROCESS_QUIET;
+	for (unsigned i = 0; i < PINK_EASY_GROUP_MAX; i++) {
+		group = current->groups[i];
+		if (group && group->quiet++ == 0)
+			pink_easy_shadow_free(group);
+	}
+}
+
+pink_easy_group_t *pink_easy_process_get_group(const pink_easy_process_t *proc,
+		pink_easy_group_type_t type)
+{
+	if (type >= PINK_EASY_GROUP_MAX)
+		return NULL;
+	return proc->groups[type];
+}
+
+pink_easy_group_type_t pink_easy_group_get_type(const pink_easy_group_t *group)
+{
+	return group->type;
+}
+
+unsigned pink_easy_group_get_refcount(const pink_easy_group_t *group)
+{
+	return group->refs;
+}
+
+pink_easy_group_t *pink_easy_group_ref(pink_easy_group_t *group)
+{
+	group->refs++;
+	return group;
+}
+
+void pink_easy_group_unref(pink_easy_group_t *group)
+{
+	if (--group->refs > 0)
+		return;
+	if (group->userdata_destroy && group->userdata)
+		group->userdata_destroy(group->userdata);
+	pink_easy_shadow_free(group);
+	free(group);
+}
+
+void pink_easy_group_set_userdata(pink_easy_group_t *group, void *userdata,
+		pink_easy_free_func_t userdata_destroy)
+{
+	group->userdata = userdata;
+	group->userdata_destroy = userdata_destroy;
+}
+
+void *pink_easy_group_get_userdata(const pink_easy_group_t *group)
+{
+	return group->userdata;
+}
@@ -0,0 +1,559 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/* A spawn request on the wire, followed by size bytes of zero terminated
+ * strings: the filename, argc arguments and envc environment entries. */
+struct launcher_request {
+	uint32_t size;
+	uint32_t argc;
+	uint32_t envc; /* UINT32_MAX to inherit the environment */
+};
+
+/* Sent back by a helper for each request it could not fork a child for.
+ * The reply is sent before the helper forks again, so the tracer reads it
+ * at the latest when it sees the next fork of the helper. */
+struct launcher_reply {
+	int32_t error;
+};
+
+struct pink_easy_launcher_proc {
+	struct pink_easy_launcher *launcher;
+
+	/** Our end of the socket and the end of the helper **/
+	int fd, peer;
+
+	/** Process ID of the helper **/
+	pid_t pid;
+
+	/** User data of the requests sent and not yet forked, in order **/
+	void **queue;
+	unsigned head, count, size;
+
+	/** Requests the socket had no room for, sent from out_off on **/
+	char *out;
+	size_t out_off, out_len, out_size;
+};
+
+struct pink_easy_launcher {
+	pink_easy_context_t *ctx;
+
+	/** Protects the sockets, the queues and the outgoing buffers **/
+	pthread_mutex_t lock;
+
+	/** Helper to send the next request to **/
+	unsigned next;
+
+	/** Destructor for the user data of requests which yield no child **/
+	pink_easy_free_func_t userdata_destroy;
+
+	unsigned nprocs;
+	struct pink_easy_launcher_proc proc[];
+};
+
+static bool read_full(int fd, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool send_full(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* Split size bytes of zero terminated strings into vec, returns the number
+ * of bytes used or 0 if the buffer is short. */
+static size_t split_strings(char *buf, size_t size, char **vec, uint32_t n)
+{
+	size_t off = 0, len;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (off >= size)
+			return 0;
+		len = strnlen(buf + off, size - off);
+		if (off + len == size)
+			return 0;
+		vec[i] = buf + off;
+		off += len + 1;
+	}
+	vec[n] = NULL;
+	return off;
+}
+
+static bool skip_full(int fd, size_t len)
+{
+	char buf[256];
+	size_t n;
+
+	while (len > 0) {
+		n = len < sizeof(buf) ? len : sizeof(buf);
+		if (!read_full(fd, buf, n))
+			return false;
+		len -= n;
+	}
+	return true;
+}
+
+/* Fork a child for a request, returns 0 or the errno of the failure */
+static int launcher_serve(const pink_easy_context_t *ctx, int fd,
+		const struct launcher_request *req, char *buf)
+{
+	int error = EINVAL;
+	size_t off;
+	char **argv, **envp = NULL;
+	pid_t pid;
+
+	argv = malloc((req->argc + 1) * sizeof(char *));
+	if (argv == NULL)
+		return ENOMEM;
+	if (req->envc != UINT32_MAX) {
+		envp = malloc((req->envc + 1) * sizeof(char *));
+		if (envp == NULL) {
+			error = ENOMEM;
+			goto out;
+		}
+	}
+
+	off = strnlen(buf, req->size) + 1;
+	if (off > req->size)
+		goto out;
+	if (req->argc > 0 && !(off += split_strings(buf + off, req->size - off, argv, req->argc)))
+		goto out;
+	argv[req->argc] = NULL;
+	if (envp && req->envc > 0 && !split_strings(buf + off, req->size - off, envp, req->envc))
+		goto out;
+	if (envp)
+		envp[req->envc] = NULL;
+
+	/* Not vfork(), the tracer follows forks of the helper only */
+	while ((pid = fork()) < 0 && errno == EAGAIN)
+		usleep(1000);
+	if (pid < 0) {
+		error = errno;
+	} else if (pid == 0) { /* child */
+		close(fd);
+		signal(SIGCHLD, SIG_DFL);
+		if (ctx->exec_hook && ctx->exec_hook(ctx->exec_hook_data) != 0)
+			_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_SETUP));
+		if (envp)
+			execvpe(buf, argv, envp);
+		else
+			execvp(buf, argv);
+		_exit(ctx->callback_table.cerror(PINK_EASY_CHILD_ERROR_EXEC));
+	} else {
+		error = 0;
+	}
+out:
+	free(argv);
+	free(envp);
+	return error;
+}
+
+/* Main loop of a helper, the socket is its only link to the tracer */
+static int launcher_main(void *data)
+{
+	struct pink_easy_launcher_proc *lp = data;
+	const pink_easy_context_t *ctx = lp->launcher->ctx;
+	struct launcher_request req;
+	struct launcher_reply reply;
+	char *buf;
+	unsigned i;
+	int fd = lp->peer;
+
+	/* Keep none of the ends of the tracer open, helpers would never see
+	 * end of file */
+	for (i = 0; i < lp->launcher->nprocs; i++) {
+		if (lp->launcher->proc[i].fd >= 0)
+			close(lp->launcher->proc[i].fd);
+	}
+	/* Children are reaped by the kernel, the tracer collects their
+	 * status. */
+	signal(SIGCHLD, SIG_IGN);
+
+	/* Requests which fail are answered one by one, the tracer pairs
+	 * requests and forks in order */
+	while (read_full(fd, &req, sizeof(req))) {
+		if (!(buf = malloc(req.size))) {
+			if (!skip_full(fd, req.size))
+				return EXIT_FAILURE;
+			reply.error = ENOMEM;
+		} else if (!read_full(fd, buf, req.size)) {
+			free(buf);
+			return EXIT_FAILURE;
+		} else {
+			reply.error = launcher_serve(ctx, fd, &req, buf);
+			free(buf);
+		}
+		if (reply.error && !send_full(fd, &reply, sizeof(reply)))
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+pink_easy_launcher_t *pink_easy_launcher_new(pink_easy_context_t *ctx, unsigned nprocs)
+{
+	unsigned i;
+	int sv[2];
+	pink_easy_launcher_t *launcher;
+	struct pink_easy_launcher_proc *lp;
+
+	if (nprocs == 0 || !(ctx->ptrace_options & PINK_TRACE_OPTION_FORK)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	launcher = calloc(1, sizeof(*launcher) + nprocs * sizeof(launcher->proc[0]));
+	if (launcher == NULL)
+		return NULL;
+	launcher->ctx = ctx;
+	launcher->nprocs = nprocs;
+	pthread_mutex_init(&launcher->lock, NULL);
+	for (i = 0; i < nprocs; i++) {
+		launcher->proc[i].launcher = launcher;
+		launcher->proc[i].fd = -1;
+		launcher->proc[i].peer = -1;
+	}
+
+	for (i = 0; i < nprocs; i++) {
+		lp = &launcher->proc[i];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+			goto fail;
+		lp->fd = sv[0];
+		lp->peer = sv[1];
+		/* Spawning never blocks, what doesn't fit is sent later */
+		if (fcntl(lp->fd, F_SETFL, fcntl(lp->fd, F_GETFL) | O_NONBLOCK) < 0) {
+			close(sv[1]);
+			goto fail;
+		}
+		if (!pink_easy_call(ctx, launcher_main, lp)) {
+			close(sv[1]);
+			goto fail;
+		}
+		close(sv[1]);
+		/* pink_easy_call() inserts at the head of the list */
+		lp->pid = SLIST_FIRST(&ctx->process_list)->pid;
+		SLIST_FIRST(&ctx->process_list)->launcher = lp;
+		SLIST_FIRST(&ctx->process_list)->flags |= PINK_EASY_PROCESS_HELPER;
+	}
+	return launcher;
+fail:
+	pink_easy_launcher_destroy(launcher);
+	return NULL;
+}
+
+/* Pop the oldest request of a helper, the caller holds the lock */
+static void *queue_pop(struct pink_easy_launcher_proc *lp)
+{
+	void *userdata = NULL;
+
+	if (lp->count > 0) {
+		userdata = lp->queue[lp->head];
+		lp->head = (lp->head + 1) % lp->size;
+		lp->count--;
+	}
+	return userdata;
+}
+
+/* Send as much of the outgoing buffer as the socket takes without
+ * blocking, the caller holds the lock. Returns false if the helper is gone. */
+static bool launcher_send(struct pink_easy_launcher_proc *lp)
+{
+	ssize_t n;
+
+	while (lp->out_off < lp->out_len) {
+		n = send(lp->fd, lp->out + lp->out_off, lp->out_len - lp->out_off, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		lp->out_off += n;
+	}
+	lp->out_off = lp->out_len = 0;
+	return true;
+}
+
+/* Drop the requests the helper has failed so far */
+static void launcher_collect(struct pink_easy_launcher_proc *lp)
+{
+	ssize_t n;
+	void *userdata;
+	struct launcher_reply reply;
+	struct pink_easy_launcher *launcher = lp->launcher;
+
+	for (;;) {
+		n = recv(lp->fd, &reply, sizeof(reply), MSG_DONTWAIT);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		/* The rest of the reply is on its way */
+		if ((size_t)n < sizeof(reply)
+				&& !read_full(lp->fd, (char *)&reply + n, sizeof(reply) - n))
+			break;
+
+		pthread_mutex_lock(&launcher->lock);
+		userdata = queue_pop(lp);
+		pthread_mutex_unlock(&launcher->lock);
+		if (launcher->userdata_destroy && userdata)
+			launcher->userdata_destroy(userdata);
+	}
+}
+
+void pink_easy_launcher_destroy(pink_easy_launcher_t *launcher)
+{
+	unsigned i;
+	int save_errno = errno;
+	void *userdata;
+	pink_easy_process_t *node;
+	struct pink_easy_launcher_proc *lp;
+
+	PINK_EASY_FOREACH_PROCESS(node, launcher->ctx) {
+		if (node->launcher && node->launcher->launcher == launcher)
+			node->launcher = NULL;
+	}
+	for (i = 0; i < launcher->nprocs; i++) {
+		lp = &launcher->proc[i];
+		if (lp->fd < 0)
+			continue;
+		/* Requests which don't fit into the socket now are dropped,
+		 * children forked from now on get no user data */
+		pthread_mutex_lock(&launcher->lock);
+		launcher_send(lp);
+		pthread_mutex_unlock(&launcher->lock);
+		launcher_collect(lp);
+		while (lp->count > 0) {
+			userdata = queue_pop(lp);
+			if (launcher->userdata_destroy && userdata)
+				launcher->userdata_destroy(userdata);
+		}
+		close(lp->fd);
+	}
+	for (i = 0; i < launcher->nprocs; i++) {
+		free(launcher->proc[i].queue);
+		free(launcher->proc[i].out);
+	}
+	pthread_mutex_destroy(&launcher->lock);
+	free(launcher);
+	errno = save_errno;
+}
+
+static bool queue_push(struct pink_easy_launcher_proc *lp, void *userdata)
+{
+	unsigned i, size;
+	void **queue;
+
+	if (lp->count == lp->size) {
+		size = lp->size ? lp->size * 2 : 16;
+		queue = malloc(size * sizeof(void *));
+		if (queue == NULL)
+			return false;
+		for (i = 0; i < lp->count; i++)
+			queue[i] = lp->queue[(lp->head + i) % lp->size];
+		free(lp->queue);
+		lp->queue = queue;
+		lp->head = 0;
+		lp->size = size;
+	}
+	lp->queue[(lp->head + lp->count) % lp->size] = userdata;
+	lp->count++;
+	return true;
+}
+
+void pink_easy_launcher_flush(struct pink_easy_launcher_proc *lp)
+{
+	int save_errno = errno;
+
+	pthread_mutex_lock(&lp->launcher->lock);
+	launcher_send(lp);
+	pthread_mutex_unlock(&lp->launcher->lock);
+	errno = save_errno;
+}
+
+void *pink_easy_launcher_take(struct pink_easy_launcher_proc *lp)
+{
+	void *userdata;
+
+	/* The helper is stopped at the fork, the replies about the requests
+	 * before this one are in the socket already */
+	launcher_collect(lp);
+
+	pthread_mutex_lock(&lp->launcher->lock);
+	userdata = queue_pop(lp);
+	pthread_mutex_unlock(&lp->launcher->lock);
+	return userdata;
+}
+
+void pink_easy_launcher_set_userdata_destroy(pink_easy_launcher_t *launcher,
+		pink_easy_free_func_t userdata_destroy)
+{
+	launcher->userdata_destroy = userdata_destroy;
+}
+
+/* Make room for len more bytes in the outgoing buffer, the caller holds
+ * the lock */
+static bool out_reserve(struct pink_easy_launcher_proc *lp, size_t len)
+{
+	size_t size;
+	char *out;
+
+	/* Drop what has been sent already */
+	if (lp->out_off > 0) {
+		memmove(lp->out, lp->out + lp->out_off, lp->out_len - lp->out_off);
+		lp->out_len -= lp->out_off;
+		lp->out_off = 0;
+	}
+	if (lp->out_len + len <= lp->out_size)
+		return true;
+
+	size = lp->out_size ? lp->out_size : 4096;
+	while (size < lp->out_len + len)
+		size *= 2;
+	out = realloc(lp->out, size);
+	if (out == NULL)
+		return false;
+	lp->out = out;
+	lp->out_size = size;
+	return true;
+}
+
+bool pink_easy_launcher_spawn(pink_easy_launcher_t *launcher, const char *filename,
+		char *const argv[], char *const envp[], void *userdata)
+{
+	bool r;
+	char *p;
+	size_t len, size, start;
+	uint32_t argc, envc;
+	struct launcher_request req;
+	struct pink_easy_launcher_proc *lp;
+
+	size = strlen(filename) + 1;
+	for (argc = 0; argv[argc]; argc++)
+		size += strlen(argv[argc]) + 1;
+	envc = UINT32_MAX;
+	if (envp) {
+		for (envc = 0; envp[envc]; envc++)
+			size += strlen(envp[envc]) + 1;
+	}
+	if (size > UINT32_MAX) {
+		errno = E2BIG;
+		return false;
+	}
+
+	req.size = size;
+	req.argc = argc;
+	req.envc = envc;
+	size += sizeof(req);
+
+	pthread_mutex_lock(&launcher->lock);
+	lp = &launcher->proc[launcher->next];
+	if (lp->out_len + size > lp->out_size && !out_reserve(lp, size)) {
+		pthread_mutex_unlock(&launcher->lock);
+		return false;
+	}
+	/* Queue first, the helper may fork before send() returns */
+	if (!queue_push(lp, userdata)) {
+		pthread_mutex_unlock(&launcher->lock);
+		return false;
+	}
+	launcher->next = (launcher->next + 1) % launcher->nprocs;
+
+	start = lp->out_len;
+	p = lp->out + start;
+	memcpy(p, &req, sizeof(req));
+	p += sizeof(req);
+	len = strlen(filename) + 1;
+	memcpy(p, filename, len);
+	p += len;
+	for (argc = 0; argv[argc]; argc++) {
+		len = strlen(argv[argc]) + 1;
+		memcpy(p, argv[argc], len);
+		p += len;
+	}
+	for (envc = 0; envp && envp[envc]; envc++) {
+		len = strlen(envp[envc]) + 1;
+		memcpy(p, envp[envc], len);
+		p += len;
+	}
+	lp->out_len += size;
+
+	/* What the socket has no room for is sent by the loop at the next
+	 * stop of the helper */
+	r = launcher_send(lp);
+	if (!r) {
+		lp->count--;
+		lp->out_len = start;
+		if (lp->out_off > start)
+			lp->out_off = start;
+	}
+	pthread_mutex_unlock(&launcher->lock);
+	return r;
+}
+
+pid_t pink_easy_launcher_get_pid(const pink_easy_launcher_t *launcher, unsigned i)
+{
+	return launcher->proc[i].pid;
+}
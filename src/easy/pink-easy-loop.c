@@ -31,14 +31,24 @@
 #include <pinktrace/easy/pink.h>
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/queue.h>
 #include <sys/wait.h>
 #include <sys/utsname.h>
 
+#ifndef PTRACE_EVENT_STOP
+#define PTRACE_EVENT_STOP	128
+#endif /* !PTRACE_EVENT_STOP */
+
 static void handle_ptrace_error(pink_easy_context_t *ctx,
 		pink_easy_process_t *current,
 		const char *errctx)
@@ -52,10 +62,240 @@ static void handle_ptrace_error(pink_easy_context_t *ctx,
 	PINK_EASY_REMOVE_PROCESS(ctx, current);
 }
 
+/* Processes under the seccomp filter of the context only stop when the filter
+ * asks for it, unless a system call stop is pending. Processes which are to
+ * be detached are let go and their entries are removed, quiet processes
+ * stop tracing system calls, once the return value of a denied system call
+ * is fixed up. */
+static bool resume_tracee(pink_easy_context_t *ctx, pink_easy_process_t *current, int sig)
+{
+	PINK_EASY_PROBE(resume, current->pid, sig, current->flags);
+	/* Requests the socket of a helper had no room for */
+	if (current->launcher)
+		pink_easy_launcher_flush(current->launcher);
+	if (current->flags & PINK_EASY_PROCESS_DENY)
+		return pink_trace_syscall(current->pid, sig);
+	if (current->flags & PINK_EASY_PROCESS_DETACH) {
+		if (!pink_trace_detach(current->pid, sig) && errno != ESRCH)
+			return false;
+		if (ctx->callback_table.teardown)
+			ctx->callback_table.teardown(ctx, current);
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		return true;
+	}
+	if (current->flags & PINK_EASY_PROCESS_QUIET) {
+		current->flags &= ~(PINK_EASY_PROCESS_INSYSCALL | PINK_EASY_PROCESS_RESOLVED
+				| PINK_EASY_PROCESS_SECCOMP_ENTRY);
+		current->scno = -1;
+		pink_easy_memo_drop(current);
+		return pink_trace_cont(current->pid, sig, NULL);
+	}
+	/* Helpers stop at their forks and seccomp stops only */
+	if (current->flags & PINK_EASY_PROCESS_HELPER
+			&& !(current->flags & (PINK_EASY_PROCESS_INSYSCALL
+					| PINK_EASY_PROCESS_SECCOMP_ENTRY)))
+		return pink_trace_cont(current->pid, sig, NULL);
+	if (current->flags & PINK_EASY_PROCESS_SECCOMP
+			&& !(current->flags & (PINK_EASY_PROCESS_INSYSCALL
+					| PINK_EASY_PROCESS_SECCOMP_ENTRY)))
+		return pink_trace_cont(current->pid, sig, NULL);
+	return pink_trace_syscall(current->pid, sig);
+}
+
+/* Release the subtree of the process as the callback asked for */
+static void release_tracee(pink_easy_process_t *current, int r)
+{
+	if (r & PINK_EASY_CFLAG_DETACH)
+		pink_easy_process_tree_release(current, PINK_EASY_RELEASE_DETACH);
+	else if (r & PINK_EASY_CFLAG_QUIET)
+		pink_easy_process_tree_release(current, PINK_EASY_RELEASE_QUIET);
+}
+
+/* Flags of the clone() the process is stopped in for a fork event, falls
+ * back to the flags fork() and vfork() imply, and to /proc to tell threads
+ * from processes for PTRACE_EVENT_CLONE. */
+static unsigned long clone_flags(const pink_easy_process_t *current, pid_t pid,
+		unsigned event)
+{
+	long scno, arg, tgid;
+	uint64_t flags;
+	char path[32], line[128];
+	FILE *f;
+
+	if (pink_util_get_syscall(current->pid, current->bitness, &scno)
+			&& pink_util_get_arg(current->pid, current->bitness, 0, &arg)) {
+		if (scno == pink_name_lookup("clone", current->bitness))
+			return (unsigned long)arg;
+#ifdef __NR_clone3
+		/* struct clone_args starts with the flags */
+		if (current->bitness == PINKTRACE_BITNESS_DEFAULT && scno == __NR_clone3
+				&& pink_util_moven(current->pid, arg, (char *)&flags, sizeof(flags)))
+			return (unsigned long)flags;
+#endif /* __NR_clone3 */
+	}
+
+	if (event == PTRACE_EVENT_FORK)
+		return 0;
+	if (event == PTRACE_EVENT_VFORK)
+		return CLONE_VM | CLONE_VFORK;
+
+	tgid = 0;
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	f = fopen(path, "r");
+	if (f) {
+		while (fgets(line, sizeof(line), f))
+			if (sscanf(line, "Tgid: %ld", &tgid) == 1)
+				break;
+		fclose(f);
+	}
+	if (tgid > 0 && tgid != pid)
+		return CLONE_THREAD | CLONE_SIGHAND | CLONE_VM | CLONE_FS | CLONE_FILES;
+	return 0;
+}
+
+/* Time callbacks for the overhead accounting */
+static inline uint64_t callback_start(const pink_easy_context_t *ctx,
+		const pink_easy_process_t *current, const char *name)
+{
+	PINK_EASY_PROBE(callback_entry, name, current->pid);
+	return ctx->overhead ? pink_easy_clock() : 0;
+}
+
+static inline void callback_end(pink_easy_context_t *ctx,
+		const pink_easy_process_t *current, const char *name,
+		uint64_t start, int r)
+{
+	if (ctx->overhead)
+		ctx->overhead_callback += pink_easy_clock() - start;
+	PINK_EASY_PROBE(callback_return, name, current->pid, r);
+}
+
+/* Evaluate the policy on system call entry.
+ * Returns -1 if the tracee must not be resumed, 1 if the policy resolved the
+ * system call and 0 if the system call is to be traced. */
+static int handle_policy(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	int err;
+	bool listed;
+	pink_easy_policy_action_t action;
+
+	if (!pink_easy_policy_eval(ctx->policy, &ctx->decisions, current->pid, current->bitness,
+				current->scno, &action, &err, &listed)) {
+		handle_ptrace_error(ctx, current, "policy");
+		return -1;
+	}
+	if (!listed && (pink_easy_dispatch_interested(ctx, current->bitness, current->scno, true)
+				|| pink_easy_dispatch_interested(ctx, current->bitness, current->scno, false)
+				|| pink_easy_memo_interested(ctx, current->bitness, current->scno)
+				|| pink_easy_shadow_interested(ctx, current->bitness, current->scno)))
+		action = PINK_EASY_POLICY_TRACE;
+
+	switch (action) {
+	case PINK_EASY_POLICY_ALLOW:
+		if (pink_easy_shadow_interested(ctx, current->bitness, current->scno)) {
+			/* Stop at exit for the shadow tables only */
+			current->flags |= PINK_EASY_PROCESS_RESOLVED;
+			return 1;
+		}
+		if (current->flags & PINK_EASY_PROCESS_SECCOMP && !ctx->stats)
+			current->flags &= ~PINK_EASY_PROCESS_INSYSCALL;
+		else
+			current->flags |= PINK_EASY_PROCESS_RESOLVED;
+		current->scno = -1;
+		return 1;
+	case PINK_EASY_POLICY_DENY:
+		if (!pink_easy_process_deny(current, err)) {
+			handle_ptrace_error(ctx, current, "deny");
+			return -1;
+		}
+		return 1;
+	case PINK_EASY_POLICY_KILL:
+		/* The exit is reported by waitpid() */
+		pink_easy_process_kill(current, SIGKILL);
+		return -1;
+	case PINK_EASY_POLICY_TRACE:
+	default:
+		return 0;
+	}
+}
+
+/* Decide whether the process stops at the exit of the system call it
+ * has just entered, or has just been resolved. */
+static void finish_syscall(const pink_easy_context_t *ctx,
+		pink_easy_process_t *current, bool entering)
+{
+	if (entering && current->flags & PINK_EASY_PROCESS_SECCOMP
+			&& !(current->flags & PINK_EASY_PROCESS_RESOLVED)
+			&& !current->memo_pending
+			&& !ctx->callback_table.syscall
+			&& !ctx->stats
+			&& !pink_easy_dispatch_interested(ctx, current->bitness, current->scno, false)
+			&& !pink_easy_shadow_interested(ctx, current->bitness, current->scno)) {
+		/* Nobody is interested in the exit, skip the stop. */
+		current->flags &= ~PINK_EASY_PROCESS_INSYSCALL;
+		current->scno = -1;
+	}
+	if ((current->flags & (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_RESOLVED | PINK_EASY_PROCESS_DENY))
+			== (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_RESOLVED)
+			&& !ctx->stats
+			&& !pink_easy_shadow_interested(ctx, current->bitness, current->scno)) {
+		/* Resolved at entry, there is nothing left to do on exit. */
+		current->flags &= ~(PINK_EASY_PROCESS_INSYSCALL | PINK_EASY_PROCESS_RESOLVED);
+		current->scno = -1;
+		pink_easy_memo_drop(current);
+	}
+}
+
+/* Resume the processes whose pending decisions are completed */
+void pink_easy_loop_handle_completions(pink_easy_context_t *ctx)
+{
+	bool entering;
+	pink_easy_process_t *current, *next;
+
+	for (current = pink_easy_async_take(ctx); current; current = next) {
+		next = current->completed;
+		if (!(current->flags & PINK_EASY_PROCESS_PARKED))
+			continue;
+		current->flags &= ~PINK_EASY_PROCESS_PARKED;
+		ctx->nparked--;
+		pink_easy_overhead_unpark(ctx, current);
+		if (current->flags & PINK_EASY_PROCESS_GONE) {
+			LIST_REMOVE(current, gone);
+			pink_easy_process_memo_flush(current);
+			free(current->overhead);
+			free(current);
+			continue;
+		}
+
+		entering = current->flags & PINK_EASY_PROCESS_INSYSCALL;
+		switch (current->verdict) {
+		case PINK_EASY_POLICY_KILL:
+			/* The exit is reported by waitpid() */
+			pink_easy_process_kill(current, SIGKILL);
+			continue;
+		case PINK_EASY_POLICY_DENY:
+			if (entering
+				? !pink_easy_process_deny(current, current->verdict_err)
+				: !pink_util_set_return(current->pid, -current->verdict_err)) {
+				handle_ptrace_error(ctx, current, "deny");
+				continue;
+			}
+			break;
+		default:
+			break;
+		}
+
+		finish_syscall(ctx, current, entering);
+		if (!resume_tracee(ctx, current, 0))
+			handle_ptrace_error(ctx, current, "syscall");
+	}
+}
+
 static bool handle_startup(pink_easy_context_t *ctx, pink_easy_process_t *current)
 {
-	/* Set up tracing options */
-	if (!pink_trace_setup(current->pid, ctx->ptrace_options)) {
+	/* Set up tracing options, PTRACE_SEIZE has done it already */
+	if (!(current->flags & PINK_EASY_PROCESS_SEIZED)
+			&& !pink_trace_setup(current->pid, ctx->ptrace_options)) {
 		handle_ptrace_error(ctx, current, "setup");
 		return false;
 	}
@@ -85,209 +325,458 @@ static bool handle_startup(pink_easy_context_t *ctx, pink_easy_process_t *curren
 	return true;
 }
 
-int pink_easy_loop(pink_easy_context_t *ctx)
+/* Handle a status change reported by waitpid().
+ * Returns -1 if the loop is to be aborted and 0 otherwise. */
+static int handle_event(pink_easy_context_t *ctx, pid_t pid, int status)
 {
-	/* Enter the event loop */
-	while (ctx->nprocs != 0) {
-		pid_t pid;
-		int r, status, sig;
-		unsigned event;
-		pink_easy_process_t *current;
+	int r, sig;
+	bool entering;
+	unsigned event;
+	uint64_t start;
+	pink_easy_process_t *current;
 
-		pid = waitpid(-1, &status, __WALL);
-		if (pid < 0) {
-			switch (errno) {
-			case EINTR:
-				continue;
-			case ECHILD:
-				goto cleanup;
-			default:
-				ctx->fatal = true;
-				ctx->error = PINK_EASY_ERROR_WAIT;
-				ctx->callback_table.error(ctx);
-				goto cleanup;
-			}
-		}
+	current = pink_easy_process_list_lookup(&(ctx->process_list), pid);
+	if (ctx->overhead)
+		ctx->overhead_current = current;
+	/* FIXME: pink_event_decide() is broken by design! */
+	event = ((unsigned) status >> 16);
+	PINK_EASY_PROBE(event, pid, status, event);
 
-		current = pink_easy_process_list_lookup(&(ctx->process_list), pid);
-		/* FIXME: pink_event_decide() is broken by design! */
-		event = ((unsigned) status >> 16);
-
-		/* Under Linux, execve changes pid to thread leader's pid,
-		 * and we see this changed pid on EVENT_EXEC and later,
-		 * execve sysexit. Leader "disappears" without exit
-		 * notification. Let user know that, drop leader's tcb,
-		 * and fix up pid in execve thread's tcb.
-		 * Effectively, execve thread's tcb replaces leader's tcb.
-		 *
-		 * BTW, leader is 'stuck undead' (doesn't report WIFEXITED
-		 * on exit syscall) in multithreaded programs exactly
-		 * in order to handle this case.
-		 *
-		 * PTRACE_GETEVENTMSG returns old pid starting from Linux 3.0.
-		 * On 2.6 and earlier, it can return garbage.
-		 */
-		if (event == PTRACE_EVENT_EXEC) {
-			pink_bitness_t old_bitness = current->bitness;
-			pink_easy_process_t *execve_thread = current;
-			long old_pid = 0;
-
-			if (pink_easy_os_release < KERNEL_VERSION(3,0,0))
-				goto dont_switch_procs;
-			if (!pink_trace_geteventmsg(pid, (unsigned long *)&old_pid))
-				goto dont_switch_procs;
-			if (old_pid <= 0 || old_pid == pid)
-				goto dont_switch_procs;
-			execve_thread = pink_easy_process_list_lookup(&(ctx->process_list), old_pid);
-			if (!execve_thread)
-				goto dont_switch_procs;
-
-			/* Drop leader, switch to the thread, reusing leader's pid */
-			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			current = execve_thread;
-			current->pid = pid;
+	/* Under Linux, execve changes pid to thread leader's pid,
+	 * and we see this changed pid on EVENT_EXEC and later,
+	 * execve sysexit. Leader "disappears" without exit
+	 * notification. Let user know that, drop leader's tcb,
+	 * and fix up pid in execve thread's tcb.
+	 * Effectively, execve thread's tcb replaces leader's tcb.
+	 *
+	 * BTW, leader is 'stuck undead' (doesn't report WIFEXITED
+	 * on exit syscall) in multithreaded programs exactly
+	 * in order to handle this case.
+	 *
+	 * PTRACE_GETEVENTMSG returns old pid starting from Linux 3.0.
+	 * On 2.6 and earlier, it can return garbage.
+	 */
+	if (event == PTRACE_EVENT_EXEC) {
+		pink_bitness_t old_bitness = current->bitness;
+		pink_easy_process_t *execve_thread = current;
+		long old_pid = 0;
+
+		if (pink_easy_os_release < KERNEL_VERSION(3,0,0))
+			goto dont_switch_procs;
+		if (!pink_trace_geteventmsg(pid, (unsigned long *)&old_pid))
+			goto dont_switch_procs;
+		if (old_pid <= 0 || old_pid == pid)
+			goto dont_switch_procs;
+		execve_thread = pink_easy_process_list_lookup(&(ctx->process_list), old_pid);
+		if (!execve_thread)
+			goto dont_switch_procs;
+
+		/* Drop leader, switch to the thread, reusing leader's pid */
+		pink_easy_process_replace(current, execve_thread);
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		current = execve_thread;
+		current->pid = pid;
 dont_switch_procs:
-			/* Update bitness */
-			current->bitness = pink_bitness_get(current->pid);
-			if (current->bitness == PINK_BITNESS_UNKNOWN) {
-				handle_ptrace_error(ctx, current, "bitness");
-				continue;
+		pink_easy_process_memo_flush(current);
+		pink_easy_group_exec(current);
+		/* Update bitness */
+		current->bitness = pink_bitness_get(current->pid);
+		if (current->bitness == PINK_BITNESS_UNKNOWN) {
+			handle_ptrace_error(ctx, current, "bitness");
+			return 0;
+		}
+		if (ctx->callback_table.exec) {
+			start = callback_start(ctx, current, "exec");
+			r = ctx->callback_table.exec(ctx, current, old_bitness);
+			callback_end(ctx, current, "exec", start, r);
+			if (r & PINK_EASY_CFLAG_ABORT) {
+				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+				return -1;
 			}
-			if (ctx->callback_table.exec) {
-				r = ctx->callback_table.exec(ctx, current, old_bitness);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-					goto cleanup;
-				}
-				if (r & PINK_EASY_CFLAG_DROP) {
-					PINK_EASY_REMOVE_PROCESS(ctx, current);
-					continue;
-				}
+			if (r & PINK_EASY_CFLAG_DROP) {
+				PINK_EASY_REMOVE_PROCESS(ctx, current);
+				return 0;
 			}
+			release_tracee(current, r);
 		}
+	}
 
-		if (current == NULL) {
-			/* We might see the child's initial trap before we see the parent
-			 * return from the clone syscall. Leave the child suspended until
-			 * the parent returns from its system call. Only then we will have
-			 * the association between parent and child.
-			 */
-			PINK_EASY_INSERT_PROCESS(ctx, current);
-			current->pid = pid;
-			current->flags = PINK_EASY_PROCESS_STARTUP;
-			continue;
-		}
+	if (current == NULL) {
+		/* We might see the child's initial trap before we see the parent
+		 * return from the clone syscall. Leave the child suspended until
+		 * the parent returns from its system call. Only then we will have
+		 * the association between parent and child.
+		 */
+		PINK_EASY_INSERT_PROCESS(ctx, current, pid);
+		current->tgid = pid;
+		current->flags = PINK_EASY_PROCESS_STARTUP;
+		return 0;
+	}
 
-		if (WIFSIGNALED(status) || WIFEXITED(status)) {
-			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			if (ctx->callback_table.exit) {
-				r = ctx->callback_table.exit(ctx, pid, status);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-					goto cleanup;
-				}
+	if (WIFSIGNALED(status) || WIFEXITED(status)) {
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		if (ctx->callback_table.exit) {
+			r = ctx->callback_table.exit(ctx, pid, status);
+			if (r & PINK_EASY_CFLAG_ABORT) {
+				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+				return -1;
 			}
-			continue;
 		}
-		if (!WIFSTOPPED(status)) {
-			ctx->callback_table.error(ctx, PINK_EASY_ERROR_PROCESS, current, "WIFSTOPPED");
+		return 0;
+	}
+	if (!WIFSTOPPED(status)) {
+		ctx->callback_table.error(ctx, PINK_EASY_ERROR_PROCESS, current, "WIFSTOPPED");
+		PINK_EASY_REMOVE_PROCESS(ctx, current);
+		return 0;
+	}
+
+	/* Is this the very first time we see this tracee stopped? */
+	if (current->flags & PINK_EASY_PROCESS_STARTUP && !handle_startup(ctx, current))
+		return 0;
+
+	if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
+		pink_easy_process_t *new_thread;
+		long new_pid;
+		unsigned long flags;
+		if (!pink_trace_geteventmsg(current->pid, (unsigned long *)&new_pid)) {
+			handle_ptrace_error(ctx, current, "geteventmsg");
+			return 0;
+		}
+		flags = clone_flags(current, new_pid, event);
+		new_thread = pink_easy_process_list_lookup(&(ctx->process_list), new_pid);
+		if (new_thread == NULL && ctx->session && pink_easy_session_claim(ctx->session, new_pid)) {
+			/* The session saw the thread stop before we did */
+			PINK_EASY_INSERT_PROCESS(ctx, new_thread, new_pid);
+			if (new_thread == NULL)
+				return 0;
+			new_thread->flags = PINK_EASY_PROCESS_STARTUP;
+		}
+		if (new_thread == NULL) {
+			/* Not attached to the thread yet, nor is it alive... */
+			PINK_EASY_INSERT_PROCESS(ctx, new_thread, new_pid);
+			if (new_thread == NULL)
+				return 0;
+			new_thread->flags = PINK_EASY_PROCESS_STARTUP;
+			/* Seized children start with PTRACE_EVENT_STOP */
+			if (!(current->flags & PINK_EASY_PROCESS_SEIZED))
+				new_thread->flags |= PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+			new_thread->flags |= current->flags & (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_SEIZED | PINK_EASY_PROCESS_DETACH
+					| PINK_EASY_PROCESS_QUIET);
+			new_thread->ppid = current->pid;
+			pink_easy_process_link(new_thread, current,
+					flags & CLONE_THREAD ? current->tgid : new_pid, flags);
+			if (current->launcher)
+				new_thread->userdata = pink_easy_launcher_take(current->launcher);
+		} else {
+			/* Thread is waiting for Pink to let her go on... */
+			new_thread->ppid = current->pid;
+			new_thread->bitness = current->bitness;
+			new_thread->flags &= ~PINK_EASY_PROCESS_STARTUP;
+			new_thread->flags |= current->flags & (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_SEIZED | PINK_EASY_PROCESS_DETACH
+					| PINK_EASY_PROCESS_QUIET);
+			pink_easy_process_link(new_thread, current,
+					flags & CLONE_THREAD ? current->tgid : new_pid, flags);
+			if (current->launcher)
+				new_thread->userdata = pink_easy_launcher_take(current->launcher);
+			/* Happy birthday! */
+			if (ctx->callback_table.startup)
+				ctx->callback_table.startup(ctx, new_thread, current);
+			if (!resume_tracee(ctx, new_thread, 0))
+				handle_ptrace_error(ctx, current, "syscall");
+		}
+	} else if (event == PTRACE_EVENT_EXIT && ctx->callback_table.pre_exit) {
+		unsigned long status;
+		if (!pink_trace_geteventmsg(current->pid, &status)) {
+			handle_ptrace_error(ctx, current, "geteventmsg");
+			return 0;
+		}
+		start = callback_start(ctx, current, "pre_exit");
+		r = ctx->callback_table.pre_exit(ctx, current, (int)status);
+		callback_end(ctx, current, "pre_exit", start, r);
+		if (r & PINK_EASY_CFLAG_ABORT) {
+			ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+			return -1;
+		}
+		if (r & PINK_EASY_CFLAG_DROP) {
 			PINK_EASY_REMOVE_PROCESS(ctx, current);
-			continue;
+			return 0;
 		}
+		release_tracee(current, r);
+	}
 
-		/* Is this the very first time we see this tracee stopped? */
-		if (current->flags & PINK_EASY_PROCESS_STARTUP && !handle_startup(ctx, current))
-			continue;
+	sig = WSTOPSIG(status);
 
-		if (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK || event == PTRACE_EVENT_CLONE) {
-			pink_easy_process_t *new_thread;
-			long new_pid;
-			if (!pink_trace_geteventmsg(current->pid, (unsigned long *)&new_pid)) {
-				handle_ptrace_error(ctx, current, "geteventmsg");
-				continue;
-			}
-			new_thread = pink_easy_process_list_lookup(&(ctx->process_list), new_pid);
-			if (new_thread == NULL) {
-				/* Not attached to the thread yet, nor is it alive... */
-				PINK_EASY_INSERT_PROCESS(ctx, new_thread);
-				new_thread->pid = pid;
-				new_thread->flags = (PINK_EASY_PROCESS_STARTUP | PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP);
-				new_thread->ppid = current->pid;
-			} else {
-				/* Thread is waiting for Pink to let her go on... */
-				new_thread->ppid = current->pid;
-				new_thread->bitness = current->bitness;
-				new_thread->flags &= ~PINK_EASY_PROCESS_STARTUP;
-				/* Happy birthday! */
-				if (ctx->callback_table.startup)
-					ctx->callback_table.startup(ctx, new_thread, current);
-				if (!pink_trace_syscall(new_thread->pid, 0))
-					handle_ptrace_error(ctx, current, "syscall");
+	if (event == PTRACE_EVENT_SECCOMP && current->flags & PINK_EASY_PROCESS_QUIET)
+		goto restart_tracee_with_sig_0;
+	if (event == PTRACE_EVENT_SECCOMP && current->flags & PINK_EASY_PROCESS_SECCOMP) {
+		if (pink_easy_os_release < KERNEL_VERSION(4,8,0)) {
+			/* The system call entry stop follows the seccomp stop,
+			 * handle the system call there. */
+			current->flags |= PINK_EASY_PROCESS_SECCOMP_ENTRY;
+			goto restart_tracee_with_sig_0;
+		}
+		current->flags |= PINK_EASY_PROCESS_INSYSCALL;
+		entering = true;
+		goto syscall_trap;
+	}
+
+	if (event == PTRACE_EVENT_STOP && current->flags & PINK_EASY_PROCESS_SEIZED) {
+		/* Group-stop: keep the tracee stopped until SIGCONT */
+		if (!(current->flags & PINK_EASY_PROCESS_DETACH) && (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU)) {
+			if (!pink_trace_listen(current->pid))
+				handle_ptrace_error(ctx, current, "listen");
+			return 0;
+		}
+		/* Otherwise it's the startup stop or a PTRACE_INTERRUPT */
+		goto restart_tracee_with_sig_0;
+	}
+
+	if (event != 0) /* Ptrace event */
+		goto restart_tracee_with_sig_0;
+
+	/* Is this post-attach SIGSTOP? */
+	if (sig == SIGSTOP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP)) {
+		current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
+		goto restart_tracee_with_sig_0;
+	}
+	/* Is this the SIGTRAP after execve() of a vfork()'ed child? */
+	if (sig == SIGTRAP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP)) {
+		current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGTRAP;
+		/* Options weren't set yet, report it as the exec event */
+		if (ctx->ptrace_options & PINK_TRACE_OPTION_EXEC && ctx->callback_table.exec) {
+			start = callback_start(ctx, current, "exec");
+			r = ctx->callback_table.exec(ctx, current, PINKTRACE_BITNESS_DEFAULT);
+			callback_end(ctx, current, "exec", start, r);
+			if (r & PINK_EASY_CFLAG_ABORT) {
+				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+				return -1;
 			}
-		} else if (event == PTRACE_EVENT_EXIT && ctx->callback_table.pre_exit) {
-			unsigned long status;
-			if (!pink_trace_geteventmsg(current->pid, &status)) {
-				handle_ptrace_error(ctx, current, "geteventmsg");
-				continue;
+			if (r & PINK_EASY_CFLAG_DROP) {
+				PINK_EASY_REMOVE_PROCESS(ctx, current);
+				return 0;
 			}
-			r = ctx->callback_table.pre_exit(ctx, current, (int)status);
+			release_tracee(current, r);
+		}
+		goto restart_tracee_with_sig_0;
+	}
+	if (sig != (SIGTRAP|0x80)) {
+		if (ctx->callback_table.signal) {
+			start = callback_start(ctx, current, "signal");
+			r = ctx->callback_table.signal(ctx, current, status);
+			callback_end(ctx, current, "signal", start, r);
 			if (r & PINK_EASY_CFLAG_ABORT) {
 				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-				goto cleanup;
+				return -1;
 			}
 			if (r & PINK_EASY_CFLAG_DROP) {
 				PINK_EASY_REMOVE_PROCESS(ctx, current);
-				continue;
+				return 0;
 			}
+			release_tracee(current, r);
+			if (r & PINK_EASY_CFLAG_SIGIGN)
+				goto restart_tracee_with_sig_0;
 		}
+		goto restart_tracee;
+	}
 
-		sig = WSTOPSIG(status);
+	/* System call trap! */
+	current->flags &= ~PINK_EASY_PROCESS_SECCOMP_ENTRY;
+	current->flags ^= PINK_EASY_PROCESS_INSYSCALL;
+	entering = current->flags & PINK_EASY_PROCESS_INSYSCALL;
+syscall_trap:
+	if (ctx->overhead || ctx->monitor) {
+		ctx->overhead_stop = entering ? PINK_EASY_STOP_SYSCALL_ENTRY : PINK_EASY_STOP_SYSCALL_EXIT;
+		if (!entering) {
+			ctx->overhead_scno = current->stats_scno;
+			ctx->overhead_bitness = current->stats_bitness;
+		}
+	}
+	if (!entering && current->stats_scno >= 0)
+		pink_easy_stats_leave(ctx, current);
+	if (!entering && current->flags & PINK_EASY_PROCESS_RESOLVED) {
+		if (current->flags & PINK_EASY_PROCESS_DENY
+				&& !pink_util_set_return(current->pid, current->retval)) {
+			handle_ptrace_error(ctx, current, "set_return");
+			return 0;
+		}
+		if (!(current->flags & PINK_EASY_PROCESS_DENY) && current->scno >= 0)
+			pink_easy_shadow_leave(ctx, current);
+		current->flags &= ~(PINK_EASY_PROCESS_RESOLVED | PINK_EASY_PROCESS_DENY);
+		current->scno = -1;
+		pink_easy_memo_drop(current);
+		goto restart_tracee_with_sig_0;
+	}
+	/* A stop which was due before the process was released */
+	if (current->flags & (PINK_EASY_PROCESS_DETACH | PINK_EASY_PROCESS_QUIET))
+		goto restart_tracee_with_sig_0;
+	if (entering && (ctx->policy || pink_easy_dispatch_any(ctx) || pink_easy_memo_any(ctx) || ctx->shadow
+				|| ctx->stats || ctx->monitor)) {
+		/* The number is remembered until exit. */
+		if (!pink_util_get_syscall(current->pid, current->bitness, &current->scno)) {
+			handle_ptrace_error(ctx, current, "get_syscall");
+			return 0;
+		}
+		if (ctx->stats)
+			pink_easy_stats_enter(ctx, current);
+		if (ctx->overhead || ctx->monitor) {
+			ctx->overhead_scno = current->scno;
+			ctx->overhead_bitness = current->bitness;
+		}
+	}
+	if (entering && ctx->policy) {
+		r = handle_policy(ctx, current);
+		if (r < 0)
+			return 0;
+		if (r > 0)
+			goto syscall_resolved;
+	}
+	if (entering && pink_easy_memo_any(ctx)) {
+		r = pink_easy_memo_enter(ctx, current);
+		if (r < 0) {
+			handle_ptrace_error(ctx, current, "memo");
+			return 0;
+		}
+		if (r > 0)
+			goto syscall_resolved;
+	}
+	if (!entering && current->memo_pending)
+		pink_easy_memo_leave(current);
+	if (!entering && current->scno >= 0 && ctx->shadow)
+		pink_easy_shadow_leave(ctx, current);
+	if (current->scno >= 0) {
+		start = callback_start(ctx, current, "dispatch");
+		r = pink_easy_dispatch_call(ctx, current, entering);
+		callback_end(ctx, current, "dispatch", start, r);
+		if (r & PINK_EASY_CFLAG_ABORT) {
+			ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+			return -1;
+		}
+		if (r & PINK_EASY_CFLAG_PENDING)
+			pink_easy_async_park(ctx, current);
+		if (r & PINK_EASY_CFLAG_DROP) {
+			PINK_EASY_REMOVE_PROCESS(ctx, current);
+			return 0;
+		}
+		release_tracee(current, r);
+		if (!entering)
+			current->scno = -1;
+	}
+	if (ctx->callback_table.syscall
+			&& !(entering && current->flags & PINK_EASY_PROCESS_RESOLVED)) {
+		start = callback_start(ctx, current, "syscall");
+		r = ctx->callback_table.syscall(ctx, current, entering);
+		callback_end(ctx, current, "syscall", start, r);
+		if (r & PINK_EASY_CFLAG_ABORT) {
+			ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+			return -1;
+		}
+		if (r & PINK_EASY_CFLAG_PENDING)
+			pink_easy_async_park(ctx, current);
+		if (r & PINK_EASY_CFLAG_DROP) {
+			PINK_EASY_REMOVE_PROCESS(ctx, current);
+			return 0;
+		}
+		release_tracee(current, r);
+	}
+	if (current->flags & PINK_EASY_PROCESS_PARKED)
+		return 0;
+syscall_resolved:
+	finish_syscall(ctx, current, entering);
 
-		if (event != 0) /* Ptrace event */
-			goto restart_tracee_with_sig_0;
+restart_tracee_with_sig_0:
+	sig = 0;
+restart_tracee:
+	if (!resume_tracee(ctx, current, sig))
+		handle_ptrace_error(ctx, current, "syscall");
+	return 0;
+}
 
-		/* Is this post-attach SIGSTOP? */
-		if (sig == SIGSTOP && (current->flags & PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP)) {
-			current->flags &= ~PINK_EASY_PROCESS_IGNORE_ONE_SIGSTOP;
-			goto restart_tracee_with_sig_0;
-		}
-		if (sig != (SIGTRAP|0x80)) {
-			if (ctx->callback_table.signal) {
-				r = ctx->callback_table.signal(ctx, current, status);
-				if (r & PINK_EASY_CFLAG_ABORT) {
-					ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
+int pink_easy_loop_handle_event(pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	int r;
+	bool overhead;
+	uint64_t start, elapsed;
+	pink_trace_account_t account, *saved;
+
+	if (!ctx->overhead && !ctx->monitor)
+		return handle_event(ctx, pid, status);
+	if (!WIFSTOPPED(status)) {
+		r = handle_event(ctx, pid, status);
+		if (ctx->monitor)
+			pink_easy_monitor_update(ctx, false, 0);
+		return r;
+	}
+
+	/* The kind of stop is refined for system call stops */
+	ctx->overhead_current = NULL;
+	ctx->overhead_callback = 0;
+	ctx->overhead_scno = -1;
+	if ((unsigned)status >> 16)
+		ctx->overhead_stop = PINK_EASY_STOP_EVENT;
+	else if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+		ctx->overhead_stop = PINK_EASY_STOP_SYSCALL_ENTRY;
+	else
+		ctx->overhead_stop = PINK_EASY_STOP_SIGNAL;
+
+	overhead = ctx->overhead;
+	if (overhead) {
+		memset(&account, 0, sizeof(account));
+		saved = pink_trace_get_account();
+		pink_trace_set_account(&account);
+	}
+	start = pink_easy_clock();
+	r = handle_event(ctx, pid, status);
+	elapsed = pink_easy_clock() - start;
+	if (overhead) {
+		pink_easy_overhead_account(ctx, elapsed, &account);
+		pink_trace_set_account(saved);
+	}
+	if (ctx->monitor)
+		pink_easy_monitor_update(ctx, true, elapsed);
+	return r;
+}
+
+int pink_easy_loop(pink_easy_context_t *ctx)
+{
+	/* Enter the event loop */
+	while (ctx->nprocs != 0 || ctx->nparked != 0) {
+		pid_t pid;
+		int status;
+
+		if (ctx->nparked) {
+			/* Don't block in waitpid(), completions must be served too */
+			pink_easy_loop_handle_completions(ctx);
+			if (!ctx->nparked)
+				continue;
+			pid = pink_easy_waitpid(&status, WNOHANG, ctx->overhead ? &ctx->overhead_wait : NULL);
+			if (pid == 0 || (pid < 0 && errno == ECHILD)) {
+				if (!pink_easy_async_wait(ctx, -1)) {
+					ctx->fatal = true;
+					ctx->error = PINK_EASY_ERROR_WAIT;
+					ctx->callback_table.error(ctx);
 					goto cleanup;
 				}
-				if (r & PINK_EASY_CFLAG_DROP) {
-					PINK_EASY_REMOVE_PROCESS(ctx, current);
-					continue;
-				}
-				if (r & PINK_EASY_CFLAG_SIGIGN)
-					goto restart_tracee_with_sig_0;
+				continue;
 			}
-			goto restart_tracee;
+		} else {
+			pid = pink_easy_waitpid(&status, 0, ctx->overhead ? &ctx->overhead_wait : NULL);
 		}
-
-		/* System call trap! */
-		current->flags ^= PINK_EASY_PROCESS_INSYSCALL;
-		if (ctx->callback_table.syscall) {
-			bool entering = current->flags & PINK_EASY_PROCESS_INSYSCALL;
-			r = ctx->callback_table.syscall(ctx, current, entering);
-			if (r & PINK_EASY_CFLAG_ABORT) {
-				ctx->error = PINK_EASY_ERROR_CALLBACK_ABORT;
-				goto cleanup;
-			}
-			if (r & PINK_EASY_CFLAG_DROP) {
-				PINK_EASY_REMOVE_PROCESS(ctx, current);
+		if (pid < 0) {
+			switch (errno) {
+			case EINTR:
 				continue;
+			case ECHILD:
+				goto cleanup;
+			default:
+				ctx->fatal = true;
+				ctx->error = PINK_EASY_ERROR_WAIT;
+				ctx->callback_table.error(ctx);
+				goto cleanup;
 			}
 		}
 
-restart_tracee_with_sig_0:
-		sig = 0;
-restart_tracee:
-		if (!pink_trace_syscall(current->pid, sig))
-			handle_ptrace_error(ctx, current, "syscall");
+		if (pink_easy_loop_handle_event(ctx, pid, status) < 0)
+			goto cleanup;
 	}
 
 cleanup:
@@ -295,3 +784,56 @@ cleanup:
 		? ctx->callback_table.cleanup(ctx)
 		: (ctx->error ? EXIT_FAILURE : EXIT_SUCCESS);
 }
+
+bool pink_easy_loop_dispatch_ready(pink_easy_context_t *ctx)
+{
+	pid_t pid;
+	int status;
+
+	for (;;) {
+		/* Drains the wakeup pipe before waitpid(), so that stops after
+		 * this point make the file descriptor readable again. */
+		pink_easy_loop_handle_completions(ctx);
+		if (ctx->nprocs == 0 && ctx->nparked == 0)
+			break;
+
+		pid = pink_easy_waitpid(&status, WNOHANG, ctx->overhead ? &ctx->overhead_wait : NULL);
+		if (pid == 0)
+			return true;
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ECHILD) {
+				if (ctx->nparked)
+					return true;
+				break;
+			}
+			ctx->fatal = true;
+			ctx->error = PINK_EASY_ERROR_WAIT;
+			ctx->callback_table.error(ctx);
+			break;
+		}
+		if (pink_easy_loop_handle_event(ctx, pid, status) < 0)
+			break;
+	}
+
+	if (ctx->callback_table.cleanup)
+		ctx->callback_table.cleanup(ctx);
+	return false;
+}
+
+bool pink_easy_loop_step(pink_easy_context_t *ctx, int timeout)
+{
+	/* Without the SIGCHLD handler, waiting falls back to polling */
+	pink_easy_loop_get_fd(ctx);
+
+	if (!pink_easy_async_wait(ctx, timeout)) {
+		ctx->fatal = true;
+		ctx->error = PINK_EASY_ERROR_WAIT;
+		ctx->callback_table.error(ctx);
+		if (ctx->callback_table.cleanup)
+			ctx->callback_table.cleanup(ctx);
+		return false;
+	}
+	return pink_easy_loop_dispatch_ready(ctx);
+}
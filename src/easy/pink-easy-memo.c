@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* System calls changing the credentials of the calling process */
+static const char *const memo_flush_names[] = {
+	"setuid", "setgid", "setreuid", "setregid",
+	"setresuid", "setresgid", "setfsuid", "setfsgid",
+	"setuid32", "setgid32", "setreuid32", "setregid32",
+	"setresuid32", "setresgid32", "setfsuid32", "setfsgid32",
+	"setgroups", "setgroups32", "capset",
+	NULL,
+};
+
+static bool memo_grow(struct pink_easy_memo *m, long scno)
+{
+	long nr, old_words, new_words;
+	struct pink_easy_memo_spec *table;
+	unsigned long *mask, *flush;
+
+	if (scno < m->nr)
+		return true;
+
+	/* Round up to a full mask word so the masks and the table stay in sync */
+	nr = (scno / PINK_EASY_MASK_BITS + 1) * PINK_EASY_MASK_BITS;
+	old_words = m->nr / PINK_EASY_MASK_BITS;
+	new_words = nr / PINK_EASY_MASK_BITS;
+
+	table = realloc(m->table, nr * sizeof(struct pink_easy_memo_spec));
+	if (!table)
+		return false;
+	memset(table + m->nr, 0, (nr - m->nr) * sizeof(struct pink_easy_memo_spec));
+	m->table = table;
+
+	mask = realloc(m->mask, new_words * sizeof(unsigned long));
+	if (!mask)
+		return false;
+	memset(mask + old_words, 0, (new_words - old_words) * sizeof(unsigned long));
+	m->mask = mask;
+
+	flush = realloc(m->flush, new_words * sizeof(unsigned long));
+	if (!flush)
+		return false;
+	memset(flush + old_words, 0, (new_words - old_words) * sizeof(unsigned long));
+	m->flush = flush;
+
+	m->nr = nr;
+	return true;
+}
+
+static bool memo_init_flush(struct pink_easy_memo *m, pink_bitness_t bitness)
+{
+	for (unsigned i = 0; memo_flush_names[i]; i++) {
+		long scno = pink_name_lookup(memo_flush_names[i], bitness);
+		if (scno < 0 || scno >= PINK_EASY_SYSCALL_MAX)
+			continue;
+		if (!memo_grow(m, scno))
+			return false;
+		m->flush[scno / PINK_EASY_MASK_BITS] |= (1UL << (scno % PINK_EASY_MASK_BITS));
+	}
+	return true;
+}
+
+bool pink_easy_memo_set(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, int keyarg, int outarg, size_t outsize)
+{
+	struct pink_easy_memo *m;
+
+	if ((bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+			|| scno < 0 || scno >= PINK_EASY_SYSCALL_MAX
+			|| keyarg < -1 || keyarg >= PINK_MAX_ARGS
+			|| outarg < -1 || outarg >= PINK_MAX_ARGS
+			|| (outarg >= 0 && (outarg == keyarg || outsize > PINK_EASY_MEMO_OUT_MAX))) {
+		errno = EINVAL;
+		return false;
+	}
+
+	m = &ctx->memo[bitness];
+	if ((!m->count && !memo_init_flush(m, bitness)) || !memo_grow(m, scno)) {
+		errno = ENOMEM;
+		return false;
+	}
+	if (pink_easy_mask_test(m->flush, m->nr, scno)) {
+		errno = EINVAL;
+		return false;
+	}
+
+	if (!pink_easy_mask_test(m->mask, m->nr, scno)) {
+		m->mask[scno / PINK_EASY_MASK_BITS] |= (1UL << (scno % PINK_EASY_MASK_BITS));
+		m->count++;
+	}
+	m->table[scno].keyarg = keyarg;
+	m->table[scno].outarg = outarg;
+	m->table[scno].outsize = outarg >= 0 ? outsize : 0;
+	return true;
+}
+
+bool pink_easy_memo_set_name(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		const char *name, int keyarg, int outarg, size_t outsize)
+{
+	long scno;
+
+	scno = pink_name_lookup(name, bitness);
+	if (scno < 0) {
+		errno = ENOENT;
+		return false;
+	}
+
+	return pink_easy_memo_set(ctx, bitness, scno, keyarg, outarg, outsize);
+}
+
+void pink_easy_memo_clear(pink_easy_context_t *ctx, pink_bitness_t bitness)
+{
+	struct pink_easy_memo *m;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return;
+
+	m = &ctx->memo[bitness];
+	free(m->table);
+	free(m->mask);
+	free(m->flush);
+	memset(m, 0, sizeof(struct pink_easy_memo));
+}
+
+void pink_easy_process_memo_flush(pink_easy_process_t *proc)
+{
+	struct pink_easy_memo_entry *e, *next;
+
+	for (e = proc->memo; e; e = next) {
+		next = e->next;
+		free(e);
+	}
+	proc->memo = NULL;
+	proc->nmemo = 0;
+	pink_easy_memo_drop(proc);
+}
+
+bool pink_easy_memo_any(const pink_easy_context_t *ctx)
+{
+	return ctx->memo[PINK_BITNESS_32].count || ctx->memo[PINK_BITNESS_64].count;
+}
+
+bool pink_easy_memo_interested(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, long scno)
+{
+	const struct pink_easy_memo *m;
+
+	if (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+		return false;
+
+	m = &ctx->memo[bitness];
+	return m->count && (pink_easy_mask_test(m->mask, m->nr, scno)
+			|| pink_easy_mask_test(m->flush, m->nr, scno));
+}
+
+int pink_easy_memo_enter(const pink_easy_context_t *ctx,
+		pink_easy_process_t *current)
+{
+	long key, addr;
+	const struct pink_easy_memo *m;
+	const struct pink_easy_memo_spec *spec;
+	struct pink_easy_memo_entry *e, *prev;
+
+	if (current->bitness != PINK_BITNESS_32 && current->bitness != PINK_BITNESS_64)
+		return 0;
+
+	m = &ctx->memo[current->bitness];
+	if (!m->count)
+		return 0;
+	if (pink_easy_mask_test(m->flush, m->nr, current->scno)) {
+		pink_easy_process_memo_flush(current);
+		return 0;
+	}
+	if (!pink_easy_mask_test(m->mask, m->nr, current->scno))
+		return 0;
+
+	key = addr = 0;
+	spec = &m->table[current->scno];
+	if (spec->keyarg >= 0 && !pink_util_get_arg(current->pid, current->bitness, spec->keyarg, &key))
+		return -1;
+	if (spec->outarg >= 0 && !pink_util_get_arg(current->pid, current->bitness, spec->outarg, &addr))
+		return -1;
+
+	for (prev = NULL, e = current->memo; e; prev = e, e = e->next) {
+		if (e->bitness == current->bitness && e->scno == current->scno && e->key == key)
+			break;
+	}
+
+	if (e) {
+		/* Let the system call itself fail on a bad output argument */
+		if (e->size && !pink_easy_process_vm_writev(current->pid, addr, e->out, e->size))
+			return 0;
+		if (!pink_easy_process_emulate(current, e->retval))
+			return -1;
+		if (prev) {
+			prev->next = e->next;
+			e->next = current->memo;
+			current->memo = e;
+		}
+		return 1;
+	}
+
+	if (current->nmemo >= PINK_EASY_MEMO_PROCESS_MAX)
+		return 0;
+
+	/* Miss, remember the result on exit */
+	pink_easy_memo_drop(current);
+	e = malloc(sizeof(struct pink_easy_memo_entry) + spec->outsize);
+	if (!e)
+		return 0;
+	e->bitness = current->bitness;
+	e->scno = current->scno;
+	e->key = key;
+	e->addr = addr;
+	e->size = spec->outsize;
+	current->memo_pending = e;
+	return 0;
+}
+
+void pink_easy_memo_leave(pink_easy_process_t *current)
+{
+	struct pink_easy_memo_entry *e;
+
+	e = current->memo_pending;
+	current->memo_pending = NULL;
+
+	if (!pink_util_get_return(current->pid, &e->retval)
+			|| (e->retval < 0 && e->retval > -4096) /* Failed system calls aren't cached */
+			|| (e->size && !pink_easy_process_vm_readv(current->pid, e->addr, e->out, e->size))) {
+		free(e);
+		return;
+	}
+
+	e->next = current->memo;
+	current->memo = e;
+	current->nmemo++;
+}
+
+void pink_easy_memo_drop(pink_easy_process_t *current)
+{
+	free(current->memo_pending);
+	current->memo_pending = NULL;
+}
+
+void pink_easy_memo_free(pink_easy_context_t *ctx)
+{
+	pink_easy_memo_clear(ctx, PINK_BITNESS_32);
+	pink_easy_memo_clear(ctx, PINK_BITNESS_64);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif /* HAVE_MALLINFO2 */
+
+/* Heap usage is expensive to gather, it is updated this often */
+#define MONITOR_MEMORY_INTERVAL	1024
+/* Readers give up after so many torn reads */
+#define MONITOR_READ_TRIES	10000
+
+bool pink_easy_context_set_monitor(pink_easy_context_t *ctx, const char *path)
+{
+	int fd, save_errno;
+	void *map;
+	pink_easy_monitor_segment_t *segment;
+
+	if (ctx->monitor) {
+		munmap(ctx->monitor, sizeof(pink_easy_monitor_segment_t));
+		ctx->monitor = NULL;
+	}
+	if (!path)
+		return true;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, sizeof(pink_easy_monitor_segment_t)) < 0)
+		goto fail;
+	map = mmap(NULL, sizeof(pink_easy_monitor_segment_t), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		goto fail;
+	close(fd);
+
+	segment = map;
+	memcpy(segment->magic, PINK_EASY_MONITOR_MAGIC, sizeof(PINK_EASY_MONITOR_MAGIC));
+	segment->version = PINK_EASY_MONITOR_VERSION;
+	segment->size = sizeof(pink_easy_monitor_segment_t);
+	segment->tracer = getpid();
+	segment->tracees = ctx->nprocs;
+	segment->start = segment->time = pink_easy_clock();
+	ctx->monitor = segment;
+	ctx->monitor_updates = 0;
+	return true;
+
+fail:
+	save_errno = errno;
+	close(fd);
+	errno = save_errno;
+	return false;
+}
+
+void pink_easy_monitor_update(pink_easy_context_t *ctx, bool stopped, uint64_t elapsed)
+{
+	uint64_t seq;
+	pink_easy_monitor_segment_t *segment = ctx->monitor;
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 mi;
+#endif /* HAVE_MALLINFO2 */
+
+	seq = segment->seq;
+	__atomic_store_n(&segment->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	segment->tracees = ctx->nprocs;
+	segment->time = pink_easy_clock();
+	if (stopped) {
+		segment->stops[ctx->overhead_stop]++;
+		segment->stop_buckets[pink_easy_stats_bucket(elapsed)]++;
+		if (ctx->overhead_stop == PINK_EASY_STOP_SYSCALL_ENTRY
+				&& ctx->overhead_scno >= 0
+				&& ctx->overhead_scno < PINK_EASY_MONITOR_SYSCALLS
+				&& (ctx->overhead_bitness == PINK_BITNESS_32
+					|| ctx->overhead_bitness == PINK_BITNESS_64))
+			segment->syscalls[ctx->overhead_bitness][ctx->overhead_scno]++;
+	}
+#ifdef HAVE_MALLINFO2
+	if (ctx->monitor_updates++ % MONITOR_MEMORY_INTERVAL == 0) {
+		mi = mallinfo2();
+		segment->memory = mi.uordblks + mi.hblkhd;
+	}
+#endif /* HAVE_MALLINFO2 */
+
+	__atomic_store_n(&segment->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+pink_easy_monitor_t *pink_easy_monitor_open(const char *path)
+{
+	int fd, save_errno;
+	void *map;
+	struct stat st;
+	const pink_easy_monitor_segment_t *segment;
+	pink_easy_monitor_t *monitor;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0) {
+		save_errno = errno;
+		close(fd);
+		errno = save_errno;
+		return NULL;
+	}
+	if ((size_t)st.st_size < sizeof(pink_easy_monitor_segment_t)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+	map = mmap(NULL, sizeof(pink_easy_monitor_segment_t), PROT_READ, MAP_SHARED, fd, 0);
+	save_errno = errno;
+	close(fd);
+	if (map == MAP_FAILED) {
+		errno = save_errno;
+		return NULL;
+	}
+
+	segment = map;
+	if (memcmp(segment->magic, PINK_EASY_MONITOR_MAGIC, sizeof(PINK_EASY_MONITOR_MAGIC))
+			|| segment->version != PINK_EASY_MONITOR_VERSION
+			|| segment->size != sizeof(pink_easy_monitor_segment_t)) {
+		munmap(map, sizeof(pink_easy_monitor_segment_t));
+		errno = EINVAL;
+		return NULL;
+	}
+
+	monitor = malloc(sizeof(pink_easy_monitor_t));
+	if (!monitor) {
+		save_errno = errno;
+		munmap(map, sizeof(pink_easy_monitor_segment_t));
+		errno = save_errno;
+		return NULL;
+	}
+	monitor->segment = segment;
+	return monitor;
+}
+
+bool pink_easy_monitor_read(const pink_easy_monitor_t *monitor,
+		pink_easy_monitor_segment_t *segment)
+{
+	uint64_t seq;
+
+	for (unsigned i = 0; i < MONITOR_READ_TRIES; i++) {
+		seq = __atomic_load_n(&monitor->segment->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+		memcpy(segment, monitor->segment, sizeof(pink_easy_monitor_segment_t));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&monitor->segment->seq, __ATOMIC_RELAXED) == seq)
+			return true;
+	}
+	errno = EAGAIN;
+	return false;
+}
+
+void pink_easy_monitor_close(pink_easy_monitor_t *monitor)
+{
+	munmap((void *)monitor->segment, sizeof(pink_easy_monitor_segment_t));
+	free(monitor);
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static inline unsigned addr_bit(const unsigned char *addr, unsigned bit)
+{
+	return (addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/* Number of leading bits the addresses share, at most max */
+static unsigned common_bits(const unsigned char *a, const unsigned char *b, unsigned max)
+{
+	unsigned n = 0;
+
+	while (n + 8 <= max && a[n / 8] == b[n / 8])
+		n += 8;
+	while (n < max && addr_bit(a, n) == addr_bit(b, n))
+		n++;
+	return n;
+}
+
+/* Whether the address starts with the prefix of the node */
+static inline bool node_matches(const struct pink_easy_netmatch_node *node,
+		const unsigned char *addr)
+{
+	unsigned bytes = node->bits / 8, rem = node->bits % 8;
+
+	if (memcmp(node->addr, addr, bytes) != 0)
+		return false;
+	if (rem) {
+		unsigned char mask = (unsigned char)(0xff << (8 - rem));
+		return (addr[bytes] & mask) == node->addr[bytes];
+	}
+	return true;
+}
+
+static int node_new(struct pink_easy_netmatch_tree *t, const unsigned char *addr, unsigned bits)
+{
+	struct pink_easy_netmatch_node *node;
+
+	if (t->nnodes == t->nodes_alloc) {
+		unsigned n = t->nodes_alloc ? t->nodes_alloc * 2 : 64;
+		node = realloc(t->nodes, n * sizeof(struct pink_easy_netmatch_node));
+		if (!node)
+			return -1;
+		t->nodes = node;
+		t->nodes_alloc = n;
+	}
+
+	node = &t->nodes[t->nnodes];
+	memset(node->addr, 0, sizeof(node->addr));
+	memcpy(node->addr, addr, (bits + 7) / 8);
+	if (bits % 8)
+		node->addr[bits / 8] &= (unsigned char)(0xff << (8 - bits % 8));
+	node->bits = bits;
+	node->child[0] = node->child[1] = -1;
+	node->first = node->last = -1;
+	return t->nnodes++;
+}
+
+/* Find or insert the node for the prefix */
+static int tree_insert(struct pink_easy_netmatch_tree *t, const unsigned char *addr, unsigned bits)
+{
+	int n, c, m, leaf;
+	unsigned b, common;
+
+	if (!t->nnodes && node_new(t, addr, 0) < 0)
+		return -1;
+
+	n = 0;
+	for (;;) {
+		if (t->nodes[n].bits == bits)
+			return n;
+
+		b = addr_bit(addr, t->nodes[n].bits);
+		c = t->nodes[n].child[b];
+		if (c < 0) {
+			if ((leaf = node_new(t, addr, bits)) < 0)
+				return -1;
+			t->nodes[n].child[b] = leaf;
+			return leaf;
+		}
+
+		common = common_bits(addr, t->nodes[c].addr,
+				bits < t->nodes[c].bits ? bits : t->nodes[c].bits);
+		if (common == t->nodes[c].bits) {
+			n = c;
+			continue;
+		}
+
+		/* Split the edge to the child */
+		if ((m = node_new(t, addr, common)) < 0)
+			return -1;
+		t->nodes[m].child[addr_bit(t->nodes[c].addr, common)] = c;
+		t->nodes[n].child[b] = m;
+		if (common == bits)
+			return m;
+		if ((leaf = node_new(t, addr, bits)) < 0)
+			return -1;
+		t->nodes[m].child[addr_bit(addr, common)] = leaf;
+		return leaf;
+	}
+}
+
+pink_easy_netmatch_t *pink_easy_netmatch_new(void)
+{
+	pink_easy_netmatch_t *nm;
+
+	nm = calloc(1, sizeof(pink_easy_netmatch_t));
+	if (!nm)
+		return NULL;
+
+	nm->inet[0].maxbits = 32;
+	nm->inet[1].maxbits = 128;
+	nm->unix_path = pink_easy_trie_new();
+	nm->unix_abstract = pink_easy_trie_new();
+	if (!nm->unix_path || !nm->unix_abstract) {
+		pink_easy_netmatch_destroy(nm);
+		errno = ENOMEM;
+		return NULL;
+	}
+	return nm;
+}
+
+void pink_easy_netmatch_destroy(pink_easy_netmatch_t *nm)
+{
+	free(nm->inet[0].nodes);
+	free(nm->inet[1].nodes);
+	free(nm->rules);
+	if (nm->unix_path)
+		pink_easy_trie_destroy(nm->unix_path);
+	if (nm->unix_abstract)
+		pink_easy_trie_destroy(nm->unix_abstract);
+	free(nm);
+}
+
+bool pink_easy_netmatch_add_inet(pink_easy_netmatch_t *nm, int family,
+		const void *addr, unsigned prefixlen,
+		unsigned port_lo, unsigned port_hi, int value)
+{
+	int n, r;
+	struct pink_easy_netmatch_tree *t;
+	struct pink_easy_netmatch_rule *rule;
+
+	if (family == AF_INET)
+		t = &nm->inet[0];
+	else if (family == AF_INET6)
+		t = &nm->inet[1];
+	else {
+		errno = EAFNOSUPPORT;
+		return false;
+	}
+	if (prefixlen > t->maxbits || port_lo > port_hi || port_hi > 65535 || value < 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	if (nm->nrules == nm->rules_alloc) {
+		unsigned k = nm->rules_alloc ? nm->rules_alloc * 2 : 64;
+		rule = realloc(nm->rules, k * sizeof(struct pink_easy_netmatch_rule));
+		if (!rule)
+			return false;
+		nm->rules = rule;
+		nm->rules_alloc = k;
+	}
+
+	if ((n = tree_insert(t, addr, prefixlen)) < 0)
+		return false;
+
+	r = nm->nrules++;
+	rule = &nm->rules[r];
+	rule->port_lo = port_lo;
+	rule->port_hi = port_hi;
+	rule->value = value;
+	rule->next = -1;
+	if (t->nodes[n].last >= 0)
+		nm->rules[t->nodes[n].last].next = r;
+	else
+		t->nodes[n].first = r;
+	t->nodes[n].last = r;
+	return true;
+}
+
+bool pink_easy_netmatch_add_unix(pink_easy_netmatch_t *nm, const char *pattern,
+		bool abstract, int value)
+{
+	return pink_easy_trie_add(abstract ? nm->unix_abstract : nm->unix_path, pattern, value);
+}
+
+bool pink_easy_netmatch_compile(pink_easy_netmatch_t *nm)
+{
+	return pink_easy_trie_compile(nm->unix_path)
+		&& pink_easy_trie_compile(nm->unix_abstract);
+}
+
+static int tree_lookup(const pink_easy_netmatch_t *nm,
+		const struct pink_easy_netmatch_tree *t,
+		const unsigned char *addr, unsigned port)
+{
+	int n, value = -1;
+
+	for (n = t->nnodes ? 0 : -1; n >= 0;) {
+		const struct pink_easy_netmatch_node *node = &t->nodes[n];
+
+		if (!node_matches(node, addr))
+			break;
+		for (int r = node->first; r >= 0; r = nm->rules[r].next) {
+			if (port >= nm->rules[r].port_lo && port <= nm->rules[r].port_hi) {
+				value = nm->rules[r].value;
+				break;
+			}
+		}
+		if (node->bits == t->maxbits)
+			break;
+		n = node->child[addr_bit(addr, node->bits)];
+	}
+
+	return value;
+}
+
+static int unix_lookup(const pink_easy_netmatch_t *nm, const pink_socket_address_t *addr)
+{
+	size_t len;
+	const char *path;
+	pink_easy_trie_cursor_t cursor;
+
+	if (addr->length <= offsetof(struct sockaddr_un, sun_path))
+		return -1; /* unnamed */
+
+	len = addr->length - offsetof(struct sockaddr_un, sun_path);
+	if (len > sizeof(addr->u.sa_un.sun_path))
+		len = sizeof(addr->u.sa_un.sun_path);
+	path = addr->u.sa_un.sun_path;
+	if (path[0] == '\0') {
+		/* Abstract names are not zero terminated */
+		pink_easy_trie_cursor_init(nm->unix_abstract, &cursor);
+		pink_easy_trie_feed(&cursor, path + 1, len - 1);
+	} else {
+		pink_easy_trie_cursor_init(nm->unix_path, &cursor);
+		pink_easy_trie_feed(&cursor, path, len);
+	}
+	return pink_easy_trie_finish(&cursor);
+}
+
+int pink_easy_netmatch_lookup(const pink_easy_netmatch_t *nm,
+		const pink_socket_address_t *addr)
+{
+	switch (addr->family) {
+	case AF_INET:
+		return tree_lookup(nm, &nm->inet[0],
+				(const unsigned char *)&addr->u.sa_in.sin_addr,
+				ntohs(addr->u.sa_in.sin_port));
+#if PINK_HAVE_IPV6
+	case AF_INET6:
+		if (IN6_IS_ADDR_V4MAPPED(&addr->u.sa6.sin6_addr))
+			return tree_lookup(nm, &nm->inet[0],
+					(const unsigned char *)&addr->u.sa6.sin6_addr + 12,
+					ntohs(addr->u.sa6.sin6_port));
+		return tree_lookup(nm, &nm->inet[1],
+				(const unsigned char *)&addr->u.sa6.sin6_addr,
+				ntohs(addr->u.sa6.sin6_port));
+#endif
+	case AF_UNIX:
+		return unix_lookup(nm, addr);
+	default:
+		return -1;
+	}
+}
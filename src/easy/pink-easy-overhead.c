@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static void overhead_add_stop(pink_easy_overhead_t *overhead, uint64_t elapsed)
+{
+	overhead->stop_time += elapsed;
+	overhead->buckets[pink_easy_stats_bucket(elapsed)]++;
+}
+
+/* The stop time of parked stops is added once the decision is picked up */
+static void overhead_add(pink_easy_overhead_t *overhead, uint64_t elapsed,
+		uint64_t wait, uint64_t callback, const pink_trace_account_t *account,
+		bool parked)
+{
+	overhead->stops++;
+	overhead->wait_time += wait;
+	overhead->callback_time += callback;
+	overhead->ptrace.regs_calls += account->regs_calls;
+	overhead->ptrace.regs_time += account->regs_time;
+	overhead->ptrace.mem_calls += account->mem_calls;
+	overhead->ptrace.mem_time += account->mem_time;
+	overhead->ptrace.ctl_calls += account->ctl_calls;
+	overhead->ptrace.ctl_time += account->ctl_time;
+	if (!parked)
+		overhead_add_stop(overhead, elapsed);
+}
+
+void pink_easy_overhead_account(pink_easy_context_t *ctx, uint64_t elapsed,
+		const pink_trace_account_t *account)
+{
+	bool parked;
+	pink_easy_process_t *current;
+
+	current = ctx->overhead_current;
+	parked = current && current->flags & PINK_EASY_PROCESS_PARKED;
+
+	overhead_add(&ctx->overhead_total[ctx->overhead_stop], elapsed,
+			ctx->overhead_wait, ctx->overhead_callback, account, parked);
+	if (current) {
+		if (!current->overhead)
+			current->overhead = calloc(PINK_EASY_STOP_MAX, sizeof(pink_easy_overhead_t));
+		if (current->overhead)
+			overhead_add(&current->overhead[ctx->overhead_stop], elapsed,
+					ctx->overhead_wait, ctx->overhead_callback, account, parked);
+	}
+
+	if (parked) {
+		current->overhead_parked = true;
+		current->overhead_park_elapsed = elapsed;
+		current->overhead_park_start = pink_easy_clock();
+		current->overhead_park_stop = ctx->overhead_stop;
+		current->overhead_park_scno = ctx->overhead_scno;
+		current->overhead_park_bitness = ctx->overhead_bitness;
+	} else if (ctx->stats && ctx->overhead_scno >= 0) {
+		pink_easy_stats_stop(ctx, ctx->overhead_bitness, ctx->overhead_scno, elapsed);
+	}
+	ctx->overhead_wait = 0;
+}
+
+void pink_easy_overhead_unpark(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	uint64_t elapsed;
+
+	if (!current->overhead_parked)
+		return;
+	current->overhead_parked = false;
+
+	elapsed = current->overhead_park_elapsed + pink_easy_clock() - current->overhead_park_start;
+	overhead_add_stop(&ctx->overhead_total[current->overhead_park_stop], elapsed);
+	if (current->overhead)
+		overhead_add_stop(&current->overhead[current->overhead_park_stop], elapsed);
+	if (ctx->stats && current->overhead_park_scno >= 0)
+		pink_easy_stats_stop(ctx, current->overhead_park_bitness,
+				current->overhead_park_scno, elapsed);
+}
+
+void pink_easy_context_set_overhead(pink_easy_context_t *ctx, bool on)
+{
+	ctx->overhead = on;
+}
+
+bool pink_easy_context_get_overhead(const pink_easy_context_t *ctx,
+		pink_easy_stop_t stop, pink_easy_overhead_t *overhead)
+{
+	if ((unsigned)stop >= PINK_EASY_STOP_MAX) {
+		errno = EINVAL;
+		return false;
+	}
+	memcpy(overhead, &ctx->overhead_total[stop], sizeof(pink_easy_overhead_t));
+	return true;
+}
+
+bool pink_easy_process_get_overhead(const pink_easy_process_t *proc,
+		pink_easy_stop_t stop, pink_easy_overhead_t *overhead)
+{
+	if ((unsigned)stop >= PINK_EASY_STOP_MAX) {
+		errno = EINVAL;
+		return false;
+	}
+	if (proc->overhead)
+		memcpy(overhead, &proc->overhead[stop], sizeof(pink_easy_overhead_t));
+	else
+		memset(overhead, 0, sizeof(pink_easy_overhead_t));
+	return true;
+}
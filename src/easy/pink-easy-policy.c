@@ -0,0 +1,744 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/* Arguments of the current system call, read at most once per evaluation */
+struct policy_args {
+	pid_t pid;
+	pink_bitness_t bitness;
+
+	unsigned have_arg;
+	long arg[PINK_MAX_ARGS];
+
+	int addr_ind;
+	bool addr_ok;
+	pink_socket_address_t addr;
+
+	/* Paths decoded for the decision cache, NULL if unreadable */
+	unsigned have_path;
+	const char *path[PINK_MAX_ARGS];
+};
+
+static bool check_rule(pink_bitness_t bitness, long scno, unsigned ind,
+		pink_easy_policy_action_t action)
+{
+	if ((bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+			|| scno < 0 || scno >= PINK_EASY_SYSCALL_MAX
+			|| ind >= PINK_MAX_ARGS
+			|| action > PINK_EASY_POLICY_TRACE) {
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+static struct pink_easy_policy_rule *rule_new(pink_easy_policy_t *policy,
+		unsigned kind, pink_bitness_t bitness, long scno, unsigned ind,
+		pink_easy_policy_action_t action, int err)
+{
+	struct pink_easy_policy_rule *r;
+
+	if (!check_rule(bitness, scno, ind, action))
+		return NULL;
+
+	if (policy->nrules == policy->rules_alloc) {
+		unsigned n = policy->rules_alloc ? policy->rules_alloc * 2 : 16;
+		r = realloc(policy->rules, n * sizeof(struct pink_easy_policy_rule));
+		if (!r) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		policy->rules = r;
+		policy->rules_alloc = n;
+	}
+
+	r = &policy->rules[policy->nrules];
+	memset(r, 0, sizeof(struct pink_easy_policy_rule));
+	r->kind = kind;
+	r->action = action;
+	r->err = err;
+	r->bitness = bitness;
+	r->scno = scno;
+	r->ind = ind;
+	return r;
+}
+
+static void policy_free_compiled(pink_easy_policy_t *policy)
+{
+	for (unsigned i = 0; i < policy->npreds; i++) {
+		if (policy->preds[i].trie)
+			pink_easy_trie_destroy(policy->preds[i].trie);
+		if (policy->preds[i].net)
+			pink_easy_netmatch_destroy(policy->preds[i].net);
+	}
+	free(policy->slots[PINK_BITNESS_32]);
+	free(policy->slots[PINK_BITNESS_64]);
+	free(policy->preds);
+	policy->slots[PINK_BITNESS_32] = policy->slots[PINK_BITNESS_64] = NULL;
+	policy->nr[PINK_BITNESS_32] = policy->nr[PINK_BITNESS_64] = 0;
+	policy->preds = NULL;
+	policy->npreds = 0;
+	policy->compiled = false;
+}
+
+pink_easy_policy_t *pink_easy_policy_new(pink_easy_policy_action_t default_action,
+		int default_errno)
+{
+	pink_easy_policy_t *policy;
+
+	if (default_action > PINK_EASY_POLICY_TRACE) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	policy = calloc(1, sizeof(pink_easy_policy_t));
+	if (!policy)
+		return NULL;
+
+	policy->default_action = default_action;
+	policy->default_errno = default_errno;
+	return policy;
+}
+
+void pink_easy_policy_destroy(pink_easy_policy_t *policy)
+{
+	for (unsigned i = 0; i < policy->nrules; i++)
+		free(policy->rules[i].path);
+	free(policy->rules);
+	policy_free_compiled(policy);
+	free(policy);
+}
+
+bool pink_easy_policy_set(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, pink_easy_policy_action_t action, int err)
+{
+	if (!rule_new(policy, PINK_EASY_POLICY_RULE_SYSCALL, bitness, scno, 0, action, err))
+		return false;
+	policy->nrules++;
+	return true;
+}
+
+bool pink_easy_policy_add_int(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, pink_easy_policy_op_t op,
+		long value, long mask,
+		pink_easy_policy_action_t action, int err)
+{
+	struct pink_easy_policy_rule *r;
+
+	if (op > PINK_EASY_POLICY_OP_ANY_SET) {
+		errno = EINVAL;
+		return false;
+	}
+
+	r = rule_new(policy, PINK_EASY_POLICY_RULE_INT, bitness, scno, ind, action, err);
+	if (!r)
+		return false;
+	r->op = op;
+	r->value = value;
+	r->mask = mask;
+	policy->nrules++;
+	return true;
+}
+
+static bool add_prefix(pink_easy_policy_t *policy, unsigned kind,
+		pink_bitness_t bitness, long scno, unsigned ind,
+		const char *prefix, bool abstract,
+		pink_easy_policy_action_t action, int err)
+{
+	char *path;
+	struct pink_easy_policy_rule *r;
+
+	r = rule_new(policy, kind, bitness, scno, ind, action, err);
+	if (!r)
+		return false;
+	path = strdup(prefix);
+	if (!path)
+		return false;
+
+	/* A trailing slash is kept, "/foo/" matches only what lies beneath */
+	r->path = path;
+	r->pathlen = strlen(path);
+	r->abstract = abstract;
+	policy->nrules++;
+	return true;
+}
+
+bool pink_easy_policy_add_path(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, const char *prefix,
+		pink_easy_policy_action_t action, int err)
+{
+	return add_prefix(policy, PINK_EASY_POLICY_RULE_PATH, bitness, scno,
+			ind, prefix, false, action, err);
+}
+
+bool pink_easy_policy_add_unix(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, const char *prefix, bool abstract,
+		pink_easy_policy_action_t action, int err)
+{
+	return add_prefix(policy, PINK_EASY_POLICY_RULE_UNIX, bitness, scno,
+			ind, prefix, abstract, action, err);
+}
+
+bool pink_easy_policy_add_inet(pink_easy_policy_t *policy, pink_bitness_t bitness,
+		long scno, unsigned ind, int family, const void *addr,
+		unsigned prefixlen, unsigned port_lo, unsigned port_hi,
+		pink_easy_policy_action_t action, int err)
+{
+	size_t len;
+	struct pink_easy_policy_rule *r;
+
+	switch (family) {
+	case AF_INET:
+		len = 4;
+		break;
+#if PINK_HAVE_IPV6
+	case AF_INET6:
+		len = 16;
+		break;
+#endif
+	default:
+		errno = EAFNOSUPPORT;
+		return false;
+	}
+	if (prefixlen > len * 8 || port_lo > port_hi || port_hi > 65535) {
+		errno = EINVAL;
+		return false;
+	}
+
+	r = rule_new(policy, PINK_EASY_POLICY_RULE_INET, bitness, scno, ind, action, err);
+	if (!r)
+		return false;
+	r->family = family;
+	memcpy(r->addr, addr, len);
+	r->prefixlen = prefixlen;
+	r->port_lo = port_lo;
+	r->port_hi = port_hi;
+	policy->nrules++;
+	return true;
+}
+
+static bool same_run(const struct pink_easy_policy_rule *head,
+		const struct pink_easy_policy_rule *r)
+{
+	if (r->ind != head->ind)
+		return false;
+	if (head->kind == PINK_EASY_POLICY_RULE_PATH)
+		return r->kind == PINK_EASY_POLICY_RULE_PATH;
+	return r->kind == PINK_EASY_POLICY_RULE_INET || r->kind == PINK_EASY_POLICY_RULE_UNIX;
+}
+
+static bool compile_socket_run(struct pink_easy_policy_rule *head, unsigned run)
+{
+	bool ok;
+	pink_easy_netmatch_t *net;
+
+	net = pink_easy_netmatch_new();
+	if (!net)
+		return false;
+	for (unsigned i = 0; i < run; i++) {
+		const struct pink_easy_policy_rule *r = &head[i];
+		if (r->kind == PINK_EASY_POLICY_RULE_INET)
+			ok = pink_easy_netmatch_add_inet(net, r->family, r->addr,
+					r->prefixlen, r->port_lo, r->port_hi, i);
+		else
+			ok = pink_easy_netmatch_add_unix(net, r->path, r->abstract, i);
+		if (!ok)
+			goto fail;
+	}
+	if (!pink_easy_netmatch_compile(net))
+		goto fail;
+
+	head->net = net;
+	head->run = run;
+	return true;
+fail:
+	pink_easy_netmatch_destroy(net);
+	return false;
+}
+
+static bool compile_run(struct pink_easy_policy_rule *head, unsigned run)
+{
+	pink_easy_trie_t *trie;
+
+	if (head->kind != PINK_EASY_POLICY_RULE_PATH)
+		return compile_socket_run(head, run);
+
+	trie = pink_easy_trie_new();
+	if (!trie)
+		return false;
+	for (unsigned i = 0; i < run; i++) {
+		if (!pink_easy_trie_add(trie, head[i].path, i))
+			goto fail;
+	}
+	if (!pink_easy_trie_compile(trie))
+		goto fail;
+
+	head->trie = trie;
+	head->run = run;
+	return true;
+fail:
+	pink_easy_trie_destroy(trie);
+	return false;
+}
+
+bool pink_easy_policy_compile(pink_easy_policy_t *policy)
+{
+	long nr[2] = { 0, 0 };
+	unsigned npreds, off;
+	struct pink_easy_policy_slot *slots[2] = { NULL, NULL };
+	struct pink_easy_policy_rule *preds = NULL;
+
+	npreds = 0;
+	for (unsigned i = 0; i < policy->nrules; i++) {
+		const struct pink_easy_policy_rule *r = &policy->rules[i];
+		if (r->scno >= nr[r->bitness])
+			nr[r->bitness] = r->scno + 1;
+		if (r->kind != PINK_EASY_POLICY_RULE_SYSCALL)
+			npreds++;
+	}
+
+	for (unsigned b = 0; b < 2; b++) {
+		if (nr[b] && !(slots[b] = calloc(nr[b], sizeof(struct pink_easy_policy_slot))))
+			goto nomem;
+	}
+	if (npreds && !(preds = malloc(npreds * sizeof(struct pink_easy_policy_rule))))
+		goto nomem;
+
+	/* First pass: the action of each system call and its predicate count.
+	 * The last pink_easy_policy_set() for a system call wins. */
+	for (unsigned i = 0; i < policy->nrules; i++) {
+		const struct pink_easy_policy_rule *r = &policy->rules[i];
+		struct pink_easy_policy_slot *s = &slots[r->bitness][r->scno];
+
+		if (!s->listed) {
+			s->listed = 1;
+			s->action = policy->default_action;
+			s->err = policy->default_errno;
+		}
+		if (r->kind == PINK_EASY_POLICY_RULE_SYSCALL) {
+			s->action = r->action;
+			s->err = r->err;
+		} else {
+			s->npred++;
+		}
+	}
+
+	/* Second pass: lay the predicates out per system call, keeping the
+	 * order in which they were added. */
+	off = 0;
+	for (unsigned b = 0; b < 2; b++) {
+		for (long scno = 0; scno < nr[b]; scno++) {
+			slots[b][scno].first = off;
+			off += slots[b][scno].npred;
+			slots[b][scno].npred = 0;
+		}
+	}
+	for (unsigned i = 0; i < policy->nrules; i++) {
+		const struct pink_easy_policy_rule *r = &policy->rules[i];
+		struct pink_easy_policy_slot *s = &slots[r->bitness][r->scno];
+
+		if (r->kind != PINK_EASY_POLICY_RULE_SYSCALL)
+			preds[s->first + s->npred++] = *r;
+	}
+
+	/* Third pass: compile runs of path rules and runs of socket address
+	 * rules on the same argument into tries and socket address matchers,
+	 * the value of a rule is its offset in the run. */
+	for (unsigned b = 0; b < 2; b++) {
+		for (long scno = 0; scno < nr[b]; scno++) {
+			const struct pink_easy_policy_slot *s = &slots[b][scno];
+			for (unsigned i = s->first; i < s->first + s->npred;) {
+				unsigned j;
+				struct pink_easy_policy_rule *head = &preds[i];
+
+				if (head->kind == PINK_EASY_POLICY_RULE_INT) {
+					i++;
+					continue;
+				}
+				for (j = i; j < s->first + s->npred
+						&& same_run(head, &preds[j]); j++)
+					/* void */;
+				if (!compile_run(head, j - i))
+					goto fail;
+				i = j;
+			}
+		}
+	}
+
+	policy_free_compiled(policy);
+	for (unsigned b = 0; b < 2; b++) {
+		policy->nr[b] = nr[b];
+		policy->slots[b] = slots[b];
+	}
+	policy->preds = preds;
+	policy->npreds = npreds;
+	policy->compiled = true;
+	policy->generation++;
+	return true;
+
+nomem:
+	errno = ENOMEM;
+fail:
+	for (unsigned i = 0; preds && i < npreds; i++) {
+		if (preds[i].trie)
+			pink_easy_trie_destroy(preds[i].trie);
+		if (preds[i].net)
+			pink_easy_netmatch_destroy(preds[i].net);
+	}
+	free(slots[0]);
+	free(slots[1]);
+	free(preds);
+	return false;
+}
+
+const struct pink_easy_policy_slot *pink_easy_policy_slot(const pink_easy_policy_t *policy,
+		pink_bitness_t bitness, long scno)
+{
+	const struct pink_easy_policy_slot *s;
+
+	if ((bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64)
+			|| scno < 0 || scno >= policy->nr[bitness])
+		return NULL;
+
+	s = &policy->slots[bitness][scno];
+	return s->listed ? s : NULL;
+}
+
+static bool match_int(const struct pink_easy_policy_rule *r, long arg)
+{
+	switch (r->op) {
+	case PINK_EASY_POLICY_OP_EQ:
+		return arg == r->value;
+	case PINK_EASY_POLICY_OP_NE:
+		return arg != r->value;
+	case PINK_EASY_POLICY_OP_LT:
+		return arg < r->value;
+	case PINK_EASY_POLICY_OP_LE:
+		return arg <= r->value;
+	case PINK_EASY_POLICY_OP_GT:
+		return arg > r->value;
+	case PINK_EASY_POLICY_OP_GE:
+		return arg >= r->value;
+	case PINK_EASY_POLICY_OP_MASKED_EQ:
+		return (arg & r->mask) == r->value;
+	case PINK_EASY_POLICY_OP_ANY_SET:
+		return (arg & r->mask) != 0;
+	default:
+		return false;
+	}
+}
+
+/* Returns 1 on match, 0 on mismatch and -1 if the process is gone */
+static int match_int_rule(const struct pink_easy_policy_rule *r, struct policy_args *args)
+{
+	if (!(args->have_arg & (1U << r->ind))) {
+		if (!pink_util_get_arg(args->pid, args->bitness, r->ind, &args->arg[r->ind]))
+			return -1;
+		args->have_arg |= 1U << r->ind;
+	}
+	return match_int(r, args->arg[r->ind]);
+}
+
+/* Returns the offset of the matching rule in the run, -1 if none matches
+ * and -2 if the process is gone. Arguments which can't be read, e.g. bad
+ * pointers, don't match. */
+static int match_run(const struct pink_easy_policy_rule *r, struct policy_args *args)
+{
+	int m;
+
+	if (r->trie) {
+		if (args->have_path & (1U << r->ind))
+			return args->path[r->ind] ? pink_easy_trie_match(r->trie, args->path[r->ind]) : -1;
+		if (!pink_easy_trie_match_string(r->trie, args->pid, args->bitness, r->ind, &m))
+			return errno == ESRCH ? -2 : -1;
+		return m;
+	}
+
+	if (args->addr_ind != (int)r->ind) {
+		args->addr_ind = r->ind;
+		args->addr_ok = pink_decode_socket_address(args->pid,
+				args->bitness, r->ind, NULL, &args->addr);
+		if (!args->addr_ok && errno == ESRCH)
+			return -2;
+	}
+	return args->addr_ok ? pink_easy_netmatch_lookup(r->net, &args->addr) : -1;
+}
+
+/* Read a string argument into buf. Returns its length including the
+ * terminating zero, 0 if it doesn't fit and -1 if it can't be read. */
+static ssize_t read_path(pid_t pid, long addr, char *buf, size_t size)
+{
+	static long pagesize;
+	size_t total;
+
+	if (!pagesize)
+		pagesize = sysconf(_SC_PAGESIZE);
+	if (!addr) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	for (total = 0; total < size;) {
+		char *nul;
+		size_t n = pagesize - ((addr + total) % pagesize);
+		if (n > size - total)
+			n = size - total;
+		if (!pink_easy_process_vm_readv(pid, addr + total, buf + total, n))
+			return -1;
+		nul = memchr(buf + total, '\0', n);
+		if (nul)
+			return nul - buf + 1;
+		total += n;
+	}
+	return 0;
+}
+
+/* Decode the arguments the predicates of a slot look at into a decision
+ * cache key, keeping them for the evaluation. Returns the length of the
+ * key, 0 if the decision can't be cached and -1 if the process is gone. */
+static ssize_t decode_key(const pink_easy_policy_t *policy,
+		const struct pink_easy_policy_slot *s, struct policy_args *args,
+		unsigned char *key)
+{
+	long addr;
+	size_t len, max;
+	ssize_t n;
+	unsigned decoded, bit;
+
+	len = 0;
+	decoded = 0;
+	for (unsigned i = 0; i < s->npred; i++) {
+		const struct pink_easy_policy_rule *r = &policy->preds[s->first + i];
+
+		/* Each argument is decoded once as an integer, a path or a
+		 * socket address */
+		if (r->kind == PINK_EASY_POLICY_RULE_INT)
+			bit = r->ind;
+		else if (r->kind == PINK_EASY_POLICY_RULE_PATH)
+			bit = PINK_MAX_ARGS + r->ind;
+		else
+			bit = 2 * PINK_MAX_ARGS + r->ind;
+		if (decoded & (1U << bit))
+			continue;
+		decoded |= 1U << bit;
+
+		if (len + 2 + sizeof(long) + sizeof(pink_socket_address_t) > PINK_EASY_DECISION_KEY_MAX)
+			return 0;
+		key[len++] = bit;
+
+		switch (r->kind) {
+		case PINK_EASY_POLICY_RULE_INT:
+			if (match_int_rule(r, args) < 0)
+				return -1;
+			memcpy(key + len, &args->arg[r->ind], sizeof(long));
+			len += sizeof(long);
+			break;
+		case PINK_EASY_POLICY_RULE_PATH:
+			if (!pink_util_get_arg(args->pid, args->bitness, r->ind, &addr))
+				return -1;
+			max = PINK_EASY_DECISION_KEY_MAX - len - 1;
+			if (max > PATH_MAX)
+				max = PATH_MAX;
+			n = read_path(args->pid, addr, (char *)key + len + 1, max);
+			if (n < 0 && errno == ESRCH)
+				return -1;
+			if (n == 0)
+				return 0;
+			args->have_path |= 1U << r->ind;
+			if (n < 0) {
+				/* Bad pointers don't match */
+				key[len++] = 0;
+				args->path[r->ind] = NULL;
+			} else {
+				key[len++] = 1;
+				args->path[r->ind] = (const char *)key + len;
+				len += n;
+			}
+			break;
+		default:
+			if (args->addr_ind >= 0)
+				return 0;
+			args->addr_ind = r->ind;
+			args->addr_ok = pink_decode_socket_address(args->pid,
+					args->bitness, r->ind, NULL, &args->addr);
+			if (!args->addr_ok && errno == ESRCH)
+				return -1;
+			key[len++] = args->addr_ok;
+			if (args->addr_ok) {
+				size_t alen = args->addr.length;
+				if (alen > sizeof(args->addr.u._pad))
+					alen = sizeof(args->addr.u._pad);
+				memcpy(key + len, &args->addr.family, sizeof(int));
+				len += sizeof(int);
+				memcpy(key + len, args->addr.u._pad, alen);
+				len += alen;
+			}
+			break;
+		}
+	}
+
+	return len;
+}
+
+bool pink_easy_policy_eval(const pink_easy_policy_t *policy,
+		struct pink_easy_decision_cache *cache, pid_t pid,
+		pink_bitness_t bitness, long scno,
+		pink_easy_policy_action_t *action, int *err, bool *listed)
+{
+	ssize_t keylen;
+	const struct pink_easy_policy_slot *s;
+	const struct pink_easy_policy_rule *r;
+	struct policy_args args;
+	unsigned char key[PINK_EASY_DECISION_KEY_MAX];
+
+	s = pink_easy_policy_slot(policy, bitness, scno);
+	if (!s) {
+		*listed = false;
+		*action = policy->default_action;
+		*err = policy->default_errno;
+		return true;
+	}
+
+	*listed = true;
+	if (!s->npred) {
+		*action = s->action;
+		*err = s->err;
+		return true;
+	}
+
+	args.pid = pid;
+	args.bitness = bitness;
+	args.have_arg = 0;
+	args.addr_ind = -1;
+	args.have_path = 0;
+
+	keylen = 0;
+	if (cache && cache->size) {
+		keylen = decode_key(policy, s, &args, key);
+		if (keylen < 0)
+			return false;
+		if (keylen > 0 && pink_easy_decision_lookup(cache, policy, bitness, scno,
+					key, keylen, action, err))
+			return true;
+	}
+
+	*action = s->action;
+	*err = s->err;
+	for (unsigned i = 0; i < s->npred; i++) {
+		int m;
+
+		r = &policy->preds[s->first + i];
+		if (r->run) {
+			/* The most specific rule of the run wins */
+			if ((m = match_run(r, &args)) == -2)
+				return false;
+			i += r->run - 1;
+			if (m < 0)
+				continue;
+			r += m;
+		} else if ((m = match_int_rule(r, &args)) < 0) {
+			return false;
+		} else if (!m) {
+			continue;
+		}
+		*action = r->action;
+		*err = r->err;
+		break;
+	}
+
+	if (keylen > 0)
+		pink_easy_decision_store(cache, bitness, scno, key, keylen, *action, *err);
+	return true;
+}
+
+pink_easy_policy_action_t pink_easy_policy_check(const pink_easy_policy_t *policy,
+		pid_t pid, pink_bitness_t bitness, long scno, int *err)
+{
+	bool listed;
+	pink_easy_policy_action_t action;
+
+	if (!policy->compiled)
+		return PINK_EASY_POLICY_TRACE;
+	if (!pink_easy_policy_eval(policy, NULL, pid, bitness, scno, &action, err, &listed))
+		return PINK_EASY_POLICY_TRACE;
+	return action;
+}
+
+bool pink_easy_context_set_policy(pink_easy_context_t *ctx,
+		const pink_easy_policy_t *policy, bool seccomp)
+{
+	if (policy && !policy->compiled) {
+		errno = EINVAL;
+		return false;
+	}
+	if (seccomp) {
+#if PINK_EASY_HAVE_SECCOMP
+		/* Filters returning SECCOMP_RET_TRACE need Linux-3.5 */
+		if (pink_easy_os_release < KERNEL_VERSION(3,5,0)) {
+			errno = ENOTSUP;
+			return false;
+		}
+#else
+		errno = ENOTSUP;
+		return false;
+#endif
+	}
+
+	if (ctx->seccomp)
+		ctx->ptrace_options &= ~PINK_TRACE_OPTION_SECCOMP;
+	ctx->policy = policy;
+	ctx->seccomp = policy && seccomp;
+	if (ctx->seccomp)
+		ctx->ptrace_options |= PINK_TRACE_OPTION_SECCOMP;
+	pink_easy_decision_flush(&ctx->decisions);
+	return true;
+}
+
+bool pink_easy_context_set_decision_cache(pink_easy_context_t *ctx, unsigned size)
+{
+	return pink_easy_decision_resize(&ctx->decisions, size);
+}
+
+void pink_easy_context_flush_decision_cache(pink_easy_context_t *ctx)
+{
+	pink_easy_decision_flush(&ctx->decisions);
+}
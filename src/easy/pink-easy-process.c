@@ -33,6 +33,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/queue.h>
 #include <sys/syscall.h>
@@ -43,7 +44,7 @@ pink_easy_process_kill(const pink_easy_process_t *proc, int sig)
 {
 	if (proc->flags & PINK_EASY_PROCESS_CLONE_THREAD) {
 #if defined(__NR_tgkill)
-		return syscall(__NR_tgkill, proc->ppid > 0 ? proc->ppid : proc->pid, proc->pid, sig);
+		return syscall(__NR_tgkill, proc->tgid, proc->pid, sig);
 #elif defined(__NR_tkill)
 		return syscall(__NR_tkill, proc->pid, sig);
 #else
@@ -64,6 +65,36 @@ pink_easy_process_resume(const pink_easy_process_t *proc, int sig)
 		return pink_trace_resume(proc->pid, sig);
 }
 
+bool
+pink_easy_process_deny(pink_easy_process_t *proc, int err)
+{
+	return pink_easy_process_emulate(proc, -err);
+}
+
+bool
+pink_easy_process_emulate(pink_easy_process_t *proc, long retval)
+{
+	if (!(proc->flags & PINK_EASY_PROCESS_INSYSCALL)
+			|| proc->flags & PINK_EASY_PROCESS_RESOLVED) {
+		errno = EINVAL;
+		return false;
+	}
+
+	if (pink_util_skip_syscall(proc->pid, proc->bitness, retval)) {
+		proc->flags |= PINK_EASY_PROCESS_RESOLVED;
+		return true;
+	}
+	if (errno != ENOTSUP)
+		return false;
+
+	/* Skip the system call now and fix the return value up on exit */
+	if (!pink_util_set_syscall(proc->pid, proc->bitness, PINK_SYSCALL_INVALID))
+		return false;
+	proc->flags |= PINK_EASY_PROCESS_RESOLVED | PINK_EASY_PROCESS_DENY;
+	proc->retval = retval;
+	return true;
+}
+
 pid_t
 pink_easy_process_get_pid(const pink_easy_process_t *proc)
 {
@@ -76,6 +107,18 @@ pink_easy_process_get_ppid(const pink_easy_process_t *proc)
 	return proc->ppid;
 }
 
+pid_t
+pink_easy_process_get_tgid(const pink_easy_process_t *proc)
+{
+	return proc->tgid;
+}
+
+pink_easy_process_t *
+pink_easy_process_get_parent(const pink_easy_process_t *proc)
+{
+	return proc->parent;
+}
+
 pink_bitness_t
 pink_easy_process_get_bitness(const pink_easy_process_t *proc)
 {
@@ -141,3 +184,187 @@ unsigned pink_easy_process_list_walk(const pink_easy_process_list_t *list,
 
 	return count;
 }
+
+void pink_easy_process_link(pink_easy_process_t *current, pink_easy_process_t *parent,
+		pid_t tgid, unsigned long flags)
+{
+	pink_easy_group_inherit(current, parent, flags);
+	current->tgid = tgid;
+	current->parent = parent;
+	if (parent)
+		LIST_INSERT_HEAD(&parent->children, current, siblings);
+	if (tgid == current->pid)
+		return;
+
+	current->flags |= PINK_EASY_PROCESS_CLONE_THREAD;
+	if (parent && parent->tgid == tgid)
+		current->leader = parent->leader ? parent->leader : parent;
+	if (current->leader)
+		LIST_INSERT_HEAD(&current->leader->threads, current, group);
+}
+
+void pink_easy_process_unlink(pink_easy_process_t *current)
+{
+	pink_easy_process_t *node;
+
+	/* Orphans are adopted by the closest traced ancestor */
+	while ((node = LIST_FIRST(&current->children))) {
+		LIST_REMOVE(node, siblings);
+		node->parent = current->parent;
+		if (node->parent)
+			LIST_INSERT_HEAD(&node->parent->children, node, siblings);
+	}
+	while ((node = LIST_FIRST(&current->threads))) {
+		LIST_REMOVE(node, group);
+		node->leader = NULL;
+	}
+	if (current->leader)
+		LIST_REMOVE(current, group);
+	if (current->parent)
+		LIST_REMOVE(current, siblings);
+	current->parent = current->leader = NULL;
+	pink_easy_group_drop(current);
+}
+
+/* A thread other than the leader called execve() and took the place of
+ * the leader, which is about to be removed. */
+void pink_easy_process_replace(pink_easy_process_t *old, pink_easy_process_t *current)
+{
+	pink_easy_process_t *node;
+
+	if (current->leader)
+		LIST_REMOVE(current, group);
+	if (current->parent)
+		LIST_REMOVE(current, siblings);
+	current->leader = NULL;
+	current->flags &= ~PINK_EASY_PROCESS_CLONE_THREAD;
+	current->ppid = old->ppid;
+	current->tgid = old->tgid;
+	current->parent = old->parent;
+	if (current->parent)
+		LIST_INSERT_HEAD(&current->parent->children, current, siblings);
+
+	while ((node = LIST_FIRST(&old->children))) {
+		LIST_REMOVE(node, siblings);
+		node->parent = current;
+		LIST_INSERT_HEAD(&current->children, node, siblings);
+	}
+	while ((node = LIST_FIRST(&old->threads))) {
+		LIST_REMOVE(node, group);
+		node->leader = current;
+		LIST_INSERT_HEAD(&current->threads, node, group);
+	}
+}
+
+/* Next entry of the subtree in preorder */
+static pink_easy_process_t *tree_next(const pink_easy_process_t *root,
+		const pink_easy_process_t *node)
+{
+	if (LIST_FIRST(&node->children))
+		return LIST_FIRST(&node->children);
+	for (; node != root; node = node->parent) {
+		if (LIST_NEXT(node, siblings))
+			return LIST_NEXT(node, siblings);
+	}
+	return NULL;
+}
+
+unsigned pink_easy_process_tree_walk(pink_easy_process_t *proc,
+		pink_easy_walk_func_t func, void *userdata)
+{
+	unsigned count = 0;
+	pink_easy_process_t *node;
+
+	for (node = proc; node; node = tree_next(proc, node)) {
+		++count;
+		if (!func(node, userdata))
+			break;
+	}
+	return count;
+}
+
+unsigned pink_easy_process_tree_count(const pink_easy_process_t *proc)
+{
+	unsigned count = 0;
+	const pink_easy_process_t *node;
+
+	for (node = proc; node; node = tree_next(proc, node))
+		++count;
+	return count;
+}
+
+unsigned pink_easy_process_tree_kill(const pink_easy_process_t *proc, int sig)
+{
+	unsigned count = 0;
+	const pink_easy_process_t *node;
+
+	for (node = proc; node; node = tree_next(proc, node)) {
+		if (pink_easy_process_kill(node, sig) == 0)
+			++count;
+	}
+	return count;
+}
+
+static void process_detach(pink_easy_process_t *node)
+{
+	node->flags |= PINK_EASY_PROCESS_DETACH;
+	/* Others are detached at their next stop */
+	if (node->flags & PINK_EASY_PROCESS_SEIZED
+			&& !(node->flags & PINK_EASY_PROCESS_STARTUP))
+		pink_trace_interrupt(node->pid);
+}
+
+unsigned pink_easy_process_tree_detach(pink_easy_process_t *proc)
+{
+	unsigned count = 0;
+	pink_easy_process_t *node;
+
+	for (node = proc; node; node = tree_next(proc, node)) {
+		/* The filter would fail the system calls it traps */
+		if (node->flags & (PINK_EASY_PROCESS_SECCOMP | PINK_EASY_PROCESS_DETACH))
+			continue;
+		process_detach(node);
+		++count;
+	}
+	return count;
+}
+
+unsigned pink_easy_process_tree_release(pink_easy_process_t *proc,
+		pink_easy_release_t how)
+{
+	unsigned count = 0;
+	pink_easy_process_t *node;
+
+	for (node = proc; node; node = tree_next(proc, node)) {
+		if (node->flags & PINK_EASY_PROCESS_DETACH)
+			continue;
+		if (how == PINK_EASY_RELEASE_DETACH
+				&& !(node->flags & PINK_EASY_PROCESS_SECCOMP)) {
+			process_detach(node);
+		} else if (!(node->flags & PINK_EASY_PROCESS_QUIET)) {
+			/* The shadow tables of its groups would go stale */
+			pink_easy_group_quiet(node);
+		} else {
+			continue;
+		}
+		++count;
+	}
+	return count;
+}
+
+unsigned pink_easy_process_thread_walk(pink_easy_process_t *proc,
+		pink_easy_walk_func_t func, void *userdata)
+{
+	unsigned count = 1;
+	pink_easy_process_t *leader, *node;
+
+	leader = proc->leader ? proc->leader : proc;
+	if (!func(leader, userdata))
+		return count;
+	LIST_FOREACH(node, &leader->threads, group) {
+		++count;
+		if (!func(node, userdata))
+			break;
+	}
+	return count;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+pink_easy_record_reader_t *pink_easy_record_reader_open(const char *path)
+{
+	int fd, save_errno;
+	void *map;
+	struct stat st;
+	const pink_easy_record_header_t *header;
+	pink_easy_record_reader_t *reader;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0)
+		goto fail;
+	if ((size_t)st.st_size < sizeof(pink_easy_record_header_t)) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto fail;
+	close(fd);
+
+	header = map;
+	if (memcmp(header->magic, PINK_EASY_RECORD_MAGIC, sizeof(PINK_EASY_RECORD_MAGIC))
+			|| header->version != PINK_EASY_RECORD_VERSION
+			|| header->byte_order != 0x01020304) {
+		munmap(map, st.st_size);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	reader = malloc(sizeof(pink_easy_record_reader_t));
+	if (!reader) {
+		save_errno = errno;
+		munmap(map, st.st_size);
+		errno = save_errno;
+		return NULL;
+	}
+	reader->map = map;
+	reader->len = st.st_size;
+	reader->off = sizeof(pink_easy_record_header_t);
+	return reader;
+
+fail:
+	save_errno = errno;
+	close(fd);
+	errno = save_errno;
+	return NULL;
+}
+
+const pink_easy_record_header_t *pink_easy_record_reader_get_header(const pink_easy_record_reader_t *reader)
+{
+	return (const pink_easy_record_header_t *)reader->map;
+}
+
+const pink_easy_record_t *pink_easy_record_reader_next(pink_easy_record_reader_t *reader)
+{
+	size_t left;
+	const pink_easy_record_t *record;
+
+	left = reader->len - reader->off;
+	if (!left) {
+		errno = 0;
+		return NULL;
+	}
+
+	record = (const pink_easy_record_t *)(reader->map + reader->off);
+	if (left < sizeof(pink_easy_record_t)
+			|| record->size > left
+			|| record->size & 7
+			|| record->nargs > PINK_EASY_RECORD_ARGS_MAX
+			|| sizeof(pink_easy_record_t) + record->nargs * sizeof(uint64_t)
+				+ record->payload_len > record->size) {
+		errno = EINVAL;
+		return NULL;
+	}
+	reader->off += record->size;
+	return record;
+}
+
+void pink_easy_record_reader_close(pink_easy_record_reader_t *reader)
+{
+	munmap((void *)reader->map, reader->len);
+	free(reader);
+}
+
+const void *pink_easy_record_get_payload(const pink_easy_record_t *record)
+{
+	return record->args + record->nargs;
+}
+
+pink_bitness_t pink_easy_record_get_bitness(const pink_easy_record_t *record)
+{
+	return record->flags & PINK_EASY_RECORD_64 ? PINK_BITNESS_64 : PINK_BITNESS_32;
+}
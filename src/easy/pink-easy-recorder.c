@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+#define RECORDER_SIZE_DEFAULT	(1 << 20)
+#define RECORDER_SIZE_MIN	(1 << 12)
+/* The writer thread writes out at least this often */
+#define RECORDER_INTERVAL_MS	10
+
+static size_t record_size(unsigned nargs, size_t len)
+{
+	return (sizeof(pink_easy_record_t) + nargs * sizeof(uint64_t) + len + 7) & ~(size_t)7;
+}
+
+static uint64_t elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000000ULL
+		+ now.tv_nsec - start->tv_nsec;
+}
+
+/* Copy in and out of the ring, wrapping around its end */
+static void ring_put(pink_easy_recorder_t *recorder, uint64_t pos, const void *src, size_t len)
+{
+	size_t off, n;
+
+	off = pos & (recorder->size - 1);
+	n = recorder->size - off < len ? recorder->size - off : len;
+	memcpy(recorder->ring + off, src, n);
+	memcpy(recorder->ring, (const char *)src + n, len - n);
+}
+
+static void ring_take(pink_easy_recorder_t *recorder, uint64_t pos, void *dest, size_t len)
+{
+	size_t off, n;
+
+	off = pos & (recorder->size - 1);
+	n = recorder->size - off < len ? recorder->size - off : len;
+	memcpy(dest, recorder->ring + off, n);
+	memcpy((char *)dest + n, recorder->ring, len - n);
+	memset(recorder->ring + off, 0, n);
+	memset(recorder->ring, 0, len - n);
+}
+
+static bool write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* Move the committed records to the batch and write it out.
+ * Returns true if there was anything to write. */
+static bool recorder_drain(pink_easy_recorder_t *recorder)
+{
+	uint32_t size;
+	uint64_t tail;
+	size_t len;
+
+	len = 0;
+	tail = recorder->tail;
+	for (;;) {
+		size = __atomic_load_n((uint32_t *)(recorder->ring + (tail & (recorder->size - 1))),
+				__ATOMIC_ACQUIRE);
+		if (!size || len + size > recorder->batch_size)
+			break;
+		ring_take(recorder, tail, recorder->batch + len, size);
+		len += size;
+		tail += size;
+	}
+	if (!len)
+		return false;
+	/* Make room for the producers before the slow part */
+	__atomic_store_n(&recorder->tail, tail, __ATOMIC_RELEASE);
+
+	if (!recorder->error && !write_all(recorder->fd, recorder->batch, len))
+		recorder->error = errno;
+
+	pthread_mutex_lock(&recorder->lock);
+	recorder->written += len;
+	pthread_cond_broadcast(&recorder->progress);
+	pthread_mutex_unlock(&recorder->lock);
+	return true;
+}
+
+static void *recorder_main(void *data)
+{
+	bool stop;
+	struct timespec ts;
+	pink_easy_recorder_t *recorder = data;
+
+	for (;;) {
+		while (recorder_drain(recorder))
+			;
+
+		pthread_mutex_lock(&recorder->lock);
+		stop = recorder->stop;
+		if (!stop) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += RECORDER_INTERVAL_MS * 1000000L;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&recorder->wake, &recorder->lock, &ts);
+		}
+		pthread_mutex_unlock(&recorder->lock);
+		if (stop && __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE) == recorder->tail)
+			return NULL;
+	}
+}
+
+static void recorder_kick(pink_easy_recorder_t *recorder)
+{
+	pthread_mutex_lock(&recorder->lock);
+	pthread_cond_signal(&recorder->wake);
+	pthread_mutex_unlock(&recorder->lock);
+}
+
+pink_easy_recorder_t *pink_easy_recorder_new(const char *path, size_t size)
+{
+	int save_errno;
+	struct timespec now;
+	pink_easy_record_header_t header;
+	pink_easy_recorder_t *recorder;
+
+	if (!size)
+		size = RECORDER_SIZE_DEFAULT;
+	if (size < RECORDER_SIZE_MIN)
+		size = RECORDER_SIZE_MIN;
+	if (size > (1UL << 30)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	while (size & (size - 1))
+		size += size & -size;
+
+	recorder = calloc(1, sizeof(pink_easy_recorder_t));
+	if (!recorder)
+		return NULL;
+	recorder->size = size;
+	recorder->batch_size = size;
+	recorder->ring = calloc(1, size);
+	recorder->batch = malloc(size);
+	if (!recorder->ring || !recorder->batch)
+		goto fail;
+
+	recorder->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (recorder->fd < 0)
+		goto fail;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PINK_EASY_RECORD_MAGIC, sizeof(PINK_EASY_RECORD_MAGIC));
+	header.version = PINK_EASY_RECORD_VERSION;
+	header.byte_order = 0x01020304;
+	clock_gettime(CLOCK_REALTIME, &now);
+	header.epoch = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+	clock_gettime(CLOCK_MONOTONIC, &recorder->start);
+	if (!write_all(recorder->fd, (const char *)&header, sizeof(header)))
+		goto fail_close;
+
+	pthread_mutex_init(&recorder->lock, NULL);
+	pthread_cond_init(&recorder->wake, NULL);
+	pthread_cond_init(&recorder->progress, NULL);
+	errno = pthread_create(&recorder->thread, NULL, recorder_main, recorder);
+	if (errno) {
+		pthread_cond_destroy(&recorder->progress);
+		pthread_cond_destroy(&recorder->wake);
+		pthread_mutex_destroy(&recorder->lock);
+		goto fail_close;
+	}
+	return recorder;
+
+fail_close:
+	save_errno = errno;
+	close(recorder->fd);
+	errno = save_errno;
+fail:
+	free(recorder->batch);
+	free(recorder->ring);
+	free(recorder);
+	return NULL;
+}
+
+bool pink_easy_recorder_append(pink_easy_recorder_t *recorder, pid_t pid,
+		pink_bitness_t bitness, long scno, unsigned flags, long retval,
+		const long *args, unsigned nargs, const void *payload, size_t len)
+{
+	size_t size;
+	uint64_t head, tail, pos;
+	pink_easy_record_t record;
+
+	if (nargs > PINK_EASY_RECORD_ARGS_MAX || (nargs && !args)
+			|| len > PINK_EASY_RECORD_PAYLOAD_MAX || (len && !payload)) {
+		errno = EINVAL;
+		return false;
+	}
+	size = record_size(nargs, len);
+	if (size > recorder->size / 2) {
+		errno = EINVAL;
+		return false;
+	}
+
+	/* Reserve room, waiting for the writer if the ring is full */
+	head = __atomic_load_n(&recorder->head, __ATOMIC_RELAXED);
+	for (;;) {
+		tail = __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE);
+		if (head + size - tail > recorder->size) {
+			pthread_mutex_lock(&recorder->lock);
+			recorder->stalls++;
+			pthread_cond_signal(&recorder->wake);
+			if (__atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE) == tail)
+				pthread_cond_wait(&recorder->progress, &recorder->lock);
+			pthread_mutex_unlock(&recorder->lock);
+			head = __atomic_load_n(&recorder->head, __ATOMIC_RELAXED);
+			continue;
+		}
+		if (__atomic_compare_exchange_n(&recorder->head, &head, head + size, true,
+					__ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			break;
+	}
+
+	record.size = 0;
+	record.payload_len = len;
+	record.flags = flags & PINK_EASY_RECORD_EXIT;
+	if (bitness == PINK_BITNESS_64)
+		record.flags |= PINK_EASY_RECORD_64;
+	record.nargs = nargs;
+	record.pid = pid;
+	record.scno = scno;
+	record.time = elapsed(&recorder->start);
+	record.retval = flags & PINK_EASY_RECORD_EXIT ? retval : 0;
+
+	/* Everything but the size, which commits the record */
+	pos = head + sizeof(uint32_t);
+	ring_put(recorder, pos, (const char *)&record + sizeof(uint32_t),
+			sizeof(record) - sizeof(uint32_t));
+	pos += sizeof(record) - sizeof(uint32_t);
+	for (unsigned i = 0; i < nargs; i++) {
+		uint64_t arg = (unsigned long)args[i];
+		ring_put(recorder, pos, &arg, sizeof(arg));
+		pos += sizeof(arg);
+	}
+	if (len)
+		ring_put(recorder, pos, payload, len);
+	__atomic_store_n((uint32_t *)(recorder->ring + (head & (recorder->size - 1))),
+			(uint32_t)size, __ATOMIC_RELEASE);
+
+	/* Don't let the writer sleep through a filling ring */
+	if (head + size - tail > recorder->size / 2)
+		recorder_kick(recorder);
+	return true;
+}
+
+bool pink_easy_recorder_syscall(pink_easy_recorder_t *recorder,
+		const pink_easy_process_t *proc, bool entering,
+		const void *payload, size_t len)
+{
+	long scno, retval, args[PINK_MAX_ARGS];
+
+	/* The loop has read the number already unless nothing needed it */
+	scno = proc->scno;
+	if (scno < 0 && !pink_util_get_syscall(proc->pid, proc->bitness, &scno))
+		return false;
+	if (!pink_util_get_args(proc->pid, proc->bitness, args))
+		return false;
+	retval = 0;
+	if (!entering && !pink_util_get_return(proc->pid, &retval))
+		return false;
+
+	return pink_easy_recorder_append(recorder, proc->pid, proc->bitness, scno,
+			entering ? 0 : PINK_EASY_RECORD_EXIT, retval,
+			args, PINK_MAX_ARGS, payload, len);
+}
+
+bool pink_easy_recorder_flush(pink_easy_recorder_t *recorder)
+{
+	int error;
+	uint64_t head;
+
+	head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+	pthread_mutex_lock(&recorder->lock);
+	while (recorder->written < head) {
+		pthread_cond_signal(&recorder->wake);
+		pthread_cond_wait(&recorder->progress, &recorder->lock);
+	}
+	error = recorder->error;
+	pthread_mutex_unlock(&recorder->lock);
+
+	if (error) {
+		errno = error;
+		return false;
+	}
+	return true;
+}
+
+unsigned long pink_easy_recorder_get_stalls(const pink_easy_recorder_t *recorder)
+{
+	return recorder->stalls;
+}
+
+bool pink_easy_recorder_destroy(pink_easy_recorder_t *recorder)
+{
+	int error;
+
+	pthread_mutex_lock(&recorder->lock);
+	recorder->stop = true;
+	pthread_cond_signal(&recorder->wake);
+	pthread_mutex_unlock(&recorder->lock);
+	pthread_join(recorder->thread, NULL);
+
+	error = recorder->error;
+	if (close(recorder->fd) < 0 && !error)
+		error = errno;
+
+	pthread_cond_destroy(&recorder->progress);
+	pthread_cond_destroy(&recorder->wake);
+	pthread_mutex_destroy(&recorder->lock);
+	free(recorder->batch);
+	free(recorder->ring);
+	free(recorder);
+
+	if (error) {
+		errno = error;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#if PINK_EASY_HAVE_SECCOMP
+#include <sys/prctl.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+#ifndef PR_SET_NO_NEW_PRIVS
+#define PR_SET_NO_NEW_PRIVS 38
+#endif
+
+/* Audit architecture of each bitness, 0 if unsupported */
+static const unsigned seccomp_arch[2] = {
+#if PINK_ARCH_X86_64
+	AUDIT_ARCH_I386, AUDIT_ARCH_X86_64,
+#elif PINK_ARCH_I386
+	AUDIT_ARCH_I386, 0,
+#elif PINK_ARCH_POWERPC64
+	AUDIT_ARCH_PPC, AUDIT_ARCH_PPC64,
+#elif PINK_ARCH_POWERPC
+	AUDIT_ARCH_PPC, 0,
+#elif PINK_ARCH_IA64
+	0, AUDIT_ARCH_IA64,
+#elif PINK_ARCH_ARM
+	AUDIT_ARCH_ARM, 0,
+#else
+	0, 0,
+#endif
+};
+
+struct seccomp_prog {
+	struct sock_fprog fprog;
+	unsigned len, alloc;
+};
+
+static bool emit(struct seccomp_prog *p, unsigned short code,
+		unsigned char jt, unsigned char jf, unsigned k)
+{
+	if (p->len == p->alloc) {
+		struct sock_filter *f;
+		unsigned n = p->alloc ? p->alloc * 2 : 64;
+
+		if (n > BPF_MAXINSNS)
+			n = BPF_MAXINSNS;
+		if (p->len == n) {
+			errno = E2BIG;
+			return false;
+		}
+		f = realloc(p->fprog.filter, n * sizeof(struct sock_filter));
+		if (!f) {
+			errno = ENOMEM;
+			return false;
+		}
+		p->fprog.filter = f;
+		p->alloc = n;
+	}
+
+	p->fprog.filter[p->len].code = code;
+	p->fprog.filter[p->len].jt = jt;
+	p->fprog.filter[p->len].jf = jf;
+	p->fprog.filter[p->len].k = k;
+	p->len++;
+	return true;
+}
+
+static unsigned action_ret(pink_easy_policy_action_t action, int err)
+{
+	switch (action) {
+	case PINK_EASY_POLICY_ALLOW:
+		return SECCOMP_RET_ALLOW;
+	case PINK_EASY_POLICY_DENY:
+		return SECCOMP_RET_ERRNO | ((unsigned)err & SECCOMP_RET_DATA);
+	case PINK_EASY_POLICY_KILL:
+		return SECCOMP_RET_KILL;
+	case PINK_EASY_POLICY_TRACE:
+	default:
+		return SECCOMP_RET_TRACE;
+	}
+}
+
+/* What the filter returns for the given system call. System calls whose
+ * verdict depends on the arguments are left to the tracer. */
+static unsigned syscall_ret(const struct pink_easy_context *ctx,
+		pink_bitness_t bitness, long scno)
+{
+	const struct pink_easy_policy_slot *s;
+
+	s = pink_easy_policy_slot(ctx->policy, bitness, scno);
+	if (s) {
+		if (s->npred || (s->action == PINK_EASY_POLICY_ALLOW
+					&& pink_easy_shadow_interested(ctx, bitness, scno)))
+			return SECCOMP_RET_TRACE;
+		return action_ret(s->action, s->err);
+	}
+	if (pink_easy_dispatch_interested(ctx, bitness, scno, true)
+			|| pink_easy_dispatch_interested(ctx, bitness, scno, false)
+			|| pink_easy_memo_interested(ctx, bitness, scno)
+			|| pink_easy_shadow_interested(ctx, bitness, scno))
+		return SECCOMP_RET_TRACE;
+	return action_ret(ctx->policy->default_action, ctx->policy->default_errno);
+}
+
+static bool emit_block(const struct pink_easy_context *ctx,
+		struct seccomp_prog *p, pink_bitness_t bitness)
+{
+	long nr;
+	unsigned def;
+
+	nr = ctx->policy->nr[bitness];
+	if (ctx->dispatch[bitness].nr > nr)
+		nr = ctx->dispatch[bitness].nr;
+	if (ctx->memo[bitness].nr > nr)
+		nr = ctx->memo[bitness].nr;
+	for (unsigned i = 0; ctx->shadow && i < PINK_EASY_SHADOW_NSYSCALLS; i++)
+		if (ctx->shadow_scno[bitness][i] >= nr && ctx->shadow_scno[bitness][i] < PINK_EASY_SYSCALL_MAX)
+			nr = ctx->shadow_scno[bitness][i] + 1;
+	def = action_ret(ctx->policy->default_action, ctx->policy->default_errno);
+
+	if (!emit(p, BPF_LD|BPF_W|BPF_ABS, 0, 0, offsetof(struct seccomp_data, nr)))
+		return false;
+#if PINK_ARCH_X86_64
+	/* x32 system calls share the architecture with x86_64 */
+	if (bitness == PINK_BITNESS_64) {
+		if (!emit(p, BPF_JMP|BPF_JGE|BPF_K, 0, 1, 0x40000000)
+				|| !emit(p, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_TRACE))
+			return false;
+	}
+#endif
+	for (long scno = 0; scno < nr; scno++) {
+		unsigned ret = syscall_ret(ctx, bitness, scno);
+		if (ret == def)
+			continue;
+		if (!emit(p, BPF_JMP|BPF_JEQ|BPF_K, 0, 1, scno)
+				|| !emit(p, BPF_RET|BPF_K, 0, 0, ret))
+			return false;
+	}
+	return emit(p, BPF_RET|BPF_K, 0, 0, def);
+}
+
+void *pink_easy_seccomp_build(const struct pink_easy_context *ctx)
+{
+	unsigned fixup[2];
+	struct seccomp_prog *p;
+
+	p = calloc(1, sizeof(struct seccomp_prog));
+	if (!p)
+		return NULL;
+
+	/* Dispatch on the architecture, unknown ones are left to the tracer:
+	 *	ld arch
+	 *	jeq arch[0], 0, 1
+	 *	ja block[0]
+	 *	jeq arch[1], 0, 1
+	 *	ja block[1]
+	 *	ret TRACE
+	 */
+	if (!emit(p, BPF_LD|BPF_W|BPF_ABS, 0, 0, offsetof(struct seccomp_data, arch)))
+		goto fail;
+	for (unsigned b = 0; b < 2; b++) {
+		fixup[b] = 0;
+		if (!seccomp_arch[b])
+			continue;
+		if (!emit(p, BPF_JMP|BPF_JEQ|BPF_K, 0, 1, seccomp_arch[b]))
+			goto fail;
+		fixup[b] = p->len;
+		if (!emit(p, BPF_JMP|BPF_JA, 0, 0, 0))
+			goto fail;
+	}
+	if (!emit(p, BPF_RET|BPF_K, 0, 0, SECCOMP_RET_TRACE))
+		goto fail;
+	for (unsigned b = 0; b < 2; b++) {
+		if (!fixup[b])
+			continue;
+		p->fprog.filter[fixup[b]].k = p->len - fixup[b] - 1;
+		if (!emit_block(ctx, p, b))
+			goto fail;
+	}
+
+	p->fprog.len = p->len;
+	return p;
+
+fail:
+	pink_easy_seccomp_free(p);
+	return NULL;
+}
+
+bool pink_easy_seccomp_load(const void *prog)
+{
+	const struct seccomp_prog *p = prog;
+
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+		return false;
+	return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &p->fprog, 0, 0) == 0;
+}
+
+void pink_easy_seccomp_free(void *prog)
+{
+	struct seccomp_prog *p = prog;
+
+	if (p) {
+		free(p->fprog.filter);
+		free(p);
+	}
+}
+#else
+void *pink_easy_seccomp_build(PINK_GCC_ATTR((unused)) const struct pink_easy_context *ctx)
+{
+	errno = ENOTSUP;
+	return NULL;
+}
+
+bool pink_easy_seccomp_load(PINK_GCC_ATTR((unused)) const void *prog)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
+void pink_easy_seccomp_free(PINK_GCC_ATTR((unused)) void *prog)
+{
+}
+#endif
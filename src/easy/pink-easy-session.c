@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* Direct mapped cache of the context index of recently seen processes,
+ * entries are checked against the process list of the context. */
+#define PID_CACHE_SIZE 1024
+
+struct session_entry {
+	pink_easy_context_t *ctx;
+	/** Whether the context has processes waiting for a decision **/
+	bool parked;
+};
+
+struct pink_easy_session {
+	/** Contexts, NULL for removed ones until the array is compacted **/
+	struct session_entry *entries;
+	unsigned nentries, size, count;
+	bool holes;
+
+	/** Number of contexts with processes waiting for a decision **/
+	unsigned nparked;
+
+	/** Processes which stopped before their parent reported them **/
+	pid_t *orphans;
+	unsigned norphans, orphans_size;
+
+	struct {
+		pid_t pid;
+		unsigned index;
+	} cache[PID_CACHE_SIZE];
+
+	/** Completions of all contexts and SIGCHLD wake the loop up **/
+	int wakeup[2];
+	int wakeup_slot;
+};
+
+static void cache_clear(pink_easy_session_t *session)
+{
+	for (unsigned i = 0; i < PID_CACHE_SIZE; i++)
+		session->cache[i].pid = 0;
+}
+
+static int session_index(const pink_easy_session_t *session, const pink_easy_context_t *ctx)
+{
+	for (unsigned i = 0; i < session->nentries; i++) {
+		if (session->entries[i].ctx == ctx)
+			return i;
+	}
+	return -1;
+}
+
+/* Find the context which traces the process */
+static int session_lookup(pink_easy_session_t *session, pid_t pid)
+{
+	unsigned i;
+	pink_easy_context_t *ctx;
+
+	i = (unsigned)pid % PID_CACHE_SIZE;
+	if (session->cache[i].pid == pid) {
+		ctx = session->entries[session->cache[i].index].ctx;
+		if (ctx && pink_easy_process_list_lookup(&ctx->process_list, pid))
+			return session->cache[i].index;
+	}
+
+	for (unsigned j = 0; j < session->nentries; j++) {
+		ctx = session->entries[j].ctx;
+		if (ctx && pink_easy_process_list_lookup(&ctx->process_list, pid)) {
+			session->cache[i].pid = pid;
+			session->cache[i].index = j;
+			return j;
+		}
+	}
+	return -1;
+}
+
+static void session_compact(pink_easy_session_t *session)
+{
+	unsigned i, n = 0;
+
+	for (i = 0; i < session->nentries; i++) {
+		if (session->entries[i].ctx)
+			session->entries[n++] = session->entries[i];
+	}
+	session->nentries = n;
+	session->holes = false;
+	cache_clear(session);
+}
+
+static void session_set_parked(pink_easy_session_t *session, unsigned i)
+{
+	bool parked = session->entries[i].ctx->nparked != 0;
+
+	if (parked == session->entries[i].parked)
+		return;
+	session->entries[i].parked = parked;
+	if (parked)
+		session->nparked++;
+	else
+		session->nparked--;
+}
+
+/* The process which reports the orphan: the thread group leader of a thread,
+ * the parent of a process. */
+static pid_t orphan_owner(pid_t pid)
+{
+	long tgid = 0, ppid = 0;
+	char path[32], line[128];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	f = fopen(path, "r");
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "Tgid: %ld", &tgid) == 1)
+			continue;
+		if (sscanf(line, "PPid: %ld", &ppid) == 1)
+			break;
+	}
+	fclose(f);
+	return tgid > 0 && tgid != pid ? tgid : ppid;
+}
+
+/* Kill the orphans no context in the session is left to report, e.g. the
+ * children of a process killed at its fork */
+static void orphans_sweep(pink_easy_session_t *session)
+{
+	pid_t owner;
+
+	for (unsigned i = 0; i < session->norphans;) {
+		owner = orphan_owner(session->orphans[i]);
+		if (owner > 0 && session_lookup(session, owner) >= 0) {
+			i++;
+			continue;
+		}
+		/* Gone already if the owner is unknown, don't kill a reused pid */
+		if (owner > 0)
+			kill(session->orphans[i], SIGKILL);
+		session->orphans[i] = session->orphans[--session->norphans];
+	}
+}
+
+void pink_easy_session_unlink(pink_easy_context_t *ctx)
+{
+	int i;
+	ssize_t n;
+	pink_easy_session_t *session = ctx->session;
+
+	i = session_index(session, ctx);
+	if (session->entries[i].parked)
+		session->nparked--;
+	session->entries[i].ctx = NULL;
+	session->entries[i].parked = false;
+	session->holes = true;
+	session->count--;
+	if (session->norphans)
+		orphans_sweep(session);
+
+	ctx->session = NULL;
+	ctx->wakeup_fd = ctx->wakeup[1];
+	if (ctx->nparked) {
+		/* Completions go to the pipe of the context from now on */
+		pink_easy_async_register(ctx->wakeup[1], &ctx->wakeup_slot);
+		n = write(ctx->wakeup[1], "", 1);
+		(void)n;
+	}
+}
+
+/* The context is done, tell the user after it has left the session */
+static void session_finish(pink_easy_session_t *session, unsigned i, bool aborted)
+{
+	pink_easy_context_t *ctx = session->entries[i].ctx;
+	pink_easy_process_t *current;
+
+	if (aborted) {
+		while ((current = SLIST_FIRST(&ctx->process_list))) {
+			pink_easy_process_kill(current, SIGKILL);
+			PINK_EASY_REMOVE_PROCESS(ctx, current);
+		}
+	}
+	pink_easy_session_unlink(ctx);
+	if (ctx->callback_table.cleanup)
+		ctx->callback_table.cleanup(ctx);
+}
+
+static void session_check(pink_easy_session_t *session, unsigned i, int r)
+{
+	pink_easy_context_t *ctx = session->entries[i].ctx;
+
+	if (ctx == NULL)
+		return;
+	if (r < 0 || (ctx->nprocs == 0 && ctx->nparked == 0))
+		session_finish(session, i, r < 0);
+	else
+		session_set_parked(session, i);
+}
+
+static void orphan_add(pink_easy_session_t *session, pid_t pid)
+{
+	unsigned size;
+	pid_t *orphans;
+
+	if (session->norphans == session->orphans_size) {
+		size = session->orphans_size ? session->orphans_size * 2 : 16;
+		orphans = realloc(session->orphans, size * sizeof(pid_t));
+		if (orphans == NULL)
+			return; /* The thread stays stopped */
+		session->orphans = orphans;
+		session->orphans_size = size;
+	}
+	session->orphans[session->norphans++] = pid;
+}
+
+bool pink_easy_session_claim(pink_easy_session_t *session, pid_t pid)
+{
+	for (unsigned i = 0; i < session->norphans; i++) {
+		if (session->orphans[i] == pid) {
+			session->orphans[i] = session->orphans[--session->norphans];
+			return true;
+		}
+	}
+	return false;
+}
+
+pink_easy_session_t *pink_easy_session_new(void)
+{
+	pink_easy_session_t *session;
+
+	session = calloc(1, sizeof(pink_easy_session_t));
+	if (session == NULL)
+		return NULL;
+	if (!pink_easy_async_pipe(session->wakeup)) {
+		free(session);
+		return NULL;
+	}
+	session->wakeup_slot = -1;
+	return session;
+}
+
+void pink_easy_session_destroy(pink_easy_session_t *session)
+{
+	for (unsigned i = 0; i < session->nentries; i++) {
+		if (session->entries[i].ctx)
+			pink_easy_session_unlink(session->entries[i].ctx);
+	}
+	pink_easy_async_unregister(session->wakeup_slot);
+	close(session->wakeup[0]);
+	close(session->wakeup[1]);
+	free(session->entries);
+	free(session->orphans);
+	free(session);
+}
+
+bool pink_easy_session_add(pink_easy_session_t *session, pink_easy_context_t *ctx)
+{
+	unsigned size;
+	struct session_entry *entries;
+
+	if (ctx->session) {
+		errno = EBUSY;
+		return false;
+	}
+	if (ctx->nprocs == 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	if (session->nentries == session->size) {
+		size = session->size ? session->size * 2 : 16;
+		entries = realloc(session->entries, size * sizeof(struct session_entry));
+		if (entries == NULL)
+			return false;
+		session->entries = entries;
+		session->size = size;
+	}
+	session->entries[session->nentries].ctx = ctx;
+	session->entries[session->nentries].parked = false;
+	ctx->session = session;
+	ctx->wakeup_fd = session->wakeup[1];
+	session_set_parked(session, session->nentries);
+	session->nentries++;
+	session->count++;
+	return true;
+}
+
+bool pink_easy_session_remove(pink_easy_session_t *session, pink_easy_context_t *ctx)
+{
+	if (ctx->session != session) {
+		errno = ENOENT;
+		return false;
+	}
+	if (ctx->nprocs != 0 || ctx->nparked != 0) {
+		errno = EBUSY;
+		return false;
+	}
+	pink_easy_session_unlink(ctx);
+	return true;
+}
+
+unsigned pink_easy_session_count(const pink_easy_session_t *session)
+{
+	return session->count;
+}
+
+bool pink_easy_session_loop(pink_easy_session_t *session)
+{
+	int i, r, status;
+	pid_t pid;
+	uint64_t wait;
+
+	while (session->count != 0) {
+		if (session->holes)
+			session_compact(session);
+
+		if (session->nparked) {
+			/* Drains the wakeup pipe before waitpid(), so that
+			 * completions after this point wake us up again. */
+			pink_easy_async_register(session->wakeup[1], &session->wakeup_slot);
+			pink_easy_async_drain(session->wakeup[0]);
+			for (i = 0; (unsigned)i < session->nentries; i++) {
+				if (session->entries[i].parked) {
+					pink_easy_loop_handle_completions(session->entries[i].ctx);
+					session_check(session, i, 0);
+				}
+			}
+			if (!session->nparked)
+				continue;
+			pid = pink_easy_waitpid(&status, WNOHANG, &wait);
+			if (pid == 0) {
+				if (!pink_easy_async_poll(session->wakeup[0], session->wakeup_slot, -1))
+					return false;
+				continue;
+			}
+		} else {
+			pid = pink_easy_waitpid(&status, 0, &wait);
+		}
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != ECHILD)
+				return false;
+			/* Nothing is left to wait for, contexts with pending
+			 * decisions finish once these are completed */
+			for (i = 0; (unsigned)i < session->nentries; i++) {
+				if (session->entries[i].ctx && !session->entries[i].ctx->nparked)
+					session_finish(session, i, false);
+			}
+			if (session->nparked
+					&& !pink_easy_async_poll(session->wakeup[0], session->wakeup_slot, -1))
+				return false;
+			continue;
+		}
+
+		i = session_lookup(session, pid);
+		if (i < 0) {
+			/* A new thread or child whose parent hasn't reported it
+			 * yet, it stays stopped until then. */
+			if (WIFSTOPPED(status))
+				orphan_add(session, pid);
+			else
+				pink_easy_session_claim(session, pid);
+			continue;
+		}
+		session->entries[i].ctx->overhead_wait = wait;
+		r = pink_easy_loop_handle_event(session->entries[i].ctx, pid, status);
+		session_check(session, i, r);
+	}
+	return true;
+}
@@ -0,0 +1,802 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#ifndef CLOSE_RANGE_UNSHARE
+#define CLOSE_RANGE_UNSHARE	(1U << 1)
+#endif /* !CLOSE_RANGE_UNSHARE */
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC	(1U << 2)
+#endif /* !CLOSE_RANGE_CLOEXEC */
+
+/* Flags which only matter when the file is opened */
+#define OPEN_ONLY_FLAGS		(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC)
+/* Flags fcntl(F_SETFL) may change */
+#define SETFL_FLAGS		(O_APPEND | O_ASYNC | O_DIRECT | O_NOATIME | O_NONBLOCK)
+
+/* System calls updating the shadow tables */
+enum {
+	SHADOW_OPEN = 0,
+	SHADOW_OPENAT,
+	SHADOW_OPENAT2,
+	SHADOW_CREAT,
+	SHADOW_DUP,
+	SHADOW_DUP2,
+	SHADOW_DUP3,
+	SHADOW_FCNTL,
+	SHADOW_FCNTL64,
+	SHADOW_CLOSE,
+	SHADOW_CLOSE_RANGE,
+	SHADOW_CHDIR,
+	SHADOW_FCHDIR,
+	SHADOW_SOCKET,
+	SHADOW_CONNECT,
+	SHADOW_ACCEPT,
+	SHADOW_ACCEPT4,
+	SHADOW_SOCKETCALL,
+	SHADOW_UNSHARE,
+};
+
+static const char *const shadow_names[PINK_EASY_SHADOW_NSYSCALLS] = {
+	[SHADOW_OPEN] = "open",
+	[SHADOW_OPENAT] = "openat",
+	[SHADOW_OPENAT2] = "openat2",
+	[SHADOW_CREAT] = "creat",
+	[SHADOW_DUP] = "dup",
+	[SHADOW_DUP2] = "dup2",
+	[SHADOW_DUP3] = "dup3",
+	[SHADOW_FCNTL] = "fcntl",
+	[SHADOW_FCNTL64] = "fcntl64",
+	[SHADOW_CLOSE] = "close",
+	[SHADOW_CLOSE_RANGE] = "close_range",
+	[SHADOW_CHDIR] = "chdir",
+	[SHADOW_FCHDIR] = "fchdir",
+	[SHADOW_SOCKET] = "socket",
+	[SHADOW_CONNECT] = "connect",
+	[SHADOW_ACCEPT] = "accept",
+	[SHADOW_ACCEPT4] = "accept4",
+	[SHADOW_SOCKETCALL] = "socketcall",
+	[SHADOW_UNSHARE] = "unshare",
+};
+
+static long shadow_lookup(unsigned op, pink_bitness_t bitness)
+{
+	long scno;
+
+	scno = pink_name_lookup(shadow_names[op], bitness);
+	if (scno >= 0 || bitness != PINKTRACE_BITNESS_DEFAULT)
+		return scno;
+
+	/* System calls newer than the name tables */
+	switch (op) {
+#ifdef __NR_openat2
+	case SHADOW_OPENAT2:
+		return __NR_openat2;
+#endif /* __NR_openat2 */
+#ifdef __NR_close_range
+	case SHADOW_CLOSE_RANGE:
+		return __NR_close_range;
+#endif /* __NR_close_range */
+	default:
+		return -1;
+	}
+}
+
+static void fd_free(struct pink_easy_shadow_fd *e)
+{
+	if (!e)
+		return;
+	free(e->path);
+	free(e->addr);
+	free(e);
+}
+
+/* Takes over the path, NULL on failure */
+static struct pink_easy_shadow_fd *fd_new(pink_easy_fd_type_t type, int flags, char *path)
+{
+	struct pink_easy_shadow_fd *e;
+
+	e = calloc(1, sizeof(struct pink_easy_shadow_fd));
+	if (!e) {
+		free(path);
+		return NULL;
+	}
+	e->type = type;
+	e->flags = flags;
+	e->path = path;
+	return e;
+}
+
+/* NULL on failure, which leaves the copy to be looked up in /proc */
+static struct pink_easy_shadow_fd *fd_copy(const struct pink_easy_shadow_fd *e)
+{
+	struct pink_easy_shadow_fd *copy;
+
+	if (!e)
+		return NULL;
+	copy = fd_new(e->type, e->flags, NULL);
+	if (!copy)
+		return NULL;
+	if ((e->path && !(copy->path = strdup(e->path)))
+			|| (e->addr && !(copy->addr = malloc(sizeof(pink_socket_address_t))))) {
+		fd_free(copy);
+		return NULL;
+	}
+	if (e->addr)
+		memcpy(copy->addr, e->addr, sizeof(pink_socket_address_t));
+	return copy;
+}
+
+static struct pink_easy_shadow_fd *fd_get(const struct pink_easy_group *files, long fd)
+{
+	if (!files || fd < 0 || (unsigned long)fd >= files->nfds)
+		return NULL;
+	return files->fds[fd];
+}
+
+/* Replace the entry of the file descriptor, NULL leaves it to be looked up
+ * in /proc. Returns false if the entry couldn't be stored, which is then
+ * the caller's to free. */
+static bool fd_store(struct pink_easy_group *files, long fd, struct pink_easy_shadow_fd *e)
+{
+	unsigned n;
+	struct pink_easy_shadow_fd **fds;
+
+	if (!files || fd < 0 || fd >= PINK_EASY_SHADOW_FD_MAX)
+		return !e;
+	if ((unsigned long)fd >= files->nfds) {
+		if (!e)
+			return true;
+		n = files->nfds ? files->nfds : 16;
+		while (n <= (unsigned long)fd)
+			n *= 2;
+		fds = realloc(files->fds, n * sizeof(struct pink_easy_shadow_fd *));
+		if (!fds)
+			return false;
+		memset(fds + files->nfds, 0, (n - files->nfds) * sizeof(struct pink_easy_shadow_fd *));
+		files->fds = fds;
+		files->nfds = n;
+	}
+	fd_free(files->fds[fd]);
+	files->fds[fd] = e;
+	return true;
+}
+
+static void fd_replace(struct pink_easy_group *files, long fd, struct pink_easy_shadow_fd *e)
+{
+	if (!fd_store(files, fd, e)) {
+		fd_free(e);
+		fd_store(files, fd, NULL);
+	}
+}
+
+static char *proc_readlink(const char *path)
+{
+	ssize_t n;
+	size_t size;
+	char *buf, *nbuf;
+
+	for (size = 128;; size *= 2) {
+		buf = malloc(size);
+		if (!buf)
+			return NULL;
+		n = readlink(path, buf, size);
+		if (n < 0) {
+			free(buf);
+			return NULL;
+		}
+		if ((size_t)n < size) {
+			buf[n] = '\0';
+			nbuf = realloc(buf, n + 1);
+			return nbuf ? nbuf : buf;
+		}
+		free(buf);
+	}
+}
+
+static struct pink_easy_shadow_fd *fd_proc(pid_t pid, long fd)
+{
+	int flags;
+	char path[64], line[128], *target;
+	FILE *f;
+	pink_easy_fd_type_t type;
+
+	snprintf(path, sizeof(path), "/proc/%ld/fd/%ld", (long)pid, fd);
+	target = proc_readlink(path);
+	if (!target) {
+		if (errno == ENOENT)
+			errno = EBADF;
+		return NULL;
+	}
+
+	flags = 0;
+	snprintf(path, sizeof(path), "/proc/%ld/fdinfo/%ld", (long)pid, fd);
+	f = fopen(path, "r");
+	if (f) {
+		while (fgets(line, sizeof(line), f))
+			if (sscanf(line, "flags: %o", (unsigned *)&flags) == 1)
+				break;
+		fclose(f);
+	}
+
+	if (target[0] == '/')
+		type = PINK_EASY_FD_FILE;
+	else if (!strncmp(target, "socket:", 7))
+		type = PINK_EASY_FD_SOCKET;
+	else
+		type = PINK_EASY_FD_OTHER;
+	return fd_new(type, flags, target);
+}
+
+/* The group of the process whose shadow table is kept, NULL if none is.
+ * Quiet members change the tables of their groups behind our back. */
+static struct pink_easy_group *shadow_group(const pink_easy_process_t *proc,
+		pink_easy_group_type_t type)
+{
+	struct pink_easy_group *group = proc->groups[type];
+
+	if (!proc->ctx->shadow || proc->flags & PINK_EASY_PROCESS_QUIET
+			|| !group || group->quiet)
+		return NULL;
+	return group;
+}
+
+/* Look the file descriptor up, in /proc unless it is in the shadow table.
+ * Entries read from /proc are kept in the table if the context keeps
+ * shadow tables, otherwise *tmp is set and the entry is to be freed. */
+static struct pink_easy_shadow_fd *fd_lookup(const pink_easy_process_t *proc, long fd, bool *tmp)
+{
+	struct pink_easy_group *files;
+	struct pink_easy_shadow_fd *e;
+
+	*tmp = false;
+	if (fd < 0) {
+		errno = EBADF;
+		return NULL;
+	}
+	files = shadow_group(proc, PINK_EASY_GROUP_FILES);
+	e = fd_get(files, fd);
+	if (e)
+		return e;
+
+	e = fd_proc(proc->pid, fd);
+	if (!e)
+		return NULL;
+	if (!files || !fd_store(files, fd, e))
+		*tmp = true;
+	return e;
+}
+
+static char *cwd_lookup(const pink_easy_process_t *proc, bool *tmp)
+{
+	char path[32], *cwd;
+	struct pink_easy_group *fs;
+
+	*tmp = false;
+	fs = shadow_group(proc, PINK_EASY_GROUP_FS);
+	if (fs && fs->cwd)
+		return fs->cwd;
+
+	snprintf(path, sizeof(path), "/proc/%ld/cwd", (long)proc->pid);
+	cwd = proc_readlink(path);
+	if (!cwd)
+		return NULL;
+	if (fs)
+		fs->cwd = cwd;
+	else
+		*tmp = true;
+	return cwd;
+}
+
+static bool copy_out(char *buf, size_t len, const char *str)
+{
+	size_t n;
+
+	n = strlen(str);
+	if (n >= len) {
+		errno = ERANGE;
+		return false;
+	}
+	memcpy(buf, str, n + 1);
+	return true;
+}
+
+bool pink_easy_context_set_shadow(pink_easy_context_t *ctx, bool shadow)
+{
+	long scno;
+
+	/* Processes already traced would have stale tables */
+	if (ctx->nprocs > 0) {
+		errno = EBUSY;
+		return false;
+	}
+
+	ctx->shadow = shadow;
+	memset(ctx->shadow_mask, 0, sizeof(ctx->shadow_mask));
+	for (unsigned b = 0; b < 2; b++) {
+		for (unsigned op = 0; op < PINK_EASY_SHADOW_NSYSCALLS; op++) {
+			scno = shadow_lookup(op, b);
+			ctx->shadow_scno[b][op] = scno;
+			if (shadow && scno >= 0 && scno < PINK_EASY_SYSCALL_MAX)
+				ctx->shadow_mask[b][scno / PINK_EASY_MASK_BITS] |= (1UL << (scno % PINK_EASY_MASK_BITS));
+		}
+	}
+	return true;
+}
+
+bool pink_easy_process_get_cwd(const pink_easy_process_t *proc, char *buf, size_t len)
+{
+	bool tmp, r;
+	char *cwd;
+
+	cwd = cwd_lookup(proc, &tmp);
+	if (!cwd)
+		return false;
+	r = copy_out(buf, len, cwd);
+	if (tmp)
+		free(cwd);
+	return r;
+}
+
+bool pink_easy_process_get_fd_path(const pink_easy_process_t *proc, long fd,
+		char *buf, size_t len)
+{
+	bool tmp, r;
+	char path[64], *target;
+	struct pink_easy_shadow_fd *e;
+
+	e = fd_lookup(proc, fd, &tmp);
+	if (!e)
+		return false;
+	if (e->path) {
+		r = copy_out(buf, len, e->path);
+	} else {
+		/* Sockets created under our eyes have no path yet */
+		snprintf(path, sizeof(path), "/proc/%ld/fd/%ld", (long)proc->pid, fd);
+		target = proc_readlink(path);
+		r = target && copy_out(buf, len, target);
+		if (target && !tmp)
+			e->path = target;
+		else
+			free(target);
+	}
+	if (tmp)
+		fd_free(e);
+	return r;
+}
+
+bool pink_easy_process_get_fd_type(const pink_easy_process_t *proc, long fd,
+		pink_easy_fd_type_t *type)
+{
+	bool tmp;
+	struct pink_easy_shadow_fd *e;
+
+	e = fd_lookup(proc, fd, &tmp);
+	if (!e)
+		return false;
+	*type = e->type;
+	if (tmp)
+		fd_free(e);
+	return true;
+}
+
+int pink_easy_process_get_fd_flags(const pink_easy_process_t *proc, long fd)
+{
+	int flags;
+	bool tmp;
+	struct pink_easy_shadow_fd *e;
+
+	e = fd_lookup(proc, fd, &tmp);
+	if (!e)
+		return -1;
+	flags = e->flags;
+	if (tmp)
+		fd_free(e);
+	return flags;
+}
+
+bool pink_easy_process_get_fd_address(const pink_easy_process_t *proc, long fd,
+		pink_socket_address_t *addr)
+{
+	bool tmp, r;
+	struct pink_easy_shadow_fd *e;
+
+	e = fd_lookup(proc, fd, &tmp);
+	if (!e)
+		return false;
+	r = false;
+	if (e->type != PINK_EASY_FD_SOCKET) {
+		errno = ENOTSOCK;
+	} else if (!e->addr) {
+		errno = ENOTCONN;
+	} else {
+		memcpy(addr, e->addr, sizeof(pink_socket_address_t));
+		r = true;
+	}
+	if (tmp)
+		fd_free(e);
+	return r;
+}
+
+bool pink_easy_process_resolve_at(const pink_easy_process_t *proc, long dirfd,
+		const char *path, char *buf, size_t len)
+{
+	int n;
+	bool tmp, r;
+	const char *base;
+	char *cwd;
+	struct pink_easy_shadow_fd *e;
+
+	if (path[0] == '/')
+		return copy_out(buf, len, path);
+
+	e = NULL;
+	cwd = NULL;
+	if ((int)dirfd == AT_FDCWD) {
+		base = cwd = cwd_lookup(proc, &tmp);
+		if (!base)
+			return false;
+	} else {
+		e = fd_lookup(proc, dirfd, &tmp);
+		if (!e)
+			return false;
+		base = e->path;
+		if (e->type != PINK_EASY_FD_FILE || !base) {
+			if (tmp)
+				fd_free(e);
+			errno = ENOTDIR;
+			return false;
+		}
+	}
+
+	r = true;
+	if (!path[0]) {
+		r = copy_out(buf, len, base);
+	} else {
+		n = snprintf(buf, len, "%s%s%s", base,
+				base[strlen(base) - 1] == '/' ? "" : "/", path);
+		if (n < 0 || (size_t)n >= len) {
+			errno = ERANGE;
+			r = false;
+		}
+	}
+	if (tmp) {
+		free(cwd);
+		fd_free(e);
+	}
+	return r;
+}
+
+bool pink_easy_shadow_interested(const pink_easy_context_t *ctx,
+		pink_bitness_t bitness, long scno)
+{
+	if (!ctx->shadow || (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64))
+		return false;
+	return pink_easy_mask_test(ctx->shadow_mask[bitness], PINK_EASY_SYSCALL_MAX, scno);
+}
+
+static bool get_arg(const pink_easy_process_t *current, bool socketcall,
+		unsigned ind, long *arg)
+{
+	if (socketcall)
+		return pink_decode_socket_fd(current->pid, current->bitness, ind, arg);
+	return pink_util_get_arg(current->pid, current->bitness, ind, arg);
+}
+
+/* Entry for a newly opened file, NULL if the path is unknown */
+static struct pink_easy_shadow_fd *shadow_open(pink_easy_process_t *current,
+		unsigned op, int flags)
+{
+	long dirfd;
+	unsigned ind;
+	char name[PATH_MAX], path[PATH_MAX], *copy;
+
+	dirfd = AT_FDCWD;
+	ind = 0;
+	if (op == SHADOW_OPENAT || op == SHADOW_OPENAT2) {
+		if (!pink_util_get_arg(current->pid, current->bitness, 0, &dirfd))
+			return NULL;
+		ind = 1;
+	}
+#ifdef O_TMPFILE
+	/* The file has no name */
+	if ((flags & O_TMPFILE) == O_TMPFILE)
+		return NULL;
+#endif /* O_TMPFILE */
+	if (!pink_decode_string(current->pid, current->bitness, ind, name, sizeof(name))
+			|| strnlen(name, sizeof(name)) >= sizeof(name) - 1
+			|| !pink_easy_process_resolve_at(current, dirfd, name, path, sizeof(path)))
+		return NULL;
+	copy = strdup(path);
+	if (!copy)
+		return NULL;
+	return fd_new(PINK_EASY_FD_FILE, flags & ~OPEN_ONLY_FLAGS, copy);
+}
+
+static void shadow_dup(struct pink_easy_group *files, long oldfd, long newfd, bool cloexec)
+{
+	struct pink_easy_shadow_fd *e;
+
+	if (oldfd == newfd)
+		return;
+	e = fd_copy(fd_get(files, oldfd));
+	if (e) {
+		e->flags &= ~O_CLOEXEC;
+		if (cloexec)
+			e->flags |= O_CLOEXEC;
+	}
+	fd_replace(files, newfd, e);
+}
+
+static void shadow_socket(struct pink_easy_group *files, long fd, long type)
+{
+	int flags;
+
+	flags = O_RDWR;
+	if (type & SOCK_NONBLOCK)
+		flags |= O_NONBLOCK;
+	if (type & SOCK_CLOEXEC)
+		flags |= O_CLOEXEC;
+	fd_replace(files, fd, fd_new(PINK_EASY_FD_SOCKET, flags, NULL));
+}
+
+static void shadow_connect(pink_easy_process_t *current, bool socketcall)
+{
+	bool tmp;
+	long fd;
+	pink_socket_address_t addr;
+	struct pink_easy_shadow_fd *e;
+
+	if (!get_arg(current, socketcall, 0, &fd)
+			|| !pink_decode_socket_address(current->pid, current->bitness, 1, NULL, &addr)
+			|| addr.family == -1)
+		return;
+	e = fd_lookup(current, fd, &tmp);
+	if (!e)
+		return;
+	if (!tmp && e->type == PINK_EASY_FD_SOCKET) {
+		if (!e->addr)
+			e->addr = malloc(sizeof(pink_socket_address_t));
+		if (e->addr)
+			memcpy(e->addr, &addr, sizeof(pink_socket_address_t));
+	}
+	if (tmp)
+		fd_free(e);
+}
+
+void pink_easy_shadow_leave(const pink_easy_context_t *ctx,
+		pink_easy_process_t *current)
+{
+	bool socketcall;
+	unsigned op;
+	long ret, arg[4], subcall;
+	uint64_t how;
+	struct pink_easy_group *files, *fs;
+	struct pink_easy_shadow_fd *e;
+
+	if (!pink_easy_shadow_interested(ctx, current->bitness, current->scno))
+		return;
+	for (op = 0; op < PINK_EASY_SHADOW_NSYSCALLS; op++)
+		if (ctx->shadow_scno[current->bitness][op] == current->scno)
+			break;
+	if (op == PINK_EASY_SHADOW_NSYSCALLS)
+		return;
+	if (!pink_util_get_return(current->pid, &ret))
+		return;
+
+	socketcall = false;
+	if (op == SHADOW_SOCKETCALL) {
+		if (!pink_decode_socket_call(current->pid, current->bitness, &subcall))
+			return;
+		socketcall = true;
+		switch (subcall) {
+		case PINK_SOCKET_SUBCALL_SOCKET:
+			op = SHADOW_SOCKET;
+			break;
+		case PINK_SOCKET_SUBCALL_CONNECT:
+			op = SHADOW_CONNECT;
+			break;
+		case PINK_SOCKET_SUBCALL_ACCEPT:
+			op = SHADOW_ACCEPT;
+			break;
+		case PINK_SOCKET_SUBCALL_ACCEPT4:
+			op = SHADOW_ACCEPT4;
+			break;
+		default:
+			return;
+		}
+	}
+	/* Failed system calls change nothing, a connect in progress will
+	 * connect the socket */
+	if (ret < 0 && !(op == SHADOW_CONNECT && ret == -EINPROGRESS))
+		return;
+
+	for (unsigned i = 0; i < 4; i++)
+		arg[i] = 0;
+	for (unsigned i = 0; i < 3; i++)
+		if (!get_arg(current, socketcall, i, &arg[i]))
+			return;
+	if (op == SHADOW_ACCEPT4 && !get_arg(current, socketcall, 3, &arg[3]))
+		return;
+
+	files = shadow_group(current, PINK_EASY_GROUP_FILES);
+	fs = shadow_group(current, PINK_EASY_GROUP_FS);
+	switch (op) {
+	case SHADOW_OPEN:
+		fd_replace(files, ret, shadow_open(current, op, (int)arg[1]));
+		break;
+	case SHADOW_OPENAT:
+		fd_replace(files, ret, shadow_open(current, op, (int)arg[2]));
+		break;
+	case SHADOW_OPENAT2:
+		/* struct open_how starts with the flags */
+		if (!pink_util_moven(current->pid, arg[2], (char *)&how, sizeof(how)))
+			fd_replace(files, ret, NULL);
+		else
+			fd_replace(files, ret, shadow_open(current, op, (int)how));
+		break;
+	case SHADOW_CREAT:
+		fd_replace(files, ret, shadow_open(current, op, O_CREAT | O_WRONLY | O_TRUNC));
+		break;
+	case SHADOW_DUP:
+		shadow_dup(files, arg[0], ret, false);
+		break;
+	case SHADOW_DUP2:
+		shadow_dup(files, arg[0], arg[1], false);
+		break;
+	case SHADOW_DUP3:
+		shadow_dup(files, arg[0], arg[1], arg[2] & O_CLOEXEC);
+		break;
+	case SHADOW_FCNTL:
+	case SHADOW_FCNTL64:
+		e = fd_get(files, arg[0]);
+		switch ((int)arg[1]) {
+		case F_DUPFD:
+			shadow_dup(files, arg[0], ret, false);
+			break;
+		case F_DUPFD_CLOEXEC:
+			shadow_dup(files, arg[0], ret, true);
+			break;
+		case F_SETFD:
+			if (e && arg[2] & FD_CLOEXEC)
+				e->flags |= O_CLOEXEC;
+			else if (e)
+				e->flags &= ~O_CLOEXEC;
+			break;
+		case F_SETFL:
+			if (e)
+				e->flags = (e->flags & ~SETFL_FLAGS) | (arg[2] & SETFL_FLAGS);
+			break;
+		default:
+			break;
+		}
+		break;
+	case SHADOW_CLOSE:
+		fd_replace(files, arg[0], NULL);
+		break;
+	case SHADOW_CLOSE_RANGE:
+		if (arg[2] & CLOSE_RANGE_UNSHARE) {
+			pink_easy_group_unshare(current, CLONE_FILES);
+			files = shadow_group(current, PINK_EASY_GROUP_FILES);
+		}
+		if (!files)
+			break;
+		for (unsigned long fd = (unsigned)arg[0]; fd <= (unsigned)arg[1] && fd < files->nfds; fd++) {
+			if (!(arg[2] & CLOSE_RANGE_CLOEXEC))
+				fd_replace(files, fd, NULL);
+			else if (files->fds[fd])
+				files->fds[fd]->flags |= O_CLOEXEC;
+		}
+		break;
+	case SHADOW_CHDIR:
+	case SHADOW_FCHDIR:
+		if (!fs)
+			break;
+		free(fs->cwd);
+		fs->cwd = NULL;
+		if (op == SHADOW_FCHDIR) {
+			e = fd_get(files, arg[0]);
+			if (e && e->type == PINK_EASY_FD_FILE && e->path)
+				fs->cwd = strdup(e->path);
+		} else {
+			/* Relative names and symbolic links are resolved by the
+			 * kernel, the new directory is read back once */
+			char path[32];
+			snprintf(path, sizeof(path), "/proc/%ld/cwd", (long)current->pid);
+			fs->cwd = proc_readlink(path);
+		}
+		break;
+	case SHADOW_SOCKET:
+		shadow_socket(files, ret, arg[1]);
+		break;
+	case SHADOW_ACCEPT:
+		shadow_socket(files, ret, 0);
+		break;
+	case SHADOW_ACCEPT4:
+		shadow_socket(files, ret, arg[3]);
+		break;
+	case SHADOW_CONNECT:
+		shadow_connect(current, socketcall);
+		break;
+	case SHADOW_UNSHARE:
+		pink_easy_group_unshare(current, (unsigned long)arg[0]);
+		break;
+	default:
+		break;
+	}
+}
+
+void pink_easy_shadow_copy(struct pink_easy_group *group,
+		const struct pink_easy_group *from)
+{
+	if (from->nfds) {
+		group->fds = calloc(from->nfds, sizeof(struct pink_easy_shadow_fd *));
+		if (group->fds) {
+			group->nfds = from->nfds;
+			for (unsigned i = 0; i < from->nfds; i++)
+				group->fds[i] = fd_copy(from->fds[i]);
+		}
+	}
+	if (from->cwd)
+		group->cwd = strdup(from->cwd);
+}
+
+void pink_easy_shadow_exec(struct pink_easy_group *group)
+{
+	for (unsigned i = 0; i < group->nfds; i++) {
+		if (group->fds[i] && group->fds[i]->flags & O_CLOEXEC) {
+			fd_free(group->fds[i]);
+			group->fds[i] = NULL;
+		}
+	}
+}
+
+void pink_easy_shadow_free(struct pink_easy_group *group)
+{
+	for (unsigned i = 0; i < group->nfds; i++)
+		fd_free(group->fds[i]);
+	free(group->fds);
+	free(group->cwd);
+	group->fds = NULL;
+	group->nfds = 0;
+	group->cwd = NULL;
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+/* Counters are written by their thread only, so increments need no atomic
+ * read-modify-write; the atomic accesses keep concurrent snapshots well
+ * defined. */
+static inline void counter_add(uint64_t *counter, uint64_t n)
+{
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+unsigned pink_easy_stats_bucket(uint64_t ns)
+{
+	unsigned e, bucket;
+
+	if (ns < 4)
+		return ns;
+	e = 63 - __builtin_clzll(ns);
+	bucket = 4 * (e - 1) + ((ns >> (e - 2)) & 3);
+	return bucket < PINK_EASY_STATS_BUCKETS ? bucket : PINK_EASY_STATS_BUCKETS - 1;
+}
+
+uint64_t pink_easy_stats_bucket_min(unsigned bucket)
+{
+	if (bucket < 4)
+		return bucket;
+	return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+/* Returns the counter of the calling thread, NULL if allocation fails */
+static struct pink_easy_stats_counter *counter_get(pink_easy_stats_t *stats,
+		pink_bitness_t bitness, long scno)
+{
+	struct pink_easy_stats_shard *shard;
+	struct pink_easy_stats_counter *counter;
+
+	if (scno < 0 || scno >= PINK_EASY_SYSCALL_MAX || (bitness != PINK_BITNESS_32 && bitness != PINK_BITNESS_64))
+		return NULL;
+
+	shard = pthread_getspecific(stats->key);
+	if (!shard) {
+		shard = calloc(1, sizeof(struct pink_easy_stats_shard));
+		if (!shard)
+			return NULL;
+		if (pthread_setspecific(stats->key, shard)) {
+			free(shard);
+			return NULL;
+		}
+		pthread_mutex_lock(&stats->lock);
+		shard->next = stats->shards;
+		stats->shards = shard;
+		pthread_mutex_unlock(&stats->lock);
+	}
+
+	counter = shard->counters[bitness][scno];
+	if (!counter) {
+		counter = calloc(1, sizeof(struct pink_easy_stats_counter));
+		if (!counter)
+			return NULL;
+		__atomic_store_n(&shard->counters[bitness][scno], counter, __ATOMIC_RELEASE);
+	}
+	return counter;
+}
+
+void pink_easy_stats_enter(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	struct pink_easy_stats_counter *counter;
+
+	counter = counter_get(ctx->stats, current->bitness, current->scno);
+	if (!counter)
+		return;
+	counter_add(&counter->calls, 1);
+	current->stats_scno = current->scno;
+	current->stats_bitness = current->bitness;
+	current->stats_start = pink_easy_clock();
+}
+
+void pink_easy_stats_leave(pink_easy_context_t *ctx, pink_easy_process_t *current)
+{
+	long retval;
+	uint64_t elapsed;
+	struct pink_easy_stats_counter *counter;
+
+	elapsed = pink_easy_clock() - current->stats_start;
+	counter = ctx->stats ? counter_get(ctx->stats, current->stats_bitness, current->stats_scno) : NULL;
+	current->stats_scno = -1;
+	if (!counter)
+		return;
+
+	if (current->flags & PINK_EASY_PROCESS_DENY)
+		retval = current->retval;
+	else if (!pink_util_get_return(current->pid, &retval))
+		retval = 0;
+	if (retval < 0 && retval >= -4095)
+		counter_add(&counter->errors, 1);
+	counter_add(&counter->time, elapsed);
+	counter_add(&counter->buckets[pink_easy_stats_bucket(elapsed)], 1);
+}
+
+void pink_easy_stats_stop(pink_easy_context_t *ctx, pink_bitness_t bitness,
+		long scno, uint64_t elapsed)
+{
+	struct pink_easy_stats_counter *counter;
+
+	counter = counter_get(ctx->stats, bitness, scno);
+	if (counter)
+		counter_add(&counter->stop_time, elapsed);
+}
+
+pink_easy_stats_t *pink_easy_stats_new(void)
+{
+	pink_easy_stats_t *stats;
+
+	stats = calloc(1, sizeof(pink_easy_stats_t));
+	if (!stats)
+		return NULL;
+	errno = pthread_key_create(&stats->key, NULL);
+	if (errno) {
+		free(stats);
+		return NULL;
+	}
+	pthread_mutex_init(&stats->lock, NULL);
+	return stats;
+}
+
+static void shard_free_counters(struct pink_easy_stats_shard *shard)
+{
+	for (unsigned b = 0; b < 2; b++)
+		for (unsigned scno = 0; scno < PINK_EASY_SYSCALL_MAX; scno++)
+			free(shard->counters[b][scno]);
+}
+
+void pink_easy_stats_free(pink_easy_stats_t *stats)
+{
+	struct pink_easy_stats_shard *shard, *next;
+
+	for (shard = stats->shards; shard; shard = next) {
+		next = shard->next;
+		shard_free_counters(shard);
+		free(shard);
+	}
+	shard_free_counters(&stats->base);
+	pthread_mutex_destroy(&stats->lock);
+	pthread_key_delete(stats->key);
+	free(stats);
+}
+
+void pink_easy_context_set_stats(pink_easy_context_t *ctx, pink_easy_stats_t *stats)
+{
+	ctx->stats = stats;
+}
+
+/* Sum the counters of all threads, with the lock held.
+ * Returns false if nothing was counted. */
+static bool stats_sum(pink_easy_stats_t *stats, unsigned b, unsigned scno,
+		struct pink_easy_stats_counter *sum)
+{
+	bool found;
+	struct pink_easy_stats_shard *shard;
+	const struct pink_easy_stats_counter *counter;
+
+	found = false;
+	memset(sum, 0, sizeof(struct pink_easy_stats_counter));
+	for (shard = stats->shards; shard; shard = shard->next) {
+		counter = __atomic_load_n(&shard->counters[b][scno], __ATOMIC_ACQUIRE);
+		if (!counter)
+			continue;
+		found = true;
+		sum->calls += __atomic_load_n(&counter->calls, __ATOMIC_RELAXED);
+		sum->errors += __atomic_load_n(&counter->errors, __ATOMIC_RELAXED);
+		sum->time += __atomic_load_n(&counter->time, __ATOMIC_RELAXED);
+		sum->stop_time += __atomic_load_n(&counter->stop_time, __ATOMIC_RELAXED);
+		for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++)
+			sum->buckets[i] += __atomic_load_n(&counter->buckets[i], __ATOMIC_RELAXED);
+	}
+	return found;
+}
+
+bool pink_easy_stats_snapshot(pink_easy_stats_t *stats,
+		pink_easy_stats_entry_t **entries, size_t *count)
+{
+	size_t n, alloc;
+	struct pink_easy_stats_counter sum;
+	const struct pink_easy_stats_counter *base;
+	pink_easy_stats_entry_t *entry, *list;
+
+	n = alloc = 0;
+	list = NULL;
+	pthread_mutex_lock(&stats->lock);
+	for (unsigned b = 0; b < 2; b++) {
+		for (unsigned scno = 0; scno < PINK_EASY_SYSCALL_MAX; scno++) {
+			if (!stats_sum(stats, b, scno, &sum))
+				continue;
+			base = stats->base.counters[b][scno];
+			if (sum.calls == (base ? base->calls : 0))
+				continue;
+
+			if (n == alloc) {
+				alloc = alloc ? alloc * 2 : 32;
+				entry = realloc(list, alloc * sizeof(pink_easy_stats_entry_t));
+				if (!entry) {
+					pthread_mutex_unlock(&stats->lock);
+					free(list);
+					return false;
+				}
+				list = entry;
+			}
+			entry = &list[n++];
+			entry->bitness = b;
+			entry->scno = scno;
+			entry->calls = sum.calls - (base ? base->calls : 0);
+			entry->errors = sum.errors - (base ? base->errors : 0);
+			entry->time = sum.time - (base ? base->time : 0);
+			entry->stop_time = sum.stop_time - (base ? base->stop_time : 0);
+			for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++)
+				entry->buckets[i] = sum.buckets[i] - (base ? base->buckets[i] : 0);
+		}
+	}
+	pthread_mutex_unlock(&stats->lock);
+
+	*entries = list;
+	*count = n;
+	return true;
+}
+
+void pink_easy_stats_reset(pink_easy_stats_t *stats)
+{
+	struct pink_easy_stats_counter sum, **base;
+
+	pthread_mutex_lock(&stats->lock);
+	for (unsigned b = 0; b < 2; b++) {
+		for (unsigned scno = 0; scno < PINK_EASY_SYSCALL_MAX; scno++) {
+			if (!stats_sum(stats, b, scno, &sum))
+				continue;
+			base = &stats->base.counters[b][scno];
+			if (!*base) {
+				*base = malloc(sizeof(struct pink_easy_stats_counter));
+				if (!*base)
+					continue;
+			}
+			memcpy(*base, &sum, sizeof(struct pink_easy_stats_counter));
+		}
+	}
+	pthread_mutex_unlock(&stats->lock);
+}
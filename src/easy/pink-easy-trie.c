@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pinktrace/easy/internal.h>
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* Upper limit on the number of automaton states */
+#define TRIE_STATES_MAX	(1U << 20)
+
+/* The automaton is built with the subset construction. A position of the
+ * nondeterministic automaton is a pattern and a token offset into it,
+ * packed as (pattern << 32 | offset). Each state of the deterministic
+ * automaton is a sorted set of positions. */
+struct trie_builder {
+	const pink_easy_trie_t *trie;
+
+	/* Positions of all states, back to back */
+	uint64_t *pool;
+	size_t pool_len, pool_alloc;
+	size_t *set_off;
+	unsigned *set_len;
+
+	/* Open addressing hash of states, index + 1, zero if empty */
+	unsigned *hash;
+	unsigned hash_size;
+
+	struct pink_easy_trie_state *states;
+	unsigned nstates, states_alloc;
+
+	unsigned char *edge_byte;
+	unsigned *edge_target;
+	unsigned nedges, edges_alloc;
+
+	/* Scratch set */
+	uint64_t *tmp;
+	size_t tmp_len, tmp_alloc;
+};
+
+#define POS(p, k)	(((uint64_t)(p) << 32) | (k))
+#define POS_PATTERN(x)	((unsigned)((x) >> 32))
+#define POS_OFFSET(x)	((unsigned)((x) & 0xffffffff))
+
+pink_easy_trie_t *pink_easy_trie_new(void)
+{
+	return calloc(1, sizeof(pink_easy_trie_t));
+}
+
+static void trie_free_compiled(pink_easy_trie_t *trie)
+{
+	free(trie->states);
+	free(trie->edge_byte);
+	free(trie->edge_target);
+	trie->states = NULL;
+	trie->edge_byte = NULL;
+	trie->edge_target = NULL;
+	trie->nstates = trie->nedges = 0;
+	trie->compiled = false;
+}
+
+void pink_easy_trie_destroy(pink_easy_trie_t *trie)
+{
+	for (unsigned i = 0; i < trie->npatterns; i++)
+		free(trie->patterns[i].tok);
+	free(trie->patterns);
+	trie_free_compiled(trie);
+	free(trie);
+}
+
+bool pink_easy_trie_add(pink_easy_trie_t *trie, const char *pattern, int value)
+{
+	size_t len;
+	unsigned n;
+	unsigned short *tok;
+	struct pink_easy_trie_pattern *p;
+
+	len = strlen(pattern);
+	if (!len || len >= UINT_MAX || value < 0) {
+		errno = EINVAL;
+		return false;
+	}
+
+	if (trie->npatterns == trie->patterns_alloc) {
+		n = trie->patterns_alloc ? trie->patterns_alloc * 2 : 16;
+		p = realloc(trie->patterns, n * sizeof(struct pink_easy_trie_pattern));
+		if (!p)
+			return false;
+		trie->patterns = p;
+		trie->patterns_alloc = n;
+	}
+
+	tok = malloc(len * sizeof(unsigned short));
+	if (!tok)
+		return false;
+
+	n = 0;
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = pattern[i];
+		if (c == '\\' && i + 1 < len) {
+			tok[n++] = (unsigned char)pattern[++i];
+		} else if (c == '*' && i + 1 < len && pattern[i + 1] == '*') {
+			while (i + 1 < len && pattern[i + 1] == '*')
+				i++;
+			tok[n++] = PINK_EASY_TRIE_DSTAR;
+		} else if (c == '*') {
+			tok[n++] = PINK_EASY_TRIE_STAR;
+		} else if (c == '?') {
+			tok[n++] = PINK_EASY_TRIE_ANY1;
+		} else {
+			tok[n++] = c;
+		}
+	}
+
+	p = &trie->patterns[trie->npatterns++];
+	p->tok = tok;
+	p->len = n;
+	p->value = value;
+	p->immediate = tok[n - 1] == '/' || tok[n - 1] == PINK_EASY_TRIE_DSTAR;
+	return true;
+}
+
+static int pos_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static bool tmp_push(struct trie_builder *b, uint64_t pos)
+{
+	if (b->tmp_len == b->tmp_alloc) {
+		size_t n = b->tmp_alloc ? b->tmp_alloc * 2 : 64;
+		uint64_t *t = realloc(b->tmp, n * sizeof(uint64_t));
+		if (!t)
+			return false;
+		b->tmp = t;
+		b->tmp_alloc = n;
+	}
+	b->tmp[b->tmp_len++] = pos;
+	return true;
+}
+
+/* Add the positions reachable by skipping wildcards which match the empty
+ * string, then sort and remove duplicates. */
+static bool tmp_close(struct trie_builder *b)
+{
+	size_t n = b->tmp_len;
+
+	for (size_t i = 0; i < n; i++) {
+		const struct pink_easy_trie_pattern *p = &b->trie->patterns[POS_PATTERN(b->tmp[i])];
+		unsigned k = POS_OFFSET(b->tmp[i]);
+		while (k < p->len && (p->tok[k] == PINK_EASY_TRIE_STAR || p->tok[k] == PINK_EASY_TRIE_DSTAR)) {
+			if (!tmp_push(b, POS(POS_PATTERN(b->tmp[i]), ++k)))
+				return false;
+		}
+	}
+
+	qsort(b->tmp, b->tmp_len, sizeof(uint64_t), pos_cmp);
+	n = 0;
+	for (size_t i = 0; i < b->tmp_len; i++) {
+		if (!n || b->tmp[n - 1] != b->tmp[i])
+			b->tmp[n++] = b->tmp[i];
+	}
+	b->tmp_len = n;
+	return true;
+}
+
+static unsigned set_hash(const uint64_t *set, size_t len)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		h ^= set[i];
+		h *= 1099511628211ULL;
+	}
+	return (unsigned)(h ^ (h >> 32));
+}
+
+static bool hash_grow(struct trie_builder *b)
+{
+	unsigned size = b->hash_size ? b->hash_size * 2 : 1024;
+	unsigned *hash = calloc(size, sizeof(unsigned));
+
+	if (!hash)
+		return false;
+	for (unsigned s = 0; s < b->nstates; s++) {
+		unsigned h = set_hash(b->pool + b->set_off[s], b->set_len[s]) & (size - 1);
+		while (hash[h])
+			h = (h + 1) & (size - 1);
+		hash[h] = s + 1;
+	}
+	free(b->hash);
+	b->hash = hash;
+	b->hash_size = size;
+	return true;
+}
+
+/* Look the scratch set up, adding a new state if it's not there yet.
+ * Returns the state, -1 for the empty set and -2 on failure. */
+static int intern(struct trie_builder *b)
+{
+	unsigned h, s;
+
+	if (!b->tmp_len)
+		return -1;
+	if (!tmp_close(b))
+		return -2;
+
+	if ((b->nstates + 1) * 2 > b->hash_size && !hash_grow(b))
+		return -2;
+	h = set_hash(b->tmp, b->tmp_len) & (b->hash_size - 1);
+	while ((s = b->hash[h])) {
+		s--;
+		if (b->set_len[s] == b->tmp_len
+				&& !memcmp(b->pool + b->set_off[s], b->tmp, b->tmp_len * sizeof(uint64_t)))
+			return s;
+		h = (h + 1) & (b->hash_size - 1);
+	}
+
+	if (b->nstates == TRIE_STATES_MAX) {
+		errno = E2BIG;
+		return -2;
+	}
+	if (b->nstates == b->states_alloc) {
+		unsigned n = b->states_alloc ? b->states_alloc * 2 : 64;
+		struct pink_easy_trie_state *states;
+		size_t *off;
+		unsigned *len;
+
+		if (!(states = realloc(b->states, n * sizeof(struct pink_easy_trie_state))))
+			return -2;
+		b->states = states;
+		if (!(off = realloc(b->set_off, n * sizeof(size_t))))
+			return -2;
+		b->set_off = off;
+		if (!(len = realloc(b->set_len, n * sizeof(unsigned))))
+			return -2;
+		b->set_len = len;
+		b->states_alloc = n;
+	}
+	if (b->pool_len + b->tmp_len > b->pool_alloc) {
+		size_t n = b->pool_alloc ? b->pool_alloc : 256;
+		uint64_t *pool;
+
+		while (n < b->pool_len + b->tmp_len)
+			n *= 2;
+		if (!(pool = realloc(b->pool, n * sizeof(uint64_t))))
+			return -2;
+		b->pool = pool;
+		b->pool_alloc = n;
+	}
+
+	s = b->nstates++;
+	memcpy(b->pool + b->pool_len, b->tmp, b->tmp_len * sizeof(uint64_t));
+	b->set_off[s] = b->pool_len;
+	b->set_len[s] = b->tmp_len;
+	b->pool_len += b->tmp_len;
+	memset(&b->states[s], 0, sizeof(struct pink_easy_trie_state));
+	b->hash[h] = s + 1;
+	return s;
+}
+
+/* Positions after reading byte c, c is -1 for "any byte other than slash
+ * which no literal in the set matches". */
+static int move(struct trie_builder *b, unsigned s, int c)
+{
+	b->tmp_len = 0;
+	for (unsigned i = 0; i < b->set_len[s]; i++) {
+		uint64_t pos = b->pool[b->set_off[s] + i];
+		const struct pink_easy_trie_pattern *p = &b->trie->patterns[POS_PATTERN(pos)];
+		unsigned k = POS_OFFSET(pos);
+		unsigned t;
+		uint64_t next;
+
+		if (k == p->len)
+			continue;
+		t = p->tok[k];
+		if (t == PINK_EASY_TRIE_DSTAR || (t == PINK_EASY_TRIE_STAR && c != '/'))
+			next = pos;
+		else if ((int)t == c || (t == PINK_EASY_TRIE_ANY1 && c != '/'))
+			next = pos + 1;
+		else
+			continue;
+		if (!tmp_push(b, next))
+			return -2;
+	}
+	return intern(b);
+}
+
+static bool add_edge(struct trie_builder *b, unsigned char c, unsigned target)
+{
+	if (b->nedges == b->edges_alloc) {
+		unsigned n = b->edges_alloc ? b->edges_alloc * 2 : 256;
+		unsigned char *eb;
+		unsigned *et;
+
+		if (!(eb = realloc(b->edge_byte, n)))
+			return false;
+		b->edge_byte = eb;
+		if (!(et = realloc(b->edge_target, n * sizeof(unsigned))))
+			return false;
+		b->edge_target = et;
+		b->edges_alloc = n;
+	}
+	b->edge_byte[b->nedges] = c;
+	b->edge_target[b->nedges] = target;
+	b->nedges++;
+	return true;
+}
+
+static bool build_state(struct trie_builder *b, unsigned s)
+{
+	int t, other;
+	unsigned char seen[256];
+	unsigned best_now = UINT_MAX, best_boundary = UINT_MAX;
+
+	memset(seen, 0, sizeof(seen));
+	seen['/'] = 1;
+	for (unsigned i = 0; i < b->set_len[s]; i++) {
+		uint64_t pos = b->pool[b->set_off[s] + i];
+		unsigned p = POS_PATTERN(pos);
+		unsigned k = POS_OFFSET(pos);
+		const struct pink_easy_trie_pattern *pat = &b->trie->patterns[p];
+
+		if (k == pat->len) {
+			/* Patterns added first win ties */
+			if (pat->immediate && p < best_now)
+				best_now = p;
+			else if (!pat->immediate && p < best_boundary)
+				best_boundary = p;
+		} else if (pat->tok[k] < 256) {
+			seen[pat->tok[k]] = 1;
+		}
+	}
+
+	if ((other = move(b, s, -1)) == -2)
+		return false;
+	b->states[s].other = other;
+	b->states[s].value_now = best_now == UINT_MAX ? -1 : b->trie->patterns[best_now].value;
+	b->states[s].value_boundary = best_boundary == UINT_MAX ? -1 : b->trie->patterns[best_boundary].value;
+	b->states[s].first = b->nedges;
+
+	for (unsigned c = 1; c < 256; c++) {
+		if (!seen[c])
+			continue;
+		if ((t = move(b, s, c)) == -2)
+			return false;
+		/* Bytes other than slash fall back to the "other" target */
+		if (t < 0 || (c != '/' && t == other))
+			continue;
+		if (!add_edge(b, c, t))
+			return false;
+	}
+	b->states[s].nedges = b->nedges - b->states[s].first;
+	return true;
+}
+
+/* A state is live if it matches or leads to a state which matches */
+static void mark_live(struct pink_easy_trie_state *states, unsigned nstates,
+		const unsigned *edge_target)
+{
+	bool changed;
+
+	for (unsigned s = 0; s < nstates; s++) {
+		if (states[s].value_now >= 0 || states[s].value_boundary >= 0)
+			states[s].flags |= PINK_EASY_TRIE_LIVE;
+	}
+
+	/* Targets mostly come after their sources, go backwards. */
+	do {
+		changed = false;
+		for (unsigned s = nstates; s-- > 0;) {
+			struct pink_easy_trie_state *st = &states[s];
+			bool live;
+
+			if (st->flags & PINK_EASY_TRIE_LIVE)
+				continue;
+			live = st->other >= 0 && states[st->other].flags & PINK_EASY_TRIE_LIVE;
+			for (unsigned e = 0; !live && e < st->nedges; e++)
+				live = states[edge_target[st->first + e]].flags & PINK_EASY_TRIE_LIVE;
+			if (live) {
+				st->flags |= PINK_EASY_TRIE_LIVE;
+				changed = true;
+			}
+		}
+	} while (changed);
+}
+
+bool pink_easy_trie_compile(pink_easy_trie_t *trie)
+{
+	bool ok = false;
+	struct trie_builder b;
+
+	memset(&b, 0, sizeof(struct trie_builder));
+	b.trie = trie;
+
+	if (trie->npatterns) {
+		for (unsigned p = 0; p < trie->npatterns; p++) {
+			if (!tmp_push(&b, POS(p, 0)))
+				goto out;
+		}
+		if (intern(&b) != 0)
+			goto out;
+		/* New states are appended while we go */
+		for (unsigned s = 0; s < b.nstates; s++) {
+			if (!build_state(&b, s))
+				goto out;
+		}
+	} else {
+		/* A start state which never matches */
+		b.states = calloc(1, sizeof(struct pink_easy_trie_state));
+		if (!b.states)
+			goto out;
+		b.states[0].other = b.states[0].value_now = b.states[0].value_boundary = -1;
+		b.nstates = 1;
+	}
+	mark_live(b.states, b.nstates, b.edge_target);
+
+	trie_free_compiled(trie);
+	trie->states = b.states;
+	trie->nstates = b.nstates;
+	trie->edge_byte = b.edge_byte;
+	trie->edge_target = b.edge_target;
+	trie->nedges = b.nedges;
+	trie->compiled = true;
+	b.states = NULL;
+	b.edge_byte = NULL;
+	b.edge_target = NULL;
+	ok = true;
+out:
+	free(b.pool);
+	free(b.set_off);
+	free(b.set_len);
+	free(b.hash);
+	free(b.tmp);
+	free(b.states);
+	free(b.edge_byte);
+	free(b.edge_target);
+	return ok;
+}
+
+static inline int trie_next(const pink_easy_trie_t *trie,
+		const struct pink_easy_trie_state *st, unsigned char c)
+{
+	const unsigned char *eb = trie->edge_byte + st->first;
+	unsigned lo = 0, hi = st->nedges;
+
+	/* Most states of path tries have a handful of edges */
+	if (hi <= 8) {
+		for (; lo < hi; lo++) {
+			if (eb[lo] == c)
+				return trie->edge_target[st->first + lo];
+		}
+	} else {
+		while (lo < hi) {
+			unsigned mid = (lo + hi) / 2;
+			if (eb[mid] == c)
+				return trie->edge_target[st->first + mid];
+			if (eb[mid] < c)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+	}
+	return c == '/' ? -1 : st->other;
+}
+
+void pink_easy_trie_cursor_init(const pink_easy_trie_t *trie,
+		pink_easy_trie_cursor_t *cursor)
+{
+	cursor->trie = trie;
+	cursor->state = 0;
+	cursor->value = -1;
+	cursor->done = !trie->compiled;
+}
+
+bool pink_easy_trie_feed(pink_easy_trie_cursor_t *cursor, const char *buf, size_t len)
+{
+	int next;
+	const pink_easy_trie_t *trie = cursor->trie;
+	const struct pink_easy_trie_state *st;
+
+	if (cursor->done)
+		return true;
+
+	st = &trie->states[cursor->state];
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = buf[i];
+
+		if (c == '\0') {
+			pink_easy_trie_finish(cursor);
+			return true;
+		}
+		if (c == '/' && st->value_boundary >= 0)
+			cursor->value = st->value_boundary;
+		if ((next = trie_next(trie, st, c)) < 0)
+			goto done;
+		cursor->state = next;
+		st = &trie->states[next];
+		if (st->value_now >= 0)
+			cursor->value = st->value_now;
+		if (!(st->flags & PINK_EASY_TRIE_LIVE))
+			goto done;
+	}
+	return false;
+done:
+	cursor->done = true;
+	return true;
+}
+
+int pink_easy_trie_finish(pink_easy_trie_cursor_t *cursor)
+{
+	if (!cursor->done) {
+		const struct pink_easy_trie_state *st = &cursor->trie->states[cursor->state];
+		if (st->value_boundary >= 0)
+			cursor->value = st->value_boundary;
+		cursor->done = true;
+	}
+	return cursor->value;
+}
+
+int pink_easy_trie_match(const pink_easy_trie_t *trie, const char *path)
+{
+	pink_easy_trie_cursor_t cursor;
+
+	pink_easy_trie_cursor_init(trie, &cursor);
+	pink_easy_trie_feed(&cursor, path, strlen(path));
+	return pink_easy_trie_finish(&cursor);
+}
+
+bool pink_easy_trie_match_string(const pink_easy_trie_t *trie, pid_t pid,
+		pink_bitness_t bitness, unsigned ind, int *value)
+{
+	static long pagesize;
+	long addr;
+	size_t total;
+	char buf[256];
+	pink_easy_trie_cursor_t cursor;
+
+	if (!pagesize)
+		pagesize = sysconf(_SC_PAGESIZE);
+	if (!pink_util_get_arg(pid, bitness, ind, &addr))
+		return false;
+	if (!addr) {
+		errno = EFAULT;
+		return false;
+	}
+
+	pink_easy_trie_cursor_init(trie, &cursor);
+	for (total = 0; !cursor.done && total < PATH_MAX;) {
+		/* Don't read across a page boundary, the next page may not
+		 * be mapped even if the string ends on this one. */
+		size_t n = pagesize - (addr % pagesize);
+		if (n > sizeof(buf))
+			n = sizeof(buf);
+		if (!pink_easy_process_vm_readv(pid, addr, buf, n))
+			return false;
+		pink_easy_trie_feed(&cursor, buf, n);
+		addr += n;
+		total += n;
+	}
+
+	*value = pink_easy_trie_finish(&cursor);
+	return true;
+}
@@ -49,12 +49,15 @@ bool pink_easy_process_vm_readv(pid_t pid, long addr, void *dest, size_t len)
 {
 	static bool process_vm_readv_not_supported = false;
 	int r;
+	bool ok;
 	struct iovec local[1], remote[1];
 
-	if (!process_vm_readv_not_supported
+	if (process_vm_readv_not_supported
 			|| pink_easy_os_release < KERNEL_VERSION(3,2,0)) {
 vm_readv_didnt_work:
-		return pink_util_moven(pid, addr, dest, len);
+		ok = pink_util_moven(pid, addr, dest, len);
+		PINK_EASY_PROBE(vm_read, pid, addr, len, PINK_EASY_PROBE_VM_PTRACE, ok ? len : 0);
+		return ok;
 	}
 
 	local[0].iov_base = dest;
@@ -73,12 +76,13 @@ vm_readv_didnt_work:
 	goto vm_readv_didnt_work;
 #endif
 
-	if (r < 0) {
-		if (errno == ENOSYS)
+	if (r < 0 || (size_t)r != len) {
+		if (r < 0 && errno == ENOSYS)
 			process_vm_readv_not_supported = true;
 		goto vm_readv_didnt_work;
 	}
 
+	PINK_EASY_PROBE(vm_read, pid, addr, len, PINK_EASY_PROBE_VM_PROCESS_VM, len);
 	return true;
 }
 
@@ -86,12 +90,15 @@ bool pink_easy_process_vm_writev(pid_t pid, long addr, const void *src, size_t l
 {
 	static bool process_vm_writev_not_supported = false;
 	int r;
+	bool ok;
 	struct iovec local[1], remote[1];
 
-	if (!process_vm_writev_not_supported
+	if (process_vm_writev_not_supported
 			|| pink_easy_os_release < KERNEL_VERSION(3,2,0)) {
 vm_writev_didnt_work:
-		return pink_util_putn(pid, addr, src, len);
+		ok = pink_util_putn(pid, addr, src, len);
+		PINK_EASY_PROBE(vm_write, pid, addr, len, PINK_EASY_PROBE_VM_PTRACE, ok ? len : 0);
+		return ok;
 	}
 
 	local[0].iov_base = (void *)src;
@@ -110,11 +117,12 @@ vm_writev_didnt_work:
 	goto vm_writev_didnt_work;
 #endif
 
-	if (r < 0) {
-		if (errno == ENOSYS)
+	if (r < 0 || (size_t)r != len) {
+		if (r < 0 && errno == ENOSYS)
 			process_vm_writev_not_supported = true;
 		goto vm_writev_didnt_work;
 	}
 
+	PINK_EASY_PROBE(vm_write, pid, addr, len, PINK_EASY_PROBE_VM_PROCESS_VM, len);
 	return true;
 }
@@ -169,3 +169,12 @@ pink_util_putn(pid_t pid, long addr, const char *src, size_t len)
 
 	return !(ptrace(PT_IO, pid, (caddr_t)&ioreq, 0) < 0);
 }
+
+bool
+pink_util_get_args(pid_t pid, pink_bitness_t bitness, long *res)
+{
+	for (unsigned i = 0; i < PINK_MAX_ARGS; i++)
+		if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, i, &res[i])))
+			return false;
+	return true;
+}
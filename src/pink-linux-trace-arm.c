@@ -108,7 +108,7 @@ pink_util_get_syscall(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness,
 bool
 pink_util_set_syscall(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness, long scno)
 {
-	return (0 == ptrace(PTRACE_SET_SYSCALL, pid, 0, scno & 0xffff));
+	return (0 == pink_ptrace(PTRACE_SET_SYSCALL, pid, 0, scno & 0xffff));
 }
 
 bool
@@ -123,6 +123,15 @@ pink_util_set_return(pid_t pid, long ret)
 	return pink_util_poke(pid, OFFSET_R0, ret);
 }
 
+bool
+pink_util_skip_syscall(PINK_GCC_ATTR((unused)) pid_t pid,
+		PINK_GCC_ATTR((unused)) pink_bitness_t bitness,
+		PINK_GCC_ATTR((unused)) long ret)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
 bool
 pink_util_get_arg(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness, unsigned ind, long *res)
 {
@@ -34,6 +34,7 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 
 #include <pinktrace/internal.h>
@@ -124,6 +125,15 @@ pink_util_set_return(pid_t pid, long ret)
 	return pink_util_poke(pid, ACCUM, ret) && pink_util_poke(pid, ACCUM_FLAGS, flags);
 }
 
+bool
+pink_util_skip_syscall(PINK_GCC_ATTR((unused)) pid_t pid,
+		PINK_GCC_ATTR((unused)) pink_bitness_t bitness,
+		PINK_GCC_ATTR((unused)) long ret)
+{
+	errno = ENOTSUP;
+	return false;
+}
+
 bool
 pink_util_get_arg(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness, unsigned ind, long *res)
 {
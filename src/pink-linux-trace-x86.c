@@ -26,6 +26,8 @@
  */
 
 #include <assert.h>
+#include <string.h>
+#include <sys/user.h>
 
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
@@ -75,6 +77,13 @@ pink_util_set_return(pid_t pid, long ret)
 	return pink_util_poke(pid, ACCUM, ret);
 }
 
+bool
+pink_util_skip_syscall(pid_t pid, PINK_GCC_ATTR((unused)) pink_bitness_t bitness, long ret)
+{
+	/* The kernel leaves the accumulator alone for skipped system calls */
+	return pink_util_poke(pid, ORIG_ACCUM, -1) && pink_util_poke(pid, ACCUM, ret);
+}
+
 bool
 pink_util_get_arg(pid_t pid, pink_bitness_t bitness, unsigned ind, long *res)
 {
@@ -84,6 +93,22 @@ pink_util_get_arg(pid_t pid, pink_bitness_t bitness, unsigned ind, long *res)
 	return pink_util_peek(pid, syscall_args[bitness][ind], res);
 }
 
+bool
+pink_util_get_args(pid_t pid, pink_bitness_t bitness, long *res)
+{
+	struct user_regs_struct regs;
+
+	assert(bitness == PINK_BITNESS_32);
+	assert(res != NULL);
+
+	/* The offsets for PTRACE_PEEKUSER are those in the registers */
+	if (PINK_GCC_UNLIKELY(!pink_util_get_regs(pid, &regs)))
+		return false;
+	for (unsigned i = 0; i < PINK_MAX_ARGS; i++)
+		memcpy(&res[i], (char *)&regs + syscall_args[bitness][i], sizeof(long));
+	return true;
+}
+
 bool
 pink_util_set_arg(pid_t pid, pink_bitness_t bitness, unsigned ind, long arg)
 {
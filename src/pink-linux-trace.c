@@ -33,41 +33,80 @@
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
 
+#ifndef PTRACE_O_TRACESECCOMP
+#define PTRACE_O_TRACESECCOMP	0x00000080
+#endif /* !PTRACE_O_TRACESECCOMP */
+#ifndef PTRACE_SEIZE
+#define PTRACE_SEIZE		0x4206
+#endif /* !PTRACE_SEIZE */
+#ifndef PTRACE_INTERRUPT
+#define PTRACE_INTERRUPT	0x4207
+#endif /* !PTRACE_INTERRUPT */
+#ifndef PTRACE_LISTEN
+#define PTRACE_LISTEN		0x4208
+#endif /* !PTRACE_LISTEN */
+
+static int
+trace_options(int options)
+{
+	int ptrace_options;
+
+	ptrace_options = 0;
+	if (options & PINK_TRACE_OPTION_SYSGOOD)
+		ptrace_options |= PTRACE_O_TRACESYSGOOD;
+	if (options & PINK_TRACE_OPTION_FORK)
+		ptrace_options |= PTRACE_O_TRACEFORK;
+	if (options & PINK_TRACE_OPTION_VFORK)
+		ptrace_options |= PTRACE_O_TRACEVFORK;
+	if (options & PINK_TRACE_OPTION_CLONE)
+		ptrace_options |= PTRACE_O_TRACECLONE;
+	if (options & PINK_TRACE_OPTION_EXEC)
+		ptrace_options |= PTRACE_O_TRACEEXEC;
+	if (options & PINK_TRACE_OPTION_VFORK_DONE)
+		ptrace_options |= PTRACE_O_TRACEVFORKDONE;
+	if (options & PINK_TRACE_OPTION_EXIT)
+		ptrace_options |= PTRACE_O_TRACEEXIT;
+	if (options & PINK_TRACE_OPTION_SECCOMP)
+		ptrace_options |= PTRACE_O_TRACESECCOMP;
+
+	return ptrace_options;
+}
+
 bool
 pink_trace_me(void)
 {
-	return !(0 > ptrace(PTRACE_TRACEME, 0, NULL, NULL));
+	return !(0 > pink_ptrace(PTRACE_TRACEME, 0, NULL, NULL));
 }
 
 bool
 pink_trace_cont(pid_t pid, int sig, PINK_GCC_ATTR((unused)) char *addr)
 {
-	return !(0 > ptrace(PTRACE_CONT, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_CONT, pid, NULL, sig));
 }
 
 bool
 pink_trace_kill(pid_t pid)
 {
-	return !(0 > ptrace(PTRACE_KILL, pid, NULL, NULL));
+	return !(0 > pink_ptrace(PTRACE_KILL, pid, NULL, NULL));
 }
 
 bool
 pink_trace_singlestep(pid_t pid, int sig)
 {
-	return !(0 > ptrace(PTRACE_SINGLESTEP, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_SINGLESTEP, pid, NULL, sig));
 }
 
 bool
 pink_trace_syscall(pid_t pid, int sig)
 {
-	return !(0 > ptrace(PTRACE_SYSCALL, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_SYSCALL, pid, NULL, sig));
 }
 
 #ifdef PTRACE_SYSEMU
 bool
 pink_trace_sysemu(pid_t pid, int sig)
 {
-	return !(0 > ptrace(PTRACE_SYSEMU, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_SYSEMU, pid, NULL, sig));
 }
 #else
 bool
@@ -82,7 +121,7 @@ pink_trace_sysemu(PINK_GCC_ATTR((unused)) pid_t pid, PINK_GCC_ATTR((unused)) int
 bool
 pink_trace_sysemu_singlestep(pid_t pid, int sig)
 {
-	return !(0 > ptrace(PTRACE_SYSEMU_SINGLESTEP, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_SYSEMU_SINGLESTEP, pid, NULL, sig));
 }
 #else
 bool
@@ -96,41 +135,41 @@ pink_trace_sysemu_singlestep(PINK_GCC_ATTR((unused)) pid_t pid, PINK_GCC_ATTR((u
 bool
 pink_trace_geteventmsg(pid_t pid, unsigned long *data)
 {
-	return !(0 > ptrace(PTRACE_GETEVENTMSG, pid, NULL, data));
+	return !(0 > pink_ptrace(PTRACE_GETEVENTMSG, pid, NULL, data));
 }
 
 bool
 pink_trace_setup(pid_t pid, int options)
 {
-	int ptrace_options;
+	return !(0 > pink_ptrace(PTRACE_SETOPTIONS, pid, NULL, trace_options(options)));
+}
 
-	ptrace_options = 0;
-	if (options & PINK_TRACE_OPTION_SYSGOOD)
-		ptrace_options |= PTRACE_O_TRACESYSGOOD;
-	if (options & PINK_TRACE_OPTION_FORK)
-		ptrace_options |= PTRACE_O_TRACEFORK;
-	if (options & PINK_TRACE_OPTION_VFORK)
-		ptrace_options |= PTRACE_O_TRACEVFORK;
-	if (options & PINK_TRACE_OPTION_CLONE)
-		ptrace_options |= PTRACE_O_TRACECLONE;
-	if (options & PINK_TRACE_OPTION_EXEC)
-		ptrace_options |= PTRACE_O_TRACEEXEC;
-	if (options & PINK_TRACE_OPTION_VFORK_DONE)
-		ptrace_options |= PTRACE_O_TRACEVFORKDONE;
-	if (options & PINK_TRACE_OPTION_EXIT)
-		ptrace_options |= PTRACE_O_TRACEEXIT;
+bool
+pink_trace_seize(pid_t pid, int options)
+{
+	return !(0 > pink_ptrace(PTRACE_SEIZE, pid, NULL, trace_options(options)));
+}
 
-	return !(0 > ptrace(PTRACE_SETOPTIONS, pid, NULL, ptrace_options));
+bool
+pink_trace_interrupt(pid_t pid)
+{
+	return !(0 > pink_ptrace(PTRACE_INTERRUPT, pid, NULL, NULL));
+}
+
+bool
+pink_trace_listen(pid_t pid)
+{
+	return !(0 > pink_ptrace(PTRACE_LISTEN, pid, NULL, NULL));
 }
 
 bool
 pink_trace_attach(pid_t pid)
 {
-	return !(0 > ptrace(PTRACE_ATTACH, pid, NULL, NULL));
+	return !(0 > pink_ptrace(PTRACE_ATTACH, pid, NULL, NULL));
 }
 
 bool
 pink_trace_detach(pid_t pid, int sig)
 {
-	return !(0 > ptrace(PTRACE_DETACH, pid, NULL, sig));
+	return !(0 > pink_ptrace(PTRACE_DETACH, pid, NULL, sig));
 }
@@ -48,7 +48,7 @@ pink_util_peek(pid_t pid, long off, long *res)
 	long val;
 
 	errno = 0;
-	val = ptrace(PTRACE_PEEKUSER, pid, off, NULL);
+	val = pink_ptrace(PTRACE_PEEKUSER, pid, off, NULL);
 	if (PINK_GCC_UNLIKELY(val == -1 && errno != 0))
 		return false;
 
@@ -64,7 +64,7 @@ pink_util_peekdata(pid_t pid, long off, long *res)
 	long val;
 
 	errno = 0;
-	val = ptrace(PTRACE_PEEKDATA, pid, off, NULL);
+	val = pink_ptrace(PTRACE_PEEKDATA, pid, off, NULL);
 	if (PINK_GCC_UNLIKELY(val == -1 && errno != 0))
 		return false;
 
@@ -77,27 +77,39 @@ pink_util_peekdata(pid_t pid, long off, long *res)
 bool
 pink_util_poke(pid_t pid, long off, long val)
 {
-	return (0 == ptrace(PTRACE_POKEUSER, pid, off, val));
+	return (0 == pink_ptrace(PTRACE_POKEUSER, pid, off, val));
 }
 
 bool
 pink_util_pokedata(pid_t pid, long off, long val)
 {
-	return (0 == ptrace(PTRACE_POKEDATA, pid, off, val));
+	return (0 == pink_ptrace(PTRACE_POKEDATA, pid, off, val));
 }
 
 bool
 pink_util_get_regs(pid_t pid, void *regs)
 {
-	return !(ptrace(PTRACE_GETREGS, pid, NULL, regs) < 0);
+	return !(pink_ptrace(PTRACE_GETREGS, pid, NULL, regs) < 0);
 }
 
 bool
 pink_util_set_regs(pid_t pid, const void *regs)
 {
-	return !(ptrace(PTRACE_SETREGS, pid, NULL, regs) < 0);
+	return !(pink_ptrace(PTRACE_SETREGS, pid, NULL, regs) < 0);
 }
 
+#if !defined(I386) && !defined(X86_64)
+/* x86 reads the arguments with PTRACE_GETREGS, see pink-linux-trace-x86*.c */
+bool
+pink_util_get_args(pid_t pid, pink_bitness_t bitness, long *res)
+{
+	for (unsigned i = 0; i < PINK_MAX_ARGS; i++)
+		if (PINK_GCC_UNLIKELY(!pink_util_get_arg(pid, bitness, i, &res[i])))
+			return false;
+	return true;
+}
+#endif
+
 bool
 pink_util_putn(pid_t pid, long addr, const char *src, size_t len)
 {
@@ -163,8 +175,8 @@ pink_util_putn_safe(pid_t pid, long addr, const char *src, size_t len)
 }
 
 #define MIN(a,b)	(((a) < (b)) ? (a) : (b))
-bool
-pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
+static bool
+moven(pid_t pid, long addr, char *dest, size_t len)
 {
 	int n, m;
 	int started = 0;
@@ -207,7 +219,17 @@ pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
 }
 
 bool
-pink_util_movestr(pid_t pid, long addr, char *dest, size_t len)
+pink_util_moven(pid_t pid, long addr, char *dest, size_t len)
+{
+	bool ok;
+
+	ok = moven(pid, addr, dest, len);
+	PINK_PROBE(moven, pid, addr, len, ok);
+	return ok;
+}
+
+static bool
+movestr(pid_t pid, long addr, char *dest, size_t len)
 {
 	int n, m;
 	int started = 0;
@@ -255,6 +277,16 @@ pink_util_movestr(pid_t pid, long addr, char *dest, size_t len)
 	return true;
 }
 
+bool
+pink_util_movestr(pid_t pid, long addr, char *dest, size_t len)
+{
+	bool ok;
+
+	ok = movestr(pid, addr, dest, len);
+	PINK_PROBE(movestr, pid, addr, len, ok);
+	return ok;
+}
+
 char *
 pink_util_movestr_persistent(pid_t pid, long addr)
 {
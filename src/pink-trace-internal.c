@@ -25,7 +25,9 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #include <pinktrace/internal.h>
 #include <pinktrace/pink.h>
@@ -55,3 +57,61 @@ _pink_decode_socket_address(pid_t pid, long addr, long addrlen, pink_socket_addr
 	paddr->length = addrlen;
 	return true;
 }
+
+#if PINK_OS_LINUX
+__thread pink_trace_account_t *_pink_trace_account;
+
+void
+pink_trace_set_account(pink_trace_account_t *account)
+{
+	_pink_trace_account = account;
+}
+
+pink_trace_account_t *
+pink_trace_get_account(void)
+{
+	return _pink_trace_account;
+}
+
+long
+_pink_ptrace_account(int request, pid_t pid, void *addr, void *data)
+{
+	int save_errno;
+	long r;
+	unsigned long long elapsed;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	r = ptrace(request, pid, addr, data);
+	save_errno = errno;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+
+	switch (request) {
+	case PTRACE_PEEKUSER:
+	case PTRACE_POKEUSER:
+	case PTRACE_GETREGS:
+	case PTRACE_SETREGS:
+#ifdef PTRACE_SET_SYSCALL
+	case PTRACE_SET_SYSCALL:
+#endif
+		_pink_trace_account->regs_calls++;
+		_pink_trace_account->regs_time += elapsed;
+		break;
+	case PTRACE_PEEKTEXT:
+	case PTRACE_PEEKDATA:
+	case PTRACE_POKETEXT:
+	case PTRACE_POKEDATA:
+		_pink_trace_account->mem_calls++;
+		_pink_trace_account->mem_time += elapsed;
+		break;
+	default:
+		_pink_trace_account->ctl_calls++;
+		_pink_trace_account->ctl_time += elapsed;
+		break;
+	}
+
+	errno = save_errno;
+	return r;
+}
+#endif /* PINK_OS_LINUX */
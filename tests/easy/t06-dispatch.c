@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+static unsigned getpid_entries;
+static unsigned getppid_exits;
+static unsigned generic_calls;
+static unsigned generic_getpid_entries;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+/* Called for every system call, after the handlers of dispatched ones */
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long scno;
+
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current), PINKTRACE_BITNESS_DEFAULT, &scno)) {
+		fprintf(stderr, "%s:%d: pink_util_get_syscall failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (scno != SYS_getpid && scno != SYS_getppid)
+		return 0;
+	++generic_calls;
+	if (scno == SYS_getpid && entering && ++generic_getpid_entries != getpid_entries) {
+		fprintf(stderr, "%s:%d: getpid entry handler not called first (%u != %u)\n",
+				__func__, __LINE__,
+				generic_getpid_entries, getpid_entries);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	return 0;
+}
+
+static int h_getpid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++getpid_entries;
+	return 0;
+}
+
+static int h_getppid_exit(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	long ret;
+
+	if (!pink_util_get_return(pink_easy_process_get_pid(current), &ret)) {
+		fprintf(stderr, "%s:%d: pink_util_get_return failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	if (ret != getpid()) {
+		fprintf(stderr, "%s:%d: getppid returned %ld != %i\n",
+				__func__, __LINE__, ret, getpid());
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	++getppid_exits;
+	return 0;
+}
+
+static bool walk_func(pink_bitness_t bitness, long scno, bool entry, bool exit, void *userdata)
+{
+	unsigned *count = userdata;
+	++*count;
+	return true;
+}
+
+static int call_func(void *data)
+{
+	for (int i = 0; i < 3; i++) {
+		syscall(SYS_getpid);
+		syscall(SYS_getppid);
+	}
+	return 0;
+}
+
+int
+main(void)
+{
+	unsigned walked;
+	long scno;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.syscall = cb_syscall;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_dispatch_set_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getpid", h_getpid_entry, NULL)
+			|| !pink_easy_dispatch_set_name(ctx, PINKTRACE_BITNESS_DEFAULT, "getppid", NULL, h_getppid_exit)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set_name failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	scno = pink_name_lookup("getppid", PINKTRACE_BITNESS_DEFAULT);
+	if (pink_easy_dispatch_interested(ctx, PINKTRACE_BITNESS_DEFAULT, scno, true)
+			|| !pink_easy_dispatch_interested(ctx, PINKTRACE_BITNESS_DEFAULT, scno, false)) {
+		fprintf(stderr, "%s:%d: wrong interest mask for getppid\n", __func__, __LINE__);
+		abort();
+	}
+
+	walked = 0;
+	pink_easy_dispatch_walk(ctx, PINKTRACE_BITNESS_DEFAULT, walk_func, &walked);
+	if (walked != 2) {
+		fprintf(stderr, "%s:%d: walked %u != 2\n", __func__, __LINE__, walked);
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, call_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	/* Entry and exit of three getpid and three getppid calls */
+	if (getpid_entries != 3 || getppid_exits != 3 || generic_calls != 12) {
+		fprintf(stderr, "%s:%d: getpid:%u getppid:%u generic:%u\n",
+				__func__, __LINE__,
+				getpid_entries, getppid_exits, generic_calls);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pinktrace/easy/pink.h>
+
+static const struct {
+	const char *pattern;
+	int value;
+} patterns[] = {
+	{"/usr", 1},
+	{"/usr/lib/secret", 2},
+	{"/home/*/.ssh", 3},
+	{"/tmp/", 4},
+	{"/var/**.log", 5},
+	{"/dev/tty?", 6},
+	{"/usr/lib/secret", 7}, /* duplicate, loses to 2 */
+	{"/lit\\*eral", 8},
+};
+
+static const struct {
+	const char *path;
+	int value;
+} cases[] = {
+	{"/usr", 1},
+	{"/usr/bin/ls", 1},
+	{"/usrfoo", -1},
+	{"/usr/lib/secret", 2},
+	{"/usr/lib/secret/key", 2},
+	{"/usr/lib/secretive", 1},
+	{"/home/alip/.ssh/id_rsa", 3},
+	{"/home/alip/x/.ssh", -1},
+	{"/tmp", -1},
+	{"/tmp/x", 4},
+	{"/var/log/messages.log", 5},
+	{"/var/log/messages", -1},
+	{"/dev/tty1", 6},
+	{"/dev/tty10", -1},
+	{"/lit*eral", 8},
+	{"/litXeral", -1},
+	{"", -1},
+	{"relative/usr", -1},
+};
+
+int
+main(void)
+{
+	char buf[64];
+	pink_easy_trie_t *trie;
+	pink_easy_trie_cursor_t cursor;
+
+	trie = pink_easy_trie_new();
+	if (!trie) {
+		perror("pink_easy_trie_new");
+		abort();
+	}
+
+	for (unsigned i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		if (!pink_easy_trie_add(trie, patterns[i].pattern, patterns[i].value)) {
+			fprintf(stderr, "%s:%d: pink_easy_trie_add(%s) failed (errno:%d %s)\n",
+					__func__, __LINE__, patterns[i].pattern,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+	if (pink_easy_trie_match(trie, "/usr") != -1) {
+		fprintf(stderr, "%s:%d: uncompiled trie matched\n", __func__, __LINE__);
+		abort();
+	}
+	if (!pink_easy_trie_compile(trie)) {
+		fprintf(stderr, "%s:%d: pink_easy_trie_compile failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	for (unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		int v = pink_easy_trie_match(trie, cases[i].path);
+		if (v != cases[i].value) {
+			fprintf(stderr, "%s:%d: %s matched %d != %d\n",
+					__func__, __LINE__, cases[i].path, v, cases[i].value);
+			abort();
+		}
+
+		/* Byte by byte gives the same result */
+		pink_easy_trie_cursor_init(trie, &cursor);
+		for (const char *p = cases[i].path; *p; p++) {
+			if (pink_easy_trie_feed(&cursor, p, 1))
+				break;
+		}
+		v = pink_easy_trie_finish(&cursor);
+		if (v != cases[i].value) {
+			fprintf(stderr, "%s:%d: %s streamed %d != %d\n",
+					__func__, __LINE__, cases[i].path, v, cases[i].value);
+			abort();
+		}
+	}
+
+	/* No pattern starts with /etc, the decision is final early */
+	pink_easy_trie_cursor_init(trie, &cursor);
+	if (!pink_easy_trie_feed(&cursor, "/etc/passwd", 11) || pink_easy_trie_finish(&cursor) != -1) {
+		fprintf(stderr, "%s:%d: /etc/passwd isn't decided early\n", __func__, __LINE__);
+		abort();
+	}
+
+	/* Under /usr/lib/secret the decision is final as well */
+	pink_easy_trie_cursor_init(trie, &cursor);
+	if (!pink_easy_trie_feed(&cursor, "/usr/lib/secret/", 16) || cursor.value != 2) {
+		fprintf(stderr, "%s:%d: /usr/lib/secret/ isn't decided early\n", __func__, __LINE__);
+		abort();
+	}
+
+	pink_easy_trie_destroy(trie);
+
+	/* Many prefixes */
+	trie = pink_easy_trie_new();
+	if (!trie) {
+		perror("pink_easy_trie_new");
+		abort();
+	}
+	for (int i = 0; i < 5000; i++) {
+		snprintf(buf, sizeof(buf), "/srv/%d/data", i);
+		if (!pink_easy_trie_add(trie, buf, i)) {
+			perror("pink_easy_trie_add");
+			abort();
+		}
+	}
+	if (!pink_easy_trie_compile(trie)) {
+		perror("pink_easy_trie_compile");
+		abort();
+	}
+	for (int i = 0; i < 5000; i += 37) {
+		snprintf(buf, sizeof(buf), "/srv/%d/data/file", i);
+		if (pink_easy_trie_match(trie, buf) != i) {
+			fprintf(stderr, "%s:%d: %s != %d\n", __func__, __LINE__, buf, i);
+			abort();
+		}
+		snprintf(buf, sizeof(buf), "/srv/%d/dat", i);
+		if (pink_easy_trie_match(trie, buf) != -1) {
+			fprintf(stderr, "%s:%d: %s matched\n", __func__, __LINE__, buf);
+			abort();
+		}
+	}
+	pink_easy_trie_destroy(trie);
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pinktrace/easy/pink.h>
+
+static void add4(pink_easy_netmatch_t *nm, const char *addr, unsigned prefixlen,
+		unsigned lo, unsigned hi, int value)
+{
+	struct in_addr a;
+
+	inet_pton(AF_INET, addr, &a);
+	if (!pink_easy_netmatch_add_inet(nm, AF_INET, &a, prefixlen, lo, hi, value)) {
+		fprintf(stderr, "%s:%d: add %s/%u failed (errno:%d %s)\n",
+				__func__, __LINE__, addr, prefixlen,
+				errno, strerror(errno));
+		abort();
+	}
+}
+
+static void check4(const pink_easy_netmatch_t *nm, const char *addr, unsigned port, int value)
+{
+	int v;
+	pink_socket_address_t sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.family = AF_INET;
+	sa.length = sizeof(struct sockaddr_in);
+	sa.u.sa_in.sin_family = AF_INET;
+	sa.u.sa_in.sin_port = htons(port);
+	inet_pton(AF_INET, addr, &sa.u.sa_in.sin_addr);
+
+	v = pink_easy_netmatch_lookup(nm, &sa);
+	if (v != value) {
+		fprintf(stderr, "%s:%d: %s:%u matched %d != %d\n",
+				__func__, __LINE__, addr, port, v, value);
+		abort();
+	}
+}
+
+#if PINK_HAVE_IPV6
+static void check6(const pink_easy_netmatch_t *nm, const char *addr, unsigned port, int value)
+{
+	int v;
+	pink_socket_address_t sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.family = AF_INET6;
+	sa.length = sizeof(struct sockaddr_in6);
+	sa.u.sa6.sin6_family = AF_INET6;
+	sa.u.sa6.sin6_port = htons(port);
+	inet_pton(AF_INET6, addr, &sa.u.sa6.sin6_addr);
+
+	v = pink_easy_netmatch_lookup(nm, &sa);
+	if (v != value) {
+		fprintf(stderr, "%s:%d: [%s]:%u matched %d != %d\n",
+				__func__, __LINE__, addr, port, v, value);
+		abort();
+	}
+}
+#endif
+
+static void checkun(const pink_easy_netmatch_t *nm, const char *path, bool abstract, int value)
+{
+	int v;
+	size_t len = strlen(path);
+	pink_socket_address_t sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.family = AF_UNIX;
+	sa.u.sa_un.sun_family = AF_UNIX;
+	if (abstract) {
+		memcpy(sa.u.sa_un.sun_path + 1, path, len);
+		sa.length = offsetof(struct sockaddr_un, sun_path) + 1 + len;
+	} else {
+		memcpy(sa.u.sa_un.sun_path, path, len + 1);
+		sa.length = offsetof(struct sockaddr_un, sun_path) + len + 1;
+	}
+
+	v = pink_easy_netmatch_lookup(nm, &sa);
+	if (v != value) {
+		fprintf(stderr, "%s:%d: %s%s matched %d != %d\n",
+				__func__, __LINE__, abstract ? "@" : "", path, v, value);
+		abort();
+	}
+}
+
+int
+main(void)
+{
+	char buf[32];
+	pink_easy_netmatch_t *nm;
+
+	nm = pink_easy_netmatch_new();
+	if (!nm) {
+		perror("pink_easy_netmatch_new");
+		abort();
+	}
+
+	add4(nm, "0.0.0.0", 0, 0, 65535, 0);
+	add4(nm, "10.0.0.0", 8, 0, 65535, 1);
+	add4(nm, "10.1.0.0", 16, 443, 443, 2);
+	add4(nm, "10.1.2.3", 32, 0, 65535, 3);
+	add4(nm, "10.1.0.0", 16, 80, 80, 4);
+	add4(nm, "10.1.0.0", 16, 0, 65535, 5);
+	add4(nm, "192.168.0.0", 24, 22, 22, 6);
+
+	check4(nm, "8.8.8.8", 53, 0);
+	check4(nm, "10.200.0.1", 80, 1);
+	check4(nm, "10.1.9.9", 443, 2);
+	check4(nm, "10.1.9.9", 80, 4);
+	check4(nm, "10.1.9.9", 8080, 5);
+	check4(nm, "10.1.2.3", 443, 3);
+	check4(nm, "10.1.2.4", 443, 2);
+	check4(nm, "192.168.0.7", 22, 6);
+	check4(nm, "192.168.0.7", 23, 0);
+
+#if PINK_HAVE_IPV6
+	{
+		struct in6_addr a;
+
+		inet_pton(AF_INET6, "2001:db8::", &a);
+		if (!pink_easy_netmatch_add_inet(nm, AF_INET6, &a, 32, 0, 65535, 7)) {
+			perror("pink_easy_netmatch_add_inet");
+			abort();
+		}
+		check6(nm, "2001:db8::1", 80, 7);
+		check6(nm, "2001:db9::1", 80, -1);
+		/* IPv4-mapped addresses use the IPv4 rules */
+		check6(nm, "::ffff:10.1.2.3", 80, 3);
+	}
+#endif
+
+	if (!pink_easy_netmatch_add_unix(nm, "/run/dbus", false, 8)
+			|| !pink_easy_netmatch_add_unix(nm, "/tmp/.X11-unix/X*", true, 9)
+			|| !pink_easy_netmatch_compile(nm)) {
+		perror("pink_easy_netmatch_add_unix");
+		abort();
+	}
+	checkun(nm, "/run/dbus/system_bus_socket", false, 8);
+	checkun(nm, "/run/dbusx", false, -1);
+	checkun(nm, "/tmp/.X11-unix/X0", true, 9);
+	checkun(nm, "/tmp/.X11-unix/X0", false, -1);
+
+	pink_easy_netmatch_destroy(nm);
+
+	/* Many host routes */
+	nm = pink_easy_netmatch_new();
+	if (!nm) {
+		perror("pink_easy_netmatch_new");
+		abort();
+	}
+	for (int i = 0; i < 20000; i++) {
+		snprintf(buf, sizeof(buf), "172.%d.%d.%d", 16 + i / 65536, (i / 256) % 256, i % 256);
+		add4(nm, buf, 32, 1000 + i % 7, 1000 + i % 7, i);
+	}
+	add4(nm, "172.16.0.0", 12, 0, 65535, 100000);
+	for (int i = 0; i < 20000; i += 101) {
+		snprintf(buf, sizeof(buf), "172.%d.%d.%d", 16 + i / 65536, (i / 256) % 256, i % 256);
+		check4(nm, buf, 1000 + i % 7, i);
+		check4(nm, buf, 999, 100000);
+	}
+	check4(nm, "172.32.0.1", 1000, -1);
+	pink_easy_netmatch_destroy(nm);
+
+	return 0;
+}
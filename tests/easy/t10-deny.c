@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define EMULATED_UID 4242
+
+static unsigned entries;
+static unsigned exits;
+static unsigned leaked;
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long scno;
+
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+				pink_easy_process_get_bitness(current), &scno))
+		return 0;
+	if (scno == SYS_getppid || scno == SYS_getuid)
+		++leaked;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	exit_status = status;
+	return 0;
+}
+
+static int h_getppid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++entries;
+	if (!pink_easy_process_deny(current, EPERM)) {
+		fprintf(stderr, "%s:%d: pink_easy_process_deny failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	/* A second resolution of the same system call is refused */
+	if (pink_easy_process_emulate(current, 0) || errno != EINVAL) {
+		fprintf(stderr, "%s:%d: double resolution succeeded\n", __func__, __LINE__);
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	return 0;
+}
+
+static int h_getuid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++entries;
+	if (!pink_easy_process_emulate(current, EMULATED_UID)) {
+		fprintf(stderr, "%s:%d: pink_easy_process_emulate failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	return 0;
+}
+
+static int h_exit(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++exits;
+	return 0;
+}
+
+static int call_func(void *data)
+{
+	errno = 0;
+	if (syscall(SYS_getppid) != -1 || errno != EPERM)
+		return 1;
+	if (syscall(SYS_getuid) != EMULATED_UID)
+		return 2;
+	return 0;
+}
+
+static void run(bool seccomp)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	entries = exits = leaked = 0;
+	exit_status = -1;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+	tbl.syscall = cb_syscall;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getppid, h_getppid_entry, h_exit)
+			|| !pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getuid, h_getuid_entry, h_exit)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	policy = NULL;
+	if (seccomp) {
+		policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+		if (!policy || !pink_easy_policy_compile(policy)) {
+			perror("pink_easy_policy");
+			abort();
+		}
+		if (!pink_easy_context_set_policy(ctx, policy, true)) {
+			if (errno == ENOTSUP) {
+				fprintf(stderr, "%s:%d: seccomp not supported, skipping\n", __func__, __LINE__);
+				pink_easy_context_destroy(ctx);
+				pink_easy_policy_destroy(policy);
+				return;
+			}
+			fprintf(stderr, "%s:%d: pink_easy_context_set_policy failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+
+	if (!pink_easy_call(ctx, call_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0) {
+		fprintf(stderr, "%s:%d: seccomp:%d child failed with status %#x\n",
+				__func__, __LINE__, seccomp, (unsigned)exit_status);
+		abort();
+	}
+
+	/* Resolved system calls reach no callback after the entry handler */
+	if (entries != 2 || exits != 0 || leaked != 0) {
+		fprintf(stderr, "%s:%d: seccomp:%d entries:%u exits:%u leaked:%u\n",
+				__func__, __LINE__, seccomp,
+				entries, exits, leaked);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	if (policy)
+		pink_easy_policy_destroy(policy);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	run(false);
+	run(true);
+
+	return 0;
+}
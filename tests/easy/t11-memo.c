@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <pinktrace/easy/pink.h>
+
+static unsigned getpid_entries;
+static unsigned getuid_entries;
+static unsigned uname_entries;
+static unsigned clock_entries;
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	long scno;
+
+	if (!entering)
+		return 0;
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+				pink_easy_process_get_bitness(current), &scno))
+		return 0;
+	if (scno == SYS_getpid)
+		++getpid_entries;
+	else if (scno == SYS_getuid)
+		++getuid_entries;
+	else if (scno == SYS_uname)
+		++uname_entries;
+	else if (scno == SYS_clock_getres)
+		++clock_entries;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		exit_status = status;
+	return 0;
+}
+
+static int call_func(void *data)
+{
+	int status;
+	long pid, uid;
+	pid_t child;
+	struct utsname u1, u2;
+	struct timespec r1, r2, m1, m2;
+
+	pid = syscall(SYS_getpid);
+	for (int i = 0; i < 4; i++)
+		if (syscall(SYS_getpid) != pid)
+			return 1;
+
+	uid = syscall(SYS_getuid);
+	if (syscall(SYS_getuid) != uid)
+		return 2;
+	if (syscall(SYS_setuid, uid) < 0)
+		return 3;
+	if (syscall(SYS_getuid) != uid || syscall(SYS_getuid) != uid)
+		return 4;
+
+	memset(&u2, 0, sizeof(struct utsname));
+	if (syscall(SYS_uname, &u1) < 0 || syscall(SYS_uname, &u2) < 0
+			|| memcmp(&u1, &u2, sizeof(struct utsname)))
+		return 5;
+
+	memset(&r2, 0, sizeof(struct timespec));
+	memset(&m2, 0, sizeof(struct timespec));
+	if (syscall(SYS_clock_getres, CLOCK_REALTIME, &r1) < 0
+			|| syscall(SYS_clock_getres, CLOCK_MONOTONIC, &m1) < 0
+			|| syscall(SYS_clock_getres, CLOCK_REALTIME, &r2) < 0
+			|| syscall(SYS_clock_getres, CLOCK_MONOTONIC, &m2) < 0
+			|| memcmp(&r1, &r2, sizeof(struct timespec))
+			|| memcmp(&m1, &m2, sizeof(struct timespec)))
+		return 6;
+
+	/* The child must not see the cached result of its parent */
+	child = fork();
+	if (child < 0)
+		return 7;
+	if (child == 0)
+		_exit(syscall(SYS_getpid) == pid ? 1 : 0);
+	if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return 8;
+	return 0;
+}
+
+static void run(bool seccomp)
+{
+	pink_bitness_t b = PINKTRACE_BITNESS_DEFAULT;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	getpid_entries = getuid_entries = uname_entries = clock_entries = 0;
+	exit_status = 0;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+	tbl.syscall = cb_syscall;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_memo_set(ctx, b, SYS_getpid, -1, -1, 0)
+			|| !pink_easy_memo_set(ctx, b, SYS_getuid, -1, -1, 0)
+			|| !pink_easy_memo_set(ctx, b, SYS_uname, -1, 0, sizeof(struct utsname))
+			|| !pink_easy_memo_set(ctx, b, SYS_clock_getres, 0, 1, sizeof(struct timespec))) {
+		fprintf(stderr, "%s:%d: pink_easy_memo_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (pink_easy_memo_set(ctx, b, SYS_setuid, -1, -1, 0) || errno != EINVAL) {
+		fprintf(stderr, "%s:%d: setuid is cached\n", __func__, __LINE__);
+		abort();
+	}
+
+	policy = NULL;
+	if (seccomp) {
+		policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+		if (!policy || !pink_easy_policy_compile(policy)) {
+			perror("pink_easy_policy");
+			abort();
+		}
+		if (!pink_easy_context_set_policy(ctx, policy, true)) {
+			if (errno == ENOTSUP) {
+				fprintf(stderr, "%s:%d: seccomp not supported, skipping\n", __func__, __LINE__);
+				pink_easy_context_destroy(ctx);
+				pink_easy_policy_destroy(policy);
+				return;
+			}
+			fprintf(stderr, "%s:%d: pink_easy_context_set_policy failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+
+	if (!pink_easy_call(ctx, call_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (exit_status != 0) {
+		fprintf(stderr, "%s:%d: seccomp:%d child failed with status %#x\n",
+				__func__, __LINE__, seccomp, (unsigned)exit_status);
+		abort();
+	}
+
+	/* Only misses reach the callback: the first getpid of each process,
+	 * getuid before and after setuid, and clock_getres once per clock. */
+	if (getpid_entries != 2 || getuid_entries != 2
+			|| uname_entries != 1 || clock_entries != 2) {
+		fprintf(stderr, "%s:%d: seccomp:%d getpid:%u getuid:%u uname:%u clock_getres:%u\n",
+				__func__, __LINE__, seccomp,
+				getpid_entries, getuid_entries,
+				uname_entries, clock_entries);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	if (policy)
+		pink_easy_policy_destroy(policy);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	run(false);
+	run(true);
+
+	return 0;
+}
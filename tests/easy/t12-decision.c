@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define DENIED_DIR "/pinktrace-decision-denied"
+
+struct expect {
+	int dup_errno;
+	int sub_errno;
+};
+
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	exit_status = status;
+	return 0;
+}
+
+static int call_func(void *data)
+{
+	const struct expect *e = data;
+
+	/* More distinct decisions than the cache holds, repeated */
+	for (int i = 0; i < 3; i++) {
+		errno = 0;
+		if (syscall(SYS_chdir, DENIED_DIR "/sub") != -1 || errno != e->sub_errno)
+			return 1;
+		errno = 0;
+		if (syscall(SYS_chdir, DENIED_DIR "-not") != -1 || errno != ENOENT)
+			return 2;
+		errno = 0;
+		if (syscall(SYS_dup, 12345) != -1 || errno != e->dup_errno)
+			return 3;
+		errno = 0;
+		if (syscall(SYS_chdir, NULL) != -1 || errno != EFAULT)
+			return 4;
+		errno = 0;
+		if (syscall(SYS_chdir, DENIED_DIR "/sub") != -1 || errno != e->sub_errno)
+			return 5;
+	}
+	return 0;
+}
+
+static void run(pink_easy_context_t *ctx, int dup_errno, int sub_errno)
+{
+	pink_easy_error_t error;
+	struct expect e;
+
+	e.dup_errno = dup_errno;
+	e.sub_errno = sub_errno;
+
+	exit_status = -1;
+	if (!pink_easy_call(ctx, call_func, &e)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0) {
+		fprintf(stderr, "%s:%d: dup:%d sub:%d child failed with status %#x\n",
+				__func__, __LINE__, dup_errno, sub_errno,
+				(unsigned)exit_status);
+		abort();
+	}
+}
+
+int
+main(void)
+{
+	pink_bitness_t b = PINKTRACE_BITNESS_DEFAULT;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+	if (!policy) {
+		perror("pink_easy_policy_new");
+		abort();
+	}
+	if (!pink_easy_policy_add_int(policy, b, pink_name_lookup("dup", b), 0,
+				PINK_EASY_POLICY_OP_EQ, 12345, 0, PINK_EASY_POLICY_DENY, EACCES)
+			|| !pink_easy_policy_add_path(policy, b, pink_name_lookup("chdir", b), 0,
+				DENIED_DIR "/", PINK_EASY_POLICY_DENY, ENOTDIR)
+			|| !pink_easy_policy_compile(policy)) {
+		fprintf(stderr, "%s:%d: policy setup failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_set_policy(ctx, policy, false)
+			|| !pink_easy_context_set_decision_cache(ctx, 2)) {
+		fprintf(stderr, "%s:%d: context setup failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	run(ctx, EACCES, ENOTDIR);
+
+	/* Compiling the policy again invalidates the cached decisions */
+	if (!pink_easy_policy_add_path(policy, b, pink_name_lookup("chdir", b), 0,
+				DENIED_DIR "/sub", PINK_EASY_POLICY_DENY, EPERM)
+			|| !pink_easy_policy_compile(policy)) {
+		fprintf(stderr, "%s:%d: policy update failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	run(ctx, EACCES, EPERM);
+
+	/* So does loading another policy */
+	pink_easy_policy_destroy(policy);
+	policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+	if (!policy
+			|| !pink_easy_policy_add_int(policy, b, pink_name_lookup("dup", b), 0,
+				PINK_EASY_POLICY_OP_GT, 10000, 0, PINK_EASY_POLICY_DENY, EBADF)
+			|| !pink_easy_policy_add_path(policy, b, pink_name_lookup("chdir", b), 0,
+				DENIED_DIR "/", PINK_EASY_POLICY_DENY, ENOTDIR)
+			|| !pink_easy_policy_compile(policy)
+			|| !pink_easy_context_set_policy(ctx, policy, false)) {
+		fprintf(stderr, "%s:%d: policy reload failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	run(ctx, EBADF, ENOTDIR);
+
+	pink_easy_context_destroy(ctx);
+	pink_easy_policy_destroy(policy);
+	return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define GETUID_CALLS 200
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static unsigned getuid_entries;
+static unsigned pending;
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		exit_status = status;
+	return 0;
+}
+
+static int h_getuid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	/* No decision is pending about this process */
+	if (pink_easy_process_complete(current, PINK_EASY_POLICY_DENY, EPERM) || errno != EBUSY) {
+		fprintf(stderr, "%s:%d: pink_easy_process_complete didn't fail with EBUSY (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	pthread_mutex_lock(&lock);
+	++getuid_entries;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	return 0;
+}
+
+/* Decides slowly: waits until the loop has served the other process */
+static void *worker(void *data)
+{
+	bool progress;
+	struct timespec deadline;
+	pink_easy_process_t *current = data;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 10;
+
+	pthread_mutex_lock(&lock);
+	while (getuid_entries < GETUID_CALLS)
+		if (pthread_cond_timedwait(&cond, &lock, &deadline) == ETIMEDOUT)
+			break;
+	progress = getuid_entries >= GETUID_CALLS;
+	pthread_mutex_unlock(&lock);
+
+	if (!pink_easy_process_complete(current,
+				progress ? PINK_EASY_POLICY_DENY : PINK_EASY_POLICY_ALLOW,
+				EPERM)) {
+		fprintf(stderr, "%s:%d: pink_easy_process_complete failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	return NULL;
+}
+
+static int h_getppid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	pthread_t thread;
+
+	++pending;
+	if (pthread_create(&thread, NULL, worker, current) != 0) {
+		perror("pthread_create");
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	pthread_detach(thread);
+	return PINK_EASY_CFLAG_PENDING;
+}
+
+static int call_func(void *data)
+{
+	int status;
+	pid_t child;
+
+	child = fork();
+	if (child < 0)
+		return 1;
+	if (child == 0) {
+		errno = 0;
+		_exit(syscall(SYS_getppid) == -1 && errno == EPERM ? 0 : 1);
+	}
+
+	/* Runs while the decision about the child is pending */
+	for (int i = 0; i < GETUID_CALLS; i++)
+		syscall(SYS_getuid);
+
+	if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return 2;
+	return 0;
+}
+
+static void run(bool seccomp)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	getuid_entries = pending = 0;
+	exit_status = 0;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getppid, h_getppid_entry, NULL)
+			|| !pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getuid, h_getuid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	policy = NULL;
+	if (seccomp) {
+		policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+		if (!policy || !pink_easy_policy_compile(policy)) {
+			perror("pink_easy_policy");
+			abort();
+		}
+		if (!pink_easy_context_set_policy(ctx, policy, true)) {
+			if (errno == ENOTSUP) {
+				fprintf(stderr, "%s:%d: seccomp not supported, skipping\n", __func__, __LINE__);
+				pink_easy_context_destroy(ctx);
+				pink_easy_policy_destroy(policy);
+				return;
+			}
+			fprintf(stderr, "%s:%d: pink_easy_context_set_policy failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+
+	if (!pink_easy_call(ctx, call_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s) != %i (%s) -> %d (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error),
+				PINK_EASY_ERROR_SUCCESS,
+				pink_easy_strerror(PINK_EASY_ERROR_SUCCESS),
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (exit_status != 0 || pending != 1 || getuid_entries != GETUID_CALLS) {
+		fprintf(stderr, "%s:%d: seccomp:%d status:%#x pending:%u getuid:%u\n",
+				__func__, __LINE__, seccomp, (unsigned)exit_status,
+				pending, getuid_entries);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	if (policy)
+		pink_easy_policy_destroy(policy);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	run(false);
+	run(true);
+
+	return 0;
+}
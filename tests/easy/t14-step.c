@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+static pink_easy_process_t *parked;
+static unsigned getpid_entries;
+static unsigned cleanups;
+static int exit_status;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	exit_status = status;
+	return 0;
+}
+
+static int cb_cleanup(const pink_easy_context_t *ctx)
+{
+	++cleanups;
+	return 0;
+}
+
+static int h_getpid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++getpid_entries;
+	return 0;
+}
+
+static int h_getppid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	/* Answered by the main loop below, like a reply from a socket */
+	parked = current;
+	return PINK_EASY_CFLAG_PENDING;
+}
+
+static int call_func(void *data)
+{
+	for (int i = 0; i < 5; i++)
+		syscall(SYS_getpid);
+	errno = 0;
+	if (syscall(SYS_getppid) != -1 || errno != EACCES)
+		return 1;
+	return 0;
+}
+
+int
+main(void)
+{
+	int fd, n;
+	bool more;
+	unsigned steps;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exit = cb_exit;
+	tbl.cleanup = cb_cleanup;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getpid, h_getpid_entry, NULL)
+			|| !pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getppid, h_getppid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, call_func, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	fd = pink_easy_loop_get_fd(ctx);
+	if (fd < 0) {
+		fprintf(stderr, "%s:%d: pink_easy_loop_get_fd failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	/* Drive the loop from poll(2) */
+	more = true;
+	for (steps = 0; more && steps < 100000; steps++) {
+		struct pollfd pfd;
+
+		if (parked) {
+			if (!pink_easy_process_complete(parked, PINK_EASY_POLICY_DENY, EACCES)) {
+				fprintf(stderr, "%s:%d: pink_easy_process_complete failed (errno:%d %s)\n",
+						__func__, __LINE__,
+						errno, strerror(errno));
+				abort();
+			}
+			parked = NULL;
+		}
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		/* SIGCHLD interrupts poll(2) even with SA_RESTART */
+		n = poll(&pfd, 1, 10000);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			fprintf(stderr, "%s:%d: no events (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+		more = pink_easy_loop_dispatch_ready(ctx);
+	}
+
+	error = pink_easy_context_get_error(ctx);
+	if (more || error != PINK_EASY_ERROR_SUCCESS || cleanups != 1) {
+		fprintf(stderr, "%s:%d: more:%d cleanups:%u %i (%s)\n",
+				__func__, __LINE__, more, cleanups,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0 || getpid_entries != 5) {
+		fprintf(stderr, "%s:%d: status:%#x getpid:%u\n",
+				__func__, __LINE__,
+				(unsigned)exit_status, getpid_entries);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
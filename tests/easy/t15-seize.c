@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+static unsigned startups;
+static unsigned getpid_entries;
+static int exit_status;
+static pid_t first_pid;
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	fprintf(stderr, "%s:%d: child[%i]: %s\n",
+			__func__, __LINE__,
+			getpid(), pink_easy_child_strerror(error));
+	return -1;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	++startups;
+	if (!parent)
+		first_pid = pink_easy_process_get_pid(current);
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (pid == first_pid)
+		exit_status = status;
+	return 0;
+}
+
+static int h_getpid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++getpid_entries;
+	return 0;
+}
+
+/* The grandchild stops itself, the group-stop must not be resumed by the
+ * tracer, only by the SIGCONT of its parent. */
+static int call_func(void *data)
+{
+	int status;
+	pid_t pid;
+	bool jobctl = *(bool *)data;
+
+	pid = fork();
+	if (pid < 0)
+		return 1;
+	if (pid == 0) {
+		syscall(SYS_getpid);
+		/* raise(3) may call getpid() */
+		if (jobctl)
+			syscall(SYS_tkill, syscall(SYS_gettid), SIGSTOP);
+		_exit(0);
+	}
+
+	if (jobctl) {
+		if (waitpid(pid, &status, WUNTRACED) < 0 || !WIFSTOPPED(status))
+			return 2;
+		kill(pid, SIGCONT);
+	}
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return 3;
+	syscall(SYS_getpid);
+	return 0;
+}
+
+/* Returns NULL if PTRACE_SEIZE is not supported */
+static pink_easy_context_t *new_context(bool seize)
+{
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.startup = cb_startup;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_set_seize(ctx, seize)) {
+		if (errno == ENOTSUP) {
+			pink_easy_context_destroy(ctx);
+			return NULL;
+		}
+		fprintf(stderr, "%s:%d: pink_easy_context_set_seize failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getpid, h_getpid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	startups = getpid_entries = 0;
+	exit_status = -1;
+	return ctx;
+}
+
+static void check(pink_easy_context_t *ctx, const char *mode,
+		unsigned want_startups, unsigned want_getpid)
+{
+	pink_easy_error_t error;
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s: %s: error %i (%s)\n",
+				__func__, mode,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0
+			|| startups != want_startups || getpid_entries != want_getpid) {
+		fprintf(stderr, "%s: %s: status:%#x startups:%u getpid:%u\n",
+				__func__, mode,
+				(unsigned)exit_status, startups, getpid_entries);
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+}
+
+static void test_call(bool seize)
+{
+	bool jobctl = seize;
+	pink_easy_context_t *ctx;
+
+	ctx = new_context(seize);
+	if (!ctx) {
+		fprintf(stderr, "PTRACE_SEIZE not supported, skipping\n");
+		return;
+	}
+	if (!pink_easy_call(ctx, call_func, &jobctl)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	check(ctx, seize ? "call, seize" : "call", 2, 2);
+}
+
+static void test_attach(bool seize)
+{
+	int fd[2];
+	char c = 0;
+	pink_easy_context_t *ctx;
+
+	if (pipe(fd) < 0) {
+		perror("pipe");
+		abort();
+	}
+	first_pid = fork();
+	if (first_pid < 0) {
+		perror("fork");
+		abort();
+	} else if (first_pid == 0) {
+		close(fd[1]);
+		if (read(fd[0], &c, 1) != 1)
+			_exit(1);
+		syscall(SYS_getpid);
+		_exit(0);
+	}
+	close(fd[0]);
+
+	ctx = new_context(seize);
+	if (!ctx) {
+		fprintf(stderr, "PTRACE_SEIZE not supported, skipping\n");
+		kill(first_pid, SIGKILL);
+		waitpid(first_pid, NULL, 0);
+		return;
+	}
+	if (!pink_easy_attach(ctx, first_pid, -1)) {
+		fprintf(stderr, "%s:%d: pink_easy_attach failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (write(fd[1], &c, 1) != 1) {
+		perror("write");
+		abort();
+	}
+	close(fd[1]);
+	pink_easy_loop(ctx);
+	check(ctx, seize ? "attach, seize" : "attach", 1, 1);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	test_call(false);
+	test_attach(false);
+	test_call(true);
+	test_attach(true);
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pinktrace/easy/pink.h>
+
+#define NTHREADS 8
+
+static unsigned startups;
+static int exit_status;
+static pid_t child;
+static int release[2];
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	++startups;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (pid == child)
+		exit_status = status;
+	return 0;
+}
+
+static void wait_release(void)
+{
+	char c;
+
+	while (read(release[0], &c, 1) < 0 && errno == EINTR)
+		/* void */;
+}
+
+static void *thread_func(void *data)
+{
+	wait_release();
+	return NULL;
+}
+
+/* The process to attach to: NTHREADS threads and a child, all blocked until
+ * the tracer closes the release pipe. */
+static void run_child(int ready)
+{
+	int status;
+	pid_t pid;
+	pthread_t threads[NTHREADS];
+
+	pid = fork();
+	if (pid < 0)
+		_exit(1);
+	if (pid == 0) {
+		close(ready);
+		wait_release();
+		_exit(0);
+	}
+	for (unsigned i = 0; i < NTHREADS; i++)
+		if (pthread_create(&threads[i], NULL, thread_func, NULL))
+			_exit(2);
+
+	close(ready);
+	for (unsigned i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		_exit(3);
+	_exit(0);
+}
+
+static void test(int flags, const char *mode)
+{
+	int ready[2];
+	char c;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_attach_stats_t stats;
+
+	if (pipe(release) < 0 || pipe(ready) < 0) {
+		perror("pipe");
+		abort();
+	}
+	child = fork();
+	if (child < 0) {
+		perror("fork");
+		abort();
+	} else if (child == 0) {
+		close(release[1]);
+		close(ready[0]);
+		run_child(ready[1]);
+	}
+	close(release[0]);
+	close(ready[1]);
+	/* Wait until all the tasks are there */
+	if (read(ready[0], &c, 1) != 0) {
+		perror("read");
+		abort();
+	}
+	close(ready[0]);
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	startups = 0;
+	exit_status = -1;
+	if (!pink_easy_attach_tree(ctx, child, flags, &stats)) {
+		fprintf(stderr, "%s: %s: pink_easy_attach_tree failed (errno:%d %s)\n",
+				__func__, mode,
+				errno, strerror(errno));
+		abort();
+	}
+	/* Process, its threads and its child */
+	if (stats.tasks != NTHREADS + 2 || stats.passes < 2) {
+		fprintf(stderr, "%s: %s: tasks:%u passes:%u\n",
+				__func__, mode,
+				stats.tasks, stats.passes);
+		abort();
+	}
+
+	close(release[1]);
+	pink_easy_loop(ctx);
+
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s: %s: error %i (%s)\n",
+				__func__, mode,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0
+			|| startups != NTHREADS + 2) {
+		fprintf(stderr, "%s: %s: status:%#x startups:%u\n",
+				__func__, mode,
+				(unsigned)exit_status, startups);
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	test(PINK_EASY_ATTACH_DESCENDANTS, "attach");
+	test(PINK_EASY_ATTACH_DESCENDANTS | PINK_EASY_ATTACH_SEIZE, "seize");
+	return 0;
+}
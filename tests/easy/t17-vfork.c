@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+static unsigned getpid_entries;
+static unsigned execve_entries;
+static unsigned execs;
+static int exit_status;
+static int hook_pipe[2];
+
+static int eb_child(pink_easy_child_error_t error)
+{
+	return 42;
+}
+
+static int cb_exec(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_bitness_t old_bitness)
+{
+	++execs;
+	return 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	exit_status = status;
+	return 0;
+}
+
+static int h_getpid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++getpid_entries;
+	return 0;
+}
+
+static int h_execve_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	++execve_entries;
+	return 0;
+}
+
+/* Runs in the vfork()'ed child */
+static int exec_hook(void *data)
+{
+	if (write(hook_pipe[1], data, 1) != 1)
+		return 1;
+	close(hook_pipe[1]);
+	return 0;
+}
+
+static void run(bool seccomp, const char *path)
+{
+	char c;
+	char *argv[] = { (char *)"t17_vfork", (char *)"child", NULL };
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	getpid_entries = execve_entries = execs = 0;
+	exit_status = -1;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cerror = eb_child;
+	tbl.exec = cb_exec;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_EXEC, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getpid, h_getpid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_execve, h_execve_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	policy = NULL;
+	if (seccomp) {
+		policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+		if (!policy || !pink_easy_policy_compile(policy)) {
+			perror("pink_easy_policy");
+			abort();
+		}
+		if (!pink_easy_context_set_policy(ctx, policy, true)) {
+			if (errno == ENOTSUP) {
+				fprintf(stderr, "%s:%d: seccomp not supported, skipping\n", __func__, __LINE__);
+				pink_easy_context_destroy(ctx);
+				pink_easy_policy_destroy(policy);
+				return;
+			}
+			fprintf(stderr, "%s:%d: pink_easy_context_set_policy failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+
+	if (pipe(hook_pipe) < 0) {
+		perror("pipe");
+		abort();
+	}
+	pink_easy_context_set_exec_hook(ctx, exec_hook, (void *)"!");
+
+	if (!pink_easy_execv(ctx, path, argv)) {
+		fprintf(stderr, "%s:%d: pink_easy_execv failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	close(hook_pipe[1]);
+	if (read(hook_pipe[0], &c, 1) != 1 || c != '!') {
+		fprintf(stderr, "%s:%d: seccomp:%d hook didn't run\n",
+				__func__, __LINE__, seccomp);
+		abort();
+	}
+	close(hook_pipe[0]);
+
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: seccomp:%d %i (%s)\n",
+				__func__, __LINE__, seccomp,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+
+	/* The execve() of a vfork()'ed child is before its first stop, with
+	 * seccomp the filter traps it */
+	if (execve_entries != (seccomp ? 1 : 0)) {
+		fprintf(stderr, "%s:%d: seccomp:%d execve:%u\n",
+				__func__, __LINE__, seccomp, execve_entries);
+		abort();
+	}
+
+	if (path[0] != '/') {
+		/* execve() failed, the child errback gives the exit status */
+		if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 42 || execs != 0) {
+			fprintf(stderr, "%s:%d: seccomp:%d status:%#x execs:%u\n",
+					__func__, __LINE__, seccomp,
+					(unsigned)exit_status, execs);
+			abort();
+		}
+	} else if (!WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 7
+			|| execs != 1 || getpid_entries != 3) {
+		fprintf(stderr, "%s:%d: seccomp:%d status:%#x execs:%u getpid:%u\n",
+				__func__, __LINE__, seccomp,
+				(unsigned)exit_status, execs, getpid_entries);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	if (policy)
+		pink_easy_policy_destroy(policy);
+}
+
+int
+main(int argc, char **argv)
+{
+	/* The traced program */
+	if (argc > 1 && !strcmp(argv[1], "child")) {
+		for (int i = 0; i < 3; i++)
+			syscall(SYS_getpid);
+		return 7;
+	}
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	run(false, "/proc/self/exe");
+	run(true, "/proc/self/exe");
+	run(false, "does-not-exist");
+	run(true, "does-not-exist");
+	return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define NJOBS 16
+/* Served by the first helper, its second fork fails with seccomp, helpers
+ * stop for nothing but their forks without */
+#define FAILED_JOB 3
+/* Spawned from a callback, more than the socket of the helper takes */
+#define NBIG 8
+#define BIG_SIZE (64 * 1024)
+
+extern char **environ;
+
+static pink_easy_launcher_t *launcher;
+static bool started[NJOBS];
+static unsigned plain, with_env;
+static unsigned helper_forks, helper_stops;
+static pid_t helper_pid[2];
+static uintptr_t failed, expect_failed;
+static char **job_envp;
+static unsigned big_exits, bare_exits, other_exits;
+static char *big_arg;
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	uintptr_t i = (uintptr_t)pink_easy_process_get_userdata(current);
+
+	if (i > 0 && i <= NJOBS)
+		started[i - 1] = true;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (!WIFEXITED(status))
+		return 0;
+	if (WEXITSTATUS(status) == 7)
+		++plain;
+	else if (WEXITSTATUS(status) == 8)
+		++with_env;
+	/* All jobs are done, let the helpers go */
+	if (launcher && plain + with_env == NJOBS - (expect_failed ? 1 : 0)) {
+		pink_easy_launcher_destroy(launcher);
+		launcher = NULL;
+	}
+	return 0;
+}
+
+static int h_clone_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	if (!launcher || pink_easy_process_get_pid(current) != pink_easy_launcher_get_pid(launcher, 0))
+		return 0;
+	if (++helper_forks == 2 && !pink_easy_process_deny(current, EPERM)) {
+		fprintf(stderr, "%s:%d: pink_easy_process_deny failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	return 0;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current, bool entering)
+{
+	pid_t pid = pink_easy_process_get_pid(current);
+
+	if (pid == helper_pid[0] || pid == helper_pid[1])
+		++helper_stops;
+	return 0;
+}
+
+static void job_destroy(void *userdata)
+{
+	if (failed) {
+		fprintf(stderr, "%s:%d: jobs %lu and %lu failed\n",
+				__func__, __LINE__,
+				(unsigned long)failed, (unsigned long)(uintptr_t)userdata);
+		abort();
+	}
+	failed = (uintptr_t)userdata;
+}
+
+static void *spawner(void *data)
+{
+	char *argv[] = { (char *)"t18_launcher", (char *)"child", NULL };
+
+	for (uintptr_t i = 1; i <= NJOBS; i++) {
+		if (!pink_easy_launcher_spawn(launcher, "/proc/self/exe", argv,
+					i % 2 ? job_envp : NULL, (void *)i)) {
+			fprintf(stderr, "%s:%d: pink_easy_launcher_spawn failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+	return NULL;
+}
+
+static void cb_startup_big(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	char *argv[] = { (char *)"t18_launcher", (char *)"child", big_arg, NULL };
+
+	/* The helper is stopped at the fork of the first child */
+	if ((uintptr_t)pink_easy_process_get_userdata(current) != 1)
+		return;
+	for (unsigned i = 0; i < NBIG; i++) {
+		if (!pink_easy_launcher_spawn(launcher, "/proc/self/exe", argv, NULL, NULL)) {
+			fprintf(stderr, "%s:%d: pink_easy_launcher_spawn failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+}
+
+static int cb_exit_big(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (!WIFEXITED(status))
+		return 0;
+	if (WEXITSTATUS(status) == 7)
+		++big_exits;
+	else if (WEXITSTATUS(status) == 9)
+		++bare_exits;
+	else
+		++other_exits;
+	if (launcher && big_exits + bare_exits + other_exits == NBIG + 2) {
+		pink_easy_launcher_destroy(launcher);
+		launcher = NULL;
+	}
+	return 0;
+}
+
+/* Spawning from a callback never blocks on the socket of a stopped helper */
+static void run_from_callback(void)
+{
+	char *argv[] = { (char *)"t18_launcher", (char *)"child", NULL };
+	char *sh_argv[] = { (char *)"sh", (char *)"-c", (char *)"exit $PINK_T18", NULL };
+	char *sh_envp[] = { (char *)"PINK_T18=9", NULL };
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	big_exits = bare_exits = other_exits = 0;
+	big_arg = malloc(BIG_SIZE);
+	if (!big_arg) {
+		perror("malloc");
+		abort();
+	}
+	memset(big_arg, 'x', BIG_SIZE - 1);
+	big_arg[BIG_SIZE - 1] = '\0';
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup_big;
+	tbl.exit = cb_exit_big;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK | PINK_TRACE_OPTION_EXEC,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	launcher = pink_easy_launcher_new(ctx, 1);
+	if (!launcher) {
+		fprintf(stderr, "%s:%d: pink_easy_launcher_new failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	/* A bare name is searched in PATH with an environment given too */
+	if (!pink_easy_launcher_spawn(launcher, "/proc/self/exe", argv, NULL, (void *)1)
+			|| !pink_easy_launcher_spawn(launcher, "sh", sh_argv, sh_envp, (void *)2)) {
+		fprintf(stderr, "%s:%d: pink_easy_launcher_spawn failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	if (pink_easy_context_get_error(ctx) != PINK_EASY_ERROR_SUCCESS
+			|| big_exits != NBIG + 1 || bare_exits != 1) {
+		fprintf(stderr, "%s:%d: error:%d exits:%u bare:%u\n",
+				__func__, __LINE__,
+				pink_easy_context_get_error(ctx), big_exits, bare_exits);
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+	free(big_arg);
+}
+
+static void run(bool seccomp)
+{
+	pthread_t thread;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_policy_t *policy;
+
+	memset(started, 0, sizeof(started));
+	plain = with_env = 0;
+	helper_forks = helper_stops = 0;
+	failed = 0;
+	expect_failed = seccomp ? FAILED_JOB : 0;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+	tbl.exit = cb_exit;
+	tbl.syscall = cb_syscall;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK | PINK_TRACE_OPTION_EXEC,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	/* Before the policy, the filter traces dispatched system calls */
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_clone, h_clone_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	policy = NULL;
+	if (seccomp) {
+		policy = pink_easy_policy_new(PINK_EASY_POLICY_ALLOW, 0);
+		if (!policy || !pink_easy_policy_compile(policy)) {
+			perror("pink_easy_policy");
+			abort();
+		}
+		if (!pink_easy_context_set_policy(ctx, policy, true)) {
+			if (errno == ENOTSUP) {
+				fprintf(stderr, "%s:%d: seccomp not supported, skipping\n", __func__, __LINE__);
+				pink_easy_context_destroy(ctx);
+				pink_easy_policy_destroy(policy);
+				return;
+			}
+			fprintf(stderr, "%s:%d: pink_easy_context_set_policy failed (errno:%d %s)\n",
+					__func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+
+	launcher = pink_easy_launcher_new(ctx, 2);
+	if (!launcher) {
+		fprintf(stderr, "%s:%d: pink_easy_launcher_new failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_launcher_set_userdata_destroy(launcher, job_destroy);
+	helper_pid[0] = pink_easy_launcher_get_pid(launcher, 0);
+	helper_pid[1] = pink_easy_launcher_get_pid(launcher, 1);
+
+	if (pthread_create(&thread, NULL, spawner, NULL) != 0) {
+		perror("pthread_create");
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	pthread_join(thread, NULL);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: seccomp:%d %i (%s)\n",
+				__func__, __LINE__, seccomp,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+
+	/* The failed job would have run with the environment */
+	if (plain != NJOBS / 2 || with_env != NJOBS / 2 - (expect_failed ? 1 : 0) || failed != expect_failed) {
+		fprintf(stderr, "%s:%d: seccomp:%d plain:%u with_env:%u failed:%lu\n",
+				__func__, __LINE__, seccomp, plain, with_env,
+				(unsigned long)failed);
+		abort();
+	}
+	if (!seccomp && (helper_forks || helper_stops)) {
+		fprintf(stderr, "%s:%d: helper system call stops:%u clones:%u\n",
+				__func__, __LINE__, helper_stops, helper_forks);
+		abort();
+	}
+	for (unsigned i = 0; i < NJOBS; i++) {
+		if (started[i] != (i + 1 != expect_failed)) {
+			fprintf(stderr, "%s:%d: seccomp:%d job %u started:%d\n",
+					__func__, __LINE__, seccomp, i + 1, started[i]);
+			abort();
+		}
+	}
+
+	pink_easy_context_destroy(ctx);
+	if (policy)
+		pink_easy_policy_destroy(policy);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned n;
+
+	/* The traced program */
+	if (argc > 1 && !strcmp(argv[1], "child"))
+		return getenv("PINK_T18") ? 8 : 7;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	for (n = 0; environ[n]; n++)
+		;
+	job_envp = calloc(n + 2, sizeof(char *));
+	if (!job_envp) {
+		perror("calloc");
+		abort();
+	}
+	memcpy(job_envp, environ, n * sizeof(char *));
+	job_envp[n] = (char *)"PINK_T18=1";
+
+	run(false);
+	run(true);
+	run_from_callback();
+	free(job_envp);
+	return 0;
+}
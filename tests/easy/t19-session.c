@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define NJOBS 8
+
+struct job {
+	unsigned id;
+	char mode; /* 'p'lain, 'f'ork, 'a'bort or 'k'illed while parked */
+	unsigned getpids;
+	unsigned exits;
+	bool bad_status;
+	unsigned cleanups;
+	pink_easy_error_t error;
+	pink_easy_context_t *ctx;
+};
+
+static pink_easy_session_t *session;
+static struct job jobs[NJOBS + 1];
+static pthread_t parked_thread;
+static volatile bool parked_completed, completed_at_cleanup;
+
+static void start(struct job *job);
+
+static int h_getpid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	struct job *job = pink_easy_context_get_userdata(ctx);
+
+	++job->getpids;
+	return job->mode == 'a' ? PINK_EASY_CFLAG_ABORT : 0;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	struct job *job = pink_easy_context_get_userdata(ctx);
+
+	++job->exits;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != job->id)
+		job->bad_status = true;
+	/* Contexts may join while the loop runs */
+	if (job->id == 1)
+		start(&jobs[NJOBS]);
+	return 0;
+}
+
+static int cb_cleanup(const pink_easy_context_t *ctx)
+{
+	struct job *job = pink_easy_context_get_userdata(ctx);
+
+	++job->cleanups;
+	job->error = pink_easy_context_get_error(ctx);
+	return 0;
+}
+
+static void start(struct job *job)
+{
+	char id[16], mode[2] = { job->mode, '\0' };
+	char *argv[] = { (char *)"t19_session", (char *)"child", id, mode, NULL };
+	pink_easy_callback_table_t tbl;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.exit = cb_exit;
+	tbl.cleanup = cb_cleanup;
+
+	job->ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK | PINK_TRACE_OPTION_EXEC,
+			&tbl, job, NULL);
+	if (!job->ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_dispatch_set(job->ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getpid, h_getpid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	snprintf(id, sizeof(id), "%u", job->id);
+	if (!pink_easy_execv(job->ctx, "/proc/self/exe", argv)) {
+		fprintf(stderr, "%s:%d: pink_easy_execv failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (!pink_easy_session_add(session, job->ctx)) {
+		fprintf(stderr, "%s:%d: pink_easy_session_add failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+}
+
+static void check(const struct job *job)
+{
+	unsigned getpids = job->id, exits = 1;
+	pink_easy_error_t error = PINK_EASY_ERROR_SUCCESS;
+
+	if (job->mode == 'f') {
+		getpids *= 2;
+		exits = 2;
+	} else if (job->mode == 'a') {
+		getpids = 1;
+		exits = 0;
+		error = PINK_EASY_ERROR_CALLBACK_ABORT;
+	}
+
+	if (job->cleanups != 1 || job->error != error || job->getpids != getpids
+			|| job->exits != exits || job->bad_status) {
+		fprintf(stderr, "%s:%d: job:%u mode:%c cleanups:%u error:%d getpids:%u exits:%u bad_status:%d\n",
+				__func__, __LINE__,
+				job->id, job->mode, job->cleanups, job->error,
+				job->getpids, job->exits, job->bad_status);
+		abort();
+	}
+}
+
+/* Kills the parked process, completes its decision only after waitpid()
+ * has nothing left to wait for */
+static void *parked_worker(void *data)
+{
+	pink_easy_process_t *current = data;
+
+	kill(pink_easy_process_get_pid(current), SIGKILL);
+	usleep(100000);
+	parked_completed = true;
+	if (!pink_easy_process_complete(current, PINK_EASY_POLICY_ALLOW, 0)) {
+		fprintf(stderr, "%s:%d: pink_easy_process_complete failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	return NULL;
+}
+
+static int h_getppid_entry(const pink_easy_context_t *ctx, pink_easy_process_t *current, long scno)
+{
+	if (pthread_create(&parked_thread, NULL, parked_worker, current) != 0) {
+		perror("pthread_create");
+		return PINK_EASY_CFLAG_ABORT;
+	}
+	return PINK_EASY_CFLAG_PENDING;
+}
+
+static int cb_cleanup_parked(const pink_easy_context_t *ctx)
+{
+	completed_at_cleanup = parked_completed;
+	return 0;
+}
+
+/* A context finishes only after its pending decisions are completed */
+static void run_parked(void)
+{
+	char *argv[] = { (char *)"t19_session", (char *)"child", (char *)"0", (char *)"k", NULL };
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.cleanup = cb_cleanup_parked;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_dispatch_set(ctx, PINKTRACE_BITNESS_DEFAULT, SYS_getppid, h_getppid_entry, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_dispatch_set failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (!pink_easy_execv(ctx, "/proc/self/exe", argv) || !pink_easy_session_add(session, ctx)) {
+		fprintf(stderr, "%s:%d: spawning failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (!pink_easy_session_loop(session)) {
+		fprintf(stderr, "%s:%d: pink_easy_session_loop failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pthread_join(parked_thread, NULL);
+	if (!completed_at_cleanup) {
+		fprintf(stderr, "%s:%d: cleanup before the decision was completed\n",
+				__func__, __LINE__);
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+}
+
+/* The traced program, does id getpid() calls and exits with id */
+static int child(unsigned id, char mode)
+{
+	int status;
+	pid_t pid = 0;
+
+	if (mode == 'a') {
+		for (;;)
+			syscall(SYS_getpid);
+	}
+	if (mode == 'k')
+		return syscall(SYS_getppid) < 0;
+	if (mode == 'f' && (pid = fork()) < 0)
+		return 0;
+	for (unsigned i = 0; i < id; i++)
+		syscall(SYS_getpid);
+	if (pid > 0 && (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)))
+		return 0;
+	return id;
+}
+
+int
+main(int argc, char **argv)
+{
+	if (argc > 3 && !strcmp(argv[1], "child"))
+		return child(atoi(argv[2]), argv[3][0]);
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	session = pink_easy_session_new();
+	if (!session) {
+		perror("pink_easy_session_new");
+		abort();
+	}
+
+	for (unsigned i = 0; i <= NJOBS; i++) {
+		jobs[i].id = i + 1;
+		jobs[i].mode = i == 3 ? 'a' : i % 2 ? 'f' : 'p';
+	}
+	/* The last one is started by the first one */
+	for (unsigned i = 0; i < NJOBS; i++)
+		start(&jobs[i]);
+
+	if (pink_easy_session_count(session) != NJOBS) {
+		fprintf(stderr, "%s:%d: count:%u\n", __func__, __LINE__,
+				pink_easy_session_count(session));
+		abort();
+	}
+	if (!pink_easy_session_loop(session)) {
+		fprintf(stderr, "%s:%d: pink_easy_session_loop failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (pink_easy_session_count(session) != 0) {
+		fprintf(stderr, "%s:%d: count:%u\n", __func__, __LINE__,
+				pink_easy_session_count(session));
+		abort();
+	}
+
+	for (unsigned i = 0; i <= NJOBS; i++) {
+		check(&jobs[i]);
+		pink_easy_context_destroy(jobs[i].ctx);
+	}
+
+	run_parked();
+	pink_easy_session_destroy(session);
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pinktrace/easy/pink.h>
+
+/* The traced program: two threads, two children and a grandchild under
+ * each child */
+#define NTASKS 7
+
+static pink_easy_process_t *root, *child1;
+static pid_t detached[2];
+static unsigned startups, teardowns, threads;
+static bool killed;
+
+static bool count_threads(pink_easy_process_t *proc, void *data)
+{
+	++threads;
+	return true;
+}
+
+static bool find_detached(pink_easy_process_t *proc, void *data)
+{
+	unsigned *n = data;
+
+	if (*n < 2)
+		detached[(*n)++] = pink_easy_process_get_pid(proc);
+	return true;
+}
+
+static bool kill_others(pink_easy_process_t *proc, void *data)
+{
+	if (proc != data)
+		pink_easy_process_kill(proc, SIGKILL);
+	return true;
+}
+
+static void check_tree(void)
+{
+	unsigned n = 0;
+
+	if (pink_easy_process_tree_count(root) != NTASKS
+			|| pink_easy_process_tree_kill(root, 0) != NTASKS) {
+		fprintf(stderr, "%s:%d: count:%u\n", __func__, __LINE__,
+				pink_easy_process_tree_count(root));
+		abort();
+	}
+	if (pink_easy_process_thread_walk(root, count_threads, NULL) != 3 || threads != 3) {
+		fprintf(stderr, "%s:%d: threads:%u\n", __func__, __LINE__, threads);
+		abort();
+	}
+	if (!child1 || pink_easy_process_tree_count(child1) != 2) {
+		fprintf(stderr, "%s:%d: child subtree:%u\n", __func__, __LINE__,
+				child1 ? pink_easy_process_tree_count(child1) : 0);
+		abort();
+	}
+	if (pink_easy_process_tree_walk(child1, find_detached, &n) != 2 || n != 2) {
+		fprintf(stderr, "%s:%d: walk:%u\n", __func__, __LINE__, n);
+		abort();
+	}
+	if (pink_easy_process_tree_detach(child1) != 2) {
+		fprintf(stderr, "%s:%d: detach failed\n", __func__, __LINE__);
+		abort();
+	}
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	if (parent == NULL) {
+		root = current;
+	} else if (pink_easy_process_is_clone(current)) {
+		if (pink_easy_process_get_tgid(current) != pink_easy_process_get_pid(root)
+				|| pink_easy_process_get_parent(current) != root) {
+			fprintf(stderr, "%s:%d: thread:%d tgid:%d\n", __func__, __LINE__,
+					pink_easy_process_get_pid(current),
+					pink_easy_process_get_tgid(current));
+			abort();
+		}
+	} else if (parent == root && !child1) {
+		child1 = current;
+	}
+	if (pink_easy_process_get_parent(current) != parent) {
+		fprintf(stderr, "%s:%d: parent mismatch\n", __func__, __LINE__);
+		abort();
+	}
+
+	if (++startups == NTASKS)
+		check_tree();
+}
+
+static void cb_teardown(const pink_easy_context_t *ctx, const pink_easy_process_t *current)
+{
+	/* The entry of the last detached process is removed after this,
+	 * the rest of the tree is to be killed */
+	if (++teardowns == 2 && !killed) {
+		killed = true;
+		if (pink_easy_process_tree_count(root) != NTASKS - 1) {
+			fprintf(stderr, "%s:%d: count:%u\n", __func__, __LINE__,
+					pink_easy_process_tree_count(root));
+			abort();
+		}
+		pink_easy_process_tree_walk(root, kill_others, (void *)current);
+	}
+}
+
+static bool traced(pid_t pid)
+{
+	long tracer = -1;
+	char path[32], line[128];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+	f = fopen(path, "r");
+	if (!f)
+		return false;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "TracerPid: %ld", &tracer) == 1)
+			break;
+	fclose(f);
+	return tracer != 0;
+}
+
+static void *thread_main(void *data)
+{
+	for (;;)
+		pause();
+	return NULL;
+}
+
+static int child(void *data)
+{
+	pthread_t thread;
+
+	for (unsigned i = 0; i < 2; i++) {
+		if (pthread_create(&thread, NULL, thread_main, NULL) != 0)
+			return 1;
+	}
+	for (unsigned i = 0; i < 2; i++) {
+		pid_t pid = fork();
+		if (pid < 0)
+			return 1;
+		if (pid == 0) {
+			if (fork() < 0)
+				_exit(1);
+			for (;;)
+				pause();
+		}
+	}
+	for (;;)
+		pause();
+	return 0;
+}
+
+int
+main(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+	tbl.teardown = cb_teardown;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK
+			| PINK_TRACE_OPTION_VFORK | PINK_TRACE_OPTION_CLONE,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	/* Only seized processes are detached right away */
+	if (!pink_easy_context_set_seize(ctx, true)) {
+		if (errno == ENOTSUP) {
+			fprintf(stderr, "%s:%d: PTRACE_SEIZE not supported, skipping\n", __func__, __LINE__);
+			pink_easy_context_destroy(ctx);
+			return 0;
+		}
+		perror("pink_easy_context_set_seize");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (startups != NTASKS || teardowns != 2 || !killed) {
+		fprintf(stderr, "%s:%d: startups:%u teardowns:%u\n",
+				__func__, __LINE__, startups, teardowns);
+		abort();
+	}
+
+	for (unsigned i = 0; i < 2; i++) {
+		if (traced(detached[i])) {
+			fprintf(stderr, "%s:%d: %d still traced\n",
+					__func__, __LINE__, detached[i]);
+			abort();
+		}
+		kill(detached[i], SIGKILL);
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <pinktrace/easy/pink.h>
+
+/* The traced program: a thread and a child */
+#define NTASKS 3
+
+static pink_easy_process_t *root;
+static unsigned startups, destroyed;
+
+static void group_destroy(void *data)
+{
+	++destroyed;
+}
+
+static void check_shared(pink_easy_process_t *current, pink_easy_group_type_t type,
+		bool shared)
+{
+	pink_easy_group_t *group, *rgroup;
+
+	group = pink_easy_process_get_group(current, type);
+	rgroup = pink_easy_process_get_group(root, type);
+	if (!group || !rgroup || pink_easy_group_get_type(group) != type) {
+		fprintf(stderr, "%s:%d: type:%d no group\n", __func__, __LINE__, type);
+		abort();
+	}
+	if ((group == rgroup) != shared
+			|| pink_easy_group_get_refcount(group) != (shared ? 2 : 1)) {
+		fprintf(stderr, "%s:%d: type:%d shared:%d refs:%u\n",
+				__func__, __LINE__, type, shared,
+				pink_easy_group_get_refcount(group));
+		abort();
+	}
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	bool thread;
+	pink_easy_group_t *group;
+
+	if (parent == NULL)
+		root = current;
+	group = pink_easy_process_get_group(current, PINK_EASY_GROUP_VM);
+	if (!group) {
+		fprintf(stderr, "%s:%d: no group\n", __func__, __LINE__);
+		abort();
+	}
+	if (parent != NULL) {
+		thread = pink_easy_process_is_clone(current);
+		for (unsigned i = 0; i < PINK_EASY_GROUP_MAX; i++)
+			check_shared(current, i, thread);
+	}
+	if (!pink_easy_group_get_userdata(group))
+		pink_easy_group_set_userdata(group, group, group_destroy);
+
+	if (++startups == NTASKS)
+		pink_easy_process_tree_kill(root, SIGKILL);
+}
+
+static void *thread_main(void *data)
+{
+	for (;;)
+		pause();
+	return NULL;
+}
+
+static int child(void *data)
+{
+	pthread_t thread;
+	pid_t pid;
+
+	if (pthread_create(&thread, NULL, thread_main, NULL) != 0)
+		return 1;
+	pid = fork();
+	if (pid < 0)
+		return 1;
+	for (;;)
+		pause();
+	return 0;
+}
+
+int
+main(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK
+			| PINK_TRACE_OPTION_VFORK | PINK_TRACE_OPTION_CLONE,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	/* The address space of the thread and its leader is one group */
+	if (startups != NTASKS || destroyed != 2) {
+		fprintf(stderr, "%s:%d: startups:%u destroyed:%u\n",
+				__func__, __LINE__, startups, destroyed);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE /* dup3() */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pinktrace/easy/pink.h>
+
+/* File descriptors of the traced program */
+#define DIRFD	10
+#define DUPFD	11
+#define SOCKFD	12
+#define ATFD	13
+
+static pink_easy_process_t *root;
+static unsigned root_marks, child_marks, quieted;
+
+/* Working directories of the traced program after each chdir() */
+static const char *const chdirs[] = { "/", "/tmp", "/", "/tmp" };
+static unsigned nchdirs;
+
+static void check_path(pink_easy_process_t *current, long fd, const char *expected)
+{
+	char path[256];
+
+	if (!pink_easy_process_get_fd_path(current, fd, path, sizeof(path))) {
+		fprintf(stderr, "%s:%d: fd:%ld (errno:%d %s)\n", __func__, __LINE__,
+				fd, errno, strerror(errno));
+		abort();
+	}
+	if (strcmp(path, expected)) {
+		fprintf(stderr, "%s:%d: fd:%ld path:`%s' expected:`%s'\n",
+				__func__, __LINE__, fd, path, expected);
+		abort();
+	}
+}
+
+static void check_closed(pink_easy_process_t *current, long fd)
+{
+	char path[256];
+
+	if (pink_easy_process_get_fd_path(current, fd, path, sizeof(path)) || errno != EBADF) {
+		fprintf(stderr, "%s:%d: fd:%ld open (errno:%d)\n", __func__, __LINE__,
+				fd, errno);
+		abort();
+	}
+}
+
+static void check_shadow(pink_easy_process_t *current, bool forked)
+{
+	int flags;
+	char path[256];
+	pink_easy_fd_type_t type;
+	pink_socket_address_t addr;
+
+	if (!pink_easy_process_get_cwd(current, path, sizeof(path)) || strcmp(path, "/")) {
+		fprintf(stderr, "%s:%d: cwd\n", __func__, __LINE__);
+		abort();
+	}
+
+	check_path(current, DIRFD, "/tmp");
+	flags = pink_easy_process_get_fd_flags(current, DIRFD);
+	if (flags < 0 || (flags & O_ACCMODE) != O_RDONLY || flags & O_CLOEXEC) {
+		fprintf(stderr, "%s:%d: flags:%#o\n", __func__, __LINE__, flags);
+		abort();
+	}
+	check_closed(current, ATFD);
+
+	if (!pink_easy_process_get_fd_type(current, SOCKFD, &type)
+			|| type != PINK_EASY_FD_SOCKET
+			|| !pink_easy_process_get_fd_address(current, SOCKFD, &addr)
+			|| addr.family != AF_INET
+			|| ntohs(addr.u.sa_in.sin_port) != 9) {
+		fprintf(stderr, "%s:%d: socket\n", __func__, __LINE__);
+		abort();
+	}
+	flags = pink_easy_process_get_fd_flags(current, SOCKFD);
+	if (flags < 0 || !(flags & O_NONBLOCK)) {
+		fprintf(stderr, "%s:%d: flags:%#o\n", __func__, __LINE__, flags);
+		abort();
+	}
+
+	/* Inherited from us, looked up in /proc */
+	if (!pink_easy_process_get_fd_type(current, 2, &type)) {
+		fprintf(stderr, "%s:%d: stderr\n", __func__, __LINE__);
+		abort();
+	}
+
+	if (!pink_easy_process_resolve_at(current, DIRFD, "a/b", path, sizeof(path))
+			|| strcmp(path, "/tmp/a/b")
+			|| !pink_easy_process_resolve_at(current, AT_FDCWD, "c", path, sizeof(path))
+			|| strcmp(path, "/c")
+			|| pink_easy_process_resolve_at(current, SOCKFD, "c", path, sizeof(path))
+			|| errno != ENOTDIR) {
+		fprintf(stderr, "%s:%d: resolve\n", __func__, __LINE__);
+		abort();
+	}
+
+	/* The child closed its copy */
+	if (forked)
+		check_closed(current, DUPFD);
+	else
+		check_path(current, DUPFD, "/tmp");
+}
+
+/* After a quiet member changed the shared table unseen */
+static void check_untracked(pink_easy_process_t *current)
+{
+	char path[256];
+	pink_socket_address_t addr;
+
+	if (!pink_easy_process_get_cwd(current, path, sizeof(path)) || strcmp(path, "/")) {
+		fprintf(stderr, "%s:%d: cwd\n", __func__, __LINE__);
+		abort();
+	}
+	check_path(current, DIRFD, "/tmp");
+	check_closed(current, DUPFD);
+
+	/* Known from the table only */
+	if (pink_easy_process_get_fd_address(current, SOCKFD, &addr) || errno != ENOTCONN) {
+		fprintf(stderr, "%s:%d: socket (errno:%d)\n", __func__, __LINE__, errno);
+		abort();
+	}
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	if (parent == NULL)
+		root = current;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool entering)
+{
+	long scno;
+
+	if (entering)
+		return 0;
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+				pink_easy_process_get_bitness(current), &scno)) {
+		fprintf(stderr, "%s:%d: get_syscall (errno:%d %s)\n",
+				__func__, __LINE__, errno, strerror(errno));
+		abort();
+	}
+	if (current == root && scno == pink_name_lookup("chdir", pink_easy_process_get_bitness(current))) {
+		char path[256];
+
+		if (nchdirs >= sizeof(chdirs) / sizeof(chdirs[0])
+				|| !pink_easy_process_get_cwd(current, path, sizeof(path))
+				|| strcmp(path, chdirs[nchdirs])) {
+			fprintf(stderr, "%s:%d: chdir %u\n", __func__, __LINE__, nchdirs);
+			abort();
+		}
+		nchdirs++;
+		return 0;
+	}
+	/* Sharing the tables with the root, which still needs them */
+	if (current != root && scno == pink_name_lookup("getpid", pink_easy_process_get_bitness(current))) {
+		quieted++;
+		return PINK_EASY_CFLAG_QUIET;
+	}
+	if (scno != pink_name_lookup("getppid", pink_easy_process_get_bitness(current)))
+		return 0;
+
+	if (current == root) {
+		if (++root_marks == 3)
+			check_untracked(current);
+		else
+			check_shadow(current, false);
+	} else {
+		child_marks++;
+		check_shadow(current, true);
+	}
+	return 0;
+}
+
+static int child(void *data)
+{
+	int fd;
+	pid_t pid;
+	struct sockaddr_in sin;
+
+	if (chdir("/") < 0)
+		return 1;
+	fd = open("tmp", O_RDONLY | O_DIRECTORY);
+	if (fd < 0 || dup2(fd, DIRFD) < 0 || close(fd) < 0)
+		return 1;
+	if (fcntl(DIRFD, F_DUPFD, DUPFD) != DUPFD)
+		return 1;
+	fd = openat(DIRFD, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0 || dup3(fd, ATFD, O_CLOEXEC) < 0 || close(fd) < 0 || close(ATFD) < 0)
+		return 1;
+
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || dup2(fd, SOCKFD) < 0 || close(fd) < 0)
+		return 1;
+	if (fcntl(SOCKFD, F_SETFL, O_NONBLOCK) < 0)
+		return 1;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(9);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(SOCKFD, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		return 1;
+
+	getppid();
+	pid = fork();
+	if (pid < 0)
+		return 1;
+	if (pid == 0) {
+		close(DUPFD);
+		getppid();
+		_exit(0);
+	}
+	if (waitpid(pid, NULL, 0) < 0)
+		return 1;
+	getppid();
+
+	pid = syscall(SYS_clone, CLONE_FILES | CLONE_FS | SIGCHLD, 0, NULL, NULL, 0);
+	if (pid < 0)
+		return 1;
+	if (pid == 0) {
+		/* Unseen by the tracer, in the table shared with the parent */
+		syscall(SYS_getpid);
+		close(DUPFD);
+		_exit(0);
+	}
+	if (waitpid(pid, NULL, 0) < 0)
+		return 1;
+	getppid();
+
+	/* Relative to the working directory */
+	if (chdir("tmp") < 0 || chdir("..") < 0 || chdir("tmp") < 0)
+		return 1;
+	return 0;
+}
+
+int
+main(void)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+	tbl.syscall = cb_syscall;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK
+			| PINK_TRACE_OPTION_VFORK | PINK_TRACE_OPTION_CLONE,
+			&tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_set_shadow(ctx, true)) {
+		perror("pink_easy_context_set_shadow");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (pink_easy_context_set_shadow(ctx, false) || errno != EBUSY) {
+		fprintf(stderr, "%s:%d: set_shadow with processes\n", __func__, __LINE__);
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (root_marks != 3 || child_marks != 1 || quieted != 1 || nchdirs != 4) {
+		fprintf(stderr, "%s:%d: marks:%u/%u quieted:%u chdirs:%u\n", __func__, __LINE__,
+				root_marks, child_marks, quieted, nchdirs);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+	return 0;
+}
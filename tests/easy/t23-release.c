@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pinktrace/easy/pink.h>
+
+static pid_t root;
+static bool released;
+static unsigned startups, teardowns, exits, late_calls;
+
+static long tracer_pid(void)
+{
+	long tracer = -1;
+	char line[128];
+	FILE *f;
+
+	f = fopen("/proc/self/status", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "TracerPid: %ld", &tracer) == 1)
+			break;
+	fclose(f);
+	return tracer;
+}
+
+static void cb_startup(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		pink_easy_process_t *parent)
+{
+	if (parent == NULL)
+		root = pink_easy_process_get_pid(current);
+	++startups;
+}
+
+static void cb_teardown(const pink_easy_context_t *ctx, const pink_easy_process_t *current)
+{
+	++teardowns;
+}
+
+static int cb_exit(const pink_easy_context_t *ctx, pid_t pid, int status)
+{
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "%s:%d: pid:%d status:%#x\n", __func__, __LINE__, pid, status);
+		abort();
+	}
+	++exits;
+	return 0;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool entering)
+{
+	long scno;
+	pink_easy_release_t *how = pink_easy_context_get_userdata(ctx);
+
+	if (released) {
+		++late_calls;
+		return 0;
+	}
+	if (entering)
+		return 0;
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+				pink_easy_process_get_bitness(current), &scno)) {
+		fprintf(stderr, "%s:%d: get_syscall (errno:%d %s)\n",
+				__func__, __LINE__, errno, strerror(errno));
+		abort();
+	}
+	if (scno != pink_name_lookup("getppid", pink_easy_process_get_bitness(current)))
+		return 0;
+
+	released = true;
+	return *how == PINK_EASY_RELEASE_DETACH ? PINK_EASY_CFLAG_DETACH : PINK_EASY_CFLAG_QUIET;
+}
+
+static int child(void *data)
+{
+	pid_t pid;
+	int status;
+	bool traced = *(pink_easy_release_t *)data == PINK_EASY_RELEASE_QUIET;
+
+	getppid();
+	for (unsigned i = 0; i < 16; i++)
+		getpid();
+	if ((tracer_pid() != 0) != traced)
+		return 1;
+
+	pid = fork();
+	if (pid < 0)
+		return 1;
+	if (pid == 0)
+		_exit((tracer_pid() != 0) != traced);
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+		return 1;
+	return WEXITSTATUS(status);
+}
+
+static void run(pink_easy_release_t how)
+{
+	int status;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	root = 0;
+	released = false;
+	startups = teardowns = exits = late_calls = 0;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.startup = cb_startup;
+	tbl.teardown = cb_teardown;
+	tbl.syscall = cb_syscall;
+	tbl.exit = cb_exit;
+
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD | PINK_TRACE_OPTION_FORK
+			| PINK_TRACE_OPTION_VFORK | PINK_TRACE_OPTION_CLONE,
+			&tbl, &how, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, child, &how)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (!released || late_calls) {
+		fprintf(stderr, "%s:%d: how:%d late calls:%u\n",
+				__func__, __LINE__, how, late_calls);
+		abort();
+	}
+
+	if (how == PINK_EASY_RELEASE_DETACH) {
+		/* The program runs untraced and is still our child */
+		if (startups != 1 || teardowns != 1 || exits != 0) {
+			fprintf(stderr, "%s:%d: startups:%u teardowns:%u exits:%u\n",
+					__func__, __LINE__, startups, teardowns, exits);
+			abort();
+		}
+		if (waitpid(root, &status, 0) < 0 || !WIFEXITED(status)
+				|| WEXITSTATUS(status) != 0) {
+			fprintf(stderr, "%s:%d: status:%#x\n", __func__, __LINE__, status);
+			abort();
+		}
+	} else if (startups != 2 || exits != 2) {
+		/* Forks and exits are still followed */
+		fprintf(stderr, "%s:%d: startups:%u exits:%u\n",
+				__func__, __LINE__, startups, exits);
+		abort();
+	}
+
+	pink_easy_context_destroy(ctx);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	run(PINK_EASY_RELEASE_DETACH);
+	run(PINK_EASY_RELEASE_QUIET);
+	return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+#define NTHREADS	4
+#define NRECORDS	20000
+
+static const char *trace_path = "t24-recorder.trace";
+static pink_easy_recorder_t *recorder;
+static pid_t traced;
+
+/* Appends records with a sequence number and a payload of varying length,
+ * the ring is small enough for the writer thread to fall behind */
+static void *producer(void *data)
+{
+	long n = (long)data;
+	long args[2];
+	char payload[64];
+
+	for (long i = 0; i < NRECORDS; i++) {
+		args[0] = i;
+		args[1] = -i;
+		memset(payload, 'a' + n, sizeof(payload));
+		if (!pink_easy_recorder_append(recorder, n, PINKTRACE_BITNESS_DEFAULT, 39,
+					i & 1 ? PINK_EASY_RECORD_EXIT : 0, i,
+					args, 2, payload, i % sizeof(payload))) {
+			fprintf(stderr, "%s:%d: append (errno:%d %s)\n", __func__, __LINE__,
+					errno, strerror(errno));
+			abort();
+		}
+	}
+	return NULL;
+}
+
+static void check_threads(void)
+{
+	long next[NTHREADS];
+	const unsigned char *p;
+	const pink_easy_record_t *record;
+	pink_easy_record_reader_t *reader;
+
+	reader = pink_easy_record_reader_open(trace_path);
+	if (!reader) {
+		fprintf(stderr, "%s:%d: open (errno:%d %s)\n", __func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+
+	memset(next, 0, sizeof(next));
+	while ((record = pink_easy_record_reader_next(reader))) {
+		long i, n = record->pid;
+
+		if (n < 0 || n >= NTHREADS) {
+			fprintf(stderr, "%s:%d: pid:%ld\n", __func__, __LINE__, n);
+			abort();
+		}
+		i = next[n]++;
+		if (record->nargs != 2
+				|| (long)record->args[0] != i
+				|| (long)record->args[1] != -i
+				|| record->scno != 39
+				|| (record->flags & PINK_EASY_RECORD_EXIT) != (i & 1 ? PINK_EASY_RECORD_EXIT : 0)
+				|| record->retval != (i & 1 ? i : 0)
+				|| pink_easy_record_get_bitness(record) != PINKTRACE_BITNESS_DEFAULT
+				|| record->payload_len != i % 64) {
+			fprintf(stderr, "%s:%d: record %ld of thread %ld\n", __func__, __LINE__,
+					i, n);
+			abort();
+		}
+		p = pink_easy_record_get_payload(record);
+		for (unsigned j = 0; j < record->payload_len; j++) {
+			if (p[j] != 'a' + n) {
+				fprintf(stderr, "%s:%d: payload of record %ld of thread %ld\n",
+						__func__, __LINE__, i, n);
+				abort();
+			}
+		}
+	}
+	if (errno) {
+		fprintf(stderr, "%s:%d: corrupt\n", __func__, __LINE__);
+		abort();
+	}
+	for (int n = 0; n < NTHREADS; n++) {
+		if (next[n] != NRECORDS) {
+			fprintf(stderr, "%s:%d: thread %d records:%ld\n", __func__, __LINE__,
+					n, next[n]);
+			abort();
+		}
+	}
+	pink_easy_record_reader_close(reader);
+}
+
+static void test_threads(void)
+{
+	pthread_t threads[NTHREADS];
+
+	recorder = pink_easy_recorder_new(trace_path, 4096);
+	if (!recorder) {
+		perror("pink_easy_recorder_new");
+		abort();
+	}
+	for (long n = 0; n < NTHREADS; n++)
+		pthread_create(&threads[n], NULL, producer, (void *)n);
+	for (int n = 0; n < NTHREADS; n++)
+		pthread_join(threads[n], NULL);
+	if (!pink_easy_recorder_flush(recorder)) {
+		perror("pink_easy_recorder_flush");
+		abort();
+	}
+	if (!pink_easy_recorder_destroy(recorder)) {
+		perror("pink_easy_recorder_destroy");
+		abort();
+	}
+	check_threads();
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool entering)
+{
+	traced = pink_easy_process_get_pid(current);
+	if (!pink_easy_recorder_syscall(recorder, current, entering,
+				entering ? NULL : "mark", entering ? 0 : 4)) {
+		fprintf(stderr, "%s:%d: record (errno:%d %s)\n", __func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	return 0;
+}
+
+static int child(void *data)
+{
+	/* The arguments are ignored, but recorded */
+	syscall(SYS_getppid, 11, 12, 13, 14, 15, 16);
+	return 0;
+}
+
+static void test_syscalls(void)
+{
+	unsigned entries, exits;
+	long getppid_scno;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	const pink_easy_record_t *record;
+	pink_easy_record_reader_t *reader;
+
+	recorder = pink_easy_recorder_new(trace_path, 0);
+	if (!recorder) {
+		perror("pink_easy_recorder_new");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.syscall = cb_syscall;
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+	if (!pink_easy_recorder_destroy(recorder)) {
+		perror("pink_easy_recorder_destroy");
+		abort();
+	}
+
+	reader = pink_easy_record_reader_open(trace_path);
+	if (!reader) {
+		perror("pink_easy_record_reader_open");
+		abort();
+	}
+	if (memcmp(pink_easy_record_reader_get_header(reader)->magic,
+				PINK_EASY_RECORD_MAGIC, sizeof(PINK_EASY_RECORD_MAGIC))) {
+		fprintf(stderr, "%s:%d: magic\n", __func__, __LINE__);
+		abort();
+	}
+	getppid_scno = pink_name_lookup("getppid", PINKTRACE_BITNESS_DEFAULT);
+	entries = exits = 0;
+	while ((record = pink_easy_record_reader_next(reader))) {
+		if (record->pid != traced || record->scno != getppid_scno)
+			continue;
+		if (!(record->flags & PINK_EASY_RECORD_EXIT)) {
+			entries++;
+			for (unsigned i = 0; i < PINK_MAX_ARGS; i++) {
+				if (record->nargs != PINK_MAX_ARGS || (long)record->args[i] != 11 + (long)i) {
+					fprintf(stderr, "%s:%d: getppid entry nargs:%u args[%u]:%ld\n",
+							__func__, __LINE__, record->nargs, i,
+							(long)record->args[i]);
+					abort();
+				}
+			}
+			continue;
+		}
+		exits++;
+		if (record->retval != getpid()
+				|| record->payload_len != 4
+				|| memcmp(pink_easy_record_get_payload(record), "mark", 4)) {
+			fprintf(stderr, "%s:%d: getppid exit\n", __func__, __LINE__);
+			abort();
+		}
+	}
+	if (errno || entries != 1 || exits != 1) {
+		fprintf(stderr, "%s:%d: entries:%u exits:%u (errno:%d)\n",
+				__func__, __LINE__, entries, exits, errno);
+		abort();
+	}
+	pink_easy_record_reader_close(reader);
+}
+
+int
+main(void)
+{
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	test_threads();
+	test_syscalls();
+
+	unlink(trace_path);
+	return 0;
+}
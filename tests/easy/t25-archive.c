@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pinktrace/easy/pink.h>
+
+#define NEVENTS		1000
+#define BLOCK_EVENTS	100
+
+static const char *archive_path = "t25-archive.archive";
+static const char *strings[] = { "/etc/passwd", "/tmp", "", "/usr/lib/libc.so.6" };
+
+/* Event i, process IDs change every block so the index tells them apart */
+static void make_event(unsigned i, pink_easy_archive_event_t *event)
+{
+	event->time = 1000000000ULL + i * 1000ULL + (i % 7);
+	event->pid = 1000 + i / BLOCK_EVENTS;
+	event->scno = i % 3 ? 2 : 257;
+	event->retval = i % 5 ? (long)i : -13;
+	event->string = i % 4 == 3 ? NULL : strings[i % 4];
+}
+
+struct check {
+	unsigned next;
+	unsigned step;
+	unsigned count;
+	unsigned limit;
+};
+
+static bool check_event(const pink_easy_archive_event_t *event, void *data)
+{
+	struct check *c = data;
+	pink_easy_archive_event_t expected;
+
+	make_event(c->next, &expected);
+	if (event->time != expected.time
+			|| event->pid != expected.pid
+			|| event->scno != expected.scno
+			|| event->retval != expected.retval
+			|| (!event->string) != (!expected.string)
+			|| (event->string && strcmp(event->string, expected.string))) {
+		fprintf(stderr, "%s:%d: event %u\n", __func__, __LINE__, c->next);
+		abort();
+	}
+	c->next += c->step;
+	c->count++;
+	return c->count != c->limit;
+}
+
+static void query(pink_easy_archive_t *archive, const pink_easy_archive_filter_t *filter,
+		unsigned first, unsigned step, unsigned limit,
+		unsigned count, unsigned decoded)
+{
+	struct check c;
+
+	c.next = first;
+	c.step = step;
+	c.count = 0;
+	c.limit = limit;
+	if (!pink_easy_archive_query(archive, filter, check_event, &c)) {
+		fprintf(stderr, "%s:%d: query (errno:%d %s)\n", __func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	if (c.count != count || pink_easy_archive_get_blocks_decoded(archive) != decoded) {
+		fprintf(stderr, "%s:%d: count:%u expected:%u decoded:%u expected:%u\n",
+				__func__, __LINE__, c.count, count,
+				pink_easy_archive_get_blocks_decoded(archive), decoded);
+		abort();
+	}
+}
+
+int
+main(void)
+{
+	unsigned i;
+	pink_easy_archive_event_t event;
+	pink_easy_archive_filter_t filter;
+	pink_easy_archive_writer_t *writer;
+	pink_easy_archive_t *archive;
+	pink_easy_record_t *record;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	writer = pink_easy_archive_writer_new(archive_path, BLOCK_EVENTS);
+	if (!writer) {
+		perror("pink_easy_archive_writer_new");
+		abort();
+	}
+	for (i = 0; i < NEVENTS; i++) {
+		make_event(i, &event);
+		if (!pink_easy_archive_writer_add(writer, &event)) {
+			perror("pink_easy_archive_writer_add");
+			abort();
+		}
+	}
+
+	/* Records of system call entries are skipped */
+	record = calloc(1, sizeof(pink_easy_record_t) + sizeof(uint64_t));
+	record->nargs = 1;
+	record->scno = 2;
+	if (!pink_easy_archive_writer_add_record(writer, record)) {
+		perror("pink_easy_archive_writer_add_record");
+		abort();
+	}
+	free(record);
+
+	if (!pink_easy_archive_writer_close(writer)) {
+		perror("pink_easy_archive_writer_close");
+		abort();
+	}
+
+	archive = pink_easy_archive_open(archive_path);
+	if (!archive) {
+		perror("pink_easy_archive_open");
+		abort();
+	}
+	if (pink_easy_archive_get_blocks(archive) != NEVENTS / BLOCK_EVENTS) {
+		fprintf(stderr, "%s:%d: blocks:%u\n", __func__, __LINE__,
+				pink_easy_archive_get_blocks(archive));
+		abort();
+	}
+
+	/* Everything */
+	query(archive, NULL, 0, 1, 0, NEVENTS, NEVENTS / BLOCK_EVENTS);
+
+	/* One process, the other blocks are skipped */
+	filter.pid = 1003;
+	filter.scno = -1;
+	filter.time_min = 0;
+	filter.time_max = UINT64_MAX;
+	query(archive, &filter, 300, 1, 0, BLOCK_EVENTS, 1);
+
+	/* One system call of one process */
+	filter.scno = 257;
+	query(archive, &filter, 300, 3, 0, 34, 1);
+
+	/* A time range spanning two blocks */
+	filter.pid = 0;
+	filter.scno = -1;
+	filter.time_min = 1000000000ULL + 150 * 1000ULL;
+	filter.time_max = 1000000000ULL + 249 * 1000ULL + 6;
+	query(archive, &filter, 150, 1, 0, 100, 2);
+
+	/* A process which doesn't exist */
+	filter.pid = 4242;
+	filter.time_min = 0;
+	filter.time_max = UINT64_MAX;
+	query(archive, &filter, 0, 1, 0, 0, 0);
+
+	/* The callback stops the query */
+	query(archive, NULL, 0, 1, 150, 150, 2);
+
+	pink_easy_archive_close(archive);
+
+	/* Not an archive */
+	if (pink_easy_archive_open("/dev/null") || errno != EINVAL) {
+		fprintf(stderr, "%s:%d: open /dev/null\n", __func__, __LINE__);
+		abort();
+	}
+
+	unlink(archive_path);
+	return 0;
+}
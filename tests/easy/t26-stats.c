@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pinktrace/easy/pink.h>
+
+static int child(void *data)
+{
+	for (int i = 0; i < 10; i++)
+		getppid();
+	for (int i = 0; i < 3; i++)
+		close(-1);
+	return 0;
+}
+
+static void trace(pink_easy_stats_t *stats)
+{
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	pink_easy_context_set_stats(ctx, stats);
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+}
+
+static const pink_easy_stats_entry_t *find(const pink_easy_stats_entry_t *entries,
+		size_t count, const char *name)
+{
+	long scno = pink_name_lookup(name, PINKTRACE_BITNESS_DEFAULT);
+
+	for (size_t i = 0; i < count; i++)
+		if (entries[i].bitness == PINKTRACE_BITNESS_DEFAULT && entries[i].scno == scno)
+			return &entries[i];
+	return NULL;
+}
+
+static void check(pink_easy_stats_t *stats)
+{
+	size_t count;
+	uint64_t sum;
+	pink_easy_stats_entry_t *entries;
+	const pink_easy_stats_entry_t *e;
+
+	if (!pink_easy_stats_snapshot(stats, &entries, &count)) {
+		perror("pink_easy_stats_snapshot");
+		abort();
+	}
+
+	e = find(entries, count, "getppid");
+	if (!e || e->calls != 10 || e->errors != 0 || !e->time) {
+		fprintf(stderr, "%s:%d: getppid calls:%llu errors:%llu\n", __func__, __LINE__,
+				e ? (unsigned long long)e->calls : 0,
+				e ? (unsigned long long)e->errors : 0);
+		abort();
+	}
+	sum = 0;
+	for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++)
+		sum += e->buckets[i];
+	if (sum != e->calls) {
+		fprintf(stderr, "%s:%d: buckets:%llu\n", __func__, __LINE__,
+				(unsigned long long)sum);
+		abort();
+	}
+
+	e = find(entries, count, "close");
+	if (!e || e->calls < 3 || e->errors < 3) {
+		fprintf(stderr, "%s:%d: close\n", __func__, __LINE__);
+		abort();
+	}
+	free(entries);
+}
+
+int
+main(void)
+{
+	size_t count;
+	pink_easy_stats_t *stats;
+	pink_easy_stats_entry_t *entries;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	for (unsigned i = 1; i < PINK_EASY_STATS_BUCKETS; i++) {
+		if (pink_easy_stats_bucket_min(i) <= pink_easy_stats_bucket_min(i - 1)) {
+			fprintf(stderr, "%s:%d: bucket %u\n", __func__, __LINE__, i);
+			abort();
+		}
+	}
+
+	stats = pink_easy_stats_new();
+	if (!stats) {
+		perror("pink_easy_stats_new");
+		abort();
+	}
+
+	trace(stats);
+	check(stats);
+
+	/* Nothing happened since the reset */
+	pink_easy_stats_reset(stats);
+	if (!pink_easy_stats_snapshot(stats, &entries, &count) || count) {
+		fprintf(stderr, "%s:%d: count:%zu\n", __func__, __LINE__, count);
+		abort();
+	}
+	free(entries);
+
+	/* Counts start over */
+	trace(stats);
+	check(stats);
+
+	pink_easy_stats_free(stats);
+	return 0;
+}
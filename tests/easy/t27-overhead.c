@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <pinktrace/easy/pink.h>
+
+/* How long the decision about getpid is pending */
+#define PARK_NS 50000000ULL
+
+static unsigned marks;
+
+static void check_overhead(const pink_easy_overhead_t *o, uint64_t min_stops, const char *what)
+{
+	uint64_t sum = 0;
+
+	for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++)
+		sum += o->buckets[i];
+	if (o->stops < min_stops || sum != o->stops || !o->stop_time
+			|| o->callback_time > o->stop_time
+			|| !o->ptrace.regs_calls || !o->ptrace.ctl_calls) {
+		fprintf(stderr, "%s: stops:%llu buckets:%llu stop_time:%llu callback_time:%llu"
+				" regs:%lu ctl:%lu\n", what,
+				(unsigned long long)o->stops, (unsigned long long)sum,
+				(unsigned long long)o->stop_time,
+				(unsigned long long)o->callback_time,
+				o->ptrace.regs_calls, o->ptrace.ctl_calls);
+		abort();
+	}
+}
+
+static void *worker(void *data)
+{
+	struct timespec ts = { 0, PARK_NS };
+
+	nanosleep(&ts, NULL);
+	if (!pink_easy_process_complete(data, PINK_EASY_POLICY_ALLOW, 0)) {
+		perror("pink_easy_process_complete");
+		abort();
+	}
+	return NULL;
+}
+
+static int cb_syscall(const pink_easy_context_t *ctx, pink_easy_process_t *current,
+		bool entering)
+{
+	long scno;
+	pthread_t thread;
+	pink_easy_overhead_t o;
+
+	if (!pink_util_get_syscall(pink_easy_process_get_pid(current),
+				pink_easy_process_get_bitness(current), &scno)) {
+		fprintf(stderr, "%s:%d: get_syscall (errno:%d %s)\n",
+				__func__, __LINE__, errno, strerror(errno));
+		abort();
+	}
+	/* The stop lasts until the worker completes the decision */
+	if (entering && scno == pink_name_lookup("getpid", pink_easy_process_get_bitness(current))) {
+		if (pthread_create(&thread, NULL, worker, current) != 0) {
+			perror("pthread_create");
+			abort();
+		}
+		pthread_detach(thread);
+		return PINK_EASY_CFLAG_PENDING;
+	}
+	if (entering || scno != pink_name_lookup("getppid", pink_easy_process_get_bitness(current)))
+		return 0;
+
+	/* Stops of the process so far, this one is accounted on resume */
+	if (++marks == 5) {
+		if (!pink_easy_process_get_overhead(current, PINK_EASY_STOP_SYSCALL_EXIT, &o)) {
+			perror("pink_easy_process_get_overhead");
+			abort();
+		}
+		check_overhead(&o, 4, "process");
+	}
+	return 0;
+}
+
+static int child(void *data)
+{
+	for (int i = 0; i < 5; i++)
+		getppid();
+	syscall(SYS_getpid);
+	return 0;
+}
+
+int
+main(void)
+{
+	size_t count;
+	long getppid_scno, getpid_scno;
+	pink_easy_error_t error;
+	pink_easy_overhead_t o;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_stats_t *stats;
+	pink_easy_stats_entry_t *entries;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	tbl.syscall = cb_syscall;
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	stats = pink_easy_stats_new();
+	if (!ctx || !stats) {
+		perror("new");
+		abort();
+	}
+	pink_easy_context_set_overhead(ctx, true);
+	pink_easy_context_set_stats(ctx, stats);
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	if (marks != 5) {
+		fprintf(stderr, "%s:%d: marks:%u\n", __func__, __LINE__, marks);
+		abort();
+	}
+	if (pink_trace_get_account()) {
+		fprintf(stderr, "%s:%d: account left set\n", __func__, __LINE__);
+		abort();
+	}
+
+	/* Totals of the context, the process is gone */
+	pink_easy_context_get_overhead(ctx, PINK_EASY_STOP_SYSCALL_ENTRY, &o);
+	check_overhead(&o, 6, "entry");
+	if (o.stop_time < PARK_NS) {
+		fprintf(stderr, "%s:%d: entry stop_time:%llu without the parked time\n",
+				__func__, __LINE__, (unsigned long long)o.stop_time);
+		abort();
+	}
+	pink_easy_context_get_overhead(ctx, PINK_EASY_STOP_SYSCALL_EXIT, &o);
+	check_overhead(&o, 5, "exit");
+	if (pink_easy_context_get_overhead(ctx, PINK_EASY_STOP_MAX, &o) || errno != EINVAL) {
+		fprintf(stderr, "%s:%d: invalid stop\n", __func__, __LINE__);
+		abort();
+	}
+
+	/* Per system call, in the statistics */
+	if (!pink_easy_stats_snapshot(stats, &entries, &count)) {
+		perror("pink_easy_stats_snapshot");
+		abort();
+	}
+	getppid_scno = pink_name_lookup("getppid", PINKTRACE_BITNESS_DEFAULT);
+	getpid_scno = pink_name_lookup("getpid", PINKTRACE_BITNESS_DEFAULT);
+	for (size_t i = 0; i < count; i++) {
+		if (entries[i].bitness != PINKTRACE_BITNESS_DEFAULT)
+			continue;
+		if (entries[i].scno == getpid_scno) {
+			if (entries[i].stop_time < PARK_NS) {
+				fprintf(stderr, "%s:%d: getpid stop_time:%llu\n",
+						__func__, __LINE__,
+						(unsigned long long)entries[i].stop_time);
+				abort();
+			}
+			getpid_scno = -1;
+			continue;
+		}
+		if (entries[i].scno != getppid_scno)
+			continue;
+		if (entries[i].calls != 5 || !entries[i].stop_time) {
+			fprintf(stderr, "%s:%d: getppid calls:%llu stop_time:%llu\n",
+					__func__, __LINE__,
+					(unsigned long long)entries[i].calls,
+					(unsigned long long)entries[i].stop_time);
+			abort();
+		}
+		getppid_scno = -1;
+	}
+	if (getppid_scno != -1 || getpid_scno != -1) {
+		fprintf(stderr, "%s:%d: getppid or getpid missing\n", __func__, __LINE__);
+		abort();
+	}
+	free(entries);
+
+	pink_easy_context_destroy(ctx);
+	pink_easy_stats_free(stats);
+	return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <pinktrace/easy/pink.h>
+
+#define SEGMENT "t28-monitor.seg"
+
+static volatile bool done;
+static unsigned long reads;
+
+static int child(void *data)
+{
+	for (int i = 0; i < 10; i++)
+		getppid();
+	return 0;
+}
+
+static uint64_t sum(const uint64_t *counts, unsigned n)
+{
+	uint64_t s = 0;
+
+	for (unsigned i = 0; i < n; i++)
+		s += counts[i];
+	return s;
+}
+
+/* Every snapshot counts each stop once in the histogram */
+static void check_consistent(const pink_easy_monitor_segment_t *segment)
+{
+	uint64_t stops, buckets;
+
+	stops = sum(segment->stops, PINK_EASY_STOP_MAX);
+	buckets = sum(segment->stop_buckets, PINK_EASY_STATS_BUCKETS);
+	if (stops != buckets || segment->seq & 1) {
+		fprintf(stderr, "%s:%d: seq:%llu stops:%llu buckets:%llu\n",
+				__func__, __LINE__,
+				(unsigned long long)segment->seq,
+				(unsigned long long)stops,
+				(unsigned long long)buckets);
+		abort();
+	}
+}
+
+static void *reader(void *data)
+{
+	pink_easy_monitor_t *monitor = data;
+	pink_easy_monitor_segment_t segment;
+
+	while (!done) {
+		if (pink_easy_monitor_read(monitor, &segment)) {
+			check_consistent(&segment);
+			reads++;
+		}
+	}
+	return NULL;
+}
+
+int
+main(void)
+{
+	long scno;
+	pthread_t thread;
+	pink_easy_error_t error;
+	pink_easy_callback_table_t tbl;
+	pink_easy_context_t *ctx;
+	pink_easy_monitor_t *monitor;
+	pink_easy_monitor_segment_t segment;
+
+	if (!pink_easy_init()) {
+		perror("pink_easy_init");
+		abort();
+	}
+
+	memset(&tbl, 0, sizeof(pink_easy_callback_table_t));
+	ctx = pink_easy_context_new(PINK_TRACE_OPTION_SYSGOOD, &tbl, NULL, NULL);
+	if (!ctx) {
+		perror("pink_easy_context_new");
+		abort();
+	}
+	if (!pink_easy_context_set_monitor(ctx, SEGMENT)) {
+		perror("pink_easy_context_set_monitor");
+		abort();
+	}
+
+	/* Not a segment */
+	if (pink_easy_monitor_open("Makefile") || errno != EINVAL) {
+		fprintf(stderr, "%s:%d: errno:%d\n", __func__, __LINE__, errno);
+		abort();
+	}
+
+	monitor = pink_easy_monitor_open(SEGMENT);
+	if (!monitor) {
+		perror("pink_easy_monitor_open");
+		abort();
+	}
+	if (pthread_create(&thread, NULL, reader, monitor)) {
+		perror("pthread_create");
+		abort();
+	}
+
+	if (!pink_easy_call(ctx, child, NULL)) {
+		fprintf(stderr, "%s:%d: pink_easy_call failed (errno:%d %s)\n",
+				__func__, __LINE__,
+				errno, strerror(errno));
+		abort();
+	}
+	pink_easy_loop(ctx);
+	error = pink_easy_context_get_error(ctx);
+	if (error != PINK_EASY_ERROR_SUCCESS) {
+		fprintf(stderr, "%s:%d: %i (%s)\n",
+				__func__, __LINE__,
+				error, pink_easy_strerror(error));
+		abort();
+	}
+	pink_easy_context_destroy(ctx);
+
+	done = true;
+	pthread_join(thread, NULL);
+
+	/* The segment outlives the context */
+	if (!pink_easy_monitor_read(monitor, &segment)) {
+		perror("pink_easy_monitor_read");
+		abort();
+	}
+	check_consistent(&segment);
+	scno = pink_name_lookup("getppid", PINKTRACE_BITNESS_DEFAULT);
+	if (segment.tracer != getpid() || segment.tracees != 0
+			|| segment.syscalls[PINKTRACE_BITNESS_DEFAULT][scno] != 10
+			|| segment.stops[PINK_EASY_STOP_SYSCALL_ENTRY] < 10
+			|| segment.stops[PINK_EASY_STOP_SYSCALL_EXIT] < 10
+			|| segment.time < segment.start) {
+		fprintf(stderr, "%s:%d: tracer:%d tracees:%u getppid:%llu entry:%llu exit:%llu\n",
+				__func__, __LINE__,
+				segment.tracer, segment.tracees,
+				(unsigned long long)segment.syscalls[PINKTRACE_BITNESS_DEFAULT][scno],
+				(unsigned long long)segment.stops[PINK_EASY_STOP_SYSCALL_ENTRY],
+				(unsigned long long)segment.stops[PINK_EASY_STOP_SYSCALL_EXIT]);
+		abort();
+	}
+
+	pink_easy_monitor_close(monitor);
+	unlink(SEGMENT);
+	return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pink-archive: pack traces of pinktrace-easy's recorder into archives and
+ * query them
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+static void usage(FILE *f)
+{
+	fprintf(f, "Usage: pink-archive pack TRACE ARCHIVE\n"
+			"       pink-archive query [-v] [-p pid] [-s syscall] [-a from] [-b to] ARCHIVE\n"
+			"Pack a trace written by pink_easy_recorder_new() into an archive,\n"
+			"or print the events of an archive matching the given criteria.\n"
+			"Times are in nanoseconds since the trace started.\n");
+}
+
+static int pack(const char *trace, const char *path)
+{
+	const pink_easy_record_t *record;
+	pink_easy_record_reader_t *reader;
+	pink_easy_archive_writer_t *writer;
+
+	reader = pink_easy_record_reader_open(trace);
+	if (!reader) {
+		fprintf(stderr, "pink-archive: %s: %s\n", trace,
+				errno == EINVAL ? "not a trace file" : strerror(errno));
+		return EXIT_FAILURE;
+	}
+	writer = pink_easy_archive_writer_new(path, 0);
+	if (!writer) {
+		fprintf(stderr, "pink-archive: %s: %s\n", path, strerror(errno));
+		pink_easy_record_reader_close(reader);
+		return EXIT_FAILURE;
+	}
+
+	while ((record = pink_easy_record_reader_next(reader))) {
+		if (!pink_easy_archive_writer_add_record(writer, record)) {
+			fprintf(stderr, "pink-archive: %s: %s\n", path, strerror(errno));
+			goto fail;
+		}
+	}
+	if (errno) {
+		fprintf(stderr, "pink-archive: %s: corrupt or truncated record\n", trace);
+		goto fail;
+	}
+
+	pink_easy_record_reader_close(reader);
+	if (!pink_easy_archive_writer_close(writer)) {
+		fprintf(stderr, "pink-archive: %s: %s\n", path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+
+fail:
+	pink_easy_archive_writer_close(writer);
+	pink_easy_record_reader_close(reader);
+	unlink(path);
+	return EXIT_FAILURE;
+}
+
+static bool print_event(const pink_easy_archive_event_t *event, void *data)
+{
+	const char *name;
+
+	name = pink_name_syscall(event->scno, PINKTRACE_BITNESS_DEFAULT);
+	printf("%llu.%09llu %d ",
+			(unsigned long long)(event->time / 1000000000ULL),
+			(unsigned long long)(event->time % 1000000000ULL),
+			event->pid);
+	if (name)
+		fputs(name, stdout);
+	else
+		printf("syscall_%ld", event->scno);
+	printf(" = %ld", event->retval);
+	if (event->string)
+		printf(" \"%s\"", event->string);
+	putchar('\n');
+	return true;
+}
+
+static int query(int argc, char **argv)
+{
+	int c;
+	bool verbose;
+	pink_easy_archive_filter_t filter;
+	pink_easy_archive_t *archive;
+
+	verbose = false;
+	filter.pid = 0;
+	filter.scno = -1;
+	filter.time_min = 0;
+	filter.time_max = UINT64_MAX;
+	while ((c = getopt(argc, argv, "vp:s:a:b:")) != -1) {
+		switch (c) {
+		case 'v':
+			verbose = true;
+			break;
+		case 'p':
+			filter.pid = atoi(optarg);
+			break;
+		case 's':
+			filter.scno = pink_name_lookup(optarg, PINKTRACE_BITNESS_DEFAULT);
+			if (filter.scno < 0)
+				filter.scno = atol(optarg);
+			break;
+		case 'a':
+			filter.time_min = strtoull(optarg, NULL, 10);
+			break;
+		case 'b':
+			filter.time_max = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	archive = pink_easy_archive_open(argv[optind]);
+	if (!archive) {
+		fprintf(stderr, "pink-archive: %s: %s\n", argv[optind],
+				errno == EINVAL ? "not an archive" : strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (!pink_easy_archive_query(archive, &filter, print_event, NULL)) {
+		fprintf(stderr, "pink-archive: %s: corrupt block\n", argv[optind]);
+		pink_easy_archive_close(archive);
+		return EXIT_FAILURE;
+	}
+	if (verbose)
+		fprintf(stderr, "pink-archive: decoded %u of %u blocks\n",
+				pink_easy_archive_get_blocks_decoded(archive),
+				pink_easy_archive_get_blocks(archive));
+	pink_easy_archive_close(archive);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 2 && !strcmp(argv[1], "-h")) {
+		usage(stdout);
+		return EXIT_SUCCESS;
+	}
+	if (argc == 4 && !strcmp(argv[1], "pack"))
+		return pack(argv[2], argv[3]);
+	if (argc >= 3 && !strcmp(argv[1], "query"))
+		return query(argc - 1, argv + 1);
+
+	usage(stderr);
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pink-top: watch the live counters published by a pinktrace-easy tracer
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+/* Number of system calls shown */
+#define TOP_SYSCALLS	10
+
+static const char *stop_names[PINK_EASY_STOP_MAX] = {
+	[PINK_EASY_STOP_SYSCALL_ENTRY] = "entry",
+	[PINK_EASY_STOP_SYSCALL_EXIT] = "exit",
+	[PINK_EASY_STOP_SIGNAL] = "signal",
+	[PINK_EASY_STOP_EVENT] = "event",
+};
+
+static pink_easy_monitor_segment_t snapshots[2];
+
+static void usage(FILE *f)
+{
+	fprintf(f, "Usage: pink-top [-hb] [-d seconds] [-n count] PATH\n"
+			"Watch the counters published by pink_easy_context_set_monitor()\n"
+			"  -b          Batch mode, don't clear the screen\n"
+			"  -d seconds  Delay between updates, defaults to 1\n"
+			"  -n count    Exit after so many updates\n");
+}
+
+static double rate(uint64_t count, uint64_t ns)
+{
+	return ns ? count * 1e9 / ns : 0;
+}
+
+static uint64_t percentile(const uint64_t *buckets, uint64_t total, double p)
+{
+	uint64_t sum = 0;
+
+	if (!total)
+		return 0;
+	for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++) {
+		sum += buckets[i];
+		if (sum >= p * total)
+			return pink_easy_stats_bucket_min(i);
+	}
+	return pink_easy_stats_bucket_min(PINK_EASY_STATS_BUCKETS - 1);
+}
+
+static void print_syscalls(const pink_easy_monitor_segment_t *old,
+		const pink_easy_monitor_segment_t *new, uint64_t ns)
+{
+	unsigned n = 0;
+	unsigned top[TOP_SYSCALLS][2];
+	uint64_t count, delta[TOP_SYSCALLS];
+	const char *name;
+
+	for (unsigned b = 0; b < 2; b++) {
+		for (unsigned s = 0; s < PINK_EASY_MONITOR_SYSCALLS; s++) {
+			count = new->syscalls[b][s] - old->syscalls[b][s];
+			if (!count)
+				continue;
+			unsigned i = n < TOP_SYSCALLS ? n++ : TOP_SYSCALLS;
+			if (i == TOP_SYSCALLS) {
+				if (count <= delta[TOP_SYSCALLS - 1])
+					continue;
+				i = TOP_SYSCALLS - 1;
+			}
+			for (; i > 0 && delta[i - 1] < count; i--) {
+				delta[i] = delta[i - 1];
+				top[i][0] = top[i - 1][0];
+				top[i][1] = top[i - 1][1];
+			}
+			delta[i] = count;
+			top[i][0] = b;
+			top[i][1] = s;
+		}
+	}
+
+	printf("\n%-24s %6s %12s %14s\n", "SYSCALL", "BITS", "CALLS/S", "TOTAL");
+	for (unsigned i = 0; i < n; i++) {
+		name = pink_name_syscall(top[i][1], top[i][0]);
+		if (name)
+			printf("%-24s", name);
+		else
+			printf("syscall_%-16u", top[i][1]);
+		printf(" %6s %12.0f %14llu\n", top[i][0] == PINK_BITNESS_32 ? "32" : "64",
+				rate(delta[i], ns),
+				(unsigned long long)new->syscalls[top[i][0]][top[i][1]]);
+	}
+}
+
+static void print_update(const pink_easy_monitor_segment_t *old,
+		const pink_easy_monitor_segment_t *new, bool batch)
+{
+	uint64_t ns, stops = 0;
+	uint64_t buckets[PINK_EASY_STATS_BUCKETS];
+
+	ns = new->time - old->time;
+	for (unsigned i = 0; i < PINK_EASY_STATS_BUCKETS; i++) {
+		buckets[i] = new->stop_buckets[i] - old->stop_buckets[i];
+		stops += buckets[i];
+	}
+
+	if (!batch)
+		fputs("\033[H\033[2J", stdout);
+	printf("tracer %d, %u tracees, up %.1fs",
+			new->tracer, new->tracees, (new->time - new->start) / 1e9);
+	if (new->memory)
+		printf(", heap %.1f MiB", new->memory / (1024.0 * 1024.0));
+	putchar('\n');
+
+	printf("stops/s:");
+	for (unsigned i = 0; i < PINK_EASY_STOP_MAX; i++)
+		printf(" %s %.0f", stop_names[i], rate(new->stops[i] - old->stops[i], ns));
+	putchar('\n');
+
+	printf("stop time: p50 %lluns p90 %lluns p99 %lluns\n",
+			(unsigned long long)percentile(buckets, stops, 0.50),
+			(unsigned long long)percentile(buckets, stops, 0.90),
+			(unsigned long long)percentile(buckets, stops, 0.99));
+
+	print_syscalls(old, new, ns);
+	if (batch)
+		putchar('\n');
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	bool batch = false;
+	unsigned long count = 0;
+	double delay = 1;
+	char *end;
+	struct timespec ts;
+	pink_easy_monitor_t *monitor;
+
+	while ((opt = getopt(argc, argv, "hbd:n:")) != -1) {
+		switch (opt) {
+		case 'h':
+			usage(stdout);
+			return EXIT_SUCCESS;
+		case 'b':
+			batch = true;
+			break;
+		case 'd':
+			delay = strtod(optarg, &end);
+			if (*end || delay <= 0) {
+				fprintf(stderr, "pink-top: invalid delay `%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'n':
+			count = strtoul(optarg, &end, 10);
+			if (*end || !count) {
+				fprintf(stderr, "pink-top: invalid count `%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	monitor = pink_easy_monitor_open(argv[optind]);
+	if (!monitor) {
+		fprintf(stderr, "pink-top: %s: %s\n", argv[optind],
+				errno == EINVAL ? "not a monitor segment" : strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	ts.tv_sec = (time_t)delay;
+	ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+	if (!pink_easy_monitor_read(monitor, &snapshots[0]))
+		goto fail;
+	for (unsigned long i = 0; !count || i < count; i++) {
+		nanosleep(&ts, NULL);
+		if (!pink_easy_monitor_read(monitor, &snapshots[(i + 1) % 2]))
+			goto fail;
+		print_update(&snapshots[i % 2], &snapshots[(i + 1) % 2], batch);
+	}
+
+	pink_easy_monitor_close(monitor);
+	return EXIT_SUCCESS;
+
+fail:
+	fprintf(stderr, "pink-top: %s: %s\n", argv[optind], strerror(errno));
+	pink_easy_monitor_close(monitor);
+	return EXIT_FAILURE;
+}
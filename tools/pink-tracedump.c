@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2010, 2011, 2012 Ali Polatel <alip@exherbo.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pink-tracedump: decode a trace written by pinktrace-easy's recorder
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pinktrace/pink.h>
+#include <pinktrace/easy/pink.h>
+
+static void usage(FILE *f)
+{
+	fprintf(f, "Usage: pink-tracedump [-h] FILE\n"
+			"Decode a trace written by pink_easy_recorder_new()\n");
+}
+
+static void print_payload(const pink_easy_record_t *record)
+{
+	const unsigned char *p;
+
+	p = pink_easy_record_get_payload(record);
+	fputs(" \"", stdout);
+	for (unsigned i = 0; i < record->payload_len; i++) {
+		if (p[i] == '"' || p[i] == '\\')
+			printf("\\%c", p[i]);
+		else if (isprint(p[i]))
+			putchar(p[i]);
+		else
+			printf("\\x%02x", p[i]);
+	}
+	putchar('"');
+}
+
+static void print_record(const pink_easy_record_t *record)
+{
+	const char *name;
+
+	printf("%llu.%09llu %d ",
+			(unsigned long long)(record->time / 1000000000ULL),
+			(unsigned long long)(record->time % 1000000000ULL),
+			record->pid);
+
+	name = pink_name_syscall(record->scno, pink_easy_record_get_bitness(record));
+	if (name)
+		fputs(name, stdout);
+	else
+		printf("syscall_%d", record->scno);
+
+	putchar('(');
+	for (unsigned i = 0; i < record->nargs; i++)
+		printf("%s%#llx", i ? ", " : "", (unsigned long long)record->args[i]);
+	putchar(')');
+
+	if (record->flags & PINK_EASY_RECORD_EXIT)
+		printf(" = %lld", (long long)record->retval);
+	else
+		fputs(" ...", stdout);
+
+	if (record->payload_len)
+		print_payload(record);
+	putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+	const pink_easy_record_t *record;
+	pink_easy_record_reader_t *reader;
+
+	if (argc == 2 && !strcmp(argv[1], "-h")) {
+		usage(stdout);
+		return EXIT_SUCCESS;
+	}
+	if (argc != 2) {
+		usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	reader = pink_easy_record_reader_open(argv[1]);
+	if (!reader) {
+		fprintf(stderr, "pink-tracedump: %s: %s\n", argv[1],
+				errno == EINVAL ? "not a trace file" : strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	while ((record = pink_easy_record_reader_next(reader)))
+		print_record(record);
+	if (errno) {
+		fprintf(stderr, "pink-tracedump: %s: corrupt or truncated record\n", argv[1]);
+		pink_easy_record_reader_close(reader);
+		return EXIT_FAILURE;
+	}
+
+	pink_easy_record_reader_close(reader);
+	return EXIT_SUCCESS;
+}